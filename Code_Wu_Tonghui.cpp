@@ -10,6 +10,41 @@
 #include <cmath>
 #include <cstdlib>
 #include <ctime>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <algorithm>
+#include <sstream>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <queue>
+#include <memory>
+#include <unordered_map>
+#include <atomic>
+#if !defined(COASTER_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define COASTER_MIP_SSE2        // 16-byte mip filtering
+#endif
+#if !defined(COASTER_NO_SIMD) && defined(__AVX__)
+#include <immintrin.h>
+#define COASTER_SPLINE_AVX      // 8-wide spline batches
+#elif !defined(COASTER_NO_SIMD) && (defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1))
+#include <xmmintrin.h>
+#define COASTER_SPLINE_SSE      // 4-wide spline batches
+#endif
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <dlfcn.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 #define _USE_MATH_DEFINES
 
 //=============================================================================
@@ -40,7 +75,114 @@ struct Vec3 {
 };
 
 // Constant for an accurate mathematical representation of    (pi).
+#ifndef M_PI
 const float M_PI = 3.14159265358979323846f;
+#endif
+
+//=============================================================================
+// MEMORY ACCOUNTING
+//=============================================================================
+
+/**
+ * Live and peak bytes per subsystem. The growing containers use TaggedAllocator, which
+ * counts what they hold; texture memory is the registry's estimate from upload sizes.
+ * Every heap allocation in the process is also counted so each frame's allocations can be
+ * reported (a steady-state frame should show zero). Building with DISABLE_PROFILER leaves
+ * the global operator new alone.
+ */
+
+enum MemoryTag {
+    MEMORY_RAIN,
+    MEMORY_TOWER_PARTICLES,   // Drop tower emitters
+    MEMORY_CLOUDS,            // Cloud list and the per-cloud sphere vectors
+    MEMORY_TRACK,             // trackPoints
+    MEMORY_SNAKE,             // snake_body
+    MEMORY_FIREWORKS,         // snake_fireworks
+    MEMORY_TEXTURES,          // GPU estimate, updated each frame
+    MEMORY_TAG_COUNT
+};
+
+const char* MEMORY_TAG_NAMES[MEMORY_TAG_COUNT] = {
+    "rain", "tower particles", "clouds", "track", "snake", "fireworks", "textures (GPU)"
+};
+
+// Containers are only touched by the main thread, so plain counters suffice
+struct MemoryCounters {
+    size_t live = 0;
+    size_t peak = 0;
+    uint64_t allocations = 0;
+};
+MemoryCounters memoryCounters[MEMORY_TAG_COUNT];
+
+void trackAllocation(MemoryTag tag, size_t bytes) {
+    MemoryCounters& counters = memoryCounters[tag];
+    counters.live += bytes;
+    counters.peak = std::max(counters.peak, counters.live);
+    counters.allocations++;
+}
+
+void trackFree(MemoryTag tag, size_t bytes) {
+    memoryCounters[tag].live -= bytes;
+}
+
+// std::allocator that reports to one memory tag
+template <typename T, MemoryTag Tag>
+struct TaggedAllocator {
+    typedef T value_type;
+
+    TaggedAllocator() {}
+    template <typename U> TaggedAllocator(const TaggedAllocator<U, Tag>&) {}
+    template <typename U> struct rebind { typedef TaggedAllocator<U, Tag> other; };
+
+    T* allocate(size_t count) {
+        trackAllocation(Tag, count * sizeof(T));
+        return static_cast<T*>(::operator new(count * sizeof(T)));
+    }
+    void deallocate(T* pointer, size_t count) {
+        trackFree(Tag, count * sizeof(T));
+        ::operator delete(pointer);
+    }
+};
+template <typename T, typename U, MemoryTag Tag>
+bool operator==(const TaggedAllocator<T, Tag>&, const TaggedAllocator<U, Tag>&) { return true; }
+template <typename T, typename U, MemoryTag Tag>
+bool operator!=(const TaggedAllocator<T, Tag>&, const TaggedAllocator<U, Tag>&) { return false; }
+
+template <typename T, MemoryTag Tag>
+using TaggedVector = std::vector<T, TaggedAllocator<T, Tag>>;
+
+// Process-wide heap allocations, from any thread
+std::atomic<uint64_t> heapAllocationCount{ 0 };
+std::atomic<uint64_t> heapAllocationBytes{ 0 };
+
+#ifndef DISABLE_PROFILER
+// Kept out of line so GCC does not pair the inlined free() with the built-in operator new
+#ifdef _MSC_VER
+#define HEAP_HOOK __declspec(noinline)
+#else
+#define HEAP_HOOK __attribute__((noinline))
+#endif
+
+HEAP_HOOK void* operator new(size_t size) {
+    heapAllocationCount.fetch_add(1, std::memory_order_relaxed);
+    heapAllocationBytes.fetch_add(size, std::memory_order_relaxed);
+    void* pointer = malloc(size > 0 ? size : 1);
+    if (pointer == nullptr) throw std::bad_alloc();
+    return pointer;
+}
+HEAP_HOOK void operator delete(void* pointer) noexcept { free(pointer); }
+HEAP_HOOK void operator delete(void* pointer, size_t) noexcept { free(pointer); }
+#endif
+
+// Heap activity between consecutive frames (timerCB updates included)
+struct MemoryFrameStats {
+    uint64_t lastCount = 0, lastBytes = 0;       // Totals when the previous frame ended
+    uint64_t frameAllocations = 0;               // Allocations in the last frame
+    uint64_t frameBytes = 0;
+    uint64_t maxFrameAllocations = 0;
+    int frames = 0;
+    int allocationFreeFrames = 0;
+} memoryFrames;
 
 //=============================================================================
 // WINDOW AND DISPLAY SETTINGS
@@ -83,9 +225,39 @@ float shakeIntensity = 0.0f;     // Camera shake magnitude
 //=============================================================================
 // Texture-related variables for controlling texture rendering.
 bool gUseTexture = true;       // Toggles texture rendering.
-unsigned int texVec[40];         // Array of texture identifiers
-unsigned int trackTextureId;     // Texture for roller coaster track
-unsigned int supportTextureId;   // Texture for support structures
+
+// Typed handle to a texture owned by the texture registry; the null handle binds no texture.
+// Copying a handle does not take a reference; see TEXTURE REGISTRY.
+struct TextureHandle {
+    uint32_t index = 0;       // Registry record, 0 for none
+    uint32_t generation = 0;  // Record generation it was issued for; stale once the slot is reused
+
+    bool isNull() const { return index == 0; }
+    bool operator==(const TextureHandle& other) const { return index == other.index && generation == other.generation; }
+};
+
+const TextureHandle NO_TEXTURE;  // Surfaces drawn with their material colour only
+
+// Scene areas whose textures are streamed in together when the player comes near
+enum TextureZone {
+    ZONE_RESIDENT,       // Loaded at startup and never evicted (character, console)
+    ZONE_INTERIOR,       // House interior
+    ZONE_GROUNDS,        // Lawn, trees and roof, visible from everywhere
+    ZONE_SKY,            // Clear sky dome
+    ZONE_WEATHER,        // Cloudy sky, needed only while it rains or the sky fades
+    ZONE_FERRIS_WHEEL,
+    ZONE_FLYING_CHAIR,
+    ZONE_COASTER,
+    ZONE_COUNT
+};
+
+// Scene textures, filled in by getTextureManifest() at startup
+TextureHandle floorTexture, wallpaperTexture, sofaTexture, woodTexture, groundTexture, paintingTexture;
+TextureHandle grassTexture, roofTexture, barkTexture, doorTexture, clearSkyTexture, rainySkyTexture, cockpitTexture;
+TextureHandle headTexture, jerseyTexture, jamesTexture, sideClothTexture, armTexture, legTexture, consoleTexture;
+TextureHandle yaomingBackTexture, yaomingFrontTexture, yaomingSideTexture;
+TextureHandle metalTexture, xjtluTexture, marbleTexture, fabricTexture, columnTexture, diskTexture;
+TextureHandle trainTexture, trackTexture;
 
 //=============================================================================
 // UI AND INTERACTION ELEMENTS
@@ -213,24 +385,20 @@ const float POLE_RADIUS = 1.2f;         // Radius of support poles
 const float POLE_SPACING = 8.0f;        // Spacing between poles
 const float levelSpacing = 6.0f;        // Vertical spacing between levels
 
-// Drop Tower dynamics
-float dropHeight = TOWER_HEIGHT;        // Initial drop height
-bool isDropping = false;                // Dropping state flag
-float dropSpeed = 0.0f;                 // Current drop speed
+// Drop Tower dynamics; each tower's drop state is its RideAnimator
 float dropAcceleration = 35.0f;         // Drop acceleration
 float recoverySpeed = 15.0f;            // Recovery speed
-bool isRecovering = false;              // Recovery state flag
 
 //=============================================================================
 // FERRIS WHEEL SYSTEM
 //=============================================================================
 // Ferris Wheel properties
 bool ferrisWheelLightsOn = false;       // Light system activation state
-float ferrisWheelRotationAngle = 0.0f;  // Current wheel rotation angle
 int numSpokes = 24;                     // Number of wheel spokes
-float ferrisWheelPosX = 10.0f;          // Wheel X position
-float ferrisWheelPosY = 0.0f;           // Wheel Y position
-float ferrisWheelPosZ = 0.0f;           // Wheel Z position
+float ferrisWheelPosX = 10.0f;          // Hub X position, relative to the supports
+float ferrisWheelPosY = 0.0f;           // Hub Y position, relative to the supports
+float ferrisWheelPosZ = 0.0f;           // Hub Z position, relative to the supports
+const float FERRIS_WHEEL_SCALE = 1.4f;  // Model scale of every wheel
 
 // Ferris Wheel lighting
 struct FerrisWheelLight {
@@ -265,7 +433,10 @@ struct TrackPoint {
     Vec3 normal;                        // Surface normal at point
     float twist;                        // Track twist angle
 };
-std::vector<TrackPoint> trackPoints;    // Track point collection
+TaggedVector<TrackPoint, MEMORY_TRACK> trackPoints; // Track point collection
+std::string coasterLayoutPath = "track/default.trk"; // Layout file loaded at startup (--track)
+float trackTessellationTolerance = 0.05f; // Max track edge error in track units (--track-tolerance)
+float coasterRotationAngle = 0.0f;      // Rotation angle of the coaster, adjustable for the desired effect
 
 // Coaster dynamics
 float coasterSpeed = 18.0f;             // Current coaster speed
@@ -325,6 +496,7 @@ const float detectionRadius = 8.5f;     // Interaction detection range
 // Rotation parameters
 float flyingChairRotationAngle = 0.0f;  // Base rotation angle
 float additionalRotationAngle = 0.0f;   // Secondary rotation angle
+float chairTurntableAngle = 0.0f;       // Turntable spin on top of the column
 float oscillateAngle = 0.0f;            // Oscillation angle
 float tiltAngle = 20.0f;                // Chair tilt angle
 float alpha = 0.0f;                     // Turntable rotation angle
@@ -347,6 +519,8 @@ const float MAX_OSCILLATE_ANGLE = 45.0f;              // Maximum oscillation ang
 const float AGGREGATE_SPREAD_SPEED = 0.05f;           // Aggregation and dispersion speed
 const float MIN_CHAIR_RADIUS = 8.0f;                  // Minimum orbit radius
 const float MAX_CHAIR_RADIUS = 12.0f;                 // Maximum orbit radius
+const float CHAIR_CABLE_TOP_Y = 15.0f;                // Height of the cable attachment, relative to the ride base
+const float CHAIR_CABLE_LENGTH = 12.0f;               // Cable length
 
 //=============================================================================
 // SNAKE GAME SYSTEM
@@ -358,7 +532,7 @@ float snake_cell_size = 2.0f;         // Size of each grid cell
 
 // Snake game state
 Direction snake_dir = RIGHT;          // Initial snake direction
-std::vector<Position> snake_body;     // Snake body segments
+TaggedVector<Position, MEMORY_SNAKE> snake_body; // Snake body segments
 Position snake_food;                  // Food position
 bool snake_game_over = false;         // Game over state
 bool snake_game_started = false;      // Game started state
@@ -370,7 +544,7 @@ struct SnakeParticle {
     float r, g, b;       // Particle color (RGB)
     float life;          // Remaining lifetime
 };
-std::vector<SnakeParticle> snake_fireworks; // Fireworks particles
+TaggedVector<SnakeParticle, MEMORY_FIREWORKS> snake_fireworks; // Fireworks particles
 bool snake_trigger_fireworks = false;       // Fireworks trigger flag
 Position snake_fireworks_position;          // Fireworks position
 
@@ -441,798 +615,3395 @@ Vec3 subtractVectors(const Vec3& v1, const Vec3& v2) {
 Vec3 scaleVector(const Vec3& v, float scale) {
     return Vec3(v.x * scale, v.y * scale, v.z * scale);
 }
-// Function declarations for managing the Snake game logic and rendering.
-void snake_init();                       // Initializes the Snake game variables.
-void snake_display();                    // Renders the Snake game on screen.
-void snake_timer(int);                   // Timer function for Snake game logic updates.
-void snake_restart_game();               // Resets the Snake game state to initial conditions.
-void snake_create_fireworks(float x, float y, float z); // Creates fireworks at a specified position.
-void snake_update_fireworks();           // Updates the positions and states of fireworks particles.
-void snake_draw_fireworks();             // Draws the fireworks particles on screen.
-void snake_draw_cube(float x, float y, float z, float size, float r, float g, float b); // Draws a colored cube in the game.
-void snake_draw_grid();                  // Renders the grid for the Snake game.
-void snake_draw_snake_lines();           // Draws connecting lines for the snake's body.
-void snake_draw_text_3d(const std::string& text, float x, float y, float z, float scale, float depth); // Renders 3D text.
 
-// Saves the current OpenGL state by storing all attributes and the current transformation matrix.
-void saveGLState() {
-    glPushAttrib(GL_ALL_ATTRIB_BITS); // Saves all OpenGL attributes (e.g., colors, lighting, textures).
-    glPushMatrix();                   // Saves the current transformation matrix.
+//=============================================================================
+// SCENE GRAPH
+//=============================================================================
+
+/**
+ * Flat scene graph for the house and ride transforms. Nodes are stored depth-first (a parent
+ * before its children, each subtree contiguous) and hold a local matrix plus a cached world
+ * matrix. setNodeLocal marks the node's subtree dirty only when the matrix actually changed, and
+ * nodeWorld recomputes dirty world matrices on demand, so static furniture is computed once and
+ * a turning wheel only redoes its own subtree. Drawing loads view * world with glLoadMatrixf
+ * instead of replaying the push/translate/rotate chain.
+ */
+
+// Column-major 4x4 matrix, the layout glLoadMatrixf expects
+struct Matrix4 {
+    float m[16];
+};
+
+Matrix4 identityMatrix() {
+    Matrix4 result = { { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 } };
+    return result;
 }
 
-// Restores the previously saved OpenGL state.
-void restoreGLState() {
-    glPopMatrix();                    // Restores the transformation matrix to the last saved state.
-    glPopAttrib();                    // Restores all OpenGL attributes to their previous values.
+Matrix4 multiplyMatrices(const Matrix4& a, const Matrix4& b) {
+    Matrix4 result;
+    for (int column = 0; column < 4; column++) {
+        for (int row = 0; row < 4; row++) {
+            result.m[column * 4 + row] = a.m[row] * b.m[column * 4] + a.m[4 + row] * b.m[column * 4 + 1] +
+                a.m[8 + row] * b.m[column * 4 + 2] + a.m[12 + row] * b.m[column * 4 + 3];
+        }
+    }
+    return result;
 }
 
-// Helper function to render a hemisphere using quadrilateral strips.
-// @param radius: Radius of the hemisphere.
-// @param startAngle: Starting latitude angle in degrees.
-// @param endAngle: Ending latitude angle in degrees.
-void drawHemisphere(float radius, float startAngle, float endAngle) {
-    int latSegments = 50;           // Number of segments along the latitude (vertical slices).
-    int lonSegments = 50;           // Number of segments along the longitude (horizontal slices).
+// Same matrices as glTranslatef / glRotatef / glScalef
+Matrix4 translationMatrix(float x, float y, float z) {
+    Matrix4 result = identityMatrix();
+    result.m[12] = x;
+    result.m[13] = y;
+    result.m[14] = z;
+    return result;
+}
 
-    // Convert angle ranges from degrees to radians.
-    float latStart = startAngle * M_PI / 180.0f;
-    float latEnd = endAngle * M_PI / 180.0f;
+Matrix4 rotationMatrix(float degrees, float x, float y, float z) {
+    float length = sqrt(x * x + y * y + z * z);
+    x /= length;
+    y /= length;
+    z /= length;
+    float c = cos(degrees * M_PI / 180.0f), s = sin(degrees * M_PI / 180.0f), t = 1.0f - c;
+    Matrix4 result = { {
+        t * x * x + c,     t * x * y + s * z, t * x * z - s * y, 0,
+        t * x * y - s * z, t * y * y + c,     t * y * z + s * x, 0,
+        t * x * z + s * y, t * y * z - s * x, t * z * z + c,     0,
+        0, 0, 0, 1 } };
+    return result;
+}
 
-    // Step size for latitude and longitude divisions.
-    float latStep = (latEnd - latStart) / latSegments;
-    float lonStep = 2.0f * M_PI / lonSegments;
+Matrix4 scaleMatrix(float x, float y, float z) {
+    Matrix4 result = identityMatrix();
+    result.m[0] = x;
+    result.m[5] = y;
+    result.m[10] = z;
+    return result;
+}
 
-    // Iterate through latitude and longitude segments to render the hemisphere.
-    for (int i = 0; i < latSegments; ++i) {
-        float lat0 = latStart + i * latStep;         // Starting latitude for the current segment.
-        float lat1 = latStart + (i + 1) * latStep;   // Ending latitude for the current segment.
+const int FLYING_CHAIR_SEATS = 8;
+
+// Node ids in depth-first order; initSceneGraph adds the nodes in exactly this order. Each
+// Ferris wheel entity appends its own supports and hub nodes after NODE_COUNT.
+enum SceneNodeId {
+    NODE_HOUSE,                 // House block, scaled 2x
+    NODE_SOFA,
+    NODE_CUPBOARD,
+    NODE_FLOOR_LAMP,
+    NODE_TABLE_LAMP,
+    NODE_PARTITION,
+    NODE_DESK,
+    NODE_FLYING_CHAIR,          // Ride base
+    NODE_CHAIR_COLUMN,
+    NODE_CHAIR_TOP,
+    NODE_CHAIR_TURNTABLE,       // Turning and oscillating
+    NODE_CHAIR_SEAT,            // First of FLYING_CHAIR_SEATS seats on the turntable
+    NODE_COUNT = NODE_CHAIR_SEAT + FLYING_CHAIR_SEATS
+};
 
-        glBegin(GL_QUAD_STRIP); // Begin drawing a strip of quadrilaterals.
-        for (int j = 0; j <= lonSegments; ++j) {
-            float lon = j * lonStep; // Current longitude angle.
+struct SceneNode {
+    int parent = -1;            // Earlier node, or -1 for a root
+    int subtreeEnd = 0;         // One past the last descendant
+    Matrix4 local;
+    Matrix4 world;              // Cached parent world * local
+    bool dirty = true;          // world is out of date
+};
 
-            // First vertex on the current latitude.
-            float x0 = radius * sinf(lat0) * cosf(lon);
-            float y0 = radius * cosf(lat0);
-            float z0 = radius * sinf(lat0) * sinf(lon);
-            float s0 = (float)j / lonSegments;  // Texture coordinate (s).
-            float t0 = (float)i / latSegments;  // Texture coordinate (t).
+struct SceneGraph {
+    std::vector<SceneNode> nodes;
+    Matrix4 view;               // Camera matrix captured after gluLookAt
+    int worldUpdates = 0;       // World matrices recomputed in the frame being drawn
+    int lastFrameUpdates = 0;   // worldUpdates of the last finished frame, for the overlay and --bench
+};
 
-            glTexCoord2f(s0, t0);              // Set texture coordinates for the first vertex.
-            glVertex3f(x0, y0, z0);            // Specify the position of the first vertex.
+SceneGraph sceneGraph;
 
-            // Second vertex on the next latitude.
-            float x1 = radius * sinf(lat1) * cosf(lon);
-            float y1 = radius * cosf(lat1);
-            float z1 = radius * sinf(lat1) * sinf(lon);
-            float t1 = (float)(i + 1) / latSegments; // Texture coordinate (t) for the second vertex.
+int addSceneNode(int parent, const Matrix4& local) {
+    int index = (int)sceneGraph.nodes.size();
+    SceneNode node;
+    node.parent = parent;
+    node.subtreeEnd = index + 1;
+    node.local = local;
+    sceneGraph.nodes.push_back(node);
+    for (int ancestor = parent; ancestor >= 0; ancestor = sceneGraph.nodes[ancestor].parent) {
+        sceneGraph.nodes[ancestor].subtreeEnd = index + 1;
+    }
+    return index;
+}
 
-            glTexCoord2f(s0, t1);              // Set texture coordinates for the second vertex.
-            glVertex3f(x1, y1, z1);            // Specify the position of the second vertex.
-        }
-        glEnd(); // End the current strip.
+// Build the nodes with their rest transforms; animated nodes are updated as they draw
+void initSceneGraph() {
+    sceneGraph.nodes.clear();
+    sceneGraph.nodes.reserve(NODE_COUNT);
+
+    int house = addSceneNode(-1, multiplyMatrices(scaleMatrix(2.0f, 2.0f, 2.0f), translationMatrix(-1.5f, 0.0f, -1.5f)));
+    addSceneNode(house, multiplyMatrices(multiplyMatrices(translationMatrix(-5.2f, 0.0f, -2.4f),
+        rotationMatrix(90.0f, 0.0f, 1.0f, 0.0f)), scaleMatrix(1.3f, 1.0f, 1.0f)));
+    addSceneNode(house, multiplyMatrices(multiplyMatrices(translationMatrix(-5.4f, 0.0f, 1.2f),
+        rotationMatrix(90.0f, 0.0f, 1.0f, 0.0f)), scaleMatrix(1.0f, 1.0f, 1.4f)));
+    addSceneNode(house, translationMatrix(-5.4f, 0.0f, -5.5f));
+    addSceneNode(house, translationMatrix(-5.4f, 0.8f, 1.8f));
+    addSceneNode(house, translationMatrix(-4.8f, 0.0f, 3.5f));
+    addSceneNode(house, translationMatrix(-1.0f, 0.0f, -2.5f));
+
+    int chairRide = addSceneNode(-1, translationMatrix(-35.0f, 8.0f, 0.0f));
+    addSceneNode(chairRide, multiplyMatrices(translationMatrix(0.0f, 20.0f, 0.0f), rotationMatrix(90.0f, 1.0f, 0.0f, 0.0f)));
+    addSceneNode(chairRide, translationMatrix(0.0f, 20.0f, 0.0f));
+    int turntable = addSceneNode(chairRide, translationMatrix(0.0f, 20.0f, 0.0f));
+    for (int seat = 0; seat < FLYING_CHAIR_SEATS; seat++) {
+        addSceneNode(turntable, identityMatrix());
     }
 }
 
-// Renders a textured sphere representing the sky.
-// @param radius: Radius of the sky sphere.
-void drawSkySphere(float radius) {
-    glEnable(GL_TEXTURE_2D);                             // Enable 2D texture mapping.
-    glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE); // Use modulate mode for combining texture and color.
-    GLUquadric* quad = gluNewQuadric();                  // Create a new quadric object for rendering.
-    gluQuadricTexture(quad, GL_TRUE);                    // Enable texture mapping on the quadric.
-    gluQuadricNormals(quad, GLU_SMOOTH);                 // Set normals for smooth shading.
-    gluSphere(quad, radius, 64, 64);                     // Render a sphere with the specified radius and detail.
-    gluDeleteQuadric(quad);                              // Delete the quadric object to free memory.
-    glDisable(GL_TEXTURE_2D);                            // Disable 2D texture mapping.
+// Replace a node's local transform; its subtree is recomputed only if the matrix changed
+void setNodeLocal(int node, const Matrix4& local) {
+    SceneNode& target = sceneGraph.nodes[node];
+    if (memcmp(target.local.m, local.m, sizeof(local.m)) == 0) return;
+    target.local = local;
+    for (int i = node; i < target.subtreeEnd; i++) {
+        sceneGraph.nodes[i].dirty = true;
+    }
 }
 
-// Structure representing a particle used for simulating rain.
-struct RainParticle {
-    float x, y, z;      // Position of the particle in 3D space.
-    float speedY;       // Falling speed of the particle along the Y-axis.
-};
+const Matrix4& nodeWorld(int node) {
+    SceneNode& target = sceneGraph.nodes[node];
+    if (target.dirty) {
+        target.world = target.parent < 0 ? target.local : multiplyMatrices(nodeWorld(target.parent), target.local);
+        target.dirty = false;
+        sceneGraph.worldUpdates++;
+    }
+    return target.world;
+}
 
-// Container for managing a collection of rain particles.
-std::vector<RainParticle> rainParticles;
+// Call once the camera is set, before anything is drawn from the graph
+void captureSceneView() {
+    glGetFloatv(GL_MODELVIEW_MATRIX, sceneGraph.view.m);
+}
 
-// Flag indicating whether the rain effect is active.
-bool isRaining = false;
+// Replace the current modelview matrix with the camera and the node's world transform
+void loadNodeMatrix(int node) {
+    Matrix4 modelview = multiplyMatrices(sceneGraph.view, nodeWorld(node));
+    glLoadMatrixf(modelview.m);
+}
 
-// Maximum number of rain particles allowed in the simulation.
-int maxRainParticles = 4000;
+//=============================================================================
+// FILE MAPPING AND HASHING UTILITIES
+//=============================================================================
+// Read-only memory mapping of a whole file. The view stays valid until close().
+struct MappedFile {
+    const unsigned char* data = nullptr;  // Start of the mapped bytes
+    size_t size = 0;                      // Number of mapped bytes
+#ifdef _WIN32
+    HANDLE fileHandle = INVALID_HANDLE_VALUE;
+    HANDLE mappingHandle = nullptr;
+#endif
 
-// Initialize rain particles within the scene
-void initRainParticles() {
-    rainParticles.clear();  // Clear any existing rain particles from the list
+    MappedFile() {}
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile() { close(); }
+
+    bool isOpen() const { return data != nullptr; }
+
+    // Map the file at the given path; returns false if it is missing or empty
+    bool open(const char* path) {
+        close();
+#ifdef _WIN32
+        fileHandle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+            FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (fileHandle == INVALID_HANDLE_VALUE) return false;
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart == 0) {
+            close();
+            return false;
+        }
+        mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mappingHandle == nullptr) {
+            close();
+            return false;
+        }
+        data = static_cast<const unsigned char*>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+        size = static_cast<size_t>(fileSize.QuadPart);
+#else
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0) return false;
+        struct stat info;
+        if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+            ::close(fd);
+            return false;
+        }
+        void* view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);  // The mapping keeps its own reference to the file
+        if (view == MAP_FAILED) return false;
+        data = static_cast<const unsigned char*>(view);
+        size = static_cast<size_t>(info.st_size);
+#endif
+        if (data == nullptr) {
+            close();
+            return false;
+        }
+        return true;
+    }
 
-    // Define boundaries for the grass area where the rain will fall
-    float grassMinX = -50.0f;
-    float grassMaxX = 50.0f;
-    float grassMinZ = -50.0f;
-    float grassMaxZ = 50.0f;
-    float rainHeight = 100.0f;  // Starting height of rain droplets (above the scene)
+    // Release the view and any OS handles
+    void close() {
+#ifdef _WIN32
+        if (data) UnmapViewOfFile(data);
+        if (mappingHandle) CloseHandle(mappingHandle);
+        if (fileHandle != INVALID_HANDLE_VALUE) CloseHandle(fileHandle);
+        mappingHandle = nullptr;
+        fileHandle = INVALID_HANDLE_VALUE;
+#else
+        if (data) munmap(const_cast<unsigned char*>(data), size);
+#endif
+        data = nullptr;
+        size = 0;
+    }
+};
 
-    // Generate rain particles and assign random positions within the specified boundaries
-    for (int i = 0; i < maxRainParticles; ++i) {
-        RainParticle particle;
-        grassMinX + static_cast<float>(rand()) / RAND_MAX * (grassMaxX - grassMinX);
-        particle.x = grassMinX + static_cast<float>(rand()) / RAND_MAX * (grassMaxX - grassMinX);  // Random X within grass area
-        particle.y = rainHeight + static_cast<float>(rand()) / RAND_MAX * 50.0f;  // Randomize Y (height) for rain
-        particle.z = grassMinZ + static_cast<float>(rand()) / RAND_MAX * (grassMaxZ - grassMinZ);  // Random Z within grass area
-        particle.speedY = 20.0f + static_cast<float>(rand()) / RAND_MAX * 10.0f;  // Randomize fall speed for each particle
-        rainParticles.push_back(particle);  // Add the particle to the rain collection
+// 64-bit FNV-1a hash, used to key on-disk caches by their source content
+uint64_t fnv1a64(const void* bytes, size_t length, uint64_t hash = 14695981039346656037ULL) {
+    const unsigned char* p = static_cast<const unsigned char*>(bytes);
+    for (size_t i = 0; i < length; ++i) {
+        hash ^= p[i];
+        hash *= 1099511628211ULL;
     }
+    return hash;
 }
 
-// Update the positions of rain particles based on elapsed time (deltaTime)
-void updateRainParticles(float deltaTime) {
-    for (auto& particle : rainParticles) {
-        particle.y -= particle.speedY * deltaTime;  // Update Y position based on speed and elapsed time
+// Read an entire file into a string; returns false if it cannot be opened
+bool readTextFile(const std::string& path, std::string& contents) {
+    std::ifstream file(path.c_str(), std::ios::in | std::ios::binary);
+    if (!file) return false;
+    std::ostringstream buffer;
+    buffer << file.rdbuf();
+    contents = buffer.str();
+    return true;
+}
 
-        // Reset the particle if it has fallen below the ground level
-        if (particle.y <= -1.5f) {
-            // Reinitialize particle to simulate continuous falling
-            particle.y = 100.0f + static_cast<float>(rand()) / RAND_MAX * 50.0f;  // Reset to a random height
-            // Randomize X and Z positions within the grass area
-            particle.x = GRASS_MIN_X + static_cast<float>(rand()) / RAND_MAX * (GRASS_MAX_X - GRASS_MIN_X);
-            particle.z = GRASS_MIN_Z + static_cast<float>(rand()) / RAND_MAX * (GRASS_MAX_Z - GRASS_MIN_Z);
-        }
-    }
+// Write a block of bytes to a file, replacing any previous contents
+bool writeBinaryFile(const std::string& path, const void* bytes, size_t length) {
+    std::ofstream file(path.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file) return false;
+    file.write(static_cast<const char*>(bytes), static_cast<std::streamsize>(length));
+    return static_cast<bool>(file);
 }
 
-// Render rain particles to the screen, creating the visual effect of falling rain
-void drawRainParticles() {
-    if (!isRaining) return;
+// Append raw bytes to a binary blob (bake cache, asset pack)
+void appendBlob(std::vector<unsigned char>& blob, const void* data, size_t bytes) {
+    const unsigned char* begin = static_cast<const unsigned char*>(data);
+    blob.insert(blob.end(), begin, begin + bytes);
+}
 
-    glPushMatrix();
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    glDisable(GL_LIGHTING);
 
-    // 设置更细的线宽
-    glLineWidth(1.4f); // 减小线宽，使雨滴更细
+//=============================================================================
+// WORKER THREAD POOL
+//=============================================================================
 
-    // 调整雨滴颜色和透明度，使其更细腻
-    glColor4f(0.7f, 0.7f, 1.0f, 0.4f); // 降低不透明度，使雨滴看起来更细
+// Fixed set of worker threads running queued tasks; OpenGL calls stay on the main thread
+struct ThreadPool {
+    std::vector<std::thread> workers;
+    std::queue<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable available;
+    bool stopping = false;
+
+    explicit ThreadPool(unsigned int threadCount) {
+        for (unsigned int i = 0; i < threadCount; i++) {
+            workers.emplace_back([this]() { workerLoop(); });
+        }
+    }
 
-    // 添加风向效果
-    float windAngle = 15.0f;
-    float windStrength = 0.2f;
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        available.notify_all();
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+    }
 
-    glBegin(GL_LINES);
-    for (const auto& particle : rainParticles) {
-        // 减小雨滴长度
-        float length = (rand() % 3 + 6) / 10.0f; // 减小长度范围，使雨滴更短
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
 
-        // 计算风的影响
-        float xOffset = length * windStrength * cos(windAngle * M_PI / 180.0f);
-        float zOffset = length * windStrength * sin(windAngle * M_PI / 180.0f);
+    // Queue a task for the next free worker
+    void submit(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.push(std::move(task));
+        }
+        available.notify_one();
+    }
 
-        glVertex3f(particle.x, particle.y, particle.z);
-        glVertex3f(particle.x + xOffset, particle.y - length, particle.z + zOffset);
+    void workerLoop() {
+        for (;;) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                available.wait(lock, [this]() { return stopping || !tasks.empty(); });
+                if (stopping && tasks.empty()) return;
+                task = std::move(tasks.front());
+                tasks.pop();
+            }
+            task();
+        }
     }
-    glEnd();
+};
 
-    // 恢复默认线宽
-    glLineWidth(1.0f);
+// Shared pool sized to leave one core for the main thread
+ThreadPool& getWorkerPool() {
+    unsigned int cores = std::thread::hardware_concurrency();
+    static ThreadPool pool(cores > 1 ? cores - 1 : 1);
+    return pool;
+}
 
-    glEnable(GL_LIGHTING);
-    glDisable(GL_BLEND);
-    glPopMatrix();
+// Milliseconds elapsed since a steady-clock time point
+double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
 }
 
+std::chrono::steady_clock::time_point startupTime = std::chrono::steady_clock::now(); // Process start, for time-to-first-frame
 
+//=============================================================================
+// WINDOW SYSTEM
+//=============================================================================
 
-// Generate a lightning bolt with random zigzag points within the scene
-void generateLightningBolt() {
-    currentLightning.points.clear();  // Clear any previous lightning points
-    currentLightning.duration = 0.4f;  // Set the duration of the lightning (in seconds)
-    currentLightning.elapsedTime = 0.0f;  // Initialize the elapsed time for lightning
-    currentLightning.active = true;  // Set the lightning to be active
+/**
+ * GLUT services used by the scene outside main(). With --bench there is no GLUT window
+ * (glutInit needs a display), so these switch to an offscreen EGL context, GLU geometry
+ * and a clock driven by the simulation tick instead of wall time.
+ */
 
-    // Randomly generate the starting position of the lightning in the rain area
-    float startX = GRASS_MIN_X + static_cast<float>(rand()) / RAND_MAX * (GRASS_MAX_X - GRASS_MIN_X);
-    float startY = 100.0f;  // Lightning starts high in the sky
-    float startZ = GRASS_MIN_Z + static_cast<float>(rand()) / RAND_MAX * (GRASS_MAX_Z - GRASS_MIN_Z);
+bool headlessMode = false;            // No GLUT window; set by --bench
+bool tickClock = false;               // Scene time from simulationTick (headless, record, replay)
+unsigned int simulationTick = 0;      // timerCB updates since startup
+int replayModifiers = -1;             // Modifier mask of a replayed key press, or -1 for live input
+const int SIMULATION_STEP_MS = 33;    // timerCB interval
 
-    // Randomly generate the end position near the ground, with a slight random offset
-    float endX = startX + (static_cast<float>(rand()) / RAND_MAX - 0.5f) * 20.0f;
-    float endY = 0.0f;  // Lightning ends at ground level
-    float endZ = startZ + (static_cast<float>(rand()) / RAND_MAX - 0.5f) * 20.0f;
+// Looks up OpenGL entry points beyond 1.1; headless modes without GLUT install their own
+typedef void* (*GLProcLoader)(const char* name);
+void* glutProcLoader(const char* name) {
+    return (void*)glutGetProcAddress(name);
+}
+GLProcLoader glProcLoader = glutProcLoader;
 
-    // Generate the lightning path using random segments to create a zigzag pattern
-    int numSegments = 10;  // Define the number of zigzag segments
-    float segmentLengthY = (startY - endY) / numSegments;  // Length of each segment in the Y direction
-    float prevX = startX, prevY = startY, prevZ = startZ;
-    currentLightning.points.push_back({ prevX, prevY, prevZ });  // Add the starting point
+// Seconds of scene time: wall time in a window, simulated ticks when headless or recording
+float sceneSeconds() {
+    if (tickClock) return simulationTick * (SIMULATION_STEP_MS / 1000.0f);
+    return glutGet(GLUT_ELAPSED_TIME) / 1000.0f;
+}
 
-    // Generate intermediate lightning points between the start and end
-    for (int i = 1; i <= numSegments; ++i) {
-        float nextX = prevX + (static_cast<float>(rand()) / RAND_MAX - 0.5f) * 10.0f;
-        float nextY = prevY - segmentLengthY;
-        float nextZ = prevZ + (static_cast<float>(rand()) / RAND_MAX - 0.5f) * 10.0f;
-        currentLightning.points.push_back({ nextX, nextY, nextZ });
-        prevX = nextX;
-        prevY = nextY;
-        prevZ = nextZ;
-    }
+void postRedisplay() {
+    if (!headlessMode) glutPostRedisplay();
 }
 
-// Render a full-screen lightning flash effect
-void drawLightningFlash() {
-    if (!isRaining || !isLightningActive) return;  // Exit if it's not raining or lightning is inactive
+void scheduleTimer(unsigned int millisec, void (*callback)(int), int value) {
+    if (!headlessMode) glutTimerFunc(millisec, callback, value);  // Headless loops call the callbacks directly
+}
 
-    glPushAttrib(GL_ENABLE_BIT | GL_COLOR_BUFFER_BIT);  // Save current OpenGL attributes
-    glDisable(GL_DEPTH_TEST);  // Disable depth testing to ensure the flash renders over everything
-    glDisable(GL_LIGHTING);    // Disable lighting to avoid interaction with the flash
-    glEnable(GL_BLEND);        // Enable alpha blending for the flash effect
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);  // Set standard alpha blending
+void swapWindowBuffers() {
+    if (headlessMode) glFinish();  // No vsync to wait for; finish so frame times include the GPU
+    else glutSwapBuffers();
+}
 
-    // Calculate flash intensity based on the lightning duration, normalized to the [0, 1] range
-    float flashIntensity = lightningDuration / 0.2f;
-    glColor4f(1.0f, 1.0f, 1.0f, flashIntensity);  // Set color to white with intensity based on flash duration
+int keyModifiers() {
+    if (replayModifiers >= 0) return replayModifiers;
+    return headlessMode ? 0 : glutGetModifiers();
+}
 
-    // Draw a full-screen quad to simulate the flash
-    glMatrixMode(GL_PROJECTION);
-    glPushMatrix();
-    glLoadIdentity();
-    gluOrtho2D(0, screenWidth, 0, screenHeight);  // Set orthogonal projection for screen space
-    glMatrixMode(GL_MODELVIEW);
+void bitmapCharacter(void* font, int character) {
+    if (!headlessMode) glutBitmapCharacter(font, character);
+}
+
+void strokeCharacter(void* font, int character) {
+    if (!headlessMode) glutStrokeCharacter(font, character);
+}
+
+// Shared quadric for the headless shape fallbacks
+GLUquadric* headlessQuadric() {
+    static GLUquadric* quadric = gluNewQuadric();
+    return quadric;
+}
+
+// Cap facing -Z at the current origin
+void headlessBaseDisk(GLdouble radius, GLint slices) {
     glPushMatrix();
-    glLoadIdentity();
+    glRotatef(180.0f, 1.0f, 0.0f, 0.0f);
+    gluDisk(headlessQuadric(), 0.0, radius, slices, 1);
+    glPopMatrix();
+}
 
+// The glutSolid* shapes, with the same extents and orientation when headless
+void solidCube(GLdouble size) {
+    if (!headlessMode) {
+        glutSolidCube(size);
+        return;
+    }
+    static const GLfloat normals[6][3] = { {1,0,0}, {-1,0,0}, {0,1,0}, {0,-1,0}, {0,0,1}, {0,0,-1} };
+    GLfloat h = (GLfloat)size * 0.5f;
     glBegin(GL_QUADS);
-    glVertex2f(0, 0);
-    glVertex2f(screenWidth, 0);
-    glVertex2f(screenWidth, screenHeight);
-    glVertex2f(0, screenHeight);
+    for (int face = 0; face < 6; face++) {
+        const GLfloat* n = normals[face];
+        // Two axes spanning the face, ordered so the winding is counter-clockwise from outside
+        GLfloat u[3] = { n[1] + n[2], 0.0f, n[0] };
+        GLfloat v[3] = { n[1] * u[2] - n[2] * u[1], n[2] * u[0] - n[0] * u[2], n[0] * u[1] - n[1] * u[0] };
+        glNormal3fv(n);
+        for (int corner = 0; corner < 4; corner++) {
+            GLfloat su = (corner == 1 || corner == 2) ? h : -h;
+            GLfloat sv = (corner >= 2) ? h : -h;
+            glVertex3f(n[0] * h + u[0] * su + v[0] * sv, n[1] * h + u[1] * su + v[1] * sv, n[2] * h + u[2] * su + v[2] * sv);
+        }
+    }
     glEnd();
+}
 
-    // Restore the matrix state after rendering the flash
-    glPopMatrix();
-    glMatrixMode(GL_PROJECTION);
+void solidSphere(GLdouble radius, GLint slices, GLint stacks) {
+    if (!headlessMode) glutSolidSphere(radius, slices, stacks);
+    else gluSphere(headlessQuadric(), radius, slices, stacks);
+}
+
+void solidCylinder(GLdouble radius, GLdouble height, GLint slices, GLint stacks) {
+    if (!headlessMode) {
+        glutSolidCylinder(radius, height, slices, stacks);
+        return;
+    }
+    gluCylinder(headlessQuadric(), radius, radius, height, slices, stacks);
+    headlessBaseDisk(radius, slices);
+    glPushMatrix();
+    glTranslatef(0.0f, 0.0f, (GLfloat)height);
+    gluDisk(headlessQuadric(), 0.0, radius, slices, 1);
     glPopMatrix();
-    glMatrixMode(GL_MODELVIEW);
+}
 
-    glPopAttrib();  // Restore OpenGL attributes
+void solidCone(GLdouble base, GLdouble height, GLint slices, GLint stacks) {
+    if (!headlessMode) {
+        glutSolidCone(base, height, slices, stacks);
+        return;
+    }
+    gluCylinder(headlessQuadric(), base, 0.0, height, slices, stacks);
+    headlessBaseDisk(base, slices);
 }
 
-// Render the lightning bolt as a line
-void drawLightningBolt() {
-    if (!isRaining || !isLightningActive) return;  // Exit if it's not raining or lightning is inactive
+void solidTorus(GLdouble innerRadius, GLdouble outerRadius, GLint sides, GLint rings) {
+    if (!headlessMode) {
+        glutSolidTorus(innerRadius, outerRadius, sides, rings);
+        return;
+    }
+    for (int ring = 0; ring < rings; ring++) {
+        glBegin(GL_QUAD_STRIP);
+        for (int side = 0; side <= sides; side++) {
+            double theta = 2.0 * M_PI * side / sides;
+            for (int k = 1; k >= 0; k--) {
+                double phi = 2.0 * M_PI * (ring + k) / rings;
+                double distance = outerRadius + innerRadius * cos(theta);
+                glNormal3d(cos(phi) * cos(theta), sin(phi) * cos(theta), sin(theta));
+                glVertex3d(cos(phi) * distance, sin(phi) * distance, innerRadius * sin(theta));
+            }
+        }
+        glEnd();
+    }
+}
 
-    glColor3f(1.0f, 1.0f, 1.0f);  // Set color for lightning (white)
+// GLU has no teapot; a sphere of the same size keeps the draw in the benchmark
+void solidTeapot(GLdouble size) {
+    if (!headlessMode) glutSolidTeapot(size);
+    else gluSphere(headlessQuadric(), size, 16, 12);
+}
 
-    glPushAttrib(GL_ENABLE_BIT);  // Save current OpenGL attributes
-    glDisable(GL_LIGHTING);  // Disable lighting for brightness effect
+void solidTeacup(GLdouble size) {
+    if (!headlessMode) glutSolidTeacup(size);
+    else gluSphere(headlessQuadric(), size * 0.5, 16, 12);
+}
 
-    // Draw the lightning bolt using lines
-    glBegin(GL_LINES);
-    // Randomize the starting position for the lightning around the character
-    float startX = manPositionX + (rand() % 20 - 10);
-    float startY = 100.0f;  // Start in the sky
-    float startZ = manPositionZ + (rand() % 20 - 10);
+#ifdef __linux__
+// EGL is loaded at run time so windowed builds need no extra library
+typedef void* (*PFNEGLGETPROCADDRESS)(const char* name);
+PFNEGLGETPROCADDRESS eglGetProcAddressEntry = nullptr;
 
-    // Set the ending point on the ground
-    float endX = startX + (rand() % 10 - 5);
-    float endY = -5.0f;  // Ground level
-    float endZ = startZ + (rand() % 10 - 5);
+void* eglProcLoader(const char* name) {
+    return eglGetProcAddressEntry(name);
+}
 
-    glVertex3f(startX, startY, startZ);  // Start point of lightning
-    glVertex3f(endX, endY, endZ);        // End point of lightning
-    glEnd();
+// Offscreen OpenGL context on a pbuffer (Mesa's surfaceless platform, e.g. llvmpipe, when available)
+bool createHeadlessContext(int width, int height) {
+    typedef void* (*PFNGETDISPLAY)(void* nativeDisplay);
+    typedef void* (*PFNGETPLATFORMDISPLAY)(unsigned int platform, void* nativeDisplay, const intptr_t* attributes);
+    typedef unsigned int (*PFNINITIALIZE)(void* display, int* major, int* minor);
+    typedef unsigned int (*PFNCHOOSECONFIG)(void* display, const int* attributes, void** configs, int size, int* count);
+    typedef unsigned int (*PFNBINDAPI)(unsigned int api);
+    typedef void* (*PFNCREATEPBUFFER)(void* display, void* config, const int* attributes);
+    typedef void* (*PFNCREATECONTEXT)(void* display, void* config, void* share, const int* attributes);
+    typedef unsigned int (*PFNMAKECURRENT)(void* display, void* draw, void* read, void* context);
+    const unsigned int EGL_PLATFORM_SURFACELESS = 0x31DD;
+    const int EGL_NONE_ = 0x3038;
+
+    void* library = dlopen("libEGL.so.1", RTLD_NOW);
+    if (library == nullptr) library = dlopen("libEGL.so", RTLD_NOW);
+    if (library == nullptr) {
+        std::cerr << "Headless mode needs libEGL" << std::endl;
+        return false;
+    }
+    eglGetProcAddressEntry = (PFNEGLGETPROCADDRESS)dlsym(library, "eglGetProcAddress");
+    PFNGETDISPLAY getDisplay = (PFNGETDISPLAY)dlsym(library, "eglGetDisplay");
+    PFNINITIALIZE initialize = (PFNINITIALIZE)dlsym(library, "eglInitialize");
+    PFNCHOOSECONFIG chooseConfig = (PFNCHOOSECONFIG)dlsym(library, "eglChooseConfig");
+    PFNBINDAPI bindApi = (PFNBINDAPI)dlsym(library, "eglBindAPI");
+    PFNCREATEPBUFFER createPbuffer = (PFNCREATEPBUFFER)dlsym(library, "eglCreatePbufferSurface");
+    PFNCREATECONTEXT createContext = (PFNCREATECONTEXT)dlsym(library, "eglCreateContext");
+    PFNMAKECURRENT makeCurrent = (PFNMAKECURRENT)dlsym(library, "eglMakeCurrent");
+    if (!eglGetProcAddressEntry || !getDisplay || !initialize || !chooseConfig || !bindApi ||
+        !createPbuffer || !createContext || !makeCurrent) {
+        std::cerr << "Headless mode: libEGL is missing entry points" << std::endl;
+        return false;
+    }
+
+    // Surfaceless needs no X or GPU device; fall back to the default display otherwise
+    void* display = nullptr;
+    int major = 0, minor = 0;
+    PFNGETPLATFORMDISPLAY getPlatformDisplay = (PFNGETPLATFORMDISPLAY)eglGetProcAddressEntry("eglGetPlatformDisplayEXT");
+    if (getPlatformDisplay != nullptr) display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS, nullptr, nullptr);
+    if (display == nullptr || !initialize(display, &major, &minor)) {
+        display = getDisplay(nullptr);
+        if (display == nullptr || !initialize(display, &major, &minor)) {
+            std::cerr << "Headless mode: no EGL display" << std::endl;
+            return false;
+        }
+    }
 
-    glPopAttrib();  // Restore OpenGL attributes
+    const int configAttributes[] = {
+        0x3033, 0x0001,     // EGL_SURFACE_TYPE: EGL_PBUFFER_BIT
+        0x3040, 0x0008,     // EGL_RENDERABLE_TYPE: EGL_OPENGL_BIT
+        0x3024, 8, 0x3023, 8, 0x3022, 8,  // EGL_RED_SIZE, EGL_GREEN_SIZE, EGL_BLUE_SIZE
+        0x3025, 24,         // EGL_DEPTH_SIZE
+        EGL_NONE_
+    };
+    const int surfaceAttributes[] = { 0x3057, width, 0x3056, height, EGL_NONE_ };  // EGL_WIDTH, EGL_HEIGHT
+    void* config = nullptr;
+    int configCount = 0;
+    if (!chooseConfig(display, configAttributes, &config, 1, &configCount) || configCount == 0 ||
+        !bindApi(0x30A2)) {  // EGL_OPENGL_API
+        std::cerr << "Headless mode: no desktop OpenGL pbuffer config" << std::endl;
+        return false;
+    }
+    void* surface = createPbuffer(display, config, surfaceAttributes);
+    void* context = createContext(display, config, nullptr, nullptr);
+    if (surface == nullptr || context == nullptr || !makeCurrent(display, surface, surface, context)) {
+        std::cerr << "Headless mode: unable to create an OpenGL context" << std::endl;
+        return false;
+    }
+
+    glProcLoader = eglProcLoader;
+    return true;
 }
+#else
+bool createHeadlessContext(int width, int height) {
+    std::cerr << "Headless mode is only available on Linux (EGL)" << std::endl;
+    return false;
+}
+#endif
 
-// Update lightning bolt state, managing timing and effects
-void updateLightningBolt(float deltaTime) {
-    if (!isRaining) return;
-
-    lightningTimer -= deltaTime;
-    if (lightningTimer <= 0.0f) {
-        isLightningActive = true;
-        lightningDuration = 0.2f;
-        lightningTimer = rand() % 10 - 3;
-        sceneBrightness = 2.5f;
-    }
+//=============================================================================
+// INPUT RECORDING
+//=============================================================================
 
-    if (isLightningActive) {
-        lightningDuration -= deltaTime;
+/**
+ * --record <file> logs every keyboard, special key and mouse callback with the simulation
+ * tick it arrived at; --replay <file> feeds the log back through the same callbacks at the
+ * same ticks, ignoring live input until it ends. Both run the scene clock from ticks and
+ * seed rand() from the log, so a replayed session takes the same path as the original.
+ * The diagnostic keys (F3, F4, F5, F9) are not logged, F9 is refused while a log is being
+ * written or played, and --state cannot be combined with either. Random jitter that only affects drawing uses renderRand() so the number of frames drawn
+ * per tick cannot change the simulation.
+ */
 
-        if (lightningDuration <= 0.0f) {
-            isLightningActive = false;
-            sceneBrightness = 1.0f;
-        }
-    }
-}
+const char INPUT_LOG_MAGIC[4] = { 'C', 'I', 'N', 'P' };
+const uint32_t INPUT_LOG_VERSION = 2;  // 1 logged the diagnostic keys
 
-// Initialize the Snake Game environment
-void snake_init() {
-    // Set the background color (light blue)
-    glClearColor(0.5f, 0.7f, 1.0f, 1.0f);
+enum InputEventType {
+    INPUT_KEY_DOWN,      // keyboardCB
+    INPUT_KEY_UP,        // keyboardUpCB
+    INPUT_SPECIAL_KEY,   // special_callback
+    INPUT_MOUSE_BUTTON,  // mouseCB
+    INPUT_MOUSE_MOTION   // mouseMotionCB
+};
 
-    // Enable depth testing for 3D rendering
-    glEnable(GL_DEPTH_TEST);
+struct InputLogHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t seed;              // srand() seed of the recorded session
+};
 
-    // Enable lighting and set up a light source
-    glEnable(GL_LIGHTING);
-    glEnable(GL_LIGHT0);
+// 12 bytes per event
+struct InputEvent {
+    uint32_t tick;              // simulationTick when the callback ran
+    uint16_t code;              // Key, special key or mouse button
+    uint8_t type;               // InputEventType
+    uint8_t detail;             // Modifier mask for key presses, GLUT_DOWN/GLUT_UP for buttons
+    int16_t x, y;
+};
 
-    // Configure the position of the light source
-    GLfloat light_pos[] = { (snake_grid_columns * snake_cell_size) / 2.0f, 50.0f, (snake_grid_rows * snake_cell_size) / 2.0f, 1.0f };
-    GLfloat light_ambient[] = { 0.5f, 0.5f, 0.5f, 1.0f };
-    GLfloat light_diffuse[] = { 1.0f, 1.0f, 1.0f, 1.0f };
-    glLightfv(GL_LIGHT0, GL_POSITION, light_pos);
-    glLightfv(GL_LIGHT0, GL_AMBIENT, light_ambient);
-    glLightfv(GL_LIGHT0, GL_DIFFUSE, light_diffuse);
+unsigned int randomSeed = (unsigned int)time(NULL);  // Fixed with --seed, or taken from a replay
+std::ofstream inputRecording;         // Open while --record is active
+std::vector<InputEvent> replayEvents; // Loaded by --replay
+size_t nextReplayEvent = 0;
+bool replayActive = false;
+bool dispatchingReplay = false;       // Replayed events pass through captureInput untouched
+uint32_t renderRandomState = 1;
+
+// rand() replacement for purely visual randomness, separate from the simulation's sequence
+int renderRand() {
+    renderRandomState = renderRandomState * 1103515245u + 12345u;
+    return (int)((renderRandomState >> 1) % ((unsigned int)RAND_MAX + 1u));
+}
 
-    // Enable color material to apply colors to the objects based on the material
-    glEnable(GL_COLOR_MATERIAL);
-    glColorMaterial(GL_FRONT, GL_AMBIENT_AND_DIFFUSE);
+bool startInputRecording(const std::string& path) {
+    inputRecording.open(path.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!inputRecording) {
+        std::cerr << "Unable to record input to " << path << std::endl;
+        return false;
+    }
+    InputLogHeader header;
+    memcpy(header.magic, INPUT_LOG_MAGIC, sizeof(header.magic));
+    header.version = INPUT_LOG_VERSION;
+    header.seed = randomSeed;
+    inputRecording.write((const char*)&header, sizeof(header));
+    tickClock = true;
+    return true;
+}
 
-    // Initialize the snake game state
-    snake_body.clear();
-    snake_dir = RIGHT;
-    snake_game_over = false;
-    snake_game_started = true;
+bool loadInputReplay(const std::string& path) {
+    MappedFile file;
+    InputLogHeader header;
+    if (!file.open(path.c_str()) || file.size < sizeof(header)) {
+        std::cerr << "Unable to read input log " << path << std::endl;
+        return false;
+    }
+    memcpy(&header, file.data, sizeof(header));
+    if (memcmp(header.magic, INPUT_LOG_MAGIC, sizeof(header.magic)) != 0 || header.version != INPUT_LOG_VERSION) {
+        std::cerr << "Ignoring invalid input log " << path << std::endl;
+        return false;
+    }
+
+    replayEvents.resize((file.size - sizeof(header)) / sizeof(InputEvent));
+    if (!replayEvents.empty()) {
+        memcpy(replayEvents.data(), file.data + sizeof(header), replayEvents.size() * sizeof(InputEvent));
+    }
+    nextReplayEvent = 0;
+    randomSeed = header.seed;
+    replayActive = true;
+    tickClock = true;
+    std::cout << "Replaying " << replayEvents.size() << " input events from " << path << std::endl;
+    return true;
+}
 
-    // Set the initial position of the snake at the center of the grid
-    snake_body.push_back({ snake_grid_columns / 2, snake_grid_rows / 2 });
+// Log a live callback; returns false when a replay owns the input and the event should be dropped
+bool captureInput(InputEventType type, int code, int detail, int x, int y) {
+    if (dispatchingReplay) return true;
+    if (replayActive) return type == INPUT_KEY_DOWN && code == 27;  // ESC still quits
+
+    if (inputRecording.is_open()) {
+        InputEvent event;
+        event.tick = simulationTick;
+        event.code = (uint16_t)code;
+        event.type = (uint8_t)type;
+        event.detail = (uint8_t)detail;
+        event.x = (int16_t)x;
+        event.y = (int16_t)y;
+        inputRecording.write((const char*)&event, sizeof(event));
+        inputRecording.flush();  // Keep the log usable if the session crashes
+    }
+    return true;
+}
 
-    // Place the first food item at a random position within the grid, avoiding the snake's body
-    bool valid_position = false;
-    while (!valid_position) {
-        snake_food.x = (rand() % snake_grid_columns);
-        snake_food.y = (rand() % snake_grid_rows);
-        valid_position = true;
-        for (const auto& segment : snake_body) {
-            if (segment.x == snake_food.x && segment.y == snake_food.y) {
-                valid_position = false;
-                break;
-            }
+void keyboardCB(unsigned char key, int x, int y);
+void keyboardUpCB(unsigned char key, int x, int y);
+void special_callback(int key, int x, int y);
+void mouseCB(int button, int state, int x, int y);
+void mouseMotionCB(int x, int y);
+
+// Called at the start of each timerCB: deliver the events recorded before this tick's update
+void dispatchReplayInput() {
+    if (!replayActive) return;
+
+    dispatchingReplay = true;
+    while (nextReplayEvent < replayEvents.size() && replayEvents[nextReplayEvent].tick <= simulationTick) {
+        const InputEvent& event = replayEvents[nextReplayEvent++];
+        switch (event.type) {
+        case INPUT_KEY_DOWN:
+            replayModifiers = event.detail;
+            keyboardCB((unsigned char)event.code, event.x, event.y);
+            replayModifiers = -1;
+            break;
+        case INPUT_KEY_UP:
+            keyboardUpCB((unsigned char)event.code, event.x, event.y);
+            break;
+        case INPUT_SPECIAL_KEY:
+            special_callback(event.code, event.x, event.y);
+            break;
+        case INPUT_MOUSE_BUTTON:
+            mouseCB(event.code, event.detail, event.x, event.y);
+            break;
+        case INPUT_MOUSE_MOTION:
+            mouseMotionCB(event.x, event.y);
+            break;
         }
     }
+    dispatchingReplay = false;
 
-    // Start the game timer
-    glutTimerFunc(150, snake_timer, 0);
+    if (nextReplayEvent == replayEvents.size()) {
+        replayActive = false;
+        std::cout << "Replay finished at tick " << simulationTick << "; live input resumed" << std::endl;
+    }
 }
 
-// Create fireworks effect at a specific position in the Snake Game
-void snake_create_fireworks(float x, float y, float z) {
-    const int num_particles = 100;  // Number of particles in the fireworks
-    snake_fireworks.clear();  // Clear any previous fireworks
 
-    // Generate random particles for the fireworks
-    for (int i = 0; i < num_particles; ++i) {
-        SnakeParticle p;
-        p.x = x;
-        p.y = y;
-        p.z = z;
-        float speed = static_cast<float>(rand()) / RAND_MAX * 5.0f + 5.0f;  // Random speed
-        float angle1 = static_cast<float>(rand()) / RAND_MAX * M_PI * 2;  // Random angle for direction
-        float angle2 = static_cast<float>(rand()) / RAND_MAX * M_PI;  // Random angle for direction
+//=============================================================================
+// TRACE EVENTS
+//=============================================================================
 
-        // Calculate particle velocity based on angles
-        p.vx = speed * sin(angle2) * cos(angle1);
-        p.vy = speed * cos(angle2);
-        p.vz = speed * sin(angle2) * sin(angle1);
+/**
+ * Optional Chrome trace (about:tracing / Perfetto) recording. Each thread appends complete
+ * events to its own fixed buffer without locks; a full buffer drops events. The JSON is
+ * written at exit and on F4. Enabled with --trace <file> or the first F4 press.
+ */
 
-        // Randomize color for the fireworks
-        p.r = static_cast<float>(rand()) / RAND_MAX;
-        p.g = static_cast<float>(rand()) / RAND_MAX;
-        p.b = static_cast<float>(rand()) / RAND_MAX;
+const size_t TRACE_BUFFER_EVENTS = 1 << 18;   // Per thread; 8 MiB of 32-byte events on 64-bit builds
 
-        p.life = 1.2f;  // Lifespan of each particle (in seconds)
+struct TraceEvent {
+    const char* category;     // Static strings: category and section name or manifest path
+    const char* name;
+    uint64_t start;           // Microseconds since startup
+    uint64_t duration;
+};
 
-        snake_fireworks.push_back(p);  // Add particle to the fireworks collection
+// Single-producer event buffer; count is published after each event is written
+struct TraceBuffer {
+    std::unique_ptr<TraceEvent[]> events{ new TraceEvent[TRACE_BUFFER_EVENTS] };
+    std::atomic<size_t> count{ 0 };
+    std::atomic<size_t> dropped{ 0 };
+    int threadId = 0;
+};
+
+std::atomic<bool> traceEnabled{ false };       // Set by the main thread, read by workers
+std::string tracePath = "trace.json";          // Output file (--trace)
+std::mutex traceBuffersMutex;                  // Guards the list only, never the events
+std::vector<TraceBuffer*> traceBuffers;        // One per thread that recorded; never freed
+
+uint64_t traceMicroseconds(std::chrono::steady_clock::time_point time) {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(time - startupTime).count();
+}
+
+// The calling thread's buffer, registered on first use
+TraceBuffer& getTraceBuffer() {
+    thread_local TraceBuffer* buffer = nullptr;
+    if (buffer == nullptr) {
+        buffer = new TraceBuffer();
+        std::lock_guard<std::mutex> lock(traceBuffersMutex);
+        buffer->threadId = (int)traceBuffers.size() + 1;
+        traceBuffers.push_back(buffer);
     }
+    return *buffer;
 }
 
-// Update the state of the fireworks particles
-void snake_update_fireworks() {
-    float delta_time = 0.05f;  // Time step for the update
+// Record one complete event on the calling thread
+void recordTraceEvent(const char* category, const char* name, std::chrono::steady_clock::time_point start) {
+    uint64_t begin = traceMicroseconds(start);
+    uint64_t end = traceMicroseconds(std::chrono::steady_clock::now());
 
-    // Update each particle's position based on its velocity
-    for (auto& p : snake_fireworks) {
-        p.x += p.vx * delta_time;
-        p.y += p.vy * delta_time;
-        p.z += p.vz * delta_time;
-        p.vy -= 9.8f * delta_time;  // Apply gravity (negative Y-velocity)
-        p.life -= delta_time * 0.5f;  // Gradually reduce lifespan for fading effect
+    TraceBuffer& buffer = getTraceBuffer();
+    size_t index = buffer.count.load(std::memory_order_relaxed);
+    if (index == TRACE_BUFFER_EVENTS) {
+        buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
     }
-
-    // Remove any particles that have expired (life <= 0)
-    snake_fireworks.erase(
-        std::remove_if(snake_fireworks.begin(), snake_fireworks.end(),
-            [](const SnakeParticle& p) { return p.life <= 0.0f; }),
-        snake_fireworks.end()
-    );
+    buffer.events[index] = { category, name, begin, end - begin };
+    buffer.count.store(index + 1, std::memory_order_release);
 }
 
-// Render the fireworks to the screen
-void snake_draw_fireworks() {
-    glDisable(GL_LIGHTING);  // Disable lighting for particles to ensure full color visibility
-    glPointSize(4.0f);  // Set the size of the points (particles)
-    glBegin(GL_POINTS);
-    for (const auto& p : snake_fireworks) {
-        glColor4f(p.r, p.g, p.b, p.life);  // Set color with alpha (transparency based on life)
-        glVertex3f(p.x, p.y, p.z);  // Draw each particle as a point in 3D space
+// Records the time spent in its scope when tracing is on
+struct TraceScope {
+    const char* category;
+    const char* name;
+    bool active;
+    std::chrono::steady_clock::time_point start;
+
+    TraceScope(const char* category_, const char* name_) : category(category_), name(name_), active(traceEnabled) {
+        if (active) start = std::chrono::steady_clock::now();
     }
-    glEnd();
-    glEnable(GL_LIGHTING);  // Re-enable lighting after rendering the fireworks
+    ~TraceScope() {
+        if (active) recordTraceEvent(category, name, start);
+    }
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+};
+
+// Write every recorded event as Chrome trace JSON; safe to call repeatedly
+void writeTraceFile() {
+    if (!traceEnabled) return;
+
+    std::ofstream file(tracePath.c_str(), std::ios::out | std::ios::trunc);
+    if (!file) {
+        std::cerr << "Unable to write trace " << tracePath << std::endl;
+        return;
+    }
+
+    std::vector<TraceBuffer*> buffers;
+    {
+        std::lock_guard<std::mutex> lock(traceBuffersMutex);
+        buffers = traceBuffers;
+    }
+
+    size_t written = 0, dropped = 0;
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    file << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"Amusement park\"}}";
+    for (TraceBuffer* buffer : buffers) {
+        file << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->threadId
+            << ",\"args\":{\"name\":\"";
+        if (buffer->threadId == 1) file << "main\"}}";
+        else file << "worker " << buffer->threadId - 1 << "\"}}";
+
+        size_t count = buffer->count.load(std::memory_order_acquire);
+        for (size_t i = 0; i < count; i++) {
+            const TraceEvent& event = buffer->events[i];
+            file << ",\n{\"cat\":\"" << event.category << "\",\"name\":\"";
+            for (const char* c = event.name; *c != '\0'; c++) {
+                if (*c == '"' || *c == '\\') file << '\\';
+                file << *c;
+            }
+            file << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->threadId
+                << ",\"ts\":" << event.start << ",\"dur\":" << event.duration << "}";
+        }
+        written += count;
+        dropped += buffer->dropped.load(std::memory_order_relaxed);
+    }
+    file << "\n]}\n";
+
+    printf("Wrote %u trace events to %s", (unsigned int)written, tracePath.c_str());
+    if (dropped > 0) printf(" (%u dropped, buffers full)", (unsigned int)dropped);
+    printf("\n");
 }
 
-// Restart the Snake Game, reinitializing all necessary components
-void snake_restart_game() {
-    snake_init();  // Call the init function to reset the game state
+// Start recording; the trace is also written when the process exits
+void enableTracing() {
+    if (traceEnabled) return;
+    traceEnabled = true;
+    getTraceBuffer();  // The first thread to record is the main thread
+    atexit(writeTraceFile);
 }
 
-// Timer logic for the Snake Game
-void snake_timer(int) {
-    if (!snake_game_over && currentGameState == SNAKE_GAME) {
-        // Move the snake's head according to the current direction
-        Position head = snake_body.front();
-        switch (snake_dir) {
-        case UP:    head.y += 1; break;
-        case DOWN:  head.y -= 1; break;
-        case LEFT:  head.x -= 1; break;
-        case RIGHT: head.x += 1; break;
-        }
+
+//=============================================================================
+// FRAME PROFILER
+//=============================================================================
+
+/**
+ * Scoped CPU timers per subsystem, plus GPU time from timer queries for render passes.
+ * Each frame's totals go into a ring buffer that gives min/avg/p99 for the F3 overlay.
+ * CPU scopes always run so frame pacing can name the subsystem behind a hitch; the ring buffer,
+ * GPU queries and overlay only while enabled. Building with DISABLE_PROFILER removes the scopes entirely.
+ */
+
+#ifndef GL_TIME_ELAPSED
+#define GL_TIME_ELAPSED 0x88BF
+#endif
+#ifndef GL_QUERY_RESULT
+#define GL_QUERY_RESULT 0x8866
+#endif
+#ifndef GL_QUERY_RESULT_AVAILABLE
+#define GL_QUERY_RESULT_AVAILABLE 0x8867
+#endif
+
+enum ProfileSection {
+    PROFILE_FRAME,              // displayCB up to the buffer swap; GPU column sums the passes
+    PROFILE_SKY_DOME,
+    PROFILE_HOUSE,              // House, furniture, console and character
+    PROFILE_ROLLER_COASTER,
+    PROFILE_FERRIS_WHEEL,
+    PROFILE_DROP_TOWERS,
+    PROFILE_FLYING_CHAIR,
+    PROFILE_SKY_CLOUDS,
+    PROFILE_TREES,
+    PROFILE_RAIN,
+    PROFILE_PARTICLES,          // Drop tower particles
+    PROFILE_TIMER_UPDATE,       // timerCB simulation updates
+    PROFILE_SECTION_COUNT
+};
+
+const char* PROFILE_SECTION_NAMES[PROFILE_SECTION_COUNT] = {
+    "frame", "sky dome", "house", "roller coaster", "ferris wheel", "drop towers",
+    "flying chair", "sky clouds", "trees", "rain", "particles", "timer update"
+};
+
+const int PROFILE_HISTORY_FRAMES = 240;  // About 8 seconds at 30 fps
+const int GPU_QUERY_SETS = 2;            // Queries alternate between frames so results are read a frame later
+const int GPU_QUERIES_PER_SECTION = 4;   // Timed uses of one pass per frame; later uses are CPU only
+const double GPU_TIME_LIMIT_MS = 10000.0; // llvmpipe reports garbage for a query around a context's first draw
+const double GPU_NO_SAMPLE = -1.0;       // GPU time of a pass whose queries were not all ready; left out of the stats
+
+typedef void (APIENTRY* PFNGENQUERIES)(GLsizei n, GLuint* ids);
+typedef void (APIENTRY* PFNBEGINQUERY)(GLenum target, GLuint id);
+typedef void (APIENTRY* PFNENDQUERY)(GLenum target);
+typedef void (APIENTRY* PFNGETQUERYOBJECTIV)(GLuint id, GLenum pname, GLint* params);
+typedef void (APIENTRY* PFNGETQUERYOBJECTUI64V)(GLuint id, GLenum pname, uint64_t* params);
+
+// GL_ARB_timer_query / GL_EXT_timer_query state; unused when neither is available
+struct GpuTimers {
+    bool available = false;
+    PFNGENQUERIES genQueries = nullptr;
+    PFNBEGINQUERY beginQuery = nullptr;
+    PFNENDQUERY endQuery = nullptr;
+    PFNGETQUERYOBJECTIV getQueryObjectiv = nullptr;
+    PFNGETQUERYOBJECTUI64V getQueryObjectui64v = nullptr;
+    GLuint queries[GPU_QUERY_SETS][PROFILE_SECTION_COUNT][GPU_QUERIES_PER_SECTION] = {};
+    int issued[GPU_QUERY_SETS][PROFILE_SECTION_COUNT] = {};     // Queries used in each set
+    int set = 0;                                                // Set used by the current frame
+    bool running = false;                                       // TIME_ELAPSED queries cannot nest
+};
+
+GpuTimers gpuTimers;
+
+struct FrameProfiler {
+    bool enabled = false;                                         // Toggled with F3
+    double current[PROFILE_SECTION_COUNT] = {};                   // Totals for the frame in progress (ms)
+    double lastFrame[PROFILE_SECTION_COUNT] = {};                 // Totals of the last finished frame (ms)
+    float history[PROFILE_SECTION_COUNT][PROFILE_HISTORY_FRAMES] = {};
+    double gpuCurrent[PROFILE_SECTION_COUNT] = {};                // GPU time read back this frame (ms), or GPU_NO_SAMPLE
+    float gpuHistory[PROFILE_SECTION_COUNT][PROFILE_HISTORY_FRAMES] = {};
+    int frameCount = 0;                                           // Recorded frames, up to the history size
+    int nextFrame = 0;                                            // Ring buffer write position
+    std::chrono::steady_clock::time_point frameStart;
+};
+
+FrameProfiler frameProfiler;
+
+struct ProfileStats {
+    float minimum, average, p99;
+    int samples;                // Frames that had a sample
+};
+
+// Adds the time spent in its scope to one profile section, and to the trace when recording
+struct ScopedTimer {
+    ProfileSection section;
+    std::chrono::steady_clock::time_point start;
+
+    explicit ScopedTimer(ProfileSection section_) : section(section_), start(std::chrono::steady_clock::now()) {}
+    ~ScopedTimer() {
+        frameProfiler.current[section] += millisecondsSince(start);
+        if (traceEnabled) recordTraceEvent("profile", PROFILE_SECTION_NAMES[section], start);
+    }
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+};
+
+// Times the GPU work issued in its scope with a timer query
+struct ScopedGpuTimer {
+    GLuint query;
+
+    explicit ScopedGpuTimer(ProfileSection section) : query(0) {
+        if (!frameProfiler.enabled || !gpuTimers.available || gpuTimers.running) return;
+        int& issued = gpuTimers.issued[gpuTimers.set][section];
+        if (issued == GPU_QUERIES_PER_SECTION) return;
+        query = gpuTimers.queries[gpuTimers.set][section][issued++];
+        gpuTimers.beginQuery(GL_TIME_ELAPSED, query);
+        gpuTimers.running = true;
+    }
+    ~ScopedGpuTimer() {
+        if (query == 0) return;
+        gpuTimers.endQuery(GL_TIME_ELAPSED);
+        gpuTimers.running = false;
+    }
+    ScopedGpuTimer(const ScopedGpuTimer&) = delete;
+    ScopedGpuTimer& operator=(const ScopedGpuTimer&) = delete;
+};
+
+#ifdef COUNT_GL_CALLS
+#define GL_COUNT_SCOPE(section) GLCountScope glCountScope(section)  // See GL CALL COUNTING
+#else
+#define GL_COUNT_SCOPE(section)
+#endif
+
+#ifndef DISABLE_PROFILER
+#define PROFILE_SCOPE(section) ScopedTimer profileScope(section)
+#define PROFILE_PASS(section) ScopedTimer profileScope(section); ScopedGpuTimer gpuProfileScope(section); GL_COUNT_SCOPE(section)
+#define TRACE_SCOPE(category, name) TraceScope traceScope(category, name)
+#else
+#define PROFILE_SCOPE(section)
+#define PROFILE_PASS(section) GL_COUNT_SCOPE(section)
+#define TRACE_SCOPE(category, name)
+#endif
+
+// Load the timer query entry points; call with a current context
+void initGpuTimers() {
+    const char* extensions = (const char*)glGetString(GL_EXTENSIONS);
+    bool supported = extensions != nullptr &&
+        (strstr(extensions, "GL_ARB_timer_query") != nullptr || strstr(extensions, "GL_EXT_timer_query") != nullptr);
+    if (!supported) {
+        printf("GPU timing unavailable (no timer query extension); profiler shows CPU times only\n");
+        return;
+    }
+
+    // Core (1.5/3.3) names first, then the extension suffixes
+    gpuTimers.genQueries = (PFNGENQUERIES)glProcLoader("glGenQueries");
+    if (!gpuTimers.genQueries) gpuTimers.genQueries = (PFNGENQUERIES)glProcLoader("glGenQueriesARB");
+    gpuTimers.beginQuery = (PFNBEGINQUERY)glProcLoader("glBeginQuery");
+    if (!gpuTimers.beginQuery) gpuTimers.beginQuery = (PFNBEGINQUERY)glProcLoader("glBeginQueryARB");
+    gpuTimers.endQuery = (PFNENDQUERY)glProcLoader("glEndQuery");
+    if (!gpuTimers.endQuery) gpuTimers.endQuery = (PFNENDQUERY)glProcLoader("glEndQueryARB");
+    gpuTimers.getQueryObjectiv = (PFNGETQUERYOBJECTIV)glProcLoader("glGetQueryObjectiv");
+    if (!gpuTimers.getQueryObjectiv) gpuTimers.getQueryObjectiv = (PFNGETQUERYOBJECTIV)glProcLoader("glGetQueryObjectivARB");
+    gpuTimers.getQueryObjectui64v = (PFNGETQUERYOBJECTUI64V)glProcLoader("glGetQueryObjectui64v");
+    if (!gpuTimers.getQueryObjectui64v) gpuTimers.getQueryObjectui64v = (PFNGETQUERYOBJECTUI64V)glProcLoader("glGetQueryObjectui64vEXT");
+
+    if (!gpuTimers.genQueries || !gpuTimers.beginQuery || !gpuTimers.endQuery ||
+        !gpuTimers.getQueryObjectiv || !gpuTimers.getQueryObjectui64v) {
+        printf("GPU timing unavailable (timer query entry points missing); profiler shows CPU times only\n");
+        return;
+    }
+    gpuTimers.genQueries(GPU_QUERY_SETS * PROFILE_SECTION_COUNT * GPU_QUERIES_PER_SECTION, &gpuTimers.queries[0][0][0]);
+    gpuTimers.available = true;
+}
+
+// Read back the query set about to be reused, without waiting for results that are not ready
+void collectGpuTimers() {
+    if (!gpuTimers.available) return;
+
+    gpuTimers.set = (gpuTimers.set + 1) % GPU_QUERY_SETS;
+    for (int section = 0; section < PROFILE_SECTION_COUNT; section++) {
+        double total = 0.0;
+        bool complete = true;
+        int& issued = gpuTimers.issued[gpuTimers.set][section];
+        for (int i = 0; i < issued; i++) {
+            GLuint query = gpuTimers.queries[gpuTimers.set][section][i];
+            GLint ready = 0;
+            gpuTimers.getQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &ready);
+            if (!ready) {
+                complete = false;  // Dropped rather than stalling the pipeline
+                continue;
+            }
+            uint64_t nanoseconds = 0;
+            gpuTimers.getQueryObjectui64v(query, GL_QUERY_RESULT, &nanoseconds);
+            if (nanoseconds / 1.0e6 < GPU_TIME_LIMIT_MS) total += nanoseconds / 1.0e6;
+        }
+        issued = 0;
+        frameProfiler.gpuCurrent[section] = complete ? total : GPU_NO_SAMPLE;
+    }
+}
+
+// Start or stop profiling; history restarts so stale frames never mix in
+void toggleProfiler() {
+    frameProfiler.enabled = !frameProfiler.enabled;
+    frameProfiler.frameCount = 0;
+    frameProfiler.nextFrame = 0;
+    for (double& total : frameProfiler.current) total = 0.0;
+    for (double& total : frameProfiler.gpuCurrent) total = 0.0;
+    for (int set = 0; set < GPU_QUERY_SETS; set++) {
+        for (int& issued : gpuTimers.issued[set]) issued = 0;
+    }
+    frameProfiler.frameStart = std::chrono::steady_clock::now();
+}
+
+// Mark the start of a rendered frame and collect GPU times from an earlier one
+void profilerBeginFrame() {
+    frameProfiler.frameStart = std::chrono::steady_clock::now();
+    if (frameProfiler.enabled) collectGpuTimers();
+}
+
+// Keep this frame's totals for frame pacing and, while enabled, commit them to the ring buffer
+void profilerEndFrame() {
+    frameProfiler.current[PROFILE_FRAME] = millisecondsSince(frameProfiler.frameStart);
+    for (int section = 0; section < PROFILE_SECTION_COUNT; section++) {
+        frameProfiler.lastFrame[section] = frameProfiler.current[section];
+    }
+    if (!frameProfiler.enabled) {
+        for (int section = 0; section < PROFILE_SECTION_COUNT; section++) frameProfiler.current[section] = 0.0;
+        return;
+    }
+
+    // The frame's GPU time is only known when every pass has a sample
+    frameProfiler.gpuCurrent[PROFILE_FRAME] = 0.0;
+    for (int section = PROFILE_FRAME + 1; section < PROFILE_SECTION_COUNT; section++) {
+        if (frameProfiler.gpuCurrent[section] == GPU_NO_SAMPLE) {
+            frameProfiler.gpuCurrent[PROFILE_FRAME] = GPU_NO_SAMPLE;
+            break;
+        }
+        frameProfiler.gpuCurrent[PROFILE_FRAME] += frameProfiler.gpuCurrent[section];
+    }
+    for (int section = 0; section < PROFILE_SECTION_COUNT; section++) {
+        frameProfiler.history[section][frameProfiler.nextFrame] = (float)frameProfiler.current[section];
+        frameProfiler.gpuHistory[section][frameProfiler.nextFrame] = (float)frameProfiler.gpuCurrent[section];
+        frameProfiler.current[section] = 0.0;
+        frameProfiler.gpuCurrent[section] = 0.0;
+    }
+    frameProfiler.nextFrame = (frameProfiler.nextFrame + 1) % PROFILE_HISTORY_FRAMES;
+    frameProfiler.frameCount = std::min(frameProfiler.frameCount + 1, PROFILE_HISTORY_FRAMES);
+}
+
+// Min, mean and 99th percentile of one section over the recorded frames; negative entries have no sample.
+// Works in a fixed scratch array so the overlay does not add to the allocations it reports.
+ProfileStats computeProfileStats(const float* samples, int count) {
+    ProfileStats stats = { 0.0f, 0.0f, 0.0f, 0 };
+    float valid[PROFILE_HISTORY_FRAMES];
+    int validCount = 0;
+    double sum = 0.0;
+    for (int i = 0; i < count && i < PROFILE_HISTORY_FRAMES; i++) {
+        if (samples[i] < 0.0f) continue;
+        if (validCount == 0 || samples[i] < stats.minimum) stats.minimum = samples[i];
+        sum += samples[i];
+        valid[validCount++] = samples[i];
+    }
+    if (validCount == 0) return stats;
+
+    float* p99 = valid + std::min(validCount - 1, (int)ceil(0.99 * validCount) - 1);
+    std::nth_element(valid, p99, valid + validCount);
+    stats.average = (float)(sum / validCount);
+    stats.p99 = *p99;
+    stats.samples = validCount;
+    return stats;
+}
+
+//=============================================================================
+// FRAME PACING
+//=============================================================================
+
+/**
+ * Frame pacing: the interval between consecutive presents goes into a histogram, and an interval
+ * over hitchThresholdMs (--hitch-ms) counts as a hitch. A hitch is blamed on whichever took the
+ * most time in that frame: a subsystem's CPU scope or the buffer swap (where a driver that renders
+ * lazily, or vsync, makes the CPU wait). When the frame itself used less than half the interval
+ * the time went between frames instead (a late timer or the OS).
+ */
+
+const int PACING_BUCKET_COUNT = 9;
+const float PACING_BUCKET_LIMITS_MS[PACING_BUCKET_COUNT - 1] = { 8.3f, 16.7f, 25.0f, 33.3f, 50.0f, 66.7f, 100.0f, 200.0f };
+const char* PACING_BUCKET_NAMES[PACING_BUCKET_COUNT] = {
+    "<=8", "<=17", "<=25", "<=33", "<=50", "<=67", "<=100", "<=200", ">200"
+};
+const int PACING_SWAP = PROFILE_SECTION_COUNT;              // Cause slot for the overlay and buffer swap
+const int PACING_OUTSIDE_FRAME = PROFILE_SECTION_COUNT + 1;  // Cause slot for time between frames
+const int PACING_CAUSE_COUNT = PROFILE_SECTION_COUNT + 2;
+
+float hitchThresholdMs = 50.0f;  // --hitch-ms; about 1.5 frames of the 33 ms timer
+
+struct FramePacing {
+    bool started = false;
+    std::chrono::steady_clock::time_point lastPresent;
+    int histogram[PACING_BUCKET_COUNT] = {};
+    int frames = 0;                                   // Intervals measured
+    int hitches = 0;
+    int hitchCauses[PACING_CAUSE_COUNT] = {};         // Hitches per blamed subsystem
+    float worstMs = 0.0f;
+    int worstCause = PACING_OUTSIDE_FRAME;
+    float worstCostMs = 0.0f;                         // Time the blamed cause took in the worst hitch
+    float lastHitchMs = 0.0f;
+    int lastHitchCause = PACING_OUTSIDE_FRAME;
+    float lastHitchCostMs = 0.0f;
+};
+
+FramePacing framePacing;
+
+const char* pacingCauseName(int cause) {
+    if (cause == PACING_SWAP) return "buffer swap";
+    if (cause == PACING_OUTSIDE_FRAME) return "between frames";
+    return PROFILE_SECTION_NAMES[cause];
+}
+
+// Most expensive part of the frame just presented; swapMs covers the overlay and the swap
+int mostExpensiveSection(float intervalMs, double swapMs, double& costMs) {
+    double busy = frameProfiler.lastFrame[PROFILE_FRAME] + frameProfiler.lastFrame[PROFILE_TIMER_UPDATE] + swapMs;
+    costMs = intervalMs - busy;
+    if (busy < intervalMs * 0.5) return PACING_OUTSIDE_FRAME;
+
+    int cause = PACING_SWAP;
+    costMs = swapMs;
+    for (int section = PROFILE_FRAME + 1; section < PROFILE_SECTION_COUNT; section++) {
+        if (frameProfiler.lastFrame[section] > costMs) {
+            costMs = frameProfiler.lastFrame[section];
+            cause = section;
+        }
+    }
+    return cause;
+}
+
+// Call right after the buffer swap
+void recordFramePresent() {
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (!framePacing.started) {
+        framePacing.started = true;
+        framePacing.lastPresent = now;
+        return;
+    }
+    float interval = (float)std::chrono::duration<double, std::milli>(now - framePacing.lastPresent).count();
+    framePacing.lastPresent = now;
+
+    int bucket = 0;
+    while (bucket < PACING_BUCKET_COUNT - 1 && interval > PACING_BUCKET_LIMITS_MS[bucket]) bucket++;
+    framePacing.histogram[bucket]++;
+    framePacing.frames++;
+
+    if (interval <= hitchThresholdMs) return;
+    double frameMs = std::chrono::duration<double, std::milli>(now - frameProfiler.frameStart).count();
+    double costMs = 0.0;
+    int cause = mostExpensiveSection(interval, frameMs - frameProfiler.lastFrame[PROFILE_FRAME], costMs);
+    framePacing.hitches++;
+    framePacing.hitchCauses[cause]++;
+    framePacing.lastHitchMs = interval;
+    framePacing.lastHitchCause = cause;
+    framePacing.lastHitchCostMs = (float)costMs;
+    if (interval > framePacing.worstMs) {
+        framePacing.worstMs = interval;
+        framePacing.worstCause = cause;
+        framePacing.worstCostMs = (float)costMs;
+    }
+}
+
+//=============================================================================
+// PROFILER OVERLAY
+//=============================================================================
+
+// Draw a line of bitmap text at a window position (pixels from the top left)
+void drawOverlayText(int x, int y, const char* text) {
+    glRasterPos2i(x, y);
+    for (const char* c = text; *c != '\0'; c++) {
+        bitmapCharacter(GLUT_BITMAP_8_BY_13, *c);
+    }
+}
+
+// Draw the profiler table over the scene in window coordinates
+void drawProfilerOverlay() {
+    if (!frameProfiler.enabled || headlessMode) return;  // Benchmarks report as JSON instead
+
+    const int lineHeight = 15;
+    const int width = 8 * 64 + 16;
+    const int memoryTop = lineHeight * (PROFILE_SECTION_COUNT + 2);
+    const int pacingTop = memoryTop + lineHeight * (MEMORY_TAG_COUNT + 3);
+    const int height = pacingTop + lineHeight * 6 + 8;
+
+    glPushAttrib(GL_ENABLE_BIT | GL_CURRENT_BIT | GL_COLOR_BUFFER_BIT);
+    glDisable(GL_LIGHTING);
+    glDisable(GL_TEXTURE_2D);
+    glDisable(GL_DEPTH_TEST);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    glMatrixMode(GL_PROJECTION);
+    glPushMatrix();
+    glLoadIdentity();
+    gluOrtho2D(0, screenWidth, screenHeight, 0);
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glLoadIdentity();
+
+    glColor4f(0.0f, 0.0f, 0.0f, 0.6f);
+    glRecti(4, 4, 4 + width, 4 + height);
+
+    char line[96];
+    glColor3f(1.0f, 1.0f, 0.6f);
+    snprintf(line, sizeof(line), "%-16s %7s %7s %7s %7s %7s", "ms", "min", "avg", "p99", "gpu avg", "gpu p99");
+    drawOverlayText(12, 4 + lineHeight, line);
+
+    glColor3f(1.0f, 1.0f, 1.0f);
+    for (int section = 0; section < PROFILE_SECTION_COUNT; section++) {
+        ProfileStats stats = computeProfileStats(frameProfiler.history[section], frameProfiler.frameCount);
+        ProfileStats gpu = computeProfileStats(frameProfiler.gpuHistory[section], frameProfiler.frameCount);
+        if (gpuTimers.available && section != PROFILE_TIMER_UPDATE && gpu.samples > 0) {
+            snprintf(line, sizeof(line), "%-16s %7.2f %7.2f %7.2f %7.2f %7.2f", PROFILE_SECTION_NAMES[section],
+                stats.minimum, stats.average, stats.p99, gpu.average, gpu.p99);
+        }
+        else {
+            snprintf(line, sizeof(line), "%-16s %7.2f %7.2f %7.2f %7s %7s", PROFILE_SECTION_NAMES[section],
+                stats.minimum, stats.average, stats.p99, "-", "-");
+        }
+        drawOverlayText(12, 4 + lineHeight * (section + 2), line);
+    }
+
+    // Memory per subsystem and heap allocations in the last frame
+    glColor3f(1.0f, 1.0f, 0.6f);
+    snprintf(line, sizeof(line), "%-16s %9s %9s", "memory", "live KB", "peak KB");
+    drawOverlayText(12, 4 + memoryTop + lineHeight, line);
+    glColor3f(1.0f, 1.0f, 1.0f);
+    for (int tag = 0; tag < MEMORY_TAG_COUNT; tag++) {
+        snprintf(line, sizeof(line), "%-16s %9.1f %9.1f", MEMORY_TAG_NAMES[tag],
+            memoryCounters[tag].live / 1024.0, memoryCounters[tag].peak / 1024.0);
+        drawOverlayText(12, 4 + memoryTop + lineHeight * (tag + 2), line);
+    }
+    snprintf(line, sizeof(line), "allocs/frame %llu (%.1f KB), max %llu, %d of %d frames free",
+        (unsigned long long)memoryFrames.frameAllocations, memoryFrames.frameBytes / 1024.0,
+        (unsigned long long)memoryFrames.maxFrameAllocations, memoryFrames.allocationFreeFrames, memoryFrames.frames);
+    drawOverlayText(12, 4 + memoryTop + lineHeight * (MEMORY_TAG_COUNT + 2), line);
+
+    // Present interval histogram and hitches
+    glColor3f(1.0f, 1.0f, 0.6f);
+    int length = snprintf(line, sizeof(line), "%-10s", "present ms");
+    for (int bucket = 0; bucket < PACING_BUCKET_COUNT; bucket++) {
+        length += snprintf(line + length, sizeof(line) - length, "%6s", PACING_BUCKET_NAMES[bucket]);
+    }
+    drawOverlayText(12, 4 + pacingTop + lineHeight, line);
+    glColor3f(1.0f, 1.0f, 1.0f);
+    length = snprintf(line, sizeof(line), "%-10s", "frames");
+    for (int bucket = 0; bucket < PACING_BUCKET_COUNT; bucket++) {
+        length += snprintf(line + length, sizeof(line) - length, "%6d", std::min(framePacing.histogram[bucket], 999999));
+    }
+    drawOverlayText(12, 4 + pacingTop + lineHeight * 2, line);
+    snprintf(line, sizeof(line), "hitches >%.0f ms: %d, last %.1f ms (%s %.1f ms)", hitchThresholdMs, framePacing.hitches,
+        framePacing.lastHitchMs, framePacing.hitches > 0 ? pacingCauseName(framePacing.lastHitchCause) : "-",
+        framePacing.lastHitchCostMs);
+    drawOverlayText(12, 4 + pacingTop + lineHeight * 3, line);
+    snprintf(line, sizeof(line), "worst %.1f ms (%s %.1f ms)", framePacing.worstMs,
+        framePacing.hitches > 0 ? pacingCauseName(framePacing.worstCause) : "-", framePacing.worstCostMs);
+    drawOverlayText(12, 4 + pacingTop + lineHeight * 4, line);
+    snprintf(line, sizeof(line), "scene graph: %d of %d world matrices recomputed", sceneGraph.lastFrameUpdates,
+        (int)sceneGraph.nodes.size());
+    drawOverlayText(12, 4 + pacingTop + lineHeight * 5, line);
+
+    glPopMatrix();
+    glMatrixMode(GL_PROJECTION);
+    glPopMatrix();
+    glMatrixMode(GL_MODELVIEW);
+    glPopAttrib();
+}
+
+//=============================================================================
+// GL CALL COUNTING
+//=============================================================================
+
+/**
+ * Building with COUNT_GL_CALLS routes the scene's heaviest GL entry points through counting
+ * wrappers. Calls, vertices and redundant state changes (binding the bound texture, enabling
+ * an enabled cap, setting a material or light value it already has) are counted per frame
+ * and attributed to the innermost PROFILE_PASS, i.e. the draw function that issued them.
+ * Per-frame averages are printed at exit and added to the --bench JSON. The state queries
+ * make this build slower; without the flag none of it is compiled.
+ */
+
+#ifdef COUNT_GL_CALLS
+enum GLCounter {
+    GL_COUNT_BEGIN,               // glBegin
+    GL_COUNT_VERTICES,            // glVertex* plus glDrawArrays/glDrawElements counts
+    GL_COUNT_BIND_TEXTURE,
+    GL_COUNT_REDUNDANT_BIND,
+    GL_COUNT_ENABLE,              // glEnable and glDisable
+    GL_COUNT_REDUNDANT_ENABLE,
+    GL_COUNT_PUSH_MATRIX,
+    GL_COUNT_MATERIAL,            // glMaterialfv
+    GL_COUNT_REDUNDANT_MATERIAL,
+    GL_COUNT_LIGHT,               // glLightfv
+    GL_COUNT_REDUNDANT_LIGHT,
+    GL_COUNT_NEW_QUADRIC,
+    GL_COUNTER_COUNT
+};
+
+const char* GL_COUNTER_NAMES[GL_COUNTER_COUNT] = {
+    "begin", "vertices", "bind", "redundant bind", "enable", "redundant enable",
+    "push matrix", "material", "redundant material", "light", "redundant light", "new quadric"
+};
+
+struct GLCallCounts {
+    ProfileSection section = PROFILE_FRAME;  // Innermost pass; PROFILE_FRAME outside any pass
+    bool insideBegin = false;                // State queries are invalid between glBegin and glEnd
+    bool inFrame = false;                    // Only calls made inside displayCB are counted
+    uint64_t current[PROFILE_SECTION_COUNT][GL_COUNTER_COUNT] = {};
+    uint64_t total[PROFILE_SECTION_COUNT][GL_COUNTER_COUNT] = {};
+    int frames = 0;
+} glCallCounts;
+
+// Attributes GL calls in its scope to a pass; part of PROFILE_PASS
+struct GLCountScope {
+    ProfileSection previous;
+
+    explicit GLCountScope(ProfileSection section) : previous(glCallCounts.section) {
+        glCallCounts.section = section;
+    }
+    ~GLCountScope() {
+        glCallCounts.section = previous;
+    }
+};
+
+void countGLCall(GLCounter counter, uint64_t amount = 1) {
+    if (glCallCounts.inFrame) glCallCounts.current[glCallCounts.section][counter] += amount;
+}
+
+// True when the first `count` values of a parameter already match
+bool sameGLValues(const GLfloat* current, const GLfloat* requested, int count) {
+    for (int i = 0; i < count; i++) {
+        if (current[i] != requested[i]) return false;
+    }
+    return true;
+}
+
+void countedBegin(GLenum mode) {
+    countGLCall(GL_COUNT_BEGIN);
+    glCallCounts.insideBegin = true;
+    glBegin(mode);
+}
+
+void countedEnd() {
+    glCallCounts.insideBegin = false;
+    glEnd();
+}
+
+void countedVertex2f(GLfloat x, GLfloat y) { countGLCall(GL_COUNT_VERTICES); glVertex2f(x, y); }
+void countedVertex3f(GLfloat x, GLfloat y, GLfloat z) { countGLCall(GL_COUNT_VERTICES); glVertex3f(x, y, z); }
+void countedVertex3d(GLdouble x, GLdouble y, GLdouble z) { countGLCall(GL_COUNT_VERTICES); glVertex3d(x, y, z); }
+void countedVertex3fv(const GLfloat* v) { countGLCall(GL_COUNT_VERTICES); glVertex3fv(v); }
+
+void countedDrawArrays(GLenum mode, GLint first, GLsizei count) {
+    countGLCall(GL_COUNT_VERTICES, count);
+    glDrawArrays(mode, first, count);
+}
+
+void countedDrawElements(GLenum mode, GLsizei count, GLenum type, const void* indices) {
+    countGLCall(GL_COUNT_VERTICES, count);
+    glDrawElements(mode, count, type, indices);
+}
+
+void countedBindTexture(GLenum target, GLuint texture) {
+    countGLCall(GL_COUNT_BIND_TEXTURE);
+    if (target == GL_TEXTURE_2D && !glCallCounts.insideBegin) {
+        GLint bound = 0;
+        glGetIntegerv(GL_TEXTURE_BINDING_2D, &bound);
+        if ((GLuint)bound == texture) countGLCall(GL_COUNT_REDUNDANT_BIND);
+    }
+    glBindTexture(target, texture);
+}
+
+void countedEnable(GLenum cap) {
+    countGLCall(GL_COUNT_ENABLE);
+    if (!glCallCounts.insideBegin && glIsEnabled(cap)) countGLCall(GL_COUNT_REDUNDANT_ENABLE);
+    glEnable(cap);
+}
+
+void countedDisable(GLenum cap) {
+    countGLCall(GL_COUNT_ENABLE);
+    if (!glCallCounts.insideBegin && !glIsEnabled(cap)) countGLCall(GL_COUNT_REDUNDANT_ENABLE);
+    glDisable(cap);
+}
+
+void countedPushMatrix() {
+    countGLCall(GL_COUNT_PUSH_MATRIX);
+    glPushMatrix();
+}
+
+void countedMaterialfv(GLenum face, GLenum pname, const GLfloat* params) {
+    countGLCall(GL_COUNT_MATERIAL);
+    if (!glCallCounts.insideBegin) {
+        GLenum queryFace = face == GL_BACK ? GL_BACK : GL_FRONT;
+        GLfloat current[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        bool redundant = false;
+        if (pname == GL_SHININESS) {
+            glGetMaterialfv(queryFace, pname, current);
+            redundant = sameGLValues(current, params, 1);
+        }
+        else if (pname == GL_AMBIENT_AND_DIFFUSE) {
+            glGetMaterialfv(queryFace, GL_AMBIENT, current);
+            redundant = sameGLValues(current, params, 4);
+            glGetMaterialfv(queryFace, GL_DIFFUSE, current);
+            redundant = redundant && sameGLValues(current, params, 4);
+        }
+        else if (pname != GL_COLOR_INDEXES) {
+            glGetMaterialfv(queryFace, pname, current);
+            redundant = sameGLValues(current, params, 4);
+        }
+        if (redundant) countGLCall(GL_COUNT_REDUNDANT_MATERIAL);
+    }
+    glMaterialfv(face, pname, params);
+}
+
+void countedLightfv(GLenum light, GLenum pname, const GLfloat* params) {
+    countGLCall(GL_COUNT_LIGHT);
+    // Position and spot direction are stored in eye space, so they cannot be compared with the input
+    if (!glCallCounts.insideBegin && pname != GL_POSITION && pname != GL_SPOT_DIRECTION) {
+        GLfloat current[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        glGetLightfv(light, pname, current);
+        bool colour = pname == GL_AMBIENT || pname == GL_DIFFUSE || pname == GL_SPECULAR;
+        if (sameGLValues(current, params, colour ? 4 : 1)) countGLCall(GL_COUNT_REDUNDANT_LIGHT);
+    }
+    glLightfv(light, pname, params);
+}
+
+GLUquadric* countedNewQuadric() {
+    countGLCall(GL_COUNT_NEW_QUADRIC);
+    return gluNewQuadric();
+}
+
+void beginGLCallFrame() {
+    memset(glCallCounts.current, 0, sizeof(glCallCounts.current));
+    glCallCounts.inFrame = true;
+}
+
+void endGLCallFrame() {
+    glCallCounts.inFrame = false;
+    for (int section = 0; section < PROFILE_SECTION_COUNT; section++) {
+        for (int counter = 0; counter < GL_COUNTER_COUNT; counter++) {
+            glCallCounts.total[section][counter] += glCallCounts.current[section][counter];
+        }
+    }
+    glCallCounts.frames++;
+}
+
+// Per-frame averages as a JSON object keyed by pass, then counter
+void writeGLCallCountsJson(std::ostream& out) {
+    int frames = std::max(glCallCounts.frames, 1);
+    out << "{";
+    for (int section = 0; section < PROFILE_SECTION_COUNT; section++) {
+        out << (section > 0 ? ",\n" : "\n") << "\"" << PROFILE_SECTION_NAMES[section] << "\":{";
+        for (int counter = 0; counter < GL_COUNTER_COUNT; counter++) {
+            out << (counter > 0 ? "," : "") << "\"" << GL_COUNTER_NAMES[counter] << "\":"
+                << (double)glCallCounts.total[section][counter] / frames;
+        }
+        out << "}";
+    }
+    out << "}";
+}
+
+// Table of per-frame averages, printed at exit
+void reportGLCallCounts() {
+    if (glCallCounts.frames == 0) return;
+    printf("GL calls per frame over %d frames (COUNT_GL_CALLS)\n", glCallCounts.frames);
+    printf("%-16s", "pass");
+    for (int counter = 0; counter < GL_COUNTER_COUNT; counter++) {
+        printf(" %9.9s", GL_COUNTER_NAMES[counter]);
+    }
+    printf("\n");
+    for (int section = 0; section < PROFILE_SECTION_COUNT; section++) {
+        printf("%-16s", PROFILE_SECTION_NAMES[section]);
+        for (int counter = 0; counter < GL_COUNTER_COUNT; counter++) {
+            printf(" %9.1f", (double)glCallCounts.total[section][counter] / glCallCounts.frames);
+        }
+        printf("\n");
+    }
+}
+
+// Everything after this point goes through the counters
+#define glBegin(mode) countedBegin(mode)
+#define glEnd() countedEnd()
+#define glVertex2f(x, y) countedVertex2f(x, y)
+#define glVertex3f(x, y, z) countedVertex3f(x, y, z)
+#define glVertex3d(x, y, z) countedVertex3d(x, y, z)
+#define glVertex3fv(v) countedVertex3fv(v)
+#define glDrawArrays(mode, first, count) countedDrawArrays(mode, first, count)
+#define glDrawElements(mode, count, type, indices) countedDrawElements(mode, count, type, indices)
+#define glBindTexture(target, texture) countedBindTexture(target, texture)
+#define glEnable(cap) countedEnable(cap)
+#define glDisable(cap) countedDisable(cap)
+#define glPushMatrix() countedPushMatrix()
+#define glMaterialfv(face, pname, params) countedMaterialfv(face, pname, params)
+#define glLightfv(light, pname, params) countedLightfv(light, pname, params)
+#define gluNewQuadric() countedNewQuadric()
+#endif
+
+
+// Function declarations for managing the Snake game logic and rendering.
+void snake_init();                       // Initializes the Snake game variables.
+void snake_display();                    // Renders the Snake game on screen.
+void snake_timer(int);                   // Timer function for Snake game logic updates.
+void snake_restart_game();               // Resets the Snake game state to initial conditions.
+void snake_create_fireworks(float x, float y, float z); // Creates fireworks at a specified position.
+void snake_update_fireworks();           // Updates the positions and states of fireworks particles.
+void snake_draw_fireworks();             // Draws the fireworks particles on screen.
+void snake_draw_cube(float x, float y, float z, float size, float r, float g, float b); // Draws a colored cube in the game.
+void snake_draw_grid();                  // Renders the grid for the Snake game.
+void snake_draw_snake_lines();           // Draws connecting lines for the snake's body.
+void snake_draw_text_3d(const std::string& text, float x, float y, float z, float scale, float depth); // Renders 3D text.
+
+// Saves the current OpenGL state by storing all attributes and the current transformation matrix.
+void saveGLState() {
+    glPushAttrib(GL_ALL_ATTRIB_BITS); // Saves all OpenGL attributes (e.g., colors, lighting, textures).
+    glPushMatrix();                   // Saves the current transformation matrix.
+}
+
+// Restores the previously saved OpenGL state.
+void restoreGLState() {
+    glPopMatrix();                    // Restores the transformation matrix to the last saved state.
+    glPopAttrib();                    // Restores all OpenGL attributes to their previous values.
+}
+
+// Helper function to render a hemisphere using quadrilateral strips.
+// @param radius: Radius of the hemisphere.
+// @param startAngle: Starting latitude angle in degrees.
+// @param endAngle: Ending latitude angle in degrees.
+void drawHemisphere(float radius, float startAngle, float endAngle) {
+    int latSegments = 50;           // Number of segments along the latitude (vertical slices).
+    int lonSegments = 50;           // Number of segments along the longitude (horizontal slices).
+
+    // Convert angle ranges from degrees to radians.
+    float latStart = startAngle * M_PI / 180.0f;
+    float latEnd = endAngle * M_PI / 180.0f;
+
+    // Step size for latitude and longitude divisions.
+    float latStep = (latEnd - latStart) / latSegments;
+    float lonStep = 2.0f * M_PI / lonSegments;
+
+    // Iterate through latitude and longitude segments to render the hemisphere.
+    for (int i = 0; i < latSegments; ++i) {
+        float lat0 = latStart + i * latStep;         // Starting latitude for the current segment.
+        float lat1 = latStart + (i + 1) * latStep;   // Ending latitude for the current segment.
+
+        glBegin(GL_QUAD_STRIP); // Begin drawing a strip of quadrilaterals.
+        for (int j = 0; j <= lonSegments; ++j) {
+            float lon = j * lonStep; // Current longitude angle.
+
+            // First vertex on the current latitude.
+            float x0 = radius * sinf(lat0) * cosf(lon);
+            float y0 = radius * cosf(lat0);
+            float z0 = radius * sinf(lat0) * sinf(lon);
+            float s0 = (float)j / lonSegments;  // Texture coordinate (s).
+            float t0 = (float)i / latSegments;  // Texture coordinate (t).
+
+            glTexCoord2f(s0, t0);              // Set texture coordinates for the first vertex.
+            glVertex3f(x0, y0, z0);            // Specify the position of the first vertex.
+
+            // Second vertex on the next latitude.
+            float x1 = radius * sinf(lat1) * cosf(lon);
+            float y1 = radius * cosf(lat1);
+            float z1 = radius * sinf(lat1) * sinf(lon);
+            float t1 = (float)(i + 1) / latSegments; // Texture coordinate (t) for the second vertex.
+
+            glTexCoord2f(s0, t1);              // Set texture coordinates for the second vertex.
+            glVertex3f(x1, y1, z1);            // Specify the position of the second vertex.
+        }
+        glEnd(); // End the current strip.
+    }
+}
+
+// Renders a textured sphere representing the sky.
+// @param radius: Radius of the sky sphere.
+void drawSkySphere(float radius) {
+    glEnable(GL_TEXTURE_2D);                             // Enable 2D texture mapping.
+    glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE); // Use modulate mode for combining texture and color.
+    GLUquadric* quad = gluNewQuadric();                  // Create a new quadric object for rendering.
+    gluQuadricTexture(quad, GL_TRUE);                    // Enable texture mapping on the quadric.
+    gluQuadricNormals(quad, GLU_SMOOTH);                 // Set normals for smooth shading.
+    gluSphere(quad, radius, 64, 64);                     // Render a sphere with the specified radius and detail.
+    gluDeleteQuadric(quad);                              // Delete the quadric object to free memory.
+    glDisable(GL_TEXTURE_2D);                            // Disable 2D texture mapping.
+}
+
+// Structure representing a particle used for simulating rain.
+struct RainParticle {
+    float x, y, z;      // Position of the particle in 3D space.
+    float speedY;       // Falling speed of the particle along the Y-axis.
+};
+
+// Container for managing a collection of rain particles.
+TaggedVector<RainParticle, MEMORY_RAIN> rainParticles;
+
+// Flag indicating whether the rain effect is active.
+bool isRaining = false;
+
+// Maximum number of rain particles allowed in the simulation.
+int maxRainParticles = 4000;
+
+// Initialize rain particles within the scene
+void initRainParticles() {
+    rainParticles.clear();  // Clear any existing rain particles from the list
+
+    // Define boundaries for the grass area where the rain will fall
+    float grassMinX = -50.0f;
+    float grassMaxX = 50.0f;
+    float grassMinZ = -50.0f;
+    float grassMaxZ = 50.0f;
+    float rainHeight = 100.0f;  // Starting height of rain droplets (above the scene)
+
+    // Generate rain particles and assign random positions within the specified boundaries
+    for (int i = 0; i < maxRainParticles; ++i) {
+        RainParticle particle;
+        grassMinX + static_cast<float>(rand()) / RAND_MAX * (grassMaxX - grassMinX);
+        particle.x = grassMinX + static_cast<float>(rand()) / RAND_MAX * (grassMaxX - grassMinX);  // Random X within grass area
+        particle.y = rainHeight + static_cast<float>(rand()) / RAND_MAX * 50.0f;  // Randomize Y (height) for rain
+        particle.z = grassMinZ + static_cast<float>(rand()) / RAND_MAX * (grassMaxZ - grassMinZ);  // Random Z within grass area
+        particle.speedY = 20.0f + static_cast<float>(rand()) / RAND_MAX * 10.0f;  // Randomize fall speed for each particle
+        rainParticles.push_back(particle);  // Add the particle to the rain collection
+    }
+}
+
+// Update the positions of rain particles based on elapsed time (deltaTime)
+void updateRainParticles(float deltaTime) {
+    for (auto& particle : rainParticles) {
+        particle.y -= particle.speedY * deltaTime;  // Update Y position based on speed and elapsed time
+
+        // Reset the particle if it has fallen below the ground level
+        if (particle.y <= -1.5f) {
+            // Reinitialize particle to simulate continuous falling
+            particle.y = 100.0f + static_cast<float>(rand()) / RAND_MAX * 50.0f;  // Reset to a random height
+            // Randomize X and Z positions within the grass area
+            particle.x = GRASS_MIN_X + static_cast<float>(rand()) / RAND_MAX * (GRASS_MAX_X - GRASS_MIN_X);
+            particle.z = GRASS_MIN_Z + static_cast<float>(rand()) / RAND_MAX * (GRASS_MAX_Z - GRASS_MIN_Z);
+        }
+    }
+}
+
+// Render rain particles to the screen, creating the visual effect of falling rain
+void drawRainParticles() {
+    PROFILE_PASS(PROFILE_RAIN);
+    if (!isRaining) return;
+
+    glPushMatrix();
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glDisable(GL_LIGHTING);
+
+    // 设置更细的线宽
+    glLineWidth(1.4f); // 减小线宽，使雨滴更细
+
+    // 调整雨滴颜色和透明度，使其更细腻
+    glColor4f(0.7f, 0.7f, 1.0f, 0.4f); // 降低不透明度，使雨滴看起来更细
+
+    // 添加风向效果
+    float windAngle = 15.0f;
+    float windStrength = 0.2f;
+
+    glBegin(GL_LINES);
+    for (const auto& particle : rainParticles) {
+        // 减小雨滴长度
+        float length = (renderRand() % 3 + 6) / 10.0f; // 减小长度范围，使雨滴更短
+
+        // 计算风的影响
+        float xOffset = length * windStrength * cos(windAngle * M_PI / 180.0f);
+        float zOffset = length * windStrength * sin(windAngle * M_PI / 180.0f);
+
+        glVertex3f(particle.x, particle.y, particle.z);
+        glVertex3f(particle.x + xOffset, particle.y - length, particle.z + zOffset);
+    }
+    glEnd();
+
+    // 恢复默认线宽
+    glLineWidth(1.0f);
+
+    glEnable(GL_LIGHTING);
+    glDisable(GL_BLEND);
+    glPopMatrix();
+}
+
+
+
+// Generate a lightning bolt with random zigzag points within the scene
+void generateLightningBolt() {
+    currentLightning.points.clear();  // Clear any previous lightning points
+    currentLightning.duration = 0.4f;  // Set the duration of the lightning (in seconds)
+    currentLightning.elapsedTime = 0.0f;  // Initialize the elapsed time for lightning
+    currentLightning.active = true;  // Set the lightning to be active
+
+    // Randomly generate the starting position of the lightning in the rain area
+    float startX = GRASS_MIN_X + static_cast<float>(rand()) / RAND_MAX * (GRASS_MAX_X - GRASS_MIN_X);
+    float startY = 100.0f;  // Lightning starts high in the sky
+    float startZ = GRASS_MIN_Z + static_cast<float>(rand()) / RAND_MAX * (GRASS_MAX_Z - GRASS_MIN_Z);
+
+    // Randomly generate the end position near the ground, with a slight random offset
+    float endX = startX + (static_cast<float>(rand()) / RAND_MAX - 0.5f) * 20.0f;
+    float endY = 0.0f;  // Lightning ends at ground level
+    float endZ = startZ + (static_cast<float>(rand()) / RAND_MAX - 0.5f) * 20.0f;
+
+    // Generate the lightning path using random segments to create a zigzag pattern
+    int numSegments = 10;  // Define the number of zigzag segments
+    float segmentLengthY = (startY - endY) / numSegments;  // Length of each segment in the Y direction
+    float prevX = startX, prevY = startY, prevZ = startZ;
+    currentLightning.points.push_back({ prevX, prevY, prevZ });  // Add the starting point
+
+    // Generate intermediate lightning points between the start and end
+    for (int i = 1; i <= numSegments; ++i) {
+        float nextX = prevX + (static_cast<float>(rand()) / RAND_MAX - 0.5f) * 10.0f;
+        float nextY = prevY - segmentLengthY;
+        float nextZ = prevZ + (static_cast<float>(rand()) / RAND_MAX - 0.5f) * 10.0f;
+        currentLightning.points.push_back({ nextX, nextY, nextZ });
+        prevX = nextX;
+        prevY = nextY;
+        prevZ = nextZ;
+    }
+}
+
+// Render a full-screen lightning flash effect
+void drawLightningFlash() {
+    if (!isRaining || !isLightningActive) return;  // Exit if it's not raining or lightning is inactive
+
+    glPushAttrib(GL_ENABLE_BIT | GL_COLOR_BUFFER_BIT);  // Save current OpenGL attributes
+    glDisable(GL_DEPTH_TEST);  // Disable depth testing to ensure the flash renders over everything
+    glDisable(GL_LIGHTING);    // Disable lighting to avoid interaction with the flash
+    glEnable(GL_BLEND);        // Enable alpha blending for the flash effect
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);  // Set standard alpha blending
+
+    // Calculate flash intensity based on the lightning duration, normalized to the [0, 1] range
+    float flashIntensity = lightningDuration / 0.2f;
+    glColor4f(1.0f, 1.0f, 1.0f, flashIntensity);  // Set color to white with intensity based on flash duration
+
+    // Draw a full-screen quad to simulate the flash
+    glMatrixMode(GL_PROJECTION);
+    glPushMatrix();
+    glLoadIdentity();
+    gluOrtho2D(0, screenWidth, 0, screenHeight);  // Set orthogonal projection for screen space
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glLoadIdentity();
+
+    glBegin(GL_QUADS);
+    glVertex2f(0, 0);
+    glVertex2f(screenWidth, 0);
+    glVertex2f(screenWidth, screenHeight);
+    glVertex2f(0, screenHeight);
+    glEnd();
+
+    // Restore the matrix state after rendering the flash
+    glPopMatrix();
+    glMatrixMode(GL_PROJECTION);
+    glPopMatrix();
+    glMatrixMode(GL_MODELVIEW);
+
+    glPopAttrib();  // Restore OpenGL attributes
+}
+
+// Render the lightning bolt as a line
+void drawLightningBolt() {
+    if (!isRaining || !isLightningActive) return;  // Exit if it's not raining or lightning is inactive
+
+    glColor3f(1.0f, 1.0f, 1.0f);  // Set color for lightning (white)
+
+    glPushAttrib(GL_ENABLE_BIT);  // Save current OpenGL attributes
+    glDisable(GL_LIGHTING);  // Disable lighting for brightness effect
+
+    // Draw the lightning bolt using lines
+    glBegin(GL_LINES);
+    // Randomize the starting position for the lightning around the character
+    float startX = manPositionX + (renderRand() % 20 - 10);
+    float startY = 100.0f;  // Start in the sky
+    float startZ = manPositionZ + (renderRand() % 20 - 10);
+
+    // Set the ending point on the ground
+    float endX = startX + (renderRand() % 10 - 5);
+    float endY = -5.0f;  // Ground level
+    float endZ = startZ + (renderRand() % 10 - 5);
+
+    glVertex3f(startX, startY, startZ);  // Start point of lightning
+    glVertex3f(endX, endY, endZ);        // End point of lightning
+    glEnd();
+
+    glPopAttrib();  // Restore OpenGL attributes
+}
+
+// Update lightning bolt state, managing timing and effects
+void updateLightningBolt(float deltaTime) {
+    if (!isRaining) return;
+
+    lightningTimer -= deltaTime;
+    if (lightningTimer <= 0.0f) {
+        isLightningActive = true;
+        lightningDuration = 0.2f;
+        lightningTimer = rand() % 10 - 3;
+        sceneBrightness = 2.5f;
+    }
+
+    if (isLightningActive) {
+        lightningDuration -= deltaTime;
+
+        if (lightningDuration <= 0.0f) {
+            isLightningActive = false;
+            sceneBrightness = 1.0f;
+        }
+    }
+}
+
+// Initialize the Snake Game environment
+void snake_init() {
+    // Set the background color (light blue)
+    glClearColor(0.5f, 0.7f, 1.0f, 1.0f);
+
+    // Enable depth testing for 3D rendering
+    glEnable(GL_DEPTH_TEST);
+
+    // Enable lighting and set up a light source
+    glEnable(GL_LIGHTING);
+    glEnable(GL_LIGHT0);
+
+    // Configure the position of the light source
+    GLfloat light_pos[] = { (snake_grid_columns * snake_cell_size) / 2.0f, 50.0f, (snake_grid_rows * snake_cell_size) / 2.0f, 1.0f };
+    GLfloat light_ambient[] = { 0.5f, 0.5f, 0.5f, 1.0f };
+    GLfloat light_diffuse[] = { 1.0f, 1.0f, 1.0f, 1.0f };
+    glLightfv(GL_LIGHT0, GL_POSITION, light_pos);
+    glLightfv(GL_LIGHT0, GL_AMBIENT, light_ambient);
+    glLightfv(GL_LIGHT0, GL_DIFFUSE, light_diffuse);
+
+    // Enable color material to apply colors to the objects based on the material
+    glEnable(GL_COLOR_MATERIAL);
+    glColorMaterial(GL_FRONT, GL_AMBIENT_AND_DIFFUSE);
+
+    // Initialize the snake game state
+    snake_body.clear();
+    snake_dir = RIGHT;
+    snake_game_over = false;
+    snake_game_started = true;
+
+    // Set the initial position of the snake at the center of the grid
+    snake_body.push_back({ snake_grid_columns / 2, snake_grid_rows / 2 });
+
+    // Place the first food item at a random position within the grid, avoiding the snake's body
+    bool valid_position = false;
+    while (!valid_position) {
+        snake_food.x = (rand() % snake_grid_columns);
+        snake_food.y = (rand() % snake_grid_rows);
+        valid_position = true;
+        for (const auto& segment : snake_body) {
+            if (segment.x == snake_food.x && segment.y == snake_food.y) {
+                valid_position = false;
+                break;
+            }
+        }
+    }
+
+    // Start the game timer
+    scheduleTimer(150, snake_timer, 0);
+}
+
+// Create fireworks effect at a specific position in the Snake Game
+void snake_create_fireworks(float x, float y, float z) {
+    const int num_particles = 100;  // Number of particles in the fireworks
+    snake_fireworks.clear();  // Clear any previous fireworks
+
+    // Generate random particles for the fireworks
+    for (int i = 0; i < num_particles; ++i) {
+        SnakeParticle p;
+        p.x = x;
+        p.y = y;
+        p.z = z;
+        float speed = static_cast<float>(rand()) / RAND_MAX * 5.0f + 5.0f;  // Random speed
+        float angle1 = static_cast<float>(rand()) / RAND_MAX * M_PI * 2;  // Random angle for direction
+        float angle2 = static_cast<float>(rand()) / RAND_MAX * M_PI;  // Random angle for direction
+
+        // Calculate particle velocity based on angles
+        p.vx = speed * sin(angle2) * cos(angle1);
+        p.vy = speed * cos(angle2);
+        p.vz = speed * sin(angle2) * sin(angle1);
+
+        // Randomize color for the fireworks
+        p.r = static_cast<float>(rand()) / RAND_MAX;
+        p.g = static_cast<float>(rand()) / RAND_MAX;
+        p.b = static_cast<float>(rand()) / RAND_MAX;
+
+        p.life = 1.2f;  // Lifespan of each particle (in seconds)
+
+        snake_fireworks.push_back(p);  // Add particle to the fireworks collection
+    }
+}
+
+// Update the state of the fireworks particles
+void snake_update_fireworks() {
+    float delta_time = 0.05f;  // Time step for the update
+
+    // Update each particle's position based on its velocity
+    for (auto& p : snake_fireworks) {
+        p.x += p.vx * delta_time;
+        p.y += p.vy * delta_time;
+        p.z += p.vz * delta_time;
+        p.vy -= 9.8f * delta_time;  // Apply gravity (negative Y-velocity)
+        p.life -= delta_time * 0.5f;  // Gradually reduce lifespan for fading effect
+    }
+
+    // Remove any particles that have expired (life <= 0)
+    snake_fireworks.erase(
+        std::remove_if(snake_fireworks.begin(), snake_fireworks.end(),
+            [](const SnakeParticle& p) { return p.life <= 0.0f; }),
+        snake_fireworks.end()
+    );
+}
+
+// Render the fireworks to the screen
+void snake_draw_fireworks() {
+    glDisable(GL_LIGHTING);  // Disable lighting for particles to ensure full color visibility
+    glPointSize(4.0f);  // Set the size of the points (particles)
+    glBegin(GL_POINTS);
+    for (const auto& p : snake_fireworks) {
+        glColor4f(p.r, p.g, p.b, p.life);  // Set color with alpha (transparency based on life)
+        glVertex3f(p.x, p.y, p.z);  // Draw each particle as a point in 3D space
+    }
+    glEnd();
+    glEnable(GL_LIGHTING);  // Re-enable lighting after rendering the fireworks
+}
+
+// Restart the Snake Game, reinitializing all necessary components
+void snake_restart_game() {
+    snake_init();  // Call the init function to reset the game state
+}
+
+// Timer logic for the Snake Game
+void snake_timer(int) {
+    if (!snake_game_over && currentGameState == SNAKE_GAME) {
+        // Move the snake's head according to the current direction
+        Position head = snake_body.front();
+        switch (snake_dir) {
+        case UP:    head.y += 1; break;
+        case DOWN:  head.y -= 1; break;
+        case LEFT:  head.x -= 1; break;
+        case RIGHT: head.x += 1; break;
+        }
 
         // Check for collision with the boundaries of the game grid
         if (head.x < 0 || head.x >= snake_grid_columns || head.y < 0 || head.y >= snake_grid_rows) {
             snake_game_over = true;
-            glutPostRedisplay();
+            postRedisplay();
             return;
         }
 
-        // Check for collision with the snake's body (self-collision)
-        for (const auto& segment : snake_body) {
-            if (segment.x == head.x && segment.y == head.y) {
-                snake_game_over = true;
-                glutPostRedisplay();
-                return;
+        // Check for collision with the snake's body (self-collision)
+        for (const auto& segment : snake_body) {
+            if (segment.x == head.x && segment.y == head.y) {
+                snake_game_over = true;
+                postRedisplay();
+                return;
+            }
+        }
+
+        // Add the new head position to the front of the snake body
+        snake_body.insert(snake_body.begin(), head);
+
+        // Check if the snake has eaten food
+        if (head.x == snake_food.x && head.y == snake_food.y) {
+            // Trigger the fireworks effect upon food consumption
+            snake_create_fireworks((snake_food.x + 0.5f) * snake_cell_size, snake_cell_size,
+                (snake_food.y + 0.5f) * snake_cell_size);
+
+            // Generate new food at a valid position
+            bool valid_position = false;
+            while (!valid_position) {
+                snake_food.x = rand() % snake_grid_columns;
+                snake_food.y = rand() % snake_grid_rows;
+                valid_position = true;
+                // Ensure that food does not overlap with the snake's body
+                for (const auto& segment : snake_body) {
+                    if (segment.x == snake_food.x && segment.y == snake_food.y) {
+                        valid_position = false;
+                        break;
+                    }
+                }
+            }
+        }
+        else {
+            // Remove the tail to maintain the snake's constant length
+            snake_body.pop_back();
+        }
+
+        // Update fireworks if active
+        if (!snake_fireworks.empty()) {
+            snake_update_fireworks();
+        }
+
+        postRedisplay();
+        scheduleTimer(150, snake_timer, 0); // Set the game speed with a timer
+    }
+}
+
+// Function to render a cube in the Snake Game
+void snake_draw_cube(float x, float y, float z, float size, float r, float g, float b) {
+    glPushMatrix();
+    glTranslatef((x + 0.5f) * snake_cell_size, y * snake_cell_size, (z + 0.5f) * snake_cell_size);
+    glColor3f(r, g, b); // Set color based on the input values
+    solidCube(size * snake_cell_size); // Draw a cube with the given size
+    glPopMatrix();
+}
+
+// Function to render the game grid for the Snake Game
+void snake_draw_grid() {
+    // Draw the grid floor
+    glColor3f(0.8f, 0.8f, 0.8f); // Light gray color
+    glBegin(GL_QUADS);
+    glNormal3f(0.0f, 1.0f, 0.0f);
+    glVertex3f(0, 0.0f, 0);
+    glVertex3f(snake_grid_columns * snake_cell_size, 0.0f, 0);
+    glVertex3f(snake_grid_columns * snake_cell_size, 0.0f, snake_grid_rows * snake_cell_size);
+    glVertex3f(0, 0.0f, snake_grid_rows * snake_cell_size);
+    glEnd();
+
+    // Enable anti-aliasing for smooth lines
+    glEnable(GL_LINE_SMOOTH);
+    glHint(GL_LINE_SMOOTH_HINT, GL_NICEST);
+    glLineWidth(1.0f); // Set a uniform line width
+
+    // Draw grid lines
+    glColor3f(0.2f, 0.6f, 0.2f); // Green grid lines
+    glBegin(GL_LINES);
+    // Vertical grid lines
+    for (int i = 0; i <= snake_grid_columns; ++i) {
+        float x = i * snake_cell_size;
+        glVertex3f(x, 0.02f, 0);
+        glVertex3f(x, 0.02f, snake_grid_rows * snake_cell_size);
+    }
+    // Horizontal grid lines
+    for (int j = 0; j <= snake_grid_rows; ++j) {
+        float z = j * snake_cell_size;
+        glVertex3f(0, 0.02f, z);
+        glVertex3f(snake_grid_columns * snake_cell_size, 0.02f, z);
+    }
+    glEnd();
+
+    // Disable anti-aliasing
+    glDisable(GL_LINE_SMOOTH);
+
+    // Draw decorative walls
+    glColor3f(0.7f, 0.4f, 0.1f); // Brown walls
+    float wall_height = 5.0f * snake_cell_size;
+
+    // Left wall
+    glBegin(GL_QUADS);
+    glNormal3f(1.0f, 0.0f, 0.0f);
+    glVertex3f(0, 0, 0);
+    glVertex3f(0, 0, snake_grid_rows * snake_cell_size);
+    glVertex3f(0, wall_height, snake_grid_rows * snake_cell_size);
+    glVertex3f(0, wall_height, 0);
+    glEnd();
+
+    // Right wall
+    glBegin(GL_QUADS);
+    glNormal3f(-1.0f, 0.0f, 0.0f);
+    glVertex3f(snake_grid_columns * snake_cell_size, 0, 0);
+    glVertex3f(snake_grid_columns * snake_cell_size, 0, snake_grid_rows * snake_cell_size);
+    glVertex3f(snake_grid_columns * snake_cell_size, wall_height, snake_grid_rows * snake_cell_size);
+    glVertex3f(snake_grid_columns * snake_cell_size, wall_height, 0);
+    glEnd();
+
+    // Back wall
+    glBegin(GL_QUADS);
+    glNormal3f(0.0f, 0.0f, -1.0f);
+    glVertex3f(0, 0, snake_grid_rows * snake_cell_size);
+    glVertex3f(snake_grid_columns * snake_cell_size, 0, snake_grid_rows * snake_cell_size);
+    glVertex3f(snake_grid_columns * snake_cell_size, wall_height, snake_grid_rows * snake_cell_size);
+    glVertex3f(0, wall_height, snake_grid_rows * snake_cell_size);
+    glEnd();
+
+    // Front wall
+    glBegin(GL_QUADS);
+    glNormal3f(0.0f, 0.0f, 1.0f);
+    glVertex3f(0, 0, 0);
+    glVertex3f(snake_grid_columns * snake_cell_size, 0, 0);
+    glVertex3f(snake_grid_columns * snake_cell_size, wall_height, 0);
+    glVertex3f(0, wall_height, 0);
+    glEnd();
+}
+
+// Function to draw the connecting lines between snake segments
+void snake_draw_snake_lines() {
+    glLineWidth(5.0f);
+    glColor3f(1.0f, 0.5f, 0.0f); // Core color (orange)
+
+    float half_cell_size = snake_cell_size / 2.0f;
+
+    for (size_t i = 0; i < snake_body.size(); ++i) {
+        Position current = snake_body[i];
+        Position next;
+        if (i < snake_body.size() - 1) {
+            next = snake_body[i + 1];
+        }
+        else {
+            next = current;
+        }
+
+        glPushMatrix();
+        glTranslatef((current.x + 0.5f) * snake_cell_size, 1.0f * snake_cell_size, (current.y + 0.5f) * snake_cell_size);
+
+        // Draw lines to represent the snake's body connections
+        glBegin(GL_LINES);
+        glColor3f(1.0f, 1.0f, 0.0f); // Edge color (yellow)
+
+        if (current.x == next.x) {
+            // Vertical line
+            glVertex3f(0, 0, -half_cell_size);
+            glVertex3f(0, 0, half_cell_size);
+        }
+        else if (current.y == next.y) {
+            // Horizontal line
+            glVertex3f(-half_cell_size, 0, 0);
+            glVertex3f(half_cell_size, 0, 0);
+        }
+        else {
+            // Diagonal turn (for corners)
+            glVertex3f(0, 0, 0);
+            if ((current.x - next.x) == 1 && (current.y - next.y) == 1) {
+                glVertex3f(-half_cell_size, 0, 0);
+                glVertex3f(0, 0, -half_cell_size);
+            }
+            else if ((current.x - next.x) == -1 && (current.y - next.y) == -1) {
+                glVertex3f(half_cell_size, 0, 0);
+                glVertex3f(0, 0, half_cell_size);
+            }
+            else if ((current.x - next.x) == -1 && (current.y - next.y) == 1) {
+                glVertex3f(half_cell_size, 0, 0);
+                glVertex3f(0, 0, -half_cell_size);
+            }
+            else if ((current.x - next.x) == 1 && (current.y - next.y) == -1) {
+                glVertex3f(-half_cell_size, 0, 0);
+                glVertex3f(0, 0, half_cell_size);
+            }
+        }
+        glEnd();
+
+        glPopMatrix();
+    }
+    glLineWidth(1.0f);
+}
+
+// Function to render 3D text with reduced thickness
+void snake_draw_text_3d(const std::string& text, float x, float y, float z, float scale, float depth) {
+    glPushMatrix();
+    glTranslatef(x, y, z);
+
+    // Rotate the text to face the camera
+    glRotatef(-40, 0, 0, 0);
+
+
+    glColor3f(1.0f, 0.0f, 0.0f); // Red front face of the text
+
+    for (float d = -depth / 4.0f; d <= depth / 4.0f; d += scale * 0.2f) { // 修改这里
+        glPushMatrix();
+        glTranslatef(0.0f, 0.0f, d);
+        glScalef(scale, scale, scale);
+        for (char c : text) {
+            strokeCharacter(GLUT_STROKE_ROMAN, c);
+        }
+        glPopMatrix();
+    }
+    glPopMatrix();
+}
+
+
+// Main display function for the Snake Game
+void snake_display() {
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    glLoadIdentity();
+    // Set up a global ambient light to increase overall scene brightness
+    GLfloat ambientLight[] = { 1.9f, 1.9f, 1.9f, 1.9f }; // Higher values will increase brightness
+    glLightfv(GL_LIGHT0, GL_AMBIENT, ambientLight);
+
+    // Set up the other spotlight or directional lights as usual
+    GLfloat diffuseLight[] = { 1.9f, 1.9f, 1.9f, 1.9f };  // White diffuse light
+    GLfloat position[] = { 20.0f, 20.0f, 20.0f, 20.0f };      // Light position
+    glLightfv(GL_LIGHT0, GL_DIFFUSE, diffuseLight);
+    glLightfv(GL_LIGHT0, GL_POSITION, position);
+    glEnable(GL_LIGHT0);  // Enable light source 0
+
+    // Set the camera view (perspective)
+    gluLookAt(
+        (snake_grid_columns * snake_cell_size) / 2.0f, 80.0f, (snake_grid_rows * snake_cell_size) + 20.0f,
+        (snake_grid_columns * snake_cell_size) / 2.0f, 0.0f, (snake_grid_rows * snake_cell_size) / 2.0f,
+        0.0f, 1.0f, 0.0f
+    );
+
+    // Draw the game grid
+    snake_draw_grid();
+
+    // Draw the snake's body
+    for (size_t i = 0; i < snake_body.size(); ++i) {
+        if (i == 0)
+            snake_draw_cube(snake_body[i].x, 0.5f, snake_body[i].y, 1.0f, 0.0f, 1.0f, 0.0f); // Head (green)
+        else
+            snake_draw_cube(snake_body[i].x, 0.5f, snake_body[i].y, 0.9f, 0.0f, 0.8f, 0.0f); // Body
+    }
+
+    // Draw the connecting lines for the snake
+    snake_draw_snake_lines();
+
+    // Draw the food object
+    snake_draw_cube(snake_food.x, 0.5f, snake_food.y, 1.0f, 1.0f, 0.0f, 0.0f); // Food (red)
+
+    // Render fireworks if any are present
+    if (!snake_fireworks.empty()) {
+        snake_draw_fireworks();
+    }
+
+    // Display "GAME OVER" text if the game has ended
+    if (snake_game_over) {
+        glColor3f(1.0f, 1.0f, 1.0f);
+        snake_draw_text_3d("GAME OVER",
+            (snake_grid_columns / 5) * snake_cell_size,
+            7.0f * snake_cell_size,
+            ((snake_grid_rows / 2.0f) - 2.0f) * snake_cell_size,
+            0.025f * snake_cell_size,
+            0.8f * snake_cell_size
+        );
+        snake_draw_text_3d("Press 'R' to Restart",
+            (snake_grid_columns / 10) * snake_cell_size,
+            1.0f * snake_cell_size,
+            ((snake_grid_rows / 2.0f) - 2.0f) * snake_cell_size,
+            0.02f * snake_cell_size,
+            0.6f * snake_cell_size
+        );
+    }
+
+
+
+    swapWindowBuffers();
+}
+
+//=============================================================================
+// BMP TEXTURE LOADING
+//=============================================================================
+
+#ifdef GL_BGR_EXT
+const GLenum BMP_FORMAT_BGR = GL_BGR_EXT;    // 24-bit BMP pixel order
+const GLenum BMP_FORMAT_BGRA = GL_BGRA_EXT;  // 32-bit BMP pixel order
+#else
+const GLenum BMP_FORMAT_BGR = GL_BGR;
+const GLenum BMP_FORMAT_BGRA = GL_BGRA;
+#endif
+
+#ifndef GL_TEXTURE_MAX_LEVEL
+#define GL_TEXTURE_MAX_LEVEL 0x813D
+#endif
+#ifndef GL_TEXTURE_MAX_ANISOTROPY_EXT
+#define GL_TEXTURE_MAX_ANISOTROPY_EXT 0x84FE
+#define GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT 0x84FF
+#endif
+
+float textureAnisotropy = 1.0f;  // Requested anisotropic filtering level (--anisotropy), 1 = off
+
+// Pixel layout of a validated BMP file; pixels point into the file bytes
+struct BmpImage {
+    int width = 0;
+    int height = 0;                      // Always positive; see topDown
+    int bytesPerPixel = 0;               // 3 (BGR) or 4 (BGRA)
+    bool topDown = false;                // Rows stored top row first
+    size_t rowStride = 0;                // Bytes per stored row, padded to 4
+    const unsigned char* pixels = nullptr;
+};
+
+// Read little-endian integers without relying on alignment or host byte order
+uint32_t readLE32(const unsigned char* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+uint16_t readLE16(const unsigned char* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+// Validate BMP headers and locate the pixel data; returns false with a reason on failure
+bool parseBmp(const unsigned char* data, size_t size, BmpImage& image, std::string& error) {
+    const size_t fileHeaderSize = 14;
+    if (size < fileHeaderSize + 40 || data[0] != 'B' || data[1] != 'M') {
+        error = "not a BMP file";
+        return false;
+    }
+
+    uint32_t pixelOffset = readLE32(data + 10);
+    uint32_t infoSize = readLE32(data + 14);
+    int32_t width = (int32_t)readLE32(data + 18);
+    int32_t height = (int32_t)readLE32(data + 22);
+    uint16_t planes = readLE16(data + 26);
+    uint16_t bitCount = readLE16(data + 28);
+    uint32_t compression = readLE32(data + 30);
+
+    if (infoSize < 40 || planes != 1) {
+        error = "unsupported BMP header";
+        return false;
+    }
+    if (bitCount != 24 && bitCount != 32) {
+        error = "unsupported bit depth " + std::to_string(bitCount);
+        return false;
+    }
+
+    // BI_RGB, or BI_BITFIELDS with the standard BGRA masks (stored at offset 54 for every header version)
+    const uint32_t BI_RGB_COMPRESSION = 0;
+    const uint32_t BI_BITFIELDS_COMPRESSION = 3;
+    if (compression == BI_BITFIELDS_COMPRESSION && bitCount == 32 && size >= 66) {
+        if (readLE32(data + 54) != 0x00FF0000u || readLE32(data + 58) != 0x0000FF00u || readLE32(data + 62) != 0x000000FFu) {
+            error = "unsupported channel masks";
+            return false;
+        }
+    }
+    else if (compression != BI_RGB_COMPRESSION) {
+        error = "compressed BMP files are not supported";
+        return false;
+    }
+
+    if (width <= 0 || height == 0 || width > 16384 || height > 16384 || height < -16384) {
+        error = "invalid dimensions";
+        return false;
+    }
+
+    image.width = width;
+    image.height = (height < 0) ? -height : height;
+    image.topDown = height < 0;
+    image.bytesPerPixel = bitCount / 8;
+    image.rowStride = ((size_t)width * image.bytesPerPixel + 3) & ~(size_t)3;
+
+    if (pixelOffset < fileHeaderSize + 40 || pixelOffset > size ||
+        size - pixelOffset < image.rowStride * image.height) {
+        error = "pixel data is truncated";
+        return false;
+    }
+    image.pixels = data + pixelOffset;
+    return true;
+}
+
+// Magenta/grey checkerboard used whenever a texture cannot be loaded
+unsigned int getPlaceholderTexture() {
+    static unsigned int placeholder = 0;
+    if (placeholder == 0) {
+        GLubyte pixels[8 * 8 * 3];
+        for (int y = 0; y < 8; y++) {
+            for (int x = 0; x < 8; x++) {
+                bool odd = ((x / 2) + (y / 2)) % 2 != 0;
+                GLubyte* pixel = &pixels[(y * 8 + x) * 3];
+                pixel[0] = odd ? 255 : 128;
+                pixel[1] = odd ? 0 : 128;
+                pixel[2] = odd ? 255 : 128;
             }
         }
 
-        // Add the new head position to the front of the snake body
-        snake_body.insert(snake_body.begin(), head);
+        glGenTextures(1, &placeholder);
+        glBindTexture(GL_TEXTURE_2D, placeholder);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, 8, 8, 0, GL_RGB, GL_UNSIGNED_BYTE, pixels);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    }
+    return placeholder;
+}
 
-        // Check if the snake has eaten food
-        if (head.x == snake_food.x && head.y == snake_food.y) {
-            // Trigger the fireworks effect upon food consumption
-            snake_create_fireworks((snake_food.x + 0.5f) * snake_cell_size, snake_cell_size,
-                (snake_food.y + 0.5f) * snake_cell_size);
+// Mip levels 1..n of a texture, bottom row first, rows padded to 4 bytes
+struct MipChain {
+    struct Level {
+        int width, height;
+        size_t offset;      // Byte offset into data
+        size_t rowStride;
+    };
+    std::vector<Level> levels;
+    std::vector<unsigned char> data;
+    const unsigned char* external = nullptr;  // Level data held elsewhere (asset pack) instead of in data
 
-            // Generate new food at a valid position
-            bool valid_position = false;
-            while (!valid_position) {
-                snake_food.x = rand() % snake_grid_columns;
-                snake_food.y = rand() % snake_grid_rows;
-                valid_position = true;
-                // Ensure that food does not overlap with the snake's body
-                for (const auto& segment : snake_body) {
-                    if (segment.x == snake_food.x && segment.y == snake_food.y) {
-                        valid_position = false;
-                        break;
-                    }
-                }
+    const unsigned char* levelData(size_t i) const {
+        return (external != nullptr ? external : data.data()) + levels[i].offset;
+    }
+};
+
+// Sum two rows byte by byte into 16-bit totals
+void sumMipRows(const unsigned char* row0, const unsigned char* row1, size_t bytes, uint16_t* sums) {
+    size_t i = 0;
+#ifdef COASTER_MIP_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 16 <= bytes; i += 16) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + i));
+        __m128i low = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+        __m128i high = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(sums + i), low);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(sums + i + 8), high);
+    }
+#endif
+    for (; i < bytes; i++) {
+        sums[i] = (uint16_t)(row0[i] + row1[i]);
+    }
+}
+
+// Average horizontal pixel pairs of summed rows into one output row (2x2 box filter)
+void reduceMipRow(const uint16_t* sums, int sourceWidth, int width, int bytesPerPixel, unsigned char* out) {
+    int x = 0;
+#ifdef COASTER_MIP_SSE2
+    if (bytesPerPixel == 4 && sourceWidth >= 2) {
+        const __m128i rounding = _mm_set1_epi16(2);
+        for (; x + 2 <= width; x += 2) {
+            // Four source pixels in, two output pixels out
+            __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sums + x * 8));
+            __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sums + x * 8 + 8));
+            __m128i pairA = _mm_add_epi16(a, _mm_srli_si128(a, 8));
+            __m128i pairB = _mm_add_epi16(b, _mm_srli_si128(b, 8));
+            __m128i averaged = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(pairA, pairB), rounding), 2);
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(out + x * 4), _mm_packus_epi16(averaged, averaged));
+        }
+    }
+#endif
+    for (; x < width; x++) {
+        int x0 = std::min(2 * x, sourceWidth - 1);
+        int x1 = std::min(2 * x + 1, sourceWidth - 1);
+        for (int c = 0; c < bytesPerPixel; c++) {
+            out[x * bytesPerPixel + c] = (unsigned char)((sums[x0 * bytesPerPixel + c] + sums[x1 * bytesPerPixel + c] + 2) >> 2);
+        }
+    }
+}
+
+// Compute sizes and offsets of mip levels 1..n; returns the total byte size
+size_t layoutMipLevels(int width, int height, int bytesPerPixel, std::vector<MipChain::Level>& levels) {
+    levels.clear();
+    size_t total = 0;
+    while (width > 1 || height > 1) {
+        width = std::max(1, width / 2);
+        height = std::max(1, height / 2);
+        size_t stride = ((size_t)width * bytesPerPixel + 3) & ~(size_t)3;
+        levels.push_back({ width, height, total, stride });
+        total += stride * height;
+    }
+    return total;
+}
+
+// Build the full mip chain below level 0 with a 2x2 box filter
+void buildMipChain(const BmpImage& image, MipChain& chain) {
+    chain.levels.clear();
+    chain.data.clear();
+    chain.external = nullptr;
+
+    // Lay out every level first so the data buffer is allocated once
+    chain.data.resize(layoutMipLevels(image.width, image.height, image.bytesPerPixel, chain.levels));
+
+    std::vector<uint16_t> sums((size_t)image.width * image.bytesPerPixel);
+    const unsigned char* source = image.pixels;
+    size_t sourceStride = image.rowStride;
+    int sourceWidth = image.width;
+    int sourceHeight = image.height;
+    bool sourceTopDown = image.topDown;
+
+    for (const MipChain::Level& level : chain.levels) {
+        unsigned char* target = chain.data.data() + level.offset;
+        for (int y = 0; y < level.height; y++) {
+            // Source rows in OpenGL (bottom-up) order
+            int y0 = std::min(2 * y, sourceHeight - 1);
+            int y1 = std::min(2 * y + 1, sourceHeight - 1);
+            if (sourceTopDown) {
+                y0 = sourceHeight - 1 - y0;
+                y1 = sourceHeight - 1 - y1;
             }
+            sumMipRows(source + y0 * sourceStride, source + y1 * sourceStride,
+                (size_t)sourceWidth * image.bytesPerPixel, sums.data());
+            reduceMipRow(sums.data(), sourceWidth, level.width, image.bytesPerPixel, target + y * level.rowStride);
         }
-        else {
-            // Remove the tail to maintain the snake's constant length
-            snake_body.pop_back();
+
+        // The next level reads from this one
+        source = target;
+        sourceStride = level.rowStride;
+        sourceWidth = level.width;
+        sourceHeight = level.height;
+        sourceTopDown = false;
+    }
+}
+
+// Upload a parsed BMP to a new texture straight from the source bytes, plus its mip chain
+unsigned int uploadBmpTexture(const BmpImage& image, const MipChain& mips) {
+    unsigned int texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, mips.levels.empty() ? GL_LINEAR : GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)mips.levels.size());
+
+    // Anisotropic filtering only when the extension is available
+    static float maxAnisotropy = -1.0f;
+    if (maxAnisotropy < 0.0f) {
+        const char* extensions = (const char*)glGetString(GL_EXTENSIONS);
+        maxAnisotropy = 1.0f;
+        if (extensions != nullptr && strstr(extensions, "GL_EXT_texture_filter_anisotropic") != nullptr) {
+            glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &maxAnisotropy);
+        }
+    }
+    if (textureAnisotropy > 1.0f && maxAnisotropy > 1.0f) {
+        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, std::min(textureAnisotropy, maxAnisotropy));
+    }
+
+    GLenum format = (image.bytesPerPixel == 4) ? BMP_FORMAT_BGRA : BMP_FORMAT_BGR;
+    GLint internalFormat = (image.bytesPerPixel == 4) ? GL_RGBA : GL_RGB;
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);  // BMP rows and mip rows are padded to 4 bytes
+
+    if (!image.topDown) {
+        // Bottom-up rows already match OpenGL's row order
+        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, image.width, image.height, 0, format, GL_UNSIGNED_BYTE, image.pixels);
+    }
+    else {
+        // Top-down rows are uploaded one at a time in reverse instead of flipping a copy
+        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, image.width, image.height, 0, format, GL_UNSIGNED_BYTE, nullptr);
+        for (int row = 0; row < image.height; row++) {
+            const unsigned char* source = image.pixels + (size_t)(image.height - 1 - row) * image.rowStride;
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, row, image.width, 1, format, GL_UNSIGNED_BYTE, source);
+        }
+    }
+
+    for (size_t i = 0; i < mips.levels.size(); i++) {
+        const MipChain::Level& level = mips.levels[i];
+        glTexImage2D(GL_TEXTURE_2D, (GLint)(i + 1), internalFormat, level.width, level.height, 0, format,
+            GL_UNSIGNED_BYTE, mips.levelData(i));
+    }
+    return texture;
+}
+
+
+//=============================================================================
+// ASSET PACK
+//=============================================================================
+
+/**
+ * A single-file texture archive written offline by --pack-assets.
+ * Layout: header, then per texture all mip levels back to back (bottom row first, rows padded
+ * to 4 bytes, ready for glTexImage2D) starting on a page boundary, then an open-addressing
+ * index keyed by the hash of the normalized texture path.
+ */
+
+const char ASSET_PACK_MAGIC[4] = { 'C', 'P', 'A', 'K' };
+const uint32_t ASSET_PACK_VERSION = 1;
+const size_t ASSET_PACK_ALIGNMENT = 4096;   // Texture data starts on a page boundary
+
+std::string assetPackPath = "assets.pak";   // Packed textures used when present (--assets)
+
+struct AssetPackHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t slotCount;         // Index slots, a power of two
+    uint32_t entryCount;        // Occupied slots
+    uint64_t indexOffset;       // Byte offset of the AssetPackEntry slots
+};
+
+// One index slot; pathHash 0 marks an empty slot
+struct AssetPackEntry {
+    uint64_t pathHash;
+    uint64_t dataOffset;        // Level 0 followed by the mip levels
+    uint32_t width, height;
+    uint32_t bytesPerPixel;
+    uint32_t levelCount;        // Mip levels stored after level 0
+};
+
+MappedFile assetPack;                          // Mapped archive, closed if absent or invalid
+const AssetPackEntry* assetPackSlots = nullptr;
+uint32_t assetPackSlotCount = 0;
+
+// Normalize a texture path so "Texture\\a.bmp" and "texture/a.bmp" name the same asset
+std::string normalizeAssetPath(const char* path) {
+    std::string normalized(path);
+    for (char& c : normalized) {
+        if (c == '\\') c = '/';
+        c = (char)tolower((unsigned char)c);
+    }
+    return normalized;
+}
+
+// Hash a normalized texture path for the pack index
+uint64_t hashAssetPath(const char* path) {
+    std::string normalized = normalizeAssetPath(path);
+    uint64_t hash = fnv1a64(normalized.data(), normalized.size());
+    return hash != 0 ? hash : 1;  // 0 is reserved for empty slots
+}
+
+// Map the archive and validate its header and index
+bool openAssetPack(const std::string& path) {
+    assetPack.close();
+    assetPackSlots = nullptr;
+    assetPackSlotCount = 0;
+    if (!assetPack.open(path.c_str())) return false;
+
+    AssetPackHeader header;
+    if (assetPack.size < sizeof(header)) {
+        assetPack.close();
+        return false;
+    }
+    memcpy(&header, assetPack.data, sizeof(header));
+    if (memcmp(header.magic, ASSET_PACK_MAGIC, sizeof(header.magic)) != 0 || header.version != ASSET_PACK_VERSION ||
+        header.slotCount == 0 || (header.slotCount & (header.slotCount - 1)) != 0 || header.indexOffset % 8 != 0 ||
+        header.indexOffset > assetPack.size ||
+        (assetPack.size - header.indexOffset) / sizeof(AssetPackEntry) < header.slotCount) {
+        std::cerr << "Ignoring invalid asset pack " << path << std::endl;
+        assetPack.close();
+        return false;
+    }
+
+    assetPackSlots = reinterpret_cast<const AssetPackEntry*>(assetPack.data + header.indexOffset);
+    assetPackSlotCount = header.slotCount;
+    std::cout << "Using asset pack " << path << " (" << header.entryCount << " textures)" << std::endl;
+    return true;
+}
+
+// Point image and mips at a packed texture; returns false if the pack does not hold it
+bool findPackedTexture(const char* path, BmpImage& image, MipChain& mips) {
+    if (assetPackSlots == nullptr) return false;
+
+    uint64_t hash = hashAssetPath(path);
+    for (uint32_t probe = 0; probe < assetPackSlotCount; probe++) {
+        const AssetPackEntry& entry = assetPackSlots[(hash + probe) & (assetPackSlotCount - 1)];
+        if (entry.pathHash == 0) return false;
+        if (entry.pathHash != hash) continue;
+
+        if ((entry.bytesPerPixel != 3 && entry.bytesPerPixel != 4) || entry.width == 0 || entry.height == 0 ||
+            entry.width > 16384 || entry.height > 16384) {
+            return false;
+        }
+        image.width = (int)entry.width;
+        image.height = (int)entry.height;
+        image.bytesPerPixel = (int)entry.bytesPerPixel;
+        image.topDown = false;
+        image.rowStride = ((size_t)image.width * image.bytesPerPixel + 3) & ~(size_t)3;
+
+        size_t baseSize = image.rowStride * image.height;
+        size_t mipSize = layoutMipLevels(image.width, image.height, image.bytesPerPixel, mips.levels);
+        mips.levels.resize(std::min(mips.levels.size(), (size_t)entry.levelCount));
+        if (entry.dataOffset > assetPack.size || assetPack.size - entry.dataOffset < baseSize + mipSize) {
+            return false;
+        }
+
+        image.pixels = assetPack.data + entry.dataOffset;
+        mips.data.clear();
+        mips.external = image.pixels + baseSize;
+        return true;
+    }
+    return false;
+}
+
+// Append zero bytes until the blob size is a multiple of alignment
+void alignBlob(std::vector<unsigned char>& blob, size_t alignment) {
+    blob.resize((blob.size() + alignment - 1) / alignment * alignment, 0);
+}
+
+/**
+ * Writes every texture in the manifest into one archive (--pack-assets <file>)
+ * Runs without a window: BMP parsing and mip generation are CPU only.
+ */
+int writeAssetPack(const std::vector<std::string>& paths, const std::string& outputPath) {
+    std::vector<unsigned char> blob(sizeof(AssetPackHeader), 0);
+    std::vector<AssetPackEntry> entries;
+
+    for (const std::string& path : paths) {
+        uint64_t hash = hashAssetPath(path.c_str());
+        bool duplicate = false;
+        for (const AssetPackEntry& entry : entries) {
+            duplicate = duplicate || entry.pathHash == hash;
+        }
+        if (duplicate) continue;  // The same file listed under two slots
+
+        MappedFile file;
+        BmpImage image;
+        std::string error;
+        if (!file.open(path.c_str())) {
+            std::cerr << "Skipping " << path << ": unable to open file" << std::endl;
+            continue;
+        }
+        if (!parseBmp(file.data, file.size, image, error)) {
+            std::cerr << "Skipping " << path << ": " << error << std::endl;
+            continue;
         }
+        MipChain mips;
+        buildMipChain(image, mips);
+
+        alignBlob(blob, ASSET_PACK_ALIGNMENT);
+        AssetPackEntry entry = { hash, blob.size(), (uint32_t)image.width, (uint32_t)image.height,
+            (uint32_t)image.bytesPerPixel, (uint32_t)mips.levels.size() };
+        entries.push_back(entry);
+
+        // Level 0 in OpenGL row order, then the mip levels as generated
+        for (int row = 0; row < image.height; row++) {
+            int storedRow = image.topDown ? image.height - 1 - row : row;
+            appendBlob(blob, image.pixels + (size_t)storedRow * image.rowStride, image.rowStride);
+        }
+        appendBlob(blob, mips.data.data(), mips.data.size());
+        std::cout << "Packed " << path << " (" << image.width << "x" << image.height << ", "
+            << mips.levels.size() + 1 << " levels)" << std::endl;
+    }
+
+    // Open-addressing index at no more than half load
+    uint32_t slotCount = 1;
+    while (slotCount < entries.size() * 2) slotCount *= 2;
+    std::vector<AssetPackEntry> slots(slotCount);
+    memset(slots.data(), 0, slots.size() * sizeof(AssetPackEntry));
+    for (const AssetPackEntry& entry : entries) {
+        uint32_t slot = (uint32_t)entry.pathHash & (slotCount - 1);
+        while (slots[slot].pathHash != 0) slot = (slot + 1) & (slotCount - 1);
+        slots[slot] = entry;
+    }
+
+    alignBlob(blob, 8);
+    AssetPackHeader header;
+    memcpy(header.magic, ASSET_PACK_MAGIC, sizeof(header.magic));
+    header.version = ASSET_PACK_VERSION;
+    header.slotCount = slotCount;
+    header.entryCount = (uint32_t)entries.size();
+    header.indexOffset = blob.size();
+    appendBlob(blob, slots.data(), slots.size() * sizeof(AssetPackEntry));
+    memcpy(blob.data(), &header, sizeof(header));
+
+    if (!writeBinaryFile(outputPath, blob.data(), blob.size())) {
+        std::cerr << "Unable to write asset pack " << outputPath << std::endl;
+        return 1;
+    }
+    std::cout << "Wrote " << entries.size() << " textures to " << outputPath << " (" << blob.size() << " bytes)" << std::endl;
+    return 0;
+}
+
+
+// Function to load a texture from a file; returns the placeholder texture on failure
+unsigned int loadGLTexture(const char* filename) {
+    BmpImage packedImage;
+    MipChain packedMips;
+    if (findPackedTexture(filename, packedImage, packedMips)) {
+        return uploadBmpTexture(packedImage, packedMips);
+    }
+
+    MappedFile file;
+    if (!file.open(filename)) {
+        std::cerr << "Unable to open texture file: " << filename << std::endl;
+        return getPlaceholderTexture();
+    }
+
+    BmpImage image;
+    std::string error;
+    if (!parseBmp(file.data, file.size, image, error)) {
+        std::cerr << "Unable to load texture " << filename << ": " << error << std::endl;
+        return getPlaceholderTexture();
+    }
+
+    // The mapping stays open until the pixels have been handed to OpenGL
+    MipChain mips;
+    buildMipChain(image, mips);
+    return uploadBmpTexture(image, mips);
+}
+
+//=============================================================================
+// TEXTURE REGISTRY
+//=============================================================================
+
+/**
+ * Owns every OpenGL texture the scene uses. Textures are found by name (normalized path) and by
+ * content hash, so a file listed twice or two files with identical pixels upload once.
+ * References are taken only by acquireTexture*, registerTexture and acquirePlaceholderTexture
+ * and dropped by releaseTexture; copying a handle does not count. The texture is deleted with the
+ * last reference. A freed slot gets a new generation, so a stale copy binds no texture instead
+ * of whatever is registered in the slot later.
+ */
+struct TextureRecord {
+    std::string name;           // Normalized path of the first name it was loaded under
+    uint64_t contentHash = 0;   // Hash of the level 0 pixels and size
+    unsigned int glTexture = 0;
+    int width = 0, height = 0;
+    size_t bytes = 0;           // Estimated GPU memory, all mip levels as RGBA8
+    int refCount = 0;           // 0 once released; the slot is then unused
+    uint32_t generation = 0;    // Bumped whenever the slot is freed
+    bool pinned = false;        // Shared textures (placeholder, atlases) are never deleted
+
+    // Streamed textures (see TEXTURE RESIDENCY); glTexture is the placeholder while not resident
+    const char* path = nullptr; // File to load from; points into the static manifest
+    unsigned int placeholder = 0;  // 1x1 stand-in colour, 0 for textures loaded at startup
+    uint32_t zoneMask = 0;      // Zones that use this texture
+    bool resident = true;
+    bool loading = false;
+    bool failed = false;        // Decode failed; keeps the placeholder and is not requested again
+};
+
+struct TextureRegistry {
+    std::vector<TextureRecord> records = std::vector<TextureRecord>(1);  // Record 0 is the null handle
+    std::unordered_map<std::string, uint32_t> byName;
+    std::unordered_map<uint64_t, uint32_t> byContent;
+};
+
+TextureRegistry textureRegistry;
+
+// Whether a handle still refers to the record it was issued for
+bool isLiveTexture(TextureHandle handle) {
+    return handle.index < textureRegistry.records.size() &&
+        textureRegistry.records[handle.index].generation == handle.generation;
+}
+
+// OpenGL texture behind a handle; 0 (no texture) for the null handle or a stale one
+unsigned int textureObject(TextureHandle handle) {
+    return isLiveTexture(handle) ? textureRegistry.records[handle.index].glTexture : 0;
+}
+
+// Hash the visible pixels of an image (row padding excluded) for deduplication
+uint64_t hashImageContent(const BmpImage& image) {
+    int size[3] = { image.width, image.height, image.bytesPerPixel };
+    uint64_t hash = fnv1a64(size, sizeof(size));
+    for (int row = 0; row < image.height; row++) {
+        hash = fnv1a64(image.pixels + (size_t)row * image.rowStride, (size_t)image.width * image.bytesPerPixel, hash);
+    }
+    return hash;
+}
+
+// Estimated GPU memory of an uploaded image with its mip chain
+size_t textureMemoryBytes(const BmpImage& image, const MipChain& mips) {
+    size_t bytes = (size_t)image.width * image.height * 4;
+    for (const MipChain::Level& level : mips.levels) {
+        bytes += (size_t)level.width * level.height * 4;
+    }
+    return bytes;
+}
+
+// Take another reference to a texture already registered under this name; null handle if unknown
+TextureHandle acquireTexture(const char* name) {
+    TextureHandle handle;
+    std::unordered_map<std::string, uint32_t>::const_iterator found = textureRegistry.byName.find(normalizeAssetPath(name));
+    if (found != textureRegistry.byName.end()) {
+        handle.index = found->second;
+        handle.generation = textureRegistry.records[handle.index].generation;
+        textureRegistry.records[handle.index].refCount++;
+    }
+    return handle;
+}
+
+// Take another reference to a texture with these pixels under a new name; null handle if unknown
+TextureHandle acquireTextureByContent(const char* name, uint64_t contentHash) {
+    TextureHandle handle;
+    std::unordered_map<uint64_t, uint32_t>::const_iterator found = textureRegistry.byContent.find(contentHash);
+    if (found != textureRegistry.byContent.end()) {
+        handle.index = found->second;
+        handle.generation = textureRegistry.records[handle.index].generation;
+        textureRegistry.records[handle.index].refCount++;
+        textureRegistry.byName[normalizeAssetPath(name)] = handle.index;
+    }
+    return handle;
+}
+
+// Register a freshly uploaded texture with one reference held by the caller
+TextureHandle registerTexture(const char* name, uint64_t contentHash, unsigned int glTexture,
+    int width, int height, size_t bytes, bool pinned = false) {
+    TextureRecord record;
+    record.name = normalizeAssetPath(name);
+    record.contentHash = contentHash;
+    record.glTexture = glTexture;
+    record.width = width;
+    record.height = height;
+    record.bytes = bytes;
+    record.refCount = 1;
+    record.pinned = pinned;
+
+    // Reuse a released slot before growing
+    TextureHandle handle;
+    for (uint32_t i = 1; i < textureRegistry.records.size() && handle.isNull(); i++) {
+        if (textureRegistry.records[i].refCount == 0) handle.index = i;
+    }
+    if (handle.isNull()) {
+        handle.index = (uint32_t)textureRegistry.records.size();
+        textureRegistry.records.push_back(record);
+    }
+    else {
+        record.generation = textureRegistry.records[handle.index].generation;
+        textureRegistry.records[handle.index] = record;
+    }
+    handle.generation = record.generation;
 
-        // Update fireworks if active
-        if (!snake_fireworks.empty()) {
-            snake_update_fireworks();
+    textureRegistry.byName[record.name] = handle.index;
+    if (contentHash != 0) textureRegistry.byContent[contentHash] = handle.index;
+    return handle;
+}
+
+// Handle to the shared checkerboard shown for textures that failed to load
+TextureHandle acquirePlaceholderTexture(const char* name) {
+    const uint64_t placeholderHash = fnv1a64("placeholder", 11);
+    TextureHandle handle = acquireTextureByContent(name, placeholderHash);
+    if (handle.isNull()) {
+        handle = registerTexture(name, placeholderHash, getPlaceholderTexture(), 8, 8, 8 * 8 * 4, true);
+        textureRegistry.byName[normalizeAssetPath(name)] = handle.index;
+    }
+    return handle;
+}
+
+// Drop one reference; the last one deletes the OpenGL texture and frees the slot
+void releaseTexture(TextureHandle& handle) {
+    if (handle.isNull() || !isLiveTexture(handle)) {
+        handle = TextureHandle();
+        return;
+    }
+
+    TextureRecord& record = textureRegistry.records[handle.index];
+    if (record.refCount > 0 && --record.refCount == 0) {
+        for (std::unordered_map<std::string, uint32_t>::iterator it = textureRegistry.byName.begin();
+            it != textureRegistry.byName.end();) {
+            if (it->second == handle.index) it = textureRegistry.byName.erase(it);
+            else ++it;
         }
+        std::unordered_map<uint64_t, uint32_t>::iterator content = textureRegistry.byContent.find(record.contentHash);
+        if (content != textureRegistry.byContent.end() && content->second == handle.index) {
+            textureRegistry.byContent.erase(content);
+        }
+        if (!record.pinned) glDeleteTextures(1, &record.glTexture);
+        if (record.placeholder != 0 && record.placeholder != record.glTexture) glDeleteTextures(1, &record.placeholder);
+        uint32_t generation = record.generation + 1;
+        record = TextureRecord();
+        record.generation = generation;
+    }
+    handle = TextureHandle();
+}
 
-        glutPostRedisplay();
-        glutTimerFunc(150, snake_timer, 0); // Set the game speed with a timer
+// Total estimated GPU memory of all live textures
+size_t totalTextureMemory() {
+    size_t total = 0;
+    for (const TextureRecord& record : textureRegistry.records) {
+        if (record.refCount > 0) total += record.bytes;
     }
+    return total;
 }
 
-// Function to render a cube in the Snake Game
-void snake_draw_cube(float x, float y, float z, float size, float r, float g, float b) {
-    glPushMatrix();
-    glTranslatef((x + 0.5f) * snake_cell_size, y * snake_cell_size, (z + 0.5f) * snake_cell_size);
-    glColor3f(r, g, b); // Set color based on the input values
-    glutSolidCube(size * snake_cell_size); // Draw a cube with the given size
-    glPopMatrix();
+// Print every live texture with its size and references, then the total
+void reportTextureMemory() {
+    size_t textures = 0;
+    for (const TextureRecord& record : textureRegistry.records) {
+        if (record.refCount == 0) continue;
+        printf("  %-34s %4dx%-4d %2d refs %8.1f KB\n", record.name.c_str(), record.width, record.height,
+            record.refCount, record.bytes / 1024.0);
+        textures++;
+    }
+    printf("Texture memory: %.2f MB in %u textures (%u names)\n", totalTextureMemory() / (1024.0 * 1024.0),
+        (unsigned int)textures, (unsigned int)textureRegistry.byName.size());
 }
 
-// Function to render the game grid for the Snake Game
-void snake_draw_grid() {
-    // Draw the grid floor
-    glColor3f(0.8f, 0.8f, 0.8f); // Light gray color
-    glBegin(GL_QUADS);
-    glNormal3f(0.0f, 1.0f, 0.0f);
-    glVertex3f(0, 0.0f, 0);
-    glVertex3f(snake_grid_columns * snake_cell_size, 0.0f, 0);
-    glVertex3f(snake_grid_columns * snake_cell_size, 0.0f, snake_grid_rows * snake_cell_size);
-    glVertex3f(0, 0.0f, snake_grid_rows * snake_cell_size);
-    glEnd();
+// Called as each frame starts: close the previous frame's heap count and refresh the texture estimate
+void countFrameAllocations() {
+    uint64_t count = heapAllocationCount.load(std::memory_order_relaxed);
+    uint64_t bytes = heapAllocationBytes.load(std::memory_order_relaxed);
+    if (memoryFrames.lastCount != 0) {  // Start-up allocations are not a frame's
+        memoryFrames.frameAllocations = count - memoryFrames.lastCount;
+        memoryFrames.frameBytes = bytes - memoryFrames.lastBytes;
+        memoryFrames.maxFrameAllocations = std::max(memoryFrames.maxFrameAllocations, memoryFrames.frameAllocations);
+        memoryFrames.frames++;
+        if (memoryFrames.frameAllocations == 0) memoryFrames.allocationFreeFrames++;
+    }
+    memoryFrames.lastCount = count;
+    memoryFrames.lastBytes = bytes;
+
+    MemoryCounters& textures = memoryCounters[MEMORY_TEXTURES];
+    textures.live = totalTextureMemory();
+    textures.peak = std::max(textures.peak, textures.live);
+}
 
-    // Enable anti-aliasing for smooth lines
-    glEnable(GL_LINE_SMOOTH);
-    glHint(GL_LINE_SMOOTH_HINT, GL_NICEST);
-    glLineWidth(1.0f); // Set a uniform line width
 
-    // Draw grid lines
-    glColor3f(0.2f, 0.6f, 0.2f); // Green grid lines
-    glBegin(GL_LINES);
-    // Vertical grid lines
-    for (int i = 0; i <= snake_grid_columns; ++i) {
-        float x = i * snake_cell_size;
-        glVertex3f(x, 0.02f, 0);
-        glVertex3f(x, 0.02f, snake_grid_rows * snake_cell_size);
-    }
-    // Horizontal grid lines
-    for (int j = 0; j <= snake_grid_rows; ++j) {
-        float z = j * snake_cell_size;
-        glVertex3f(0, 0.02f, z);
-        glVertex3f(snake_grid_columns * snake_cell_size, 0.02f, z);
-    }
-    glEnd();
+//=============================================================================
+// TEXTURE ATLASES
+//=============================================================================
 
-    // Disable anti-aliasing
-    glDisable(GL_LINE_SMOOTH);
+const int ATLAS_GUTTER = 4;        // Edge pixels repeated around each region against filter bleeding
+const int ATLAS_MAX_MIP_LEVEL = 2; // Deeper levels would blend neighbouring regions
 
-    // Draw decorative walls
-    glColor3f(0.7f, 0.4f, 0.1f); // Brown walls
-    float wall_height = 5.0f * snake_cell_size;
+// Sub-rectangle of an atlas in texture coordinates
+struct AtlasRegion {
+    float u0, v0, u1, v1;
+};
 
-    // Left wall
-    glBegin(GL_QUADS);
-    glNormal3f(1.0f, 0.0f, 0.0f);
-    glVertex3f(0, 0, 0);
-    glVertex3f(0, 0, snake_grid_rows * snake_cell_size);
-    glVertex3f(0, wall_height, snake_grid_rows * snake_cell_size);
-    glVertex3f(0, wall_height, 0);
-    glEnd();
+// Small textures packed into one texture; regions are keyed by the standalone texture id
+struct TextureAtlas {
+    unsigned int texture = 0;
+    std::vector<std::pair<unsigned int, AtlasRegion>> regions;
+};
 
-    // Right wall
-    glBegin(GL_QUADS);
-    glNormal3f(-1.0f, 0.0f, 0.0f);
-    glVertex3f(snake_grid_columns * snake_cell_size, 0, 0);
-    glVertex3f(snake_grid_columns * snake_cell_size, 0, snake_grid_rows * snake_cell_size);
-    glVertex3f(snake_grid_columns * snake_cell_size, wall_height, snake_grid_rows * snake_cell_size);
-    glVertex3f(snake_grid_columns * snake_cell_size, wall_height, 0);
-    glEnd();
+TextureAtlas characterAtlas;                // Character, Yao Ming and game console textures
+const TextureAtlas* activeAtlas = nullptr;  // Atlas bound by beginAtlasDraw
+bool activeAtlasBound = false;              // False after a texture outside the atlas was bound
 
-    // Back wall
-    glBegin(GL_QUADS);
-    glNormal3f(0.0f, 0.0f, -1.0f);
-    glVertex3f(0, 0, snake_grid_rows * snake_cell_size);
-    glVertex3f(snake_grid_columns * snake_cell_size, 0, snake_grid_rows * snake_cell_size);
-    glVertex3f(snake_grid_columns * snake_cell_size, wall_height, snake_grid_rows * snake_cell_size);
-    glVertex3f(0, wall_height, snake_grid_rows * snake_cell_size);
-    glEnd();
+// Find the atlas region standing in for a standalone texture
+const AtlasRegion* findAtlasRegion(const TextureAtlas& atlas, unsigned int texture) {
+    for (const std::pair<unsigned int, AtlasRegion>& entry : atlas.regions) {
+        if (entry.first == texture) return &entry.second;
+    }
+    return nullptr;
+}
 
-    // Front wall
-    glBegin(GL_QUADS);
-    glNormal3f(0.0f, 0.0f, 1.0f);
-    glVertex3f(0, 0, 0);
-    glVertex3f(snake_grid_columns * snake_cell_size, 0, 0);
-    glVertex3f(snake_grid_columns * snake_cell_size, wall_height, 0);
-    glVertex3f(0, wall_height, 0);
-    glEnd();
+// Bind an atlas once for a group of draws that use its member textures
+void beginAtlasDraw(const TextureAtlas& atlas) {
+    if (atlas.texture == 0) return;  // Atlas not built; bindTexture2D falls back to plain binds
+    activeAtlas = &atlas;
+    activeAtlasBound = true;
+    glBindTexture(GL_TEXTURE_2D, atlas.texture);
 }
 
-// Function to draw the connecting lines between snake segments
-void snake_draw_snake_lines() {
-    glLineWidth(5.0f);
-    glColor3f(1.0f, 0.5f, 0.0f); // Core color (orange)
+// Leave atlas drawing and restore the identity texture matrix
+void endAtlasDraw() {
+    if (activeAtlas == nullptr) return;
+    activeAtlas = nullptr;
+    glMatrixMode(GL_TEXTURE);
+    glLoadIdentity();
+    glMatrixMode(GL_MODELVIEW);
+}
 
-    float half_cell_size = snake_cell_size / 2.0f;
+/**
+ * Binds a texture, or inside beginAtlasDraw/endAtlasDraw selects its atlas region
+ * The region is applied through the texture matrix, so callers keep their 0..1 coordinates
+ */
+void bindTexture2D(unsigned int texture) {
+    const AtlasRegion* region = (activeAtlas != nullptr) ? findAtlasRegion(*activeAtlas, texture) : nullptr;
 
-    for (size_t i = 0; i < snake_body.size(); ++i) {
-        Position current = snake_body[i];
-        Position next;
-        if (i < snake_body.size() - 1) {
-            next = snake_body[i + 1];
-        }
-        else {
-            next = current;
+    if (activeAtlas != nullptr) {
+        glMatrixMode(GL_TEXTURE);
+        glLoadIdentity();
+        if (region != nullptr) {
+            glTranslatef(region->u0, region->v0, 0.0f);
+            glScalef(region->u1 - region->u0, region->v1 - region->v0, 1.0f);
         }
+        glMatrixMode(GL_MODELVIEW);
+    }
 
-        glPushMatrix();
-        glTranslatef((current.x + 0.5f) * snake_cell_size, 1.0f * snake_cell_size, (current.y + 0.5f) * snake_cell_size);
+    if (region == nullptr) {
+        glBindTexture(GL_TEXTURE_2D, texture);
+        activeAtlasBound = false;
+    }
+    else if (!activeAtlasBound) {
+        glBindTexture(GL_TEXTURE_2D, activeAtlas->texture);
+        activeAtlasBound = true;
+    }
+}
 
-        // Draw lines to represent the snake's body connections
-        glBegin(GL_LINES);
-        glColor3f(1.0f, 1.0f, 0.0f); // Edge color (yellow)
+// Bind a registry texture (or its atlas region)
+void bindTexture2D(TextureHandle texture) {
+    bindTexture2D(textureObject(texture));
+}
 
-        if (current.x == next.x) {
-            // Vertical line
-            glVertex3f(0, 0, -half_cell_size);
-            glVertex3f(0, 0, half_cell_size);
-        }
-        else if (current.y == next.y) {
-            // Horizontal line
-            glVertex3f(-half_cell_size, 0, 0);
-            glVertex3f(half_cell_size, 0, 0);
+/**
+ * Packs decoded textures into one atlas with shelf packing (tallest first)
+ * @param members: pairs of standalone texture id and decoded image
+ */
+void buildTextureAtlas(TextureAtlas& atlas, const std::vector<std::pair<unsigned int, const BmpImage*>>& members) {
+    atlas.texture = 0;
+    atlas.regions.clear();
+    if (members.empty()) return;
+
+    std::vector<size_t> order(members.size());
+    for (size_t i = 0; i < order.size(); i++) order[i] = i;
+    std::sort(order.begin(), order.end(), [&members](size_t a, size_t b) {
+        return members[a].second->height > members[b].second->height;
+    });
+
+    // Find the smallest square power-of-two size the shelves fit in
+    GLint maxTextureSize = 2048;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTextureSize);
+    std::vector<int> placeX(members.size()), placeY(members.size());
+    int size = 256;
+    for (;; size *= 2) {
+        if (size > maxTextureSize) {
+            std::cerr << "Texture atlas does not fit in " << maxTextureSize << " pixels; using separate textures" << std::endl;
+            return;
         }
-        else {
-            // Diagonal turn (for corners)
-            glVertex3f(0, 0, 0);
-            if ((current.x - next.x) == 1 && (current.y - next.y) == 1) {
-                glVertex3f(-half_cell_size, 0, 0);
-                glVertex3f(0, 0, -half_cell_size);
-            }
-            else if ((current.x - next.x) == -1 && (current.y - next.y) == -1) {
-                glVertex3f(half_cell_size, 0, 0);
-                glVertex3f(0, 0, half_cell_size);
+
+        int shelfX = 0, shelfY = 0, shelfHeight = 0;
+        bool fits = true;
+        for (size_t index : order) {
+            int w = members[index].second->width + 2 * ATLAS_GUTTER;
+            int h = members[index].second->height + 2 * ATLAS_GUTTER;
+            if (shelfX + w > size) {
+                shelfY += shelfHeight;
+                shelfX = 0;
+                shelfHeight = 0;
             }
-            else if ((current.x - next.x) == -1 && (current.y - next.y) == 1) {
-                glVertex3f(half_cell_size, 0, 0);
-                glVertex3f(0, 0, -half_cell_size);
+            if (w > size || shelfY + h > size) {
+                fits = false;
+                break;
             }
-            else if ((current.x - next.x) == 1 && (current.y - next.y) == -1) {
-                glVertex3f(-half_cell_size, 0, 0);
-                glVertex3f(0, 0, half_cell_size);
+            placeX[index] = shelfX;
+            placeY[index] = shelfY;
+            shelfX += w;
+            shelfHeight = std::max(shelfHeight, h);
+        }
+        if (fits) break;
+    }
+
+    // Compose BGRA pixels bottom row first, clamping into the gutter
+    std::vector<unsigned char> pixels((size_t)size * size * 4, 0);
+    size_t usedPixels = 0;
+    for (size_t i = 0; i < members.size(); i++) {
+        const BmpImage& image = *members[i].second;
+        usedPixels += (size_t)image.width * image.height;
+
+        for (int y = -ATLAS_GUTTER; y < image.height + ATLAS_GUTTER; y++) {
+            int glRow = std::max(0, std::min(y, image.height - 1));
+            int storedRow = image.topDown ? image.height - 1 - glRow : glRow;
+            const unsigned char* sourceRow = image.pixels + (size_t)storedRow * image.rowStride;
+            unsigned char* targetRow = &pixels[((size_t)(placeY[i] + ATLAS_GUTTER + y) * size + placeX[i] + ATLAS_GUTTER) * 4];
+
+            for (int x = -ATLAS_GUTTER; x < image.width + ATLAS_GUTTER; x++) {
+                const unsigned char* source = sourceRow + (size_t)std::max(0, std::min(x, image.width - 1)) * image.bytesPerPixel;
+                unsigned char* target = targetRow + x * 4;
+                target[0] = source[0];
+                target[1] = source[1];
+                target[2] = source[2];
+                target[3] = (image.bytesPerPixel == 4) ? source[3] : 255;
             }
         }
-        glEnd();
 
-        glPopMatrix();
+        AtlasRegion region = {
+            (float)(placeX[i] + ATLAS_GUTTER) / size,
+            (float)(placeY[i] + ATLAS_GUTTER) / size,
+            (float)(placeX[i] + ATLAS_GUTTER + image.width) / size,
+            (float)(placeY[i] + ATLAS_GUTTER + image.height) / size
+        };
+        atlas.regions.push_back(std::make_pair(members[i].first, region));
     }
-    glLineWidth(1.0f);
-}
-
-// Function to render 3D text with reduced thickness
-void snake_draw_text_3d(const std::string& text, float x, float y, float z, float scale, float depth) {
-    glPushMatrix();
-    glTranslatef(x, y, z);
-
-    // Rotate the text to face the camera
-    glRotatef(-40, 0, 0, 0);
 
+    BmpImage atlasImage;
+    atlasImage.width = size;
+    atlasImage.height = size;
+    atlasImage.bytesPerPixel = 4;
+    atlasImage.rowStride = (size_t)size * 4;
+    atlasImage.pixels = pixels.data();
 
-    glColor3f(1.0f, 0.0f, 0.0f); // Red front face of the text
+    MipChain mips;
+    buildMipChain(atlasImage, mips);
+    mips.levels.resize(std::min(mips.levels.size(), (size_t)ATLAS_MAX_MIP_LEVEL));
+    atlas.texture = uploadBmpTexture(atlasImage, mips);
+    registerTexture("<atlas>", hashImageContent(atlasImage), atlas.texture, size, size,
+        textureMemoryBytes(atlasImage, mips), true);
 
-    for (float d = -depth / 4.0f; d <= depth / 4.0f; d += scale * 0.2f) { // 修改这里
-        glPushMatrix();
-        glTranslatef(0.0f, 0.0f, d);
-        glScalef(scale, scale, scale);
-        for (char c : text) {
-            glutStrokeCharacter(GLUT_STROKE_ROMAN, c);
-        }
-        glPopMatrix();
-    }
-    glPopMatrix();
+    printf("Texture atlas: %u textures in %dx%d (%.0f%% used)\n", (unsigned int)members.size(), size, size,
+        100.0 * usedPixels / ((double)size * size));
 }
 
+// Texture file to load into a texture slot
+struct TextureLoadRequest {
+    TextureHandle* target;            // Handle receiving the texture
+    const char* path;
+    TextureZone zone;                 // Loaded at startup (ZONE_RESIDENT) or streamed with its zone
+    TextureAtlas* atlas = nullptr;    // Also pack into this atlas when set; resident textures only
+};
 
-// Main display function for the Snake Game
-void snake_display() {
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    glLoadIdentity();
-    // Set up a global ambient light to increase overall scene brightness
-    GLfloat ambientLight[] = { 1.9f, 1.9f, 1.9f, 1.9f }; // Higher values will increase brightness
-    glLightfv(GL_LIGHT0, GL_AMBIENT, ambientLight);
-
-    // Set up the other spotlight or directional lights as usual
-    GLfloat diffuseLight[] = { 1.9f, 1.9f, 1.9f, 1.9f };  // White diffuse light
-    GLfloat position[] = { 20.0f, 20.0f, 20.0f, 20.0f };      // Light position
-    glLightfv(GL_LIGHT0, GL_DIFFUSE, diffuseLight);
-    glLightfv(GL_LIGHT0, GL_POSITION, position);
-    glEnable(GL_LIGHT0);  // Enable light source 0
+// Result of decoding one texture on a worker thread
+struct DecodedTexture {
+    size_t request = 0;                  // Index into the request list
+    std::unique_ptr<MappedFile> file;    // Keeps the pixels mapped until upload
+    BmpImage image;
+    MipChain mips;                       // Levels below 0, filtered on the worker
+    std::string error;                   // Empty on success
+    uint64_t contentHash = 0;            // Pixel hash for registry deduplication
+    double decodeMilliseconds = 0.0;
+};
 
-    // Set the camera view (perspective)
-    gluLookAt(
-        (snake_grid_columns * snake_cell_size) / 2.0f, 80.0f, (snake_grid_rows * snake_cell_size) + 20.0f,
-        (snake_grid_columns * snake_cell_size) / 2.0f, 0.0f, (snake_grid_rows * snake_cell_size) / 2.0f,
-        0.0f, 1.0f, 0.0f
-    );
+// Map, validate and mip a BMP on a worker, touching every page so disk reads happen off the main thread
+void decodeTexture(const char* path, DecodedTexture& result) {
+    TRACE_SCOPE("texture decode", path);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    // Packed textures are already GPU-ready; only their pages need faulting in
+    if (findPackedTexture(path, result.image, result.mips)) {
+        const unsigned char* begin = result.image.pixels;
+        const unsigned char* end = result.mips.levels.empty() ? begin + result.image.rowStride * result.image.height :
+            result.mips.levelData(result.mips.levels.size() - 1) +
+            result.mips.levels.back().rowStride * result.mips.levels.back().height;
+        unsigned char pageSum = 0;
+        for (const unsigned char* page = begin; page < end; page += 4096) {
+            pageSum ^= *page;
+        }
+        volatile unsigned char sink = pageSum;
+        (void)sink;
+        result.contentHash = hashImageContent(result.image);
+        result.decodeMilliseconds = millisecondsSince(start);
+        return;
+    }
 
-    // Draw the game grid
-    snake_draw_grid();
+    result.file.reset(new MappedFile());
+    if (!result.file->open(path)) {
+        result.error = "unable to open file";
+    }
+    else if (parseBmp(result.file->data, result.file->size, result.image, result.error)) {
+        unsigned char pageSum = 0;
+        for (size_t offset = 0; offset < result.file->size; offset += 4096) {
+            pageSum ^= result.file->data[offset];
+        }
+        volatile unsigned char sink = pageSum;  // Keep the page reads from being optimized away
+        (void)sink;
 
-    // Draw the snake's body
-    for (size_t i = 0; i < snake_body.size(); ++i) {
-        if (i == 0)
-            snake_draw_cube(snake_body[i].x, 0.5f, snake_body[i].y, 1.0f, 0.0f, 1.0f, 0.0f); // Head (green)
-        else
-            snake_draw_cube(snake_body[i].x, 0.5f, snake_body[i].y, 0.9f, 0.0f, 0.8f, 0.0f); // Body
+        buildMipChain(result.image, result.mips);
+        result.contentHash = hashImageContent(result.image);
     }
+    result.decodeMilliseconds = millisecondsSince(start);
+}
 
-    // Draw the connecting lines for the snake
-    snake_draw_snake_lines();
+/**
+ * Loads a batch of textures: files are mapped and validated on the worker pool, and each
+ * one is uploaded on this (the GL context) thread as soon as its decode finishes
+ */
+void loadTexturesParallel(const std::vector<TextureLoadRequest>& requests) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    std::mutex doneMutex;
+    std::condition_variable doneSignal;
+    std::vector<std::unique_ptr<DecodedTexture>> done;
+
+    // Decode each name once; repeated names are resolved from the registry afterwards
+    std::vector<size_t> decodeList;
+    std::vector<size_t> repeated;
+    for (size_t i = 0; i < requests.size(); i++) {
+        if (requests[i].zone != ZONE_RESIDENT) continue;  // Streamed later by updateTextureResidency()
+        bool seen = textureRegistry.byName.count(normalizeAssetPath(requests[i].path)) > 0;
+        for (size_t j = 0; j < decodeList.size() && !seen; j++) {
+            seen = normalizeAssetPath(requests[decodeList[j]].path) == normalizeAssetPath(requests[i].path);
+        }
+        if (seen) repeated.push_back(i);
+        else decodeList.push_back(i);
+    }
 
-    // Draw the food object
-    snake_draw_cube(snake_food.x, 0.5f, snake_food.y, 1.0f, 1.0f, 0.0f, 0.0f); // Food (red)
+    ThreadPool& pool = getWorkerPool();
+    for (size_t i : decodeList) {
+        pool.submit([&requests, &doneMutex, &doneSignal, &done, i]() {
+            std::unique_ptr<DecodedTexture> result(new DecodedTexture());
+            result->request = i;
+            decodeTexture(requests[i].path, *result);
 
-    // Render fireworks if any are present
-    if (!snake_fireworks.empty()) {
-        snake_draw_fireworks();
+            std::lock_guard<std::mutex> lock(doneMutex);
+            done.push_back(std::move(result));
+            doneSignal.notify_one();
+        });
     }
 
-    // Display "GAME OVER" text if the game has ended
-    if (snake_game_over) {
-        glColor3f(1.0f, 1.0f, 1.0f);
-        snake_draw_text_3d("GAME OVER",
-            (snake_grid_columns / 5) * snake_cell_size,
-            7.0f * snake_cell_size,
-            ((snake_grid_rows / 2.0f) - 2.0f) * snake_cell_size,
-            0.025f * snake_cell_size,
-            0.8f * snake_cell_size
-        );
-        snake_draw_text_3d("Press 'R' to Restart",
-            (snake_grid_columns / 10) * snake_cell_size,
-            1.0f * snake_cell_size,
-            ((snake_grid_rows / 2.0f) - 2.0f) * snake_cell_size,
-            0.02f * snake_cell_size,
-            0.6f * snake_cell_size
-        );
-    }
+    // Atlas members stay decoded until every texture has arrived
+    std::vector<std::unique_ptr<DecodedTexture>> atlasMembers;
+    size_t shared = 0;
 
+    // Upload in completion order; the loop only returns once every worker task has finished
+    for (size_t uploaded = 0; uploaded < decodeList.size(); uploaded++) {
+        std::unique_ptr<DecodedTexture> item;
+        {
+            std::unique_lock<std::mutex> lock(doneMutex);
+            doneSignal.wait(lock, [&done]() { return !done.empty(); });
+            item = std::move(done.back());
+            done.pop_back();
+        }
 
+        const TextureLoadRequest& request = requests[item->request];
+        if (!item->error.empty()) {
+            std::cerr << "Unable to load texture " << request.path << ": " << item->error << std::endl;
+            *request.target = acquirePlaceholderTexture(request.path);
+            continue;
+        }
 
-    glutSwapBuffers();
-}
+        // Identical pixels under another name share the existing texture
+        *request.target = acquireTextureByContent(request.path, item->contentHash);
+        if (!request.target->isNull()) {
+            shared++;
+            continue;
+        }
 
-// Function to load a texture from a file
-unsigned int loadGLTexture(const char* filename) {
-    unsigned int texture;
+        TRACE_SCOPE("texture upload", request.path);
+        std::chrono::steady_clock::time_point uploadStart = std::chrono::steady_clock::now();
+        *request.target = registerTexture(request.path, item->contentHash, uploadBmpTexture(item->image, item->mips),
+            item->image.width, item->image.height, textureMemoryBytes(item->image, item->mips));
+        printf("Texture %-32s %4dx%-4d decode %7.2f ms, upload %7.2f ms\n", request.path,
+            item->image.width, item->image.height, item->decodeMilliseconds, millisecondsSince(uploadStart));
 
-    static GLint   imagewidth;
-    static GLint   imageheight;
-    static GLint   pixellength;
-    static GLubyte* pixeldata;
-    FILE* pfile;
-    errno_t err = fopen_s(&pfile, filename, "rb");
-    if (err != 0 || pfile == nullptr) {
-        std::cerr << "Unable to open texture file: " << filename << std::endl;
-        exit(1);
+        if (request.atlas != nullptr) {
+            atlasMembers.push_back(std::move(item));
+        }
     }
 
-    fseek(pfile, 0x0012, SEEK_SET); // Skip BMP file header
-    fread(&imagewidth, sizeof(imagewidth), 1, pfile); // Read image width
-    fread(&imageheight, sizeof(imageheight), 1, pfile); // Read image height
-    pixellength = imagewidth * 3;
-    while (pixellength % 4 != 0)
-        pixellength++;
-    pixellength *= imageheight;
-    pixeldata = (GLubyte*)malloc(pixellength);
-    if (pixeldata == 0) {
-        std::cerr << "Unable to allocate memory for texture." << std::endl;
-        exit(1);
+    for (size_t i : repeated) {
+        *requests[i].target = acquireTexture(requests[i].path);
+        shared++;
     }
-    fseek(pfile, 54, SEEK_SET);
-    fread(pixeldata, pixellength, 1, pfile);
-    fclose(pfile);
 
-    glGenTextures(1, &texture);
-    glBindTexture(GL_TEXTURE_2D, texture);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-#ifdef GL_BGR_EXT
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, imagewidth, imageheight, 0, GL_BGR_EXT, GL_UNSIGNED_BYTE, pixeldata);
-#else
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, imagewidth, imageheight, 0, GL_BGR, GL_UNSIGNED_BYTE, pixeldata);
-#endif
-
-    free(pixeldata); // Release memory after uploading to GPU
+    // Build each atlas from its decoded members, in request order so the layout does not depend on decode timing
+    std::sort(atlasMembers.begin(), atlasMembers.end(),
+        [](const std::unique_ptr<DecodedTexture>& a, const std::unique_ptr<DecodedTexture>& b) { return a->request < b->request; });
+    std::vector<TextureAtlas*> atlases;
+    for (const std::unique_ptr<DecodedTexture>& member : atlasMembers) {
+        TextureAtlas* atlas = requests[member->request].atlas;
+        if (std::find(atlases.begin(), atlases.end(), atlas) == atlases.end()) atlases.push_back(atlas);
+    }
+    for (TextureAtlas* atlas : atlases) {
+        std::vector<std::pair<unsigned int, const BmpImage*>> members;
+        for (const std::unique_ptr<DecodedTexture>& member : atlasMembers) {
+            const TextureLoadRequest& request = requests[member->request];
+            if (request.atlas == atlas) members.push_back(std::make_pair(textureObject(*request.target), &member->image));
+        }
+        buildTextureAtlas(*atlas, members);
+    }
 
-    return texture;
+    printf("Loaded %u textures (%u shared) in %.2f ms on %u worker threads\n",
+        (unsigned int)(decodeList.size() + repeated.size()), (unsigned int)shared, millisecondsSince(start), (unsigned int)pool.workers.size());
+    reportTextureMemory();
 }
 
 
-void mySolidCube(float scale, unsigned int texId) {
+
+void mySolidCube(float scale, TextureHandle texture) {
     glPushMatrix();
     glScaled(scale, scale, scale); // Scale the cube
 
     if (gUseTexture) {
         glColor3f(1, 1, 1);  // Set color to white for texturing
         glEnable(GL_TEXTURE_2D);
-        glBindTexture(GL_TEXTURE_2D, texId);  // Bind the texture
+        bindTexture2D(texture);  // Bind the texture (or its atlas region)
     }
     else {
         glColor3ub(255, 211, 155);  // Set a solid color for the cube
@@ -1293,14 +4064,14 @@ void mySolidCube(float scale, unsigned int texId) {
 struct Cloud {
     GLfloat x, y, z; // Position of the cloud in 3D space (X, Y, Z coordinates)
     GLfloat size;    // Size of the cloud
-    std::vector<GLfloat> sphereOffsetsX; // Offsets for the X-coordinate of spheres in the cloud
-    std::vector<GLfloat> sphereOffsetsY; // Offsets for the Y-coordinate of spheres in the cloud
-    std::vector<GLfloat> sphereOffsetsZ; // Offsets for the Z-coordinate of spheres in the cloud
-    std::vector<GLfloat> sphereSizes;    // Sizes of the individual spheres in the cloud
+    TaggedVector<GLfloat, MEMORY_CLOUDS> sphereOffsetsX; // Offsets for the X-coordinate of spheres in the cloud
+    TaggedVector<GLfloat, MEMORY_CLOUDS> sphereOffsetsY; // Offsets for the Y-coordinate of spheres in the cloud
+    TaggedVector<GLfloat, MEMORY_CLOUDS> sphereOffsetsZ; // Offsets for the Z-coordinate of spheres in the cloud
+    TaggedVector<GLfloat, MEMORY_CLOUDS> sphereSizes;    // Sizes of the individual spheres in the cloud
 };
 
 // Vector to store all clouds
-std::vector<Cloud> clouds;
+TaggedVector<Cloud, MEMORY_CLOUDS> clouds;
 
 // Function to initialize clouds with random positions, sizes, and shapes
 void initClouds() {
@@ -1360,7 +4131,7 @@ void drawCloud(const Cloud& cloud, const GLfloat color[4]) {
         // Move to the sphere's offset position within the cloud
         glTranslatef(cloud.sphereOffsetsX[i], cloud.sphereOffsetsY[i], cloud.sphereOffsetsZ[i]);
         // Draw the sphere (solid)
-        glutSolidSphere(cloud.sphereSizes[i], 20, 20);
+        solidSphere(cloud.sphereSizes[i], 20, 20);
         glPopMatrix();
     }
 
@@ -1372,6 +4143,7 @@ void drawCloud(const Cloud& cloud, const GLfloat color[4]) {
 
 // Function to draw clouds in the sky
 void drawSkyClouds() {
+    PROFILE_PASS(PROFILE_SKY_CLOUDS);
     glPushMatrix(); // Save the current matrix state
     GLfloat cloudColor[4]; // Array to store the RGBA color of the clouds
 
@@ -1417,7 +4189,7 @@ void drawGround() {
     if (gUseTexture) {
         // If textures are enabled, use the grass texture
         glEnable(GL_TEXTURE_2D); // Enable 2D texturing
-        glBindTexture(GL_TEXTURE_2D, texVec[9]); // Bind the grass texture
+        bindTexture2D(grassTexture); // Bind the grass texture
     }
     else {
         // If textures are disabled, ensure texturing is off
@@ -1567,6 +4339,7 @@ void drawBranches(float treeHeight, float trunkRadius) {
 
 // Function to render all trees
 void drawTrees() {
+    PROFILE_PASS(PROFILE_TREES);
     glPushMatrix();
 
     for (const auto& tree : trees) {
@@ -1579,7 +4352,7 @@ void drawTrees() {
         // Render the trunk with optional texture mapping
         if (gUseTexture) {
             glEnable(GL_TEXTURE_2D);
-            glBindTexture(GL_TEXTURE_2D, texVec[11]); // Bind bark texture
+            bindTexture2D(barkTexture); // Bind bark texture
             glColor3f(1.0f, 1.0f, 1.0f); // Set color to white for texture
         }
         else {
@@ -1628,7 +4401,7 @@ void drawTrees() {
 
             glPushMatrix();
             glTranslatef(0.0f, treeHeight + i * layerHeight, 0.0f); // Position foliage layer
-            glutSolidSphere(sphereRadius, 16, 16); // Draw sphere for foliage
+            solidSphere(sphereRadius, 16, 16); // Draw sphere for foliage
             glPopMatrix();
         }
 
@@ -1652,7 +4425,7 @@ void renderBase() {
 
     if (gUseTexture) {
         glEnable(GL_TEXTURE_2D); // Enable texturing for the rug
-        glBindTexture(GL_TEXTURE_2D, texVec[0]); // Bind rug texture (ensure texVec[11] is loaded)
+        bindTexture2D(floorTexture); // Bind rug texture
         glColor3f(1.0f, 1.0f, 1.0f); // White color for texture fidelity
     }
     else {
@@ -1686,7 +4459,7 @@ void renderRoof() {
 
     if (gUseTexture) {
         glEnable(GL_TEXTURE_2D); // Enable texturing for the roof
-        glBindTexture(GL_TEXTURE_2D, texVec[10]); // Bind the roof texture
+        bindTexture2D(roofTexture); // Bind the roof texture
         glColor3f(1.0f, 1.0f, 1.0f); // Use white color to preserve texture colors
     }
     else {
@@ -1737,7 +4510,7 @@ void renderRoof() {
 
     if (gUseTexture) {
         glEnable(GL_TEXTURE_2D); // Enable texturing for the chimney
-        glBindTexture(GL_TEXTURE_2D, texVec[12]); // Bind chimney texture (ensure texVec[12] is loaded)
+        bindTexture2D(headTexture); // Bind chimney texture
         glColor3f(1.0f, 1.0f, 1.0f); // White color for texture fidelity
     }
     else {
@@ -1746,7 +4519,7 @@ void renderRoof() {
     }
 
     // Draw the chimney as a scaled cube or cylinder
-    glutSolidCube(1.0f); // Using a solid cube for simplicity; can be replaced with cylinders for more detail
+    solidCube(1.0f); // Using a solid cube for simplicity; can be replaced with cylinders for more detail
 
     glDisable(GL_TEXTURE_2D); // Disable texturing after chimney
     glPopMatrix(); // Restore transformation
@@ -1775,7 +4548,7 @@ void drawDoor() {
 
     if (gUseTexture) {
         glEnable(GL_TEXTURE_2D);  // Enable texture mapping for the door
-        glBindTexture(GL_TEXTURE_2D, texVec[22]);  // Bind the door texture
+        bindTexture2D(doorTexture);  // Bind the door texture
         glColor3f(1.0f, 1.0f, 1.0f);  // Set color to white for texture rendering
     }
     else {
@@ -1827,7 +4600,7 @@ void renderWalls() {
         glDisable(GL_TEXTURE_2D); // Disable texturing
     }
 
-    glBindTexture(GL_TEXTURE_2D, texVec[1]); // Bind wall texture
+    bindTexture2D(wallpaperTexture); // Bind wall texture
     glBegin(GL_QUADS);
     glNormal3f(1.0f, 0.0f, 0.0f); // Normal pointing right
 
@@ -1855,7 +4628,7 @@ void renderWalls() {
         glDisable(GL_TEXTURE_2D); // Disable texturing
     }
 
-    glBindTexture(GL_TEXTURE_2D, texVec[1]); // Bind wall texture
+    bindTexture2D(wallpaperTexture); // Bind wall texture
     glBegin(GL_QUADS);
     glNormal3f(0.0f, 0.0f, 1.0f); // Normal pointing forward
 
@@ -1885,7 +4658,7 @@ void renderWalls() {
         glDisable(GL_TEXTURE_2D); // Disable texturing
     }
 
-    glBindTexture(GL_TEXTURE_2D, texVec[1]); // Bind wall texture
+    bindTexture2D(wallpaperTexture); // Bind wall texture
     glBegin(GL_QUADS);
     glNormal3f(-1.0f, 0.0f, 0.0f); // Normal pointing left
 
@@ -1913,7 +4686,7 @@ void renderWalls() {
         glDisable(GL_TEXTURE_2D); // Disable texturing
     }
 
-    glBindTexture(GL_TEXTURE_2D, texVec[1]); // Bind wall texture
+    bindTexture2D(wallpaperTexture); // Bind wall texture
     glBegin(GL_QUADS);
     glNormal3f(0.0f, 0.0f, -1.0f); // Normal facing front
 
@@ -1941,7 +4714,7 @@ void renderWalls() {
         glDisable(GL_TEXTURE_2D); // Disable texturing
     }
 
-    glBindTexture(GL_TEXTURE_2D, texVec[1]); // Bind wall texture
+    bindTexture2D(wallpaperTexture); // Bind wall texture
     glBegin(GL_QUADS);
     glNormal3f(0.0f, 0.0f, -1.0f); // Normal facing front
 
@@ -1970,7 +4743,7 @@ void renderWalls() {
         glDisable(GL_TEXTURE_2D); // Disable texturing
     }
 
-    glBindTexture(GL_TEXTURE_2D, texVec[1]); // Bind wall texture
+    bindTexture2D(wallpaperTexture); // Bind wall texture
     glBegin(GL_QUADS);
     glNormal3f(0.0f, 0.0f, -1.0f); // Normal facing front
 
@@ -1989,7 +4762,7 @@ void renderWalls() {
     glTranslatef(-3.0f, 3.0f, -5.99f); // Position the left window
     glScalef(1.5f, 1.5f, 0.1f); // Scale for window size
     glColor3ub(173, 216, 230); // Light blue color for glass
-    glutSolidCube(1.0f); // Draw the window as a solid cube
+    solidCube(1.0f); // Draw the window as a solid cube
     glPopMatrix(); // Restore transformation
 
     // Render the right window on the front wall
@@ -1997,7 +4770,7 @@ void renderWalls() {
     glTranslatef(3.0f, 3.0f, -5.99f); // Position the right window
     glScalef(1.5f, 1.5f, 0.1f); // Scale for window size
     glColor3ub(173, 216, 230); // Light blue color for glass
-    glutSolidCube(1.0f); // Draw the window as a solid cube
+    solidCube(1.0f); // Draw the window as a solid cube
     glPopMatrix(); // Restore transformation
 
     // Render the roof by calling the roof rendering function
@@ -2015,7 +4788,7 @@ void renderSofa() {
     glTranslatef(-1.7f, 0.6f, 0.0f); // Position relative to sofa center
     glScalef(0.5f, 1.2f, 1.6f); // Scale for armrest dimensions
     glColor3ub(160, 82, 45); // Brown color for armrest
-    glutSolidCube(1.0f); // Draw the armrest as a solid cube
+    solidCube(1.0f); // Draw the armrest as a solid cube
     glPopMatrix(); // Restore transformation
 
     // Render the right armrest of the sofa
@@ -2023,7 +4796,7 @@ void renderSofa() {
     glTranslatef(1.7f, 0.6f, 0.0f); // Position relative to sofa center
     glScalef(0.5f, 1.2f, 1.6f); // Scale for armrest dimensions
     glColor3ub(160, 82, 45); // Brown color for armrest
-    glutSolidCube(1.0f); // Draw the armrest as a solid cube
+    solidCube(1.0f); // Draw the armrest as a solid cube
     glPopMatrix(); // Restore transformation
 
     // Render the seat cushion of the sofa
@@ -2031,7 +4804,7 @@ void renderSofa() {
     glTranslatef(0.0f, 0.15f, 0.0f); // Position relative to sofa center
     glScalef(3.4f, 0.3f, 1.6f); // Scale for cushion dimensions
     glColor3ub(210, 180, 140); // Tan color for cushion
-    glutSolidCube(1.0f); // Draw the cushion as a solid cube
+    solidCube(1.0f); // Draw the cushion as a solid cube
     glPopMatrix(); // Restore transformation
 
     // Render the backrest of the sofa
@@ -2039,7 +4812,7 @@ void renderSofa() {
     glTranslatef(0.0f, 0.75f, -0.7f); // Position slightly behind the cushion
     glScalef(3.8f, 1.5f, 0.2f); // Scale for backrest dimensions
     glColor3ub(160, 82, 45); // Brown color for backrest
-    glutSolidCube(1.0f); // Draw the backrest as a solid cube
+    solidCube(1.0f); // Draw the backrest as a solid cube
     glPopMatrix(); // Restore transformation
 
     // Render the left side cushion of the sofa
@@ -2047,7 +4820,7 @@ void renderSofa() {
     glTranslatef(-0.75f, 0.5f, 0.2f); // Position above the seat
     glScalef(1.4f, 0.4f, 1.6f); // Scale for cushion dimensions
     glColor3ub(210, 180, 140); // Tan color for cushion
-    glutSolidCube(1.0f); // Draw the cushion as a solid cube
+    solidCube(1.0f); // Draw the cushion as a solid cube
     glPopMatrix(); // Restore transformation
 
     // Render the right side cushion of the sofa
@@ -2055,7 +4828,7 @@ void renderSofa() {
     glTranslatef(0.75f, 0.5f, 0.2f); // Position above the seat
     glScalef(1.5f, 0.4f, 1.6f); // Scale for cushion dimensions
     glColor3ub(210, 180, 140); // Tan color for cushion
-    glutSolidCube(1.0f); // Draw the cushion as a solid cube
+    solidCube(1.0f); // Draw the cushion as a solid cube
     glPopMatrix(); // Restore transformation
 
     // Add decorative pillows on the sofa
@@ -2064,7 +4837,7 @@ void renderSofa() {
     glTranslatef(-1.0f, 0.6f, 0.3f); // Position the left pillow
     glScalef(0.3f, 0.2f, 0.3f); // Scale for pillow dimensions
     glColor3ub(255, 192, 203); // Pink color for pillow
-    glutSolidCube(1.0f); // Draw the pillow as a solid cube
+    solidCube(1.0f); // Draw the pillow as a solid cube
     glPopMatrix(); // Restore transformation
 
     // Right pillow
@@ -2072,7 +4845,7 @@ void renderSofa() {
     glTranslatef(1.0f, 0.6f, 0.3f); // Position the right pillow
     glScalef(0.3f, 0.2f, 0.3f); // Scale for pillow dimensions
     glColor3ub(255, 192, 203); // Pink color for pillow
-    glutSolidCube(1.0f); // Draw the pillow as a solid cube
+    solidCube(1.0f); // Draw the pillow as a solid cube
     glPopMatrix(); // Restore transformation
 
     glPopMatrix(); // Restore the original transformation state
@@ -2091,14 +4864,14 @@ void renderCupboard() {
     glScalef(0.1f, 0.8f, 0.8f); // Scale for panel dimensions
     if (gUseTexture) {
         glEnable(GL_TEXTURE_2D); // Enable texturing
-        glBindTexture(GL_TEXTURE_2D, texVec[4]); // Bind cupboard texture
+        bindTexture2D(woodTexture); // Bind cupboard texture
         glColor3f(1.0f, 1.0f, 1.0f); // White for texture fidelity
     }
     else {
         glColor3ub(70, 130, 180); // Steel blue color if no texture
         glDisable(GL_TEXTURE_2D); // Disable texturing
     }
-    glutSolidCube(1.0f); // Draw the panel as a solid cube
+    solidCube(1.0f); // Draw the panel as a solid cube
     glDisable(GL_TEXTURE_2D); // Disable texturing after panel
     glPopMatrix(); // Restore transformation
 
@@ -2108,14 +4881,14 @@ void renderCupboard() {
     glScalef(0.1f, 0.8f, 0.8f); // Scale for panel dimensions
     if (gUseTexture) {
         glEnable(GL_TEXTURE_2D); // Enable texturing
-        glBindTexture(GL_TEXTURE_2D, texVec[4]); // Bind cupboard texture
+        bindTexture2D(woodTexture); // Bind cupboard texture
         glColor3f(1.0f, 1.0f, 1.0f); // White for texture fidelity
     }
     else {
         glColor3ub(70, 130, 180); // Steel blue color if no texture
         glDisable(GL_TEXTURE_2D); // Disable texturing
     }
-    glutSolidCube(1.0f); // Draw the panel as a solid cube
+    solidCube(1.0f); // Draw the panel as a solid cube
     glDisable(GL_TEXTURE_2D); // Disable texturing after panel
     glPopMatrix(); // Restore transformation
 
@@ -2125,14 +4898,14 @@ void renderCupboard() {
     glScalef(2.0f, 0.1f, 0.8f); // Scale for base dimensions
     if (gUseTexture) {
         glEnable(GL_TEXTURE_2D); // Enable texturing
-        glBindTexture(GL_TEXTURE_2D, texVec[4]); // Bind cupboard texture
+        bindTexture2D(woodTexture); // Bind cupboard texture
         glColor3f(1.0f, 1.0f, 1.0f); // White for texture fidelity
     }
     else {
         glColor3ub(70, 130, 180); // Steel blue color if no texture
         glDisable(GL_TEXTURE_2D); // Disable texturing
     }
-    glutSolidCube(1.0f); // Draw the base as a solid cube
+    solidCube(1.0f); // Draw the base as a solid cube
     glDisable(GL_TEXTURE_2D); // Disable texturing after base
     glPopMatrix(); // Restore transformation
 
@@ -2142,14 +4915,14 @@ void renderCupboard() {
     glScalef(2.4f, 0.1f, 0.9f); // Scale for shelf dimensions
     if (gUseTexture) {
         glEnable(GL_TEXTURE_2D); // Enable texturing
-        glBindTexture(GL_TEXTURE_2D, texVec[4]); // Bind cupboard texture
+        bindTexture2D(woodTexture); // Bind cupboard texture
         glColor3f(1.0f, 1.0f, 1.0f); // White for texture fidelity
     }
     else {
         glColor3ub(70, 130, 180); // Steel blue color if no texture
         glDisable(GL_TEXTURE_2D); // Disable texturing
     }
-    glutSolidCube(1.0f); // Draw the shelf as a solid cube
+    solidCube(1.0f); // Draw the shelf as a solid cube
     glDisable(GL_TEXTURE_2D); // Disable texturing after shelf
     glPopMatrix(); // Restore transformation
 
@@ -2160,21 +4933,21 @@ void renderCupboard() {
     glScalef(0.45f, 0.8f, 0.05f); // Scale for door dimensions
     if (gUseTexture) {
         glEnable(GL_TEXTURE_2D); // Enable texturing
-        glBindTexture(GL_TEXTURE_2D, texVec[14]); // Bind door texture (ensure texVec[14] is loaded)
+        bindTexture2D(jamesTexture); // Bind door texture
         glColor3f(1.0f, 1.0f, 1.0f); // White for texture fidelity
     }
     else {
         glColor3ub(169, 169, 169); // Dark gray color if no texture
         glDisable(GL_TEXTURE_2D); // Disable texturing
     }
-    glutSolidCube(1.0f); // Draw the door as a solid cube
+    solidCube(1.0f); // Draw the door as a solid cube
     glDisable(GL_TEXTURE_2D); // Disable texturing after door
 
     // Add a doorknob to the left door
     glPushMatrix();
     glTranslatef(0.3f, 0.0f, 0.0f); // Position the doorknob on the door
     glColor3ub(255, 215, 0); // Gold color for the doorknob
-    glutSolidSphere(0.05f, 16, 16); // Draw the doorknob as a small sphere
+    solidSphere(0.05f, 16, 16); // Draw the doorknob as a small sphere
     glPopMatrix(); // Restore transformation
     glPopMatrix(); // Restore transformation
 
@@ -2184,21 +4957,21 @@ void renderCupboard() {
     glScalef(0.45f, 0.8f, 0.05f); // Scale for door dimensions
     if (gUseTexture) {
         glEnable(GL_TEXTURE_2D); // Enable texturing
-        glBindTexture(GL_TEXTURE_2D, texVec[14]); // Bind door texture (ensure texVec[14] is loaded)
+        bindTexture2D(jamesTexture); // Bind door texture
         glColor3f(1.0f, 1.0f, 1.0f); // White for texture fidelity
     }
     else {
         glColor3ub(169, 169, 169); // Dark gray color if no texture
         glDisable(GL_TEXTURE_2D); // Disable texturing
     }
-    glutSolidCube(1.0f); // Draw the door as a solid cube
+    solidCube(1.0f); // Draw the door as a solid cube
     glDisable(GL_TEXTURE_2D); // Disable texturing after door
 
     // Add a doorknob to the right door
     glPushMatrix();
     glTranslatef(-0.3f, 0.0f, 0.0f); // Position the doorknob on the door
     glColor3ub(255, 215, 0); // Gold color for the doorknob
-    glutSolidSphere(0.05f, 16, 16); // Draw the doorknob as a small sphere
+    solidSphere(0.05f, 16, 16); // Draw the doorknob as a small sphere
     glPopMatrix(); // Restore transformation
     glPopMatrix(); // Restore transformation
 
@@ -2241,14 +5014,14 @@ void renderFloorLamp() {
     glPushMatrix();
     glTranslatef(0.0f, 0.01f, 0.0f);  // Slight elevation to prevent z-fighting
     glRotatef(90.0f, 1.0f, 0.0f, 0.0f);  // Rotate to vertical orientation
-    glutSolidCylinder(0.5f, 0.01f, 32, 8);  // Parameters: radius, height, slices, stacks
+    solidCylinder(0.5f, 0.01f, 32, 8);  // Parameters: radius, height, slices, stacks
     glPopMatrix();
 
     // Render the vertical support pole
     glPushMatrix();
     glTranslatef(0.0f, 3.0f, 0.0f);  // Position at appropriate height
     glRotatef(90.0f, 1.0f, 0.0f, 0.0f);  // Vertical alignment
-    glutSolidCylinder(0.07f, 3.0f, 32, 8);  // Thin, tall cylinder
+    solidCylinder(0.07f, 3.0f, 32, 8);  // Thin, tall cylinder
     glPopMatrix();
 
     // Define material properties for the illuminated lampshade
@@ -2325,14 +5098,14 @@ void renderTableLamp() {
     glPushMatrix();
     glTranslatef(0.0f, 0.01f, 0.0f); // Slightly elevate the base above ground
     glRotatef(90.0f, 1.0f, 0.0f, 0.0f); // Align cylinder vertically
-    glutSolidCylinder(0.5f, 0.01f, 32, 8); // Draw the base cylinder
+    solidCylinder(0.5f, 0.01f, 32, 8); // Draw the base cylinder
     glPopMatrix(); // Restore transformation
 
     // Render the lamp pole (a shorter, thin cylinder)
     glPushMatrix();
     glTranslatef(0.0f, 1.5f, 0.0f); // Position above the base
     glRotatef(90.0f, 1.0f, 0.0f, 0.0f); // Align cylinder vertically
-    glutSolidCylinder(0.07f, 1.5f, 32, 8); // Draw the pole cylinder
+    solidCylinder(0.07f, 1.5f, 32, 8); // Draw the pole cylinder
     glPopMatrix(); // Restore transformation
 
     glColor3ub(255, 215, 0); // Set lampshade color to yellow
@@ -2365,7 +5138,7 @@ void renderDesk() {
 
     if (gUseTexture) {
         glEnable(GL_TEXTURE_2D); // Enable texturing if active
-        glBindTexture(GL_TEXTURE_2D, texVec[5]); // Bind desk texture
+        bindTexture2D(groundTexture); // Bind desk texture
         glColor3f(1.0f, 1.0f, 1.0f); // White to maintain texture colors
     }
     else {
@@ -2399,7 +5172,7 @@ void renderDesk() {
         glRotatef(legRotations[i], 0.0f, 0.0f, 1.0f); // Rotate leg outward
         glTranslatef(0.0f, 0.8f, 0.0f); // Adjust height
         glRotatef(90.0f, 1.0f, 0.0f, 0.0f); // Align cylinder vertically
-        glutSolidCylinder(0.05f, 0.8f, 32, 8); // Draw the leg cylinder
+        solidCylinder(0.05f, 0.8f, 32, 8); // Draw the leg cylinder
         glPopMatrix(); // Restore transformation
     }
 
@@ -2407,7 +5180,7 @@ void renderDesk() {
     glPushMatrix();
     glTranslatef(0.0f, 0.74f, 0.0f); // Position near legs
     glRotatef(90.0f, 1.0f, 0.0f, 0.0f); // Align horizontally
-    glutSolidCylinder(0.8f, 0.05f, 32, 8); // Draw the support cylinder
+    solidCylinder(0.8f, 0.05f, 32, 8); // Draw the support cylinder
     glPopMatrix(); // Restore transformation
 
     // Add additional objects on the desk
@@ -2418,14 +5191,14 @@ void renderDesk() {
     glTranslatef(0.3f, 0.8f, -0.3f); // Position the laptop
     glScalef(0.6f, 0.05f, 0.4f); // Scale for laptop dimensions
     glColor3ub(105, 105, 105); // Dim gray color for laptop base
-    glutSolidCube(1.0f); // Draw the laptop base
+    solidCube(1.0f); // Draw the laptop base
 
     // Render the laptop screen
     glPushMatrix();
     glTranslatef(0.0f, 0.5f, 0.0f); // Position the screen on top of the base
     glScalef(1.0f, 0.5f, 0.05f); // Scale for screen dimensions
     glColor3ub(0, 0, 0); // Black color for the screen
-    glutSolidCube(1.0f); // Draw the screen as a solid cube
+    solidCube(1.0f); // Draw the screen as a solid cube
     glPopMatrix(); // Restore transformation
     glPopMatrix(); // Restore transformation
 
@@ -2440,14 +5213,14 @@ void renderDesk() {
     // Render a teacup on the desk
     glPushMatrix();
     glTranslatef(-0.3f, 0.86f, -0.3f); // Position the teacup
-    glutSolidTeacup(0.3f); // Draw the teacup
+    solidTeacup(0.3f); // Draw the teacup
     glPopMatrix(); // Restore transformation
 
     // Render a teapot on the desk
     glPushMatrix();
     glTranslatef(0.3f, 0.86f, 0.0f); // Position the teapot
     glRotatef(180.0f, 0.0f, 1.0f, 0.0f); // Rotate for orientation
-    glutSolidTeapot(0.2f); // Draw the teapot
+    solidTeapot(0.2f); // Draw the teapot
     glPopMatrix(); // Restore transformation
 
 
@@ -2479,14 +5252,14 @@ void renderPartitionBoard() {
     glScalef(1.9f, 5.9f, 0.1f); // Scale for dimensions
     if (gUseTexture) {
         glEnable(GL_TEXTURE_2D); // Enable texturing
-        glBindTexture(GL_TEXTURE_2D, texVec[4]); // Bind partition texture
+        bindTexture2D(woodTexture); // Bind partition texture
         glColor3f(1.0f, 1.0f, 1.0f); // White for texture fidelity
     }
     else {
         glColor3ub(160, 82, 45); // Brown color if no texture
         glDisable(GL_TEXTURE_2D); // Disable texturing
     }
-    glutSolidCube(1.0f); // Draw the section as a solid cube
+    solidCube(1.0f); // Draw the section as a solid cube
     glDisable(GL_TEXTURE_2D); // Disable texturing after section
     glPopMatrix(); // Restore transformation
 
@@ -2507,9 +5280,9 @@ void renderPartitionBoard() {
 
 
 
-void drawTexturedCube(GLfloat size, GLuint textureID) {
+void drawTexturedCube(GLfloat size, TextureHandle texture) {
     GLfloat halfSize = size / 2.0f;
-    glBindTexture(GL_TEXTURE_2D, textureID);
+    bindTexture2D(texture);
     glBegin(GL_QUADS);
     // ǰ  
     glNormal3f(0.0f, 0.0f, 1.0f); //         
@@ -2539,7 +5312,7 @@ void drawPhoto() {
     glPushMatrix(); // Push the current matrix onto the stack
     glTranslated(0, 3.2, -5.9); // Translate the photo frame
     glScaled(4, 3, 0.1); // Scale the photo frame
-    glutSolidCube(1.f); // Draw a solid cube for the photo frame
+    solidCube(1.f); // Draw a solid cube for the photo frame
     glPopMatrix(); // Pop the matrix from the stack
 
     // Draw a textured photo
@@ -2554,7 +5327,7 @@ void drawPhoto() {
         glColor3ub(0, 191, 255); // Set a blue color
         glDisable(GL_TEXTURE_2D); // Disable texturing
     }
-    glBindTexture(GL_TEXTURE_2D, texVec[6]); // Bind the texture
+    bindTexture2D(paintingTexture); // Bind the texture
     glBegin(GL_QUADS); // Begin drawing a quad
     // Define the vertices and texture coordinates of the quad
     glNormal3f(0, 0, 1);
@@ -2592,21 +5365,21 @@ void drawSpotlightLamp() {
     // Draw the lamp base (a disk attached to the wall)
     glPushMatrix(); // Push the current matrix onto the stack
     glRotatef(-90, 1, 0, 0); // Rotate the base to lie flat against the wall
-    glutSolidCylinder(lampBaseRadius, lampBaseHeight, 32, 8); // Draw a cylinder for the base
+    solidCylinder(lampBaseRadius, lampBaseHeight, 32, 8); // Draw a cylinder for the base
     glPopMatrix(); // Pop the matrix from the stack
 
     // Draw the lamp body (the cylindrical part connecting the base and the head)
     glPushMatrix(); // Push the current matrix onto the stack
     glTranslatef(0.0f, -lampBodyHeight / 2.0f, 0.0f); // Translate the body
     glRotatef(180, 0, 1, 0); // Rotate the body downwards
-    glutSolidCylinder(lampBodyRadius, lampBodyHeight, 16, 8); // Draw a cylinder for the body
+    solidCylinder(lampBodyRadius, lampBodyHeight, 16, 8); // Draw a cylinder for the body
     glPopMatrix(); // Pop the matrix from the stack
 
     // Draw the lamp head (the conical part representing the lampshade)
     glPushMatrix(); // Push the current matrix onto the stack
     glTranslatef(0.0f, -lampBodyHeight, 0.0f); // Translate the head
     glRotatef(180, 0, 1, 0); // Rotate the head downwards
-    glutSolidCone(lampHeadRadius, lampHeadHeight, 32, 8); // Draw a cone for the head
+    solidCone(lampHeadRadius, lampHeadHeight, 32, 8); // Draw a cone for the head
     glPopMatrix(); // Pop the matrix from the stack
 }
 
@@ -2783,7 +5556,7 @@ void drawCoolCircle(float centerX, float centerY, float centerZ, float scaleFact
     glPushMatrix();
     glTranslatef(centerX, centerY, centerZ); // Translate to the specified center position
 
-    float time = glutGet(GLUT_ELAPSED_TIME) / 1000.0f; // Retrieve the current time in seconds
+    float time = sceneSeconds(); // Retrieve the current time in seconds
     int numLayers = 200; // Number of layers in the circular beam
     float layerSpacing = 0.03f * scaleFactor; // Vertical spacing between each layer
     float baseRadius = 2.0f * scaleFactor; // Base radius of the circular beam
@@ -2837,6 +5610,9 @@ void drawGameConsole()
     glMaterialfv(GL_FRONT, GL_SPECULAR, matSpecular);
     glMaterialfv(GL_FRONT, GL_SHININESS, matShininess);
 
+    // Base and main unit share the console texture from the character atlas
+    beginAtlasDraw(characterAtlas);
+
     // Render the base of the game console
     glPushMatrix();
     glRotatef(90.0f, 0.0f, 1.0f, 0.0f);
@@ -2846,7 +5622,7 @@ void drawGameConsole()
 
     if (gUseTexture) {
         glEnable(GL_TEXTURE_2D);
-        glBindTexture(GL_TEXTURE_2D, texVec[19]); // Bind the texture for the base
+        bindTexture2D(consoleTexture); // Bind the texture for the base
         glColor3f(1.0f, 1.0f, 1.0f);
     }
     else {
@@ -2854,7 +5630,7 @@ void drawGameConsole()
     }
 
     // Draw a textured solid cube for the base
-    mySolidCube(1.0f, texVec[19]);
+    mySolidCube(1.0f, consoleTexture);
 
     if (gUseTexture) {
         glDisable(GL_TEXTURE_2D);
@@ -2874,7 +5650,7 @@ void drawGameConsole()
 
     if (gUseTexture) {
         glEnable(GL_TEXTURE_2D);
-        glBindTexture(GL_TEXTURE_2D, texVec[19]); // Bind the texture for the main unit
+        bindTexture2D(consoleTexture); // Bind the texture for the main unit
         glColor3f(1.0f, 1.0f, 1.0f);
     }
     else {
@@ -2882,7 +5658,7 @@ void drawGameConsole()
     }
 
     // Draw a textured solid cube for the main unit
-    mySolidCube(1.0f, texVec[19]);
+    mySolidCube(1.0f, consoleTexture);
 
     if (gUseTexture) {
         glDisable(GL_TEXTURE_2D);
@@ -2890,6 +5666,8 @@ void drawGameConsole()
 
     glPopMatrix();
 
+    endAtlasDraw();
+
     // Render the screen of the game console with a semi-transparent effect
     glPushMatrix();
     glRotatef(90.0f, 0.0f, 1.0f, 0.0f); // Rotate 90 degrees to the left
@@ -2899,7 +5677,7 @@ void drawGameConsole()
     glColor4ub(0, 191, 255, 150); // Semi-transparent blue color for the screen
     glTranslatef(-5.0, (2 * scaleFactor) + baseHeight, -1.45f * scaleFactor);
     glScalef(0.9f * scaleFactor, 0.6f * scaleFactor, 0.1f * scaleFactor); // Increase thickness to ensure solidity
-    glutSolidCube(1.4f); // Draw the screen as a solid cube
+    solidCube(1.4f); // Draw the screen as a solid cube
     glDisable(GL_BLEND);
     glPopMatrix();
 
@@ -2911,7 +5689,7 @@ void drawGameConsole()
     glColor3ub(255, 20, 147); // Pink color for the neon stripe
     glTranslatef(-5.0, (1.7f * scaleFactor) + baseHeight, -1.5f * scaleFactor);
     glScalef(0.1f * scaleFactor, 0.8f * scaleFactor, 0.05f * scaleFactor); // Increase thickness to ensure solidity
-    glutSolidCube(1.0f); // Draw the first neon stripe
+    solidCube(1.0f); // Draw the first neon stripe
     glPopMatrix();
 
     // Second neon stripe
@@ -2921,7 +5699,7 @@ void drawGameConsole()
     glColor3ub(255, 20, 147); // Pink color for the neon stripe
     glTranslatef(-5, (1.7f * scaleFactor) + baseHeight, -1.5f * scaleFactor);
     glScalef(0.1f * scaleFactor, 0.8f * scaleFactor, 0.05f * scaleFactor); // Increase thickness to ensure solidity
-    glutSolidCube(1.0f); // Draw the second neon stripe
+    solidCube(1.0f); // Draw the second neon stripe
     glPopMatrix();
 
     // Render the button area of the game console
@@ -2931,7 +5709,7 @@ void drawGameConsole()
     glColor3ub(50, 50, 50); // Dark color for the button area
     glTranslatef(-5.0f, (1.3f * scaleFactor) + baseHeight, -1.45f * scaleFactor);
     glScalef(1.0f * scaleFactor, 0.1f * scaleFactor, 0.5f * scaleFactor); // Increase thickness to ensure solidity
-    glutSolidCube(1.0f); // Draw the button area as a solid cube
+    solidCube(1.0f); // Draw the button area as a solid cube
     glPopMatrix();
 
     // Render the red buttons positioned above the button area
@@ -2943,7 +5721,7 @@ void drawGameConsole()
         glRotatef(90.0f, 0.0f, 1.0f, 0.0f); // Rotate 90 degrees to the left
         glRotatef(180.0f, 0.0f, 1.0f, 0.0f); // Rotate 180 degrees backwards
         glTranslatef(-5.4f + (0.15f * i) * scaleFactor, (1.3f * scaleFactor) + baseHeight, -1.35f * scaleFactor);
-        glutSolidSphere(buttonRadius, 30, 30); // Draw the red button as a solid sphere
+        solidSphere(buttonRadius, 30, 30); // Draw the red button as a solid sphere
         glPopMatrix();
     }
 
@@ -2955,7 +5733,7 @@ void drawGameConsole()
     glColor3ub(0, 0, 0); // Black color for the directional key base
     glTranslatef(-5.4f + 0.35f * scaleFactor, (1.33f * scaleFactor) + baseHeight, -1.35f * scaleFactor); // Move to the right position
     glScalef(0.35f * scaleFactor, 0.05f * scaleFactor, 0.35f * scaleFactor); // Increase thickness to ensure solidity
-    glutSolidCube(1.0f); // Draw the base of the directional key
+    solidCube(1.0f); // Draw the base of the directional key
     glPopMatrix();
 
     // Directional key horizontal bar
@@ -2965,7 +5743,7 @@ void drawGameConsole()
     glColor3ub(0, 0, 255); // Blue color for the horizontal bar
     glTranslatef(-5.4f + 0.4f * scaleFactor, (1.37f * scaleFactor) + baseHeight, -1.3f * scaleFactor); // Move to the right position
     glScalef(0.12f * scaleFactor, 0.05f * scaleFactor, 0.06f * scaleFactor); // Increase thickness to ensure solidity
-    glutSolidCube(1.0f); // Draw the horizontal bar of the directional key
+    solidCube(1.0f); // Draw the horizontal bar of the directional key
     glPopMatrix();
 
     // Directional key vertical bar
@@ -2975,7 +5753,7 @@ void drawGameConsole()
     glColor3ub(0, 0, 255); // Blue color for the vertical bar
     glTranslatef(-5.4f + 0.45f * scaleFactor, (1.37f * scaleFactor) + baseHeight, -1.3f * scaleFactor); // Move to the right position
     glScalef(0.06f * scaleFactor, 0.05f * scaleFactor, 0.12f * scaleFactor); // Increase thickness to ensure solidity
-    glutSolidCube(1.0f); // Draw the vertical bar of the directional key
+    solidCube(1.0f); // Draw the vertical bar of the directional key
     glPopMatrix();
 
     // Render the arrow indicator positioned above the game console
@@ -2997,7 +5775,7 @@ void drawGameConsole()
     glMaterialfv(GL_FRONT, GL_EMISSION, emission);
 
     // Draw the arrow as a solid cone
-    glutSolidCone(0.45f, 0.9f, 20, 20); // Adjust size to fit the scene
+    solidCone(0.45f, 0.9f, 20, 20); // Adjust size to fit the scene
 
     // Reset the emission property to prevent unintended glowing
     GLfloat no_emission[] = { 0.0f, 0.0f, 0.0f, 1.0f };
@@ -3028,7 +5806,7 @@ void drawSupportColumn(float height, float radius)
     if (gUseTexture)
     {
         glEnable(GL_TEXTURE_2D);
-        glBindTexture(GL_TEXTURE_2D, texVec[30]); // Bind the desired texture
+        bindTexture2D(marbleTexture); // Bind the desired texture
         glColor3f(1.0f, 1.0f, 1.0f);              // Set color to white to display texture colors correctly
     }
     else
@@ -3095,7 +5873,7 @@ void drawFoundation(float width, float depth, float height)
     if (gUseTexture)
     {
         glEnable(GL_TEXTURE_2D);             // Enable texture mapping
-        glBindTexture(GL_TEXTURE_2D, texVec[30]);  // Bind the texture
+        bindTexture2D(marbleTexture);  // Bind the texture
         glColor3f(1.0f, 1.0f, 1.0f);        // Set color to white (so the texture colors are visible)
     }
     else
@@ -3107,7 +5885,7 @@ void drawFoundation(float width, float depth, float height)
     glPushMatrix();
     glTranslatef(10.0f, -height / 1.5f, 0.0f);      // Position the foundation appropriately
     glScalef(width, height, depth);               // Scale the cube to desired dimensions
-    glutSolidCube(1.0f);                           // Draw a solid cube
+    solidCube(1.0f);                           // Draw a solid cube
     glPopMatrix();
 
     // Disable texture mapping if it was previously enabled
@@ -3130,7 +5908,7 @@ void drawFoundation(float width, float depth, float height)
   * @brief Renders the support structures for the Ferris wheel, including support columns and foundation.
   *
   * This function sets up material properties and textures for the support structures.
-  * It draws the support columns and the foundation with the texture at texVec[30] if texture usage is enabled.
+  * It draws the support columns and the foundation with the marble texture if texture usage is enabled.
   * Transformations are carefully managed to position the supports relative to the Ferris wheel.
   */
 void drawSupports()
@@ -3161,7 +5939,7 @@ void drawSupports()
     if (gUseTexture)
     {
         glEnable(GL_TEXTURE_2D);
-        glBindTexture(GL_TEXTURE_2D, texVec[30]); // Bind the desired texture
+        bindTexture2D(marbleTexture); // Bind the desired texture
         glColor3f(1.0f, 1.0f, 1.0f);              // Set color to white
     }
     else
@@ -3178,7 +5956,7 @@ void drawSupports()
     if (gUseTexture)
     {
         glEnable(GL_TEXTURE_2D);
-        glBindTexture(GL_TEXTURE_2D, texVec[30]); // Bind the desired texture
+        bindTexture2D(marbleTexture); // Bind the desired texture
         glColor3f(1.0f, 1.0f, 1.0f);              // Set color to white
     }
     else
@@ -3277,7 +6055,7 @@ void drawInnerRings(float rimRadius, int numInnerRings)
         if (gUseTexture)
         {
             glEnable(GL_TEXTURE_2D);
-            glBindTexture(GL_TEXTURE_2D, texVec[26]); // Bind metal texture
+            bindTexture2D(metalTexture); // Bind metal texture
             glColor3f(1.0f, 1.0f, 1.0f);              // Set color to white to display texture colors correctly
         }
         else
@@ -3286,7 +6064,7 @@ void drawInnerRings(float rimRadius, int numInnerRings)
         }
 
         // Draw the solid torus representing the inner ring
-        glutSolidTorus(ringThickness, ringRadius, 32, 128);
+        solidTorus(ringThickness, ringRadius, 32, 128);
 
         // Disable texture mapping if it was previously enabled
         if (gUseTexture)
@@ -3325,14 +6103,14 @@ void drawCabin(float swingAngle, float r, float g, float b)
     if (gUseTexture)
     {
         glEnable(GL_TEXTURE_2D);
-        glBindTexture(GL_TEXTURE_2D, texVec[27]); // Bind cabin texture
+        bindTexture2D(cockpitTexture); // Bind cabin texture
         glColor3f(r, g, b); // Set color based on parameters
     }
     else
     {
         glColor3f(r, g, b); // Use specified color if textures are not used
     }
-    glutSolidCube(1.0f); // Draw the cabin as a solid cube
+    solidCube(1.0f); // Draw the cabin as a solid cube
     if (gUseTexture)
     {
         glDisable(GL_TEXTURE_2D);
@@ -3343,7 +6121,7 @@ void drawCabin(float swingAngle, float r, float g, float b)
     glColor3f(0.6f, 0.3f, 0.0f); // Brown color for the roof
     glPushMatrix();
     glTranslatef(0.0f, 0.6f * cabinScale, 0.0f); // Position the roof on top of the cabin
-    glutSolidCone(0.6f * cabinScale, 0.4f * cabinScale, 16, 16); // Draw the roof as a solid cone
+    solidCone(0.6f * cabinScale, 0.4f * cabinScale, 16, 16); // Draw the roof as a solid cone
     glPopMatrix();
 
     // Draw the windows of the cabin
@@ -3353,28 +6131,28 @@ void drawCabin(float swingAngle, float r, float g, float b)
     glPushMatrix();
     glTranslatef(0.0f, 0.0f, (0.51f + 0.1f) * cabinScale); // Position the front window
     glScalef(0.6f * cabinScale, 0.6f * cabinScale, 0.01f); // Scale the window to be flat
-    glutSolidCube(1.0f); // Draw the front window as a solid cube
+    solidCube(1.0f); // Draw the front window as a solid cube
     glPopMatrix();
 
     // Back window
     glPushMatrix();
     glTranslatef(0.0f, 0.0f, (-0.51f - 0.1f) * cabinScale); // Position the back window
     glScalef(0.6f * cabinScale, 0.6f * cabinScale, 0.01f); // Scale the window to be flat
-    glutSolidCube(1.0f); // Draw the back window as a solid cube
+    solidCube(1.0f); // Draw the back window as a solid cube
     glPopMatrix();
 
     // Right window
     glPushMatrix();
     glTranslatef((0.51f + 0.1f) * cabinScale, 0.0f, 0.0f); // Position the right window
     glScalef(0.01f, 0.6f * cabinScale, 0.6f * cabinScale); // Scale the window to be thin
-    glutSolidCube(1.0f); // Draw the right window as a solid cube
+    solidCube(1.0f); // Draw the right window as a solid cube
     glPopMatrix();
 
     // Left window
     glPushMatrix();
     glTranslatef((-0.51f - 0.1f) * cabinScale, 0.0f, 0.0f); // Position the left window
     glScalef(0.01f, 0.6f * cabinScale, 0.6f * cabinScale); // Scale the window to be thin
-    glutSolidCube(1.0f); // Draw the left window as a solid cube
+    solidCube(1.0f); // Draw the left window as a solid cube
     glPopMatrix();
 
     glPopMatrix(); // End of cabin rendering
@@ -3453,7 +6231,7 @@ void drawFrontBlock()
     if (gUseTexture)
     {
         glEnable(GL_TEXTURE_2D);                     // Enable texturing
-        glBindTexture(GL_TEXTURE_2D, texVec[29]);    // Bind texture texVec[29]
+        bindTexture2D(xjtluTexture);    // Bind the XJTLU texture
     }
 
     glBegin(GL_QUADS);
@@ -3513,294 +6291,30 @@ void drawFrontBlock()
     glNormal3f(1.0f, 0.0f, 0.0f); // Normal pointing out of the right face
     glVertex3f(blockWidth / 2, -blockHeight / 2, -blockDepth / 2);
     glVertex3f(blockWidth / 2, blockHeight / 2, -blockDepth / 2);
-    glVertex3f(blockWidth / 2, blockHeight / 2, blockDepth / 2);
-    glVertex3f(blockWidth / 2, -blockHeight / 2, blockDepth / 2);
-
-    // Left face
-    glNormal3f(-1.0f, 0.0f, 0.0f); // Normal pointing out of the left face
-    glVertex3f(-blockWidth / 2, -blockHeight / 2, -blockDepth / 2);
-    glVertex3f(-blockWidth / 2, blockHeight / 2, -blockDepth / 2);
-    glVertex3f(-blockWidth / 2, blockHeight / 2, blockDepth / 2);
-    glVertex3f(-blockWidth / 2, -blockHeight / 2, blockDepth / 2);
-
-    glEnd();
-
-    glPopMatrix();
-}
-// Modified function to draw the Ferris wheel with gradient-colored cabins
-/**
- * @brief Draws the Ferris wheel with gradient-colored cabins and matching support frames.
- *
- * This function renders the Ferris wheel, including the rim, inner rings, spokes, support frames,
- * and cabins. Each cabin and its supporting steel frame have the same gradient color to create
- * a cohesive visual effect. The function also handles the rotation and swing animations of the cabins.
- */
-void drawFerrisWheel()
-{
-
-    // Draw the front block of the scene
-    drawFrontBlock();
-
-    // Control the rotation speed of the Ferris wheel
-    ferrisWheelRotationAngle += 0.2f;
-
-    glPushMatrix();
-    glScalef(1.4, 1.4, 1.4);
-    // Move the Ferris wheel to the specified position
-    glTranslatef(20.0f, 0.0f, 0.0f);
-
-    // Draw the support structures of the Ferris wheel
-    drawSupports();
-
-    // Move the Ferris wheel to the specified position using the global variables
-    glTranslatef(ferrisWheelPosX, ferrisWheelPosY, ferrisWheelPosZ);
-
-    // Begin drawing the Ferris wheel
-    glPushMatrix();
-
-    // Raise the center of the wheel to Y = 13.0f
-    glTranslatef(0.0f, 13.0f, 0.0f);
-
-    // Rotate the wheel around the Z-axis based on the rotation angle
-    glRotatef(ferrisWheelRotationAngle, 0.0f, 0.0f, 1.0f);
-
-    // Enable smooth shading for better visual quality
-    glShadeModel(GL_SMOOTH);
-
-    // Set warm metallic material properties
-    GLfloat matAmbient[] = { 0.4f, 0.2f, 0.1f, 1.0f };
-    GLfloat matDiffuse[] = { 0.7f, 0.4f, 0.2f, 1.0f };
-    GLfloat matSpecular[] = { 0.9f, 0.6f, 0.3f, 1.0f };
-    GLfloat matShininess[] = { 50.0f };
-
-    glMaterialfv(GL_FRONT, GL_AMBIENT, matAmbient);
-    glMaterialfv(GL_FRONT, GL_DIFFUSE, matDiffuse);
-    glMaterialfv(GL_FRONT, GL_SPECULAR, matSpecular);
-    glMaterialfv(GL_FRONT, GL_SHININESS, matShininess);
-
-    float rimRadius = 10.0f;        // Radius of the rim
-    float rimThickness = 0.17f;     // Thickness of the rim
-
-    if (gUseTexture)
-    {
-        glEnable(GL_TEXTURE_2D);               // Enable textures
-        glBindTexture(GL_TEXTURE_2D, texVec[26]);  // Bind the specified texture
-        glColor3f(1.0f, 1.0f, 1.0f);          // Set color to white (keep original texture color)
-        glPushMatrix();
-        // Draw the outer rim using a solid torus
-        float rimRadius = 10.0f;        // Radius of the rim
-        float rimThickness = 0.17f;     // Thickness of the rim
-        glutSolidTorus(rimThickness, rimRadius, 32, 128);
-        glPopMatrix();
-    }
-    else
-    {
-        glColor3f(0.7f, 1.0f, 0.7f);          // Set color to light gray if no texture is used
-        // Draw the outer rim using a solid torus
-        glPushMatrix();
-        glutSolidTorus(rimThickness, rimRadius, 32, 128);
-        glPopMatrix();
-    }
-
-    if (gUseTexture)
-    {
-        glDisable(GL_TEXTURE_2D);  // Disable textures when done
-    }
-
-    // Draw the inner rings using a separate function
-    int numInnerRings = 4; // Number of inner rings
-    drawInnerRings(rimRadius, numInnerRings);
-
-    // Draw the spokes with increased thickness
-    int numSpokes = 24; // Number of spokes
-
-    for (int i = 0; i < numSpokes; ++i)
-    {
-        // Calculate the angle for the current spoke
-        float spokeAngle = i * 360.0f / numSpokes;
-
-        glPushMatrix();
-
-        // Rotate to the current spoke angle around the Z-axis
-        glRotatef(spokeAngle, 0.0f, 0.0f, 1.0f);
-
-        // Create a new quadric object for rendering cylinders
-        GLUquadric* quad = gluNewQuadric();
-        gluQuadricNormals(quad, GLU_SMOOTH);
-        gluQuadricTexture(quad, GL_TRUE);
-
-        float spokeThickness = 0.3f;               // Thickness of the spoke
-        float centralCylinderLength = rimRadius * 0.2f; // Length of the central cylinder
-        gluCylinder(quad, spokeThickness, spokeThickness, centralCylinderLength, 16, 1);
-
-        // Add a cube at the front end of the central cylinder
-        float cubeSize = spokeThickness * 3.5f; // Size of the cube
-
-        glPushMatrix();
-
-        // Move to the end of the central cylinder
-        glTranslatef(0.0f, 0.0f, centralCylinderLength + cubeSize / 2.0f);
-
-        // Enable texture for the cube if required
-        if (gUseTexture)
-        {
-            glEnable(GL_TEXTURE_2D);
-            glBindTexture(GL_TEXTURE_2D, texVec[28]); // Cube texture
-            glColor3f(1.0f, 1.0f, 1.0f);
-        }
-        else
-        {
-            glColor3f(0.8f, 1.0f, 1.0f); // Light gray color
-        }
-
-        // Draw the cube representing the cabin attachment
-        glutSolidCube(cubeSize);
-
-        // Disable texture after drawing the cube
-        if (gUseTexture)
-        {
-            glDisable(GL_TEXTURE_2D);
-        }
-
-        glPopMatrix();
-
-        // Draw support rods for each inner ring
-        for (int r = 1; r <= numInnerRings; ++r)
-        {
-            float ringRadius = rimRadius * (1.0f - r * 0.25f);
-
-            // Draw the cylindrical support rod
-            glPushMatrix();
-            gluCylinder(quad, spokeThickness, spokeThickness, ringRadius, 10, 1);
-            glPopMatrix();
-
-            // Draw a rectangular prism at the end of the support rod
-            float length = ringRadius - 2;          // Length of the prism
-            float width = 2.0f * spokeThickness;    // Width of the prism
-            float height = spokeThickness;          // Height of the prism
-
-            glPushMatrix();
-
-            // Translate to the end of the support rod
-            glTranslatef(0.0f, 0.0f, length);
-
-            // Apply texture if enabled
-            if (gUseTexture)
-            {
-                glEnable(GL_TEXTURE_2D);
-                glBindTexture(GL_TEXTURE_2D, texVec[29]); // Selected texture
-                glColor3f(1.0f, 1.0f, 1.0f); // Set color to white to display texture colors
-            }
-            else
-            {
-                glColor3f(0.8f, 0.8f, 0.8f); // Light gray color
-            }
-
-            // Scale and draw the rectangular prism
-            glScalef(width, height, length); // Set the size of the prism
-            glutSolidCube(1.0f); // Use a cube to draw the prism
-
-            // Disable texture after drawing the prism
-            if (gUseTexture)
-            {
-                glDisable(GL_TEXTURE_2D);
-            }
-
-            glPopMatrix();
-        }
-
-        // Delete the quadric object to free resources
-        gluDeleteQuadric(quad);
-        glPopMatrix();
-    }
-
-    // Draw the cabins with gradient colors
-    int numCabins = numSpokes; // Assume one cabin per spoke
-
-    for (int i = 0; i < numCabins; ++i)
-    {
-        glPushMatrix();
-
-        // Calculate the angle for the current cabin
-        float spokeAngle = i * 360.0f / numCabins;
-        glRotatef(spokeAngle, 0.0f, 0.0f, 1.0f);
-
-        // Translate to the position of the cabin
-        glTranslatef(rimRadius, 0.0f, 0.0f);
-
-        // Calculate color to create a gradient effect
-        float hue = i / static_cast<float>(numCabins); // Hue ranges from 0 to 1
-        float r, g, b;
-        HSVtoRGB(hue, 0.8f, 1.0f, r, g, b);
-
-        // Draw the steel frame from the center to the cabin with matching color
-        glPushMatrix();
-        glTranslatef(-rimRadius, 0.0f, 0.0f); // Move back to the center
-
-        // Set material properties and apply texture for the steel frame
-        if (gUseTexture)
-        {
-            glEnable(GL_TEXTURE_2D);
-            glBindTexture(GL_TEXTURE_2D, texVec[26]); // Metal texture
-            glColor3f(r, g, b); // Set color matching the cabin
-        }
-        else
-        {
-            glColor3f(r, g, b); // Set color matching the cabin
-        }
-
-        // Create a new quadric object for the frame cylinder
-        GLUquadric* quad = gluNewQuadric();
-        gluQuadricNormals(quad, GLU_SMOOTH);
-        gluQuadricTexture(quad, GL_TRUE);
-
-        float frameThickness = 0.15f; // Thickness of the frame
-        float frameLength = rimRadius; // Length of the frame
-
-        // Rotate to align the cylinder along the X-axis
-        glRotatef(90.0f, 0.0f, 1.0f, 0.0f);
-        gluCylinder(quad, frameThickness, frameThickness, frameLength, 16, 1);
-
-        // Delete the quadric object to free resources
-        gluDeleteQuadric(quad);
-
-        // Disable texture after drawing the frame
-        if (gUseTexture)
-        {
-            glDisable(GL_TEXTURE_2D);
-        }
-
-        glPopMatrix(); // Restore to the cabin position
-
-        // Calculate the swing angle based on the rotation speed
-        float swingAngle = sin((ferrisWheelRotationAngle + spokeAngle) * M_PI / 180.0f) * 10.0f;
-
-        // Call the function to draw the cabin, passing color parameters
-        drawCabin(swingAngle, r, g, b);
+    glVertex3f(blockWidth / 2, blockHeight / 2, blockDepth / 2);
+    glVertex3f(blockWidth / 2, -blockHeight / 2, blockDepth / 2);
 
-        glPopMatrix(); // Restore to the center of the wheel
-    }
+    // Left face
+    glNormal3f(-1.0f, 0.0f, 0.0f); // Normal pointing out of the left face
+    glVertex3f(-blockWidth / 2, -blockHeight / 2, -blockDepth / 2);
+    glVertex3f(-blockWidth / 2, blockHeight / 2, -blockDepth / 2);
+    glVertex3f(-blockWidth / 2, blockHeight / 2, blockDepth / 2);
+    glVertex3f(-blockWidth / 2, -blockHeight / 2, blockDepth / 2);
 
-    // Disable textures if they were enabled
-    if (gUseTexture)
-    {
-        glDisable(GL_TEXTURE_2D);
-    }
+    glEnd();
 
-    glPopMatrix(); // Restore the wheel's transformations
-    glPopMatrix(); // Restore the Ferris wheel's transformations
+    glPopMatrix();
 }
-
 void drawCylinder(float baseRadius, float topRadius, float height, float r, float g, float b) {
     GLUquadric* quad = gluNewQuadric();
     glColor3f(r, g, b);
     gluCylinder(quad, baseRadius, topRadius, height, 32, 32);
     gluDeleteQuadric(quad);
 }
-void drawTexturedCylinder(float baseRadius, float topRadius, float height, GLuint textureID) {
-    // Check if the texture ID is valid
-    if (textureID == 0) {
-        std::cerr << "Invalid texture ID!" << std::endl;
+void drawTexturedCylinder(float baseRadius, float topRadius, float height, TextureHandle texture) {
+    // Check if the texture handle is valid
+    if (texture.isNull()) {
+        std::cerr << "Invalid texture handle!" << std::endl;
         return;
     }
 
@@ -3808,7 +6322,7 @@ void drawTexturedCylinder(float baseRadius, float topRadius, float height, GLuin
     if (gUseTexture)
     {
         glEnable(GL_TEXTURE_2D); // Enable 2D texture mapping
-        glBindTexture(GL_TEXTURE_2D, textureID); // Bind the metal texture
+        bindTexture2D(texture); // Bind the metal texture
         glColor3f(1.0f, 1.0f, 1.0f); // Set color to white for proper texture display
 
         // Create a new quadric object and enable texture mapping
@@ -3831,7 +6345,7 @@ void drawTexturedCylinder(float baseRadius, float topRadius, float height, GLuin
     glDisable(GL_TEXTURE_2D); // Disable texture mapping after rendering
 }
 
-void drawTurntable(GLuint textureID) {
+void drawTurntable(TextureHandle texture) {
     GLUquadric* quad = gluNewQuadric();
     gluQuadricTexture(quad, GL_TRUE); // Enable texture mapping
 
@@ -3841,7 +6355,7 @@ void drawTurntable(GLuint textureID) {
 
     if (gUseTexture) {
         glEnable(GL_TEXTURE_2D); // Enable 2D texture mapping
-        glBindTexture(GL_TEXTURE_2D, textureID); // Bind the provided texture ID
+        bindTexture2D(texture); // Bind the provided texture
         glColor3f(1.0f, 1.0f, 1.0f); // Maintain the original color of the texture
     }
     else {
@@ -3871,7 +6385,7 @@ void drawTurntable(GLuint textureID) {
 
         if (gUseTexture) {
             glEnable(GL_TEXTURE_2D); // Enable 2D texture mapping
-            glBindTexture(GL_TEXTURE_2D, textureID); // Bind the provided texture ID
+            bindTexture2D(texture); // Bind the provided texture
             glColor3f(1.0f, 1.0f, 1.0f); // Use the original texture color
         }
         else {
@@ -3879,7 +6393,7 @@ void drawTurntable(GLuint textureID) {
         }
 
         // Render the decorative sphere
-        glutSolidSphere(0.2f, 16, 16);
+        solidSphere(0.2f, 16, 16);
 
         if (gUseTexture) {
             glDisable(GL_TEXTURE_2D); // Disable texture mapping after rendering the sphere
@@ -3924,7 +6438,7 @@ void chair() {
 
     if (gUseTexture) {
         glEnable(GL_TEXTURE_2D); // Enable texture mapping
-        glBindTexture(GL_TEXTURE_2D, texVec[31]); // Bind the chair texture
+        bindTexture2D(fabricTexture); // Bind the chair texture
         glColor3f(1.0f, 1.0f, 1.0f); // Use original colors from the texture
     }
     else {
@@ -3932,7 +6446,7 @@ void chair() {
     }
 
     // Draw the base
-    drawTexturedCube(1.0f, texVec[31]); // Using the chair texture
+    drawTexturedCube(1.0f, fabricTexture); // Using the chair texture
     glPopMatrix();
 
     // Draw the backrest
@@ -3942,7 +6456,7 @@ void chair() {
 
     if (gUseTexture) {
         glEnable(GL_TEXTURE_2D); // Enable texture mapping
-        glBindTexture(GL_TEXTURE_2D, texVec[31]); // Bind the chair texture
+        bindTexture2D(fabricTexture); // Bind the chair texture
         glColor3f(1.0f, 1.0f, 1.0f); // Use original colors from the texture
     }
     else {
@@ -3950,7 +6464,7 @@ void chair() {
     }
 
     // Draw the backrest
-    drawTexturedCube(1.0f, texVec[31]); // Using the chair texture
+    drawTexturedCube(1.0f, fabricTexture); // Using the chair texture
     glPopMatrix();
 
     // Draw the left armrest
@@ -3960,7 +6474,7 @@ void chair() {
 
     if (gUseTexture) {
         glEnable(GL_TEXTURE_2D); // Enable texture mapping
-        glBindTexture(GL_TEXTURE_2D, texVec[31]); // Bind the chair texture
+        bindTexture2D(fabricTexture); // Bind the chair texture
         glColor3f(1.0f, 1.0f, 1.0f); // Use original colors from the texture
     }
     else {
@@ -3968,7 +6482,7 @@ void chair() {
     }
 
     // Draw the left armrest
-    drawTexturedCube(1.0f, texVec[31]);
+    drawTexturedCube(1.0f, fabricTexture);
     glPopMatrix();
 
     // Draw the right armrest
@@ -3977,7 +6491,7 @@ void chair() {
 
     if (gUseTexture) {
         glEnable(GL_TEXTURE_2D); // Enable texture mapping
-        glBindTexture(GL_TEXTURE_2D, texVec[31]); // Bind the chair texture
+        bindTexture2D(fabricTexture); // Bind the chair texture
         glColor3f(1.0f, 1.0f, 1.0f); // Use original colors from the texture
     }
     else {
@@ -3985,7 +6499,7 @@ void chair() {
     }
 
     // Draw the right armrest
-    drawTexturedCube(1.0f, texVec[31]);
+    drawTexturedCube(1.0f, fabricTexture);
     glPopMatrix();
 
     // Add a connector between the backrest and the armrests (optional)
@@ -3995,7 +6509,7 @@ void chair() {
 
     if (gUseTexture) {
         glEnable(GL_TEXTURE_2D); // Enable texture mapping
-        glBindTexture(GL_TEXTURE_2D, texVec[31]); // Bind the chair texture
+        bindTexture2D(fabricTexture); // Bind the chair texture
         glColor3f(1.0f, 1.0f, 1.0f); // Use original colors from the texture
     }
     else {
@@ -4003,7 +6517,7 @@ void chair() {
     }
 
     // Draw the connector
-    drawTexturedCube(1.0f, texVec[31]);
+    drawTexturedCube(1.0f, fabricTexture);
     glPopMatrix();
 
     // Draw the cable
@@ -4017,40 +6531,10 @@ void chair() {
     glPopMatrix();
 }
 
-void flyingChair() {
-    glPushMatrix();
-    static float additionalAngle = 0.0f; // Additional rotation angle
-    static float oscillateAngle = 0.0f;  // Oscillation angle
-    // Translate the rotating flying chair to the specified position in the scene
-    glTranslatef(-35.0f, 8.0f, 0.0f); // Adjust this position based on your scene
-
-    // Draw the fixed central support column
-    glPushMatrix();
-    glTranslatef(0.0f, 20.0f, 0.0f);
-    glRotatef(90.0f, 1.0f, 0.0f, 0.0f); // Rotate to make the column vertical
-    drawTexturedCylinder(0.4f, 1.6f, 28.0f, texVec[32]); // Central column with height of 28.0f
-    glPopMatrix();
-
-    // Draw the decorative top
-    glPushMatrix();
-    glTranslatef(0.0f, 20.0f, 0.0f); // Position at the top of the central axis
-    glColor3f(1.0f, 0.84f, 0.0f); // Gold color
-    glutSolidSphere(1.0f, 32, 32); // Sphere with radius of 1.0f
-    glPopMatrix();
-
-    // Draw the turntable and chairs
-    glPushMatrix();
-    glTranslatef(0.0f, 20.0f, 0.0f); // Elevate to the top of the central column
-
-    // Update the additional rotation angle
-    additionalAngle += ADDITIONAL_ROTATION_SPEED; // Control the speed of additional rotation
-    if (additionalAngle > 360.0f) additionalAngle -= 360.0f;
-
-    // Perform multi-axis rotation around the Y and Z axes
-    glRotatef(additionalAngle, 0.0f, 1.0f, 0.0f); // Rotate around the Y-axis
-    glRotatef(oscillateAngle, 0.0f, 0.0f, 1.0f);  // Oscillate around the Z-axis
-
-    drawTurntable(texVec[33]); // Draw the turntable with texture
+// Advance the flying chair once per simulation tick and track the first seat for riding
+void updateFlyingChair() {
+    chairTurntableAngle += ADDITIONAL_ROTATION_SPEED; // Control the speed of additional rotation
+    if (chairTurntableAngle > 360.0f) chairTurntableAngle -= 360.0f;
 
     // Update the chair radius to create aggregation and dispersion effects
     if (isAggregating) {
@@ -4069,58 +6553,64 @@ void flyingChair() {
     }
 
     // Update the oscillation angle
-    oscillateAngle = 10.0f * sin((alpha + additionalAngle) * M_PI / 180.0f); // Oscillation amplitude varies between -10 and 10 degrees
+    oscillateAngle = 10.0f * sin((alpha + chairTurntableAngle) * M_PI / 180.0f); // Oscillation amplitude varies between -10 and 10 degrees
+
+    // Update the rotation angle of the flying chair
+    flyingChairRotationAngle = alpha + chairTurntableAngle;
+
+    // Position of the first chair in world coordinates; the ride is centred at (-30, 8, 10)
+    float angleRad = flyingChairRotationAngle * M_PI / 180.0f;
+    chairCurrentX = -30.0f + currentChairRadius * cos(angleRad);
+    chairCurrentZ = 10.0f + currentChairRadius * sin(angleRad);
+    chairCurrentY = CHAIR_CABLE_TOP_Y - CHAIR_CABLE_LENGTH + 8.0f;
+}
+
+void flyingChair() {
+    PROFILE_PASS(PROFILE_FLYING_CHAIR);
+    glPushMatrix();
+
+    // Draw the fixed central support column, rotated upright
+    loadNodeMatrix(NODE_CHAIR_COLUMN);
+    drawTexturedCylinder(0.4f, 1.6f, 28.0f, columnTexture); // Central column with height of 28.0f
+
+    // Draw the decorative top
+    loadNodeMatrix(NODE_CHAIR_TOP);
+    glColor3f(1.0f, 0.84f, 0.0f); // Gold color
+    solidSphere(1.0f, 32, 32); // Sphere with radius of 1.0f
+
+    // The turntable sits on top of the column and rotates around the Y axis while oscillating around Z
+    setNodeLocal(NODE_CHAIR_TURNTABLE, multiplyMatrices(multiplyMatrices(translationMatrix(0.0f, 20.0f, 0.0f),
+        rotationMatrix(chairTurntableAngle, 0.0f, 1.0f, 0.0f)), rotationMatrix(oscillateAngle, 0.0f, 0.0f, 1.0f)));
+    loadNodeMatrix(NODE_CHAIR_TURNTABLE);
+    drawTurntable(diskTexture); // Draw the turntable with texture
 
     // Parameters for the chairs and cables
-    int numChairs = 8;               // Number of chairs
-    float cableLength = 12.0f;       // Cable length
+    int numChairs = FLYING_CHAIR_SEATS;  // Number of chairs
     float turntableRadius = 7.0f;    // Turntable radius
 
     // Draw each chair and cable
     for (int i = 0; i < numChairs; ++i) {
         float baseAngle = i * (360.0f / numChairs);
-        float totalAngle = baseAngle + alpha + additionalAngle; // Combined rotation angle
+        float totalAngle = baseAngle + alpha + chairTurntableAngle; // Combined rotation angle
         float angleRad = totalAngle * M_PI / 180.0f;
 
         // Cable starting point (edge of the turntable)
         float cableStartX = (turntableRadius - 0.5f) * cos(angleRad);  // Adjust the cable connection to the inner side of the turntable
         float cableStartZ = (turntableRadius - 0.5f) * sin(angleRad);
-        float cableStartY = 15.0f; // Height of the turntable
+        float cableStartY = CHAIR_CABLE_TOP_Y; // Height of the turntable
 
         // Chair position (at the end of the cable)
         float chairX = currentChairRadius * cos(angleRad); // Calculate chair position based on the current radius
         float chairZ = currentChairRadius * sin(angleRad);
-        float chairY = cableStartY - cableLength; // Height after cable stretch
-
-        // Draw the chair
-        glPushMatrix();
-        glTranslatef(chairX, chairY, chairZ);
-
-        // Apply the oscillation angle to slightly sway the chair
-        glRotatef(-totalAngle + tiltAngle * 0.5f, 0.0f, 1.0f, 0.0f); // Rotate the chair to face outward and slightly tilt it
-        glRotatef(oscillateAngle, 0.0f, 0.0f, 1.0f); // Slight oscillation around the Z-axis
+        float chairY = cableStartY - CHAIR_CABLE_LENGTH; // Height after cable stretch
 
+        // Draw the chair facing outward, slightly tilted and swaying with the oscillation angle
+        setNodeLocal(NODE_CHAIR_SEAT + i, multiplyMatrices(multiplyMatrices(translationMatrix(chairX, chairY, chairZ),
+            rotationMatrix(-totalAngle + tiltAngle * 0.5f, 0.0f, 1.0f, 0.0f)), rotationMatrix(oscillateAngle, 0.0f, 0.0f, 1.0f)));
+        loadNodeMatrix(NODE_CHAIR_SEAT + i);
         chair(); // Draw the chair
-        glPopMatrix();
-
-        // Track the position of the first chair
-        if (i == 0) {
-            chairCurrentX = chairX;
-            chairCurrentZ = chairZ;
-            // Since the flying chair's center has already been translated via glTranslatef(-30.0f, 8.0f, 10.0f),
-            // we need to convert chairCurrentX and chairCurrentZ to the global coordinate system
-            chairCurrentX += -30.0f;
-            chairCurrentZ += 10.0f;
-            // chairCurrentY remains unchanged since the chair's Y coordinate is fixed
-            chairCurrentY = chairY + 8.0f; // Adjust based on actual height
-        }
     }
 
-    // Update the rotation angle of the flying chair
-    flyingChairRotationAngle = alpha + additionalAngle;
-
-    glPopMatrix(); // End the drawing of the turntable and chairs
-
     glPopMatrix(); // End the entire flying chair drawing
 }
 
@@ -4152,13 +6642,13 @@ void drawBody()
     {
         glEnable(GL_TEXTURE_2D);
         // Select textures based on texture state
-        unsigned int frontTexture = isAlternateTexture ? texVec[20] : texVec[14]; // Front panel texture
-        unsigned int backTexture = isAlternateTexture ? texVec[21] : texVec[13];  // Back panel texture
-        unsigned int sideTexture = isAlternateTexture ? texVec[23] : texVec[15];  // Side panel texture (added logic)
+        TextureHandle frontTexture = isAlternateTexture ? yaomingBackTexture : jamesTexture; // Front panel texture
+        TextureHandle backTexture = isAlternateTexture ? yaomingFrontTexture : jerseyTexture;  // Back panel texture
+        TextureHandle sideTexture = isAlternateTexture ? yaomingSideTexture : sideClothTexture;  // Side panel texture (added logic)
 
         // Draw the body using textures
         // Front panel
-        glBindTexture(GL_TEXTURE_2D, frontTexture);
+        bindTexture2D(frontTexture);
         glBegin(GL_QUADS);
         glNormal3f(0, 0, 1);
         glTexCoord2d(0.0, 0.0); glVertex3f(-bodyWidth / 2.0f, 0.0f, bodyDepth / 2.0f);
@@ -4168,7 +6658,7 @@ void drawBody()
         glEnd();
 
         // Back panel
-        glBindTexture(GL_TEXTURE_2D, backTexture);
+        bindTexture2D(backTexture);
         glBegin(GL_QUADS);
         glNormal3f(0, 0, -1);
         glTexCoord2d(0.0, 0.0); glVertex3f(bodyWidth / 2.0f, 0.0f, -bodyDepth / 2.0f);
@@ -4178,7 +6668,7 @@ void drawBody()
         glEnd();
 
         // Left side panel
-        glBindTexture(GL_TEXTURE_2D, sideTexture); // Body side texture
+        bindTexture2D(sideTexture); // Body side texture
         glBegin(GL_QUADS);
         glNormal3f(-1, 0, 0);
         glTexCoord2d(0.0, 0.0); glVertex3f(-bodyWidth / 2.0f, 0.0f, -bodyDepth / 2.0f);
@@ -4212,7 +6702,7 @@ void drawBody()
         glColor3f(0.8f, 0.5f, 0.3f); // Body color
         glTranslatef(0.0f, bodyHeight / 2.0f, 0.0f); // Move the body center up
         glScalef(bodyWidth, bodyHeight, bodyDepth);
-        glutSolidCube(1.0f);
+        solidCube(1.0f);
     }
     glPopMatrix();
 }
@@ -4231,7 +6721,7 @@ void drawHead()
     if (gUseTexture)
     {
         glEnable(GL_TEXTURE_2D);
-        glBindTexture(GL_TEXTURE_2D, texVec[12]);
+        bindTexture2D(headTexture);
         GLUquadric* quad = gluNewQuadric();
         gluQuadricTexture(quad, GL_TRUE);
         gluQuadricNormals(quad, GLU_SMOOTH);
@@ -4242,7 +6732,7 @@ void drawHead()
     else
     {
         glColor3f(1.0f, 0.8f, 0.6f); // Skin color
-        glutSolidSphere(headRadius, 32, 32);
+        solidSphere(headRadius, 32, 32);
     }
     glPopMatrix();
 }
@@ -4266,12 +6756,12 @@ void drawNeck()
     {
         // Ensure texture is bound
         glEnable(GL_TEXTURE_2D); // Enable texture functionality
-        glBindTexture(GL_TEXTURE_2D, texVec[12]);
+        bindTexture2D(headTexture);
     }
 
     // Set the scaling and shape of the neck
     glScalef(neckWidth, neckHeight, neckWidth);
-    glutSolidCube(1.0f);
+    solidCube(1.0f);
 
     if (gUseTexture)
     {
@@ -4295,7 +6785,7 @@ void drawLeg(bool isLeft)
     if (gUseTexture)
     {
         glEnable(GL_TEXTURE_2D);
-        glBindTexture(GL_TEXTURE_2D, texVec[18]);
+        bindTexture2D(legTexture);
         glColor3f(1.0f, 1.0f, 1.0f);
     }
     else
@@ -4306,7 +6796,7 @@ void drawLeg(bool isLeft)
     glPushMatrix();
     glTranslatef(0.0f, -legHeight / 4.0f, 0.0f);
     glScalef(0.5f, legHeight / 2.0f, 0.5f); // Thicken thigh
-    glutSolidCube(1.0f);
+    solidCube(1.0f);
     glPopMatrix();
 
     // Move to knee
@@ -4318,7 +6808,7 @@ void drawLeg(bool isLeft)
     glPushMatrix();
     glTranslatef(0.0f, -legHeight / 4.0f, 0.0f);
     glScalef(0.45f, legHeight / 2.0f, 0.45f); // Thicken calf
-    glutSolidCube(1.0f);
+    solidCube(1.0f);
     glPopMatrix();
 
     // Move to ankle
@@ -4330,7 +6820,7 @@ void drawLeg(bool isLeft)
     glColor3f(0.3f, 0.3f, 0.3f); // Shoe color
     glTranslatef(0.0f, -0.1f, 0.15f);
     glScalef(0.6f, 0.2f, 0.9f);
-    glutSolidCube(1.0f); // Simple cube represents the foot
+    solidCube(1.0f); // Simple cube represents the foot
     glPopMatrix();
 
     if (gUseTexture)
@@ -4360,7 +6850,7 @@ void drawArm(bool isLeft)
     if (gUseTexture)
     {
         glEnable(GL_TEXTURE_2D);
-        glBindTexture(GL_TEXTURE_2D, texVec[17]);
+        bindTexture2D(armTexture);
         glColor3f(1.0f, 1.0f, 1.0f);
     }
     else
@@ -4371,7 +6861,7 @@ void drawArm(bool isLeft)
     glPushMatrix();
     glTranslatef(0.0f, -armLength / 4.0f, 0.0f);
     glScalef(0.4f, armLength / 2.0f, 0.4f); // Thicken upper arm
-    glutSolidCube(1.0f);
+    solidCube(1.0f);
     glPopMatrix();
 
     // Move to elbow
@@ -4383,7 +6873,7 @@ void drawArm(bool isLeft)
     glPushMatrix();
     glTranslatef(0.0f, -armLength / 4.0f, 0.0f);
     glScalef(0.35f, armLength / 2.0f, 0.35f); // Thicken forearm
-    glutSolidCube(1.0f);
+    solidCube(1.0f);
     glPopMatrix();
 
     // Add wrist and hand
@@ -4393,7 +6883,7 @@ void drawArm(bool isLeft)
     glPushMatrix();
     glColor3f(1.0f, 0.8f, 0.6f); // Skin color
     glTranslatef(0.0f, -0.1f, 0.0f);
-    glutSolidSphere(0.2f, 16, 16); // Simple sphere represents the hand
+    solidSphere(0.2f, 16, 16); // Simple sphere represents the hand
     glPopMatrix();
 
     if (gUseTexture)
@@ -4414,6 +6904,9 @@ void drawMan()
         glScalef(0.5f, 0.5f, 0.5f);
         glRotatef(manRotationAngle, 0, 1, 0);
 
+        // All body part textures live in one atlas, bound once
+        beginAtlasDraw(characterAtlas);
+
         // Draw legs
         drawLeg(true);  // Left leg
         drawLeg(false); // Right leg
@@ -4430,6 +6923,8 @@ void drawMan()
 
         // Draw head
         drawHead();
+
+        endAtlasDraw();
     }
     glPopMatrix();
     glEnable(GL_TEXTURE_2D);
@@ -4529,639 +7024,466 @@ void updateLimbSwing()
     }
 }
 
-// Structure to represent the properties of a tower light
-struct TowerLight {
-    float x, y, z;      // Position of the light in 3D space (x, y, z coordinates)
-    float r, g, b;      // Color of the light (red, green, blue components)
-    bool isOn;          // State of the light (true if the light is on, false if off)
-};
-
-// Vector to store the collection of tower lights
-std::vector<TowerLight> towerLights;
-
-// Function to initialize the decorative tower lights
-void initTowerLights() {
-    // Add decorative lights around the tower at different heights
-    for (int height = 0; height < TOWER_HEIGHT; height += 8) {
-        // Loop through four cardinal directions (0, 90, 180, and 270 degrees)
-        for (int i = 0; i < 4; i++) {
-            // Calculate the angle for each direction
-            float angle = i * 90.0f * M_PI / 180.0f;
-            // Set the radius at which the lights will be placed around the tower
-            float radius = POLE_SPACING * 1.2f; // Increase the radius to spread out the lights
-
-            // Create multi-colored lights based on height
-            float hue = height / TOWER_HEIGHT; // Color hue changes with height
-            float r, g, b;
-            // Convert HSV to RGB color model
-            HSVtoRGB(hue, 1.0f, 1.0f, r, g, b);
-
-            // Define a new light object with position and color
-            TowerLight light = {
-                radius * cos(angle),  // x coordinate of the light
-                (float)height,        // y coordinate (height of the light)
-                radius * sin(angle),  // z coordinate of the light
-                r, g, b,              // RGB color values for the light
-                true                  // The light is turned on initially
-            };
-
-            // Add the newly created light to the towerLights vector
-            towerLights.push_back(light);
-        }
-    }
-}
-
-// Structure to define the properties of a particle in the tower's particle system
-struct TowerParticle {
-    float x, y, z;        // Position of the particle in 3D space
-    float vx, vy, vz;     // Velocity components of the particle along the x, y, and z axes
-    float life;           // Lifetime of the particle, representing how long it will exist before disappearing
-    float r, g, b, a;     // Color and transparency of the particle (RGBA format)
-    float size;           // Size of the particle, which can affect its visual appearance
-};
-
-// Container to store all particles in the tower's particle system
-std::vector<TowerParticle> towerParticles;
-
-// Function to update the dynamic lighting effects on the tower
-void updateTowerLights(float deltaTime) {
-    static float time = 0.0f;  // Static variable to keep track of time between updates
-    time += deltaTime;  // Accumulate time to create continuous animation
-
-    // Iterate over each light in the towerLights vector
-    for (size_t i = 0; i < towerLights.size(); i++) {
-        // Create a wave-like flicker effect for the lights based on the time and index
-        float phase = time * 3.0f + i * 0.2f;  // Calculate the phase of the sine wave for flickering
-        float brightness = 0.5f + 0.5f * sin(phase);  // Set brightness based on sine wave
-
-        // Modify the light color based on its height along the tower
-        float heightRatio = towerLights[i].y / TOWER_HEIGHT;  // Calculate the height ratio relative to the tower height
-        if (isDropping && fabs(heightRatio - dropHeight / TOWER_HEIGHT) < 0.1f) {
-            // Lights near the seat (during a drop event) turn red and flicker
-            towerLights[i].r = 1.0f;  // Set red component to maximum
-            towerLights[i].g = 0.0f;  // Set green component to zero
-            towerLights[i].b = 0.0f;  // Set blue component to zero
-            towerLights[i].isOn = (sin(time * 10.0f) > 0.0f);  // Flicker effect based on time
-        }
-        else {
-            // Restore the original color based on the height ratio
-            float hue = heightRatio;  // Use the height ratio to vary the color hue
-            HSVtoRGB(hue, 1.0f, brightness, towerLights[i].r, towerLights[i].g, towerLights[i].b);  // Convert from HSV to RGB
-            towerLights[i].isOn = true;  // Ensure the light is on
-        }
-    }
-}
-
-// Function to update the tower particle system
-void updateTowerParticles(float deltaTime) {
-    // Generate particles when the seat is rapidly dropping
-    if (isDropping && dropSpeed > 20.0f) {
-        // Add new particles around the seat during the drop
-        for (int i = 0; i < 30; i++) {
-            TowerParticle particle;
-
-            // Set the initial position of the particle (random position around the seat)
-            float angle = (rand() % 360) * M_PI / 180.0f;  // Random angle
-            float radius = (rand() % 100) / 100.0f * POLE_SPACING;  // Random radius within a certain range
-            particle.x = TOWER_POSITION_X + radius * cos(angle);  // X position of the particle
-            particle.y = dropHeight;  // Y position of the particle (at the height of the drop)
-            particle.z = TOWER_POSITION_Z + radius * sin(angle);  // Z position of the particle
-
-            // Set the initial velocity of the particle
-            particle.vx = (rand() % 200 - 100) / 100.0f * 2.0f;  // Random X velocity
-            particle.vy = (rand() % 100) / 100.0f * 5.0f;  // Random Y velocity
-            particle.vz = (rand() % 200 - 100) / 100.0f * 2.0f;  // Random Z velocity
-
-            // Set the particle's lifetime and appearance
-            particle.life = 1.0f + (rand() % 100) / 100.0f;  // Random lifetime between 1 and 2 seconds
-            particle.r = 1.0f;  // Red component of the color
-            particle.g = 0.5f + (rand() % 50) / 100.0f;  // Green component of the color, with slight random variation
-            particle.b = 0.0f;  // Blue component of the color
-            particle.a = 1.0f;  // Full opacity
-            particle.size = 0.2f + (rand() % 30) / 100.0f;  // Random particle size between 0.2 and 0.5
-
-            // Add the new particle to the list of tower particles
-            towerParticles.push_back(particle);
-        }
-    }
-
-    // Update existing particles
-    for (auto it = towerParticles.begin(); it != towerParticles.end();) {
-        // Update the position based on velocity
-        it->x += it->vx * deltaTime;  // Update X position
-        it->y += it->vy * deltaTime;  // Update Y position
-        it->z += it->vz * deltaTime;  // Update Z position
-
-        // Apply gravity effect on the particle
-        it->vy -= 9.8f * deltaTime;  // Gravity affects the Y velocity
-
-        // Update the particle's life and adjust transparency
-        it->life -= deltaTime;  // Decrease the particle's life over time
-        it->a = it->life;  // Transparency decreases as the particle's life diminishes
-
-        // Remove dead particles from the system
-        if (it->life <= 0) {
-            it = towerParticles.erase(it);  // Remove the particle and move to the next
-        }
-        else {
-            ++it;  // Proceed to the next particle if the current one is still alive
-        }
-    }
-}
-
-/**
- * Renders particle effects for the tower attraction.
- * This function handles the visualization of particles with:
- * - Billboard technique (particles always face camera)
- * - Alpha blending for transparency
- * - Depth testing disabled for proper blending
- */
-void drawTowerParticles() {
-    glPushMatrix();
-
-    // Disable lighting for particle effects
-    glDisable(GL_LIGHTING);
-
-    // Enable alpha blending for transparency
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE);  // Additive blending for glow effect
-
-    // Disable depth testing to prevent particle sorting issues
-    glDisable(GL_DEPTH_TEST);
-
-    // Render each particle in the system
-    for (const auto& particle : towerParticles) {
-        glPushMatrix();
-        glTranslatef(particle.x, particle.y, particle.z);
-
-        // Implement billboard technique - make particles face camera
-        glRotatef(-cameraAngleY, 0.0f, 1.0f, 0.0f);  // Horizontal rotation
-        glRotatef(-cameraAngleX, 1.0f, 0.0f, 0.0f);  // Vertical rotation
-
-        // Set particle color and alpha
-        glColor4f(particle.r, particle.g, particle.b, particle.a);
-
-        // Draw particle as a textured quad
-        glBegin(GL_QUADS);
-        float size = particle.size / 2.0f;
-        glVertex3f(-size, -size, 0.0f);  // Bottom-left
-        glVertex3f(size, -size, 0.0f);   // Bottom-right
-        glVertex3f(size, size, 0.0f);    // Top-right
-        glVertex3f(-size, size, 0.0f);   // Top-left
-        glEnd();
-
-        glPopMatrix();
-    }
-
-    // Restore OpenGL states
-    glEnable(GL_DEPTH_TEST);
-    glDisable(GL_BLEND);
-    glEnable(GL_LIGHTING);
-    glPopMatrix();
-}
-
-/**
- * Renders the first drop tower with detailed components and effects.
- * This function includes the base, main pillar, support pillars, seating structure,
- * decorative lights, and particle effects.
- */
-void drawFirstDropTower() {
-    glPushMatrix();
-
-    // Save current material state
-    GLfloat currentAmbient[4], currentDiffuse[4], currentSpecular[4];
-    GLfloat currentShininess;
-    glGetMaterialfv(GL_FRONT, GL_AMBIENT, currentAmbient);
-    glGetMaterialfv(GL_FRONT, GL_DIFFUSE, currentDiffuse);
-    glGetMaterialfv(GL_FRONT, GL_SPECULAR, currentSpecular);
-    glGetMaterialfv(GL_FRONT, GL_SHININESS, &currentShininess);
-
-    glTranslatef(TOWER_POSITION_X, 0.4f, TOWER_POSITION_Z);
-
-    // 1. Draw the base - using deep blue metallic texture
-    glPushMatrix();
-    if (gUseTexture) {
-        glEnable(GL_TEXTURE_2D);
-        glBindTexture(GL_TEXTURE_2D, texVec[34]);
-    }
-    glColor3f(0.2f, 0.3f, 0.4f); // Deep blue tone
-    glScalef(BASE_SIZE, 2.0f, BASE_SIZE);
-    glutSolidCube(1.0f);
-
-    // Add decorative edges to the base
-    glColor3f(0.4f, 0.6f, 0.8f); // Bright blue decoration
-    glTranslatef(0.0f, 0.5f, 0.0f);
-    glScalef(1.05f, 0.1f, 1.05f);
-    glutSolidCube(1.0f);
-    glPopMatrix();
-
-    // Main central pillar - using gradient colors
-    glPushMatrix();
-    glTranslatef(0.0f, TOWER_HEIGHT / 2, 0.0f);
-
-    // Gradient effect - draw all faces
-    glBegin(GL_QUADS);
-    for (float h = 0; h < TOWER_HEIGHT; h += 2.0f) {
-        float ratio = h / TOWER_HEIGHT;
-        // Use a richer gradient color
-        glColor3f(0.3f + ratio * 0.3f,
-            0.2f + ratio * 0.4f,
-            0.4f + ratio * 0.4f);
-
-        float y = h - TOWER_HEIGHT / 2;
-        float size = POLE_RADIUS * 2;
-
-        // Front face
-        glVertex3f(-size, y, size);
-        glVertex3f(size, y, size);
-        glVertex3f(size, y + 2.0f, size);
-        glVertex3f(-size, y + 2.0f, size);
-
-        // Back face
-        glVertex3f(-size, y, -size);
-        glVertex3f(size, y, -size);
-        glVertex3f(size, y + 2.0f, -size);
-        glVertex3f(-size, y + 2.0f, -size);
-
-        // Left face
-        glVertex3f(-size, y, -size);
-        glVertex3f(-size, y, size);
-        glVertex3f(-size, y + 2.0f, size);
-        glVertex3f(-size, y + 2.0f, -size);
+//=============================================================================
+// ATTRACTION ENTITIES
+//=============================================================================
 
-        // Right face
-        glVertex3f(size, y, -size);
-        glVertex3f(size, y, size);
-        glVertex3f(size, y + 2.0f, size);
-        glVertex3f(size, y + 2.0f, -size);
-    }
-    glEnd();
-    glPopMatrix();
+/**
+ * Entity/component layer for the drop towers and Ferris wheels. An entity is an index with a
+ * mask of the components it has. Each component type (Transform, RideAnimator, WheelAnimator,
+ * LightRig, Emitter, Renderable) is stored densely, in entity order, with a map from entity to
+ * item, so a system walks only the entities that have its component. Attractions are spawned
+ * from ATTRACTION_SPAWNS (and --extra-towers), so another instance is one more table row rather
+ * than a copy of the drawing, light and particle code. Particles from every emitter share one
+ * world-space pool; every wheel has its own supports and hub scene nodes.
+ */
 
-    // Surrounding support pillars - using metallic color
-    for (int i = 0; i < 4; i++) {
-        glPushMatrix();
-        float angle = i * 90.0f;
-        float radius = POLE_SPACING;
-        float x = radius * cos(angle * M_PI / 180.0f);
-        float z = radius * sin(angle * M_PI / 180.0f);
+enum AttractionComponent {
+    COMPONENT_TRANSFORM = 1 << 0,
+    COMPONENT_RIDE_ANIMATOR = 1 << 1,
+    COMPONENT_LIGHT_RIG = 1 << 2,
+    COMPONENT_EMITTER = 1 << 3,
+    COMPONENT_RENDERABLE = 1 << 4,
+    COMPONENT_WHEEL_ANIMATOR = 1 << 5
+};
 
-        glTranslatef(x, TOWER_HEIGHT / 2, z);
+enum RenderKind {
+    RENDER_DROP_TOWER,
+    RENDER_FERRIS_WHEEL
+};
 
-        // Gradient metallic color - all faces
-        glBegin(GL_QUADS);
-        for (float h = 0; h < TOWER_HEIGHT; h += 2.0f) {
-            float ratio = h / TOWER_HEIGHT;
-            // Use a cooler metallic gradient color
-            glColor3f(0.6f + ratio * 0.2f,
-                0.6f + ratio * 0.2f,
-                0.7f + ratio * 0.2f);
+struct Transform {
+    float x, y, z;          // Base position in world space
+};
 
-            float y = h - TOWER_HEIGHT / 2;
-            float size = POLE_RADIUS;
+// Drop cycle: wait at the top, free fall, bounce, then climb back
+struct RideAnimator {
+    float height = TOWER_HEIGHT;    // Seat height above the base
+    float speed = 0.0f;
+    bool dropping = false;
+    bool recovering = false;
+    float waitTimer = 0.0f;         // Time spent at the top
+    float bounceHeight = 0.0f;      // Nonzero while bouncing at the bottom
+};
 
-            // Front face
-            glVertex3f(-size, y, size);
-            glVertex3f(size, y, size);
-            glVertex3f(size, y + 2.0f, size);
-            glVertex3f(-size, y + 2.0f, size);
+// Ferris wheel rotation, advanced once per simulation tick, and the scene nodes it turns
+struct WheelAnimator {
+    float angle = 0.0f;             // Degrees around the hub
+    float degreesPerTick = 0.2f;
+    int supportsNode = -1;          // Scaled and placed at the entity's transform
+    int hubNode = -1;               // Child of supportsNode, turning
+};
 
-            // Back face
-            glVertex3f(-size, y, -size);
-            glVertex3f(size, y, -size);
-            glVertex3f(size, y + 2.0f, -size);
-            glVertex3f(-size, y + 2.0f, -size);
+// Structure to represent the properties of a tower light
+struct TowerLight {
+    float x, y, z;      // Position of the light relative to the tower base
+    float r, g, b;      // Color of the light (red, green, blue components)
+    bool isOn;          // State of the light (true if the light is on, false if off)
+};
 
-            // Left face
-            glVertex3f(-size, y, -size);
-            glVertex3f(-size, y, size);
-            glVertex3f(-size, y + 2.0f, size);
-            glVertex3f(-size, y + 2.0f, -size);
+// Range of decorative lights in AttractionRegistry::lights
+struct LightRig {
+    uint32_t first = 0, count = 0;
+    float time = 0.0f;              // Animation clock for the colour wave
+};
 
-            // Right face
-            glVertex3f(size, y, -size);
-            glVertex3f(size, y, size);
-            glVertex3f(size, y + 2.0f, size);
-            glVertex3f(size, y + 2.0f, -size);
+// Sparks thrown off the seat during a fast drop
+struct Emitter {
+    int burst = 30;                 // Particles per update while active
+    float minimumSpeed = 20.0f;     // Drop speed that starts the sparks
+    float radius = POLE_SPACING;    // Spawn radius around the tower axis
+};
+
+struct Renderable {
+    RenderKind kind = RENDER_DROP_TOWER;
+};
+
+// One component type for the entities that have it, in entity order
+template <typename T>
+struct ComponentArray {
+    std::vector<T> items;            // Dense; systems walk these front to back
+    std::vector<uint32_t> owners;    // Entity of each item
+    std::vector<int32_t> slots;      // Item of each entity, -1 without the component
+
+    T& add(uint32_t entity) {
+        if (slots.size() <= entity) slots.resize(entity + 1, -1);
+        slots[entity] = (int32_t)items.size();
+        owners.push_back(entity);
+        items.push_back(T());
+        return items.back();
+    }
+
+    T* find(uint32_t entity) {
+        return entity < slots.size() && slots[entity] >= 0 ? &items[slots[entity]] : nullptr;
+    }
+
+    // Rebuild owners and slots for items loaded in entity order
+    void index(const std::vector<uint32_t>& masks, uint32_t component) {
+        owners.clear();
+        slots.assign(masks.size(), -1);
+        for (uint32_t entity = 0; entity < masks.size(); entity++) {
+            if (!(masks[entity] & component)) continue;
+            slots[entity] = (int32_t)owners.size();
+            owners.push_back(entity);
         }
-        glEnd();
-        glPopMatrix();
     }
+};
 
-    // Seat support structure - using modern color scheme
-    glPushMatrix();
-    glTranslatef(0.0f, dropHeight, 0.0f);
+struct AttractionRegistry {
+    std::vector<uint32_t> components;       // Component mask of each entity
+    ComponentArray<Transform> transforms;
+    ComponentArray<RideAnimator> animators;
+    ComponentArray<WheelAnimator> wheels;
+    ComponentArray<LightRig> lightRigs;
+    ComponentArray<Emitter> emitters;
+    ComponentArray<Renderable> renderables;
+    std::vector<TowerLight> lights;
+};
 
-    // Main crossbeam
-    glColor3f(0.3f, 0.5f, 0.7f); // Deep blue tone
-    glPushMatrix();
-    glScalef(POLE_SPACING * 2, POLE_RADIUS * 2, POLE_RADIUS * 2);
-    glutSolidCube(1.0f);
-    glPopMatrix();
+AttractionRegistry attractions;
 
-    // Seating levels
-    for (int level = 0; level < 2; level++) {
-        float currentHeight = level * levelSpacing;
-        glPushMatrix();
-        glTranslatef(0.0f, currentHeight, 0.0f);
+// Structure to define the properties of a particle in the tower's particle system
+struct TowerParticle {
+    float x, y, z;        // Position of the particle in 3D space
+    float vx, vy, vz;     // Velocity components of the particle along the x, y, and z axes
+    float life;           // Lifetime of the particle, representing how long it will exist before disappearing
+    float r, g, b, a;     // Color and transparency of the particle (RGBA format)
+    float size;           // Size of the particle, which can affect its visual appearance
+};
 
-        // Seat support crossbeam
-        glColor3f(0.4f, 0.6f, 0.8f); // Bright blue
-        glPushMatrix();
-        glScalef(POLE_SPACING * 2, POLE_RADIUS, POLE_RADIUS);
-        glutSolidCube(1.0f);
-        glPopMatrix();
+// Particles from every emitter, in world space
+TaggedVector<TowerParticle, MEMORY_TOWER_PARTICLES> towerParticles;
 
-        // Seats
-        float seatRadius = POLE_SPACING - 1.0f;
-        int seatsPerLevel = 8;
-        for (int i = 0; i < seatsPerLevel; i++) {
-            float angle = i * 360.0f / seatsPerLevel;
-            glPushMatrix();
-            glRotatef(angle, 0.0f, 1.0f, 0.0f);
-            glTranslatef(seatRadius, 0.0f, 0.0f);
+struct AttractionSpawn {
+    RenderKind kind;
+    float x, y, z;
+};
 
-            // Seat support arm - using gradient color
-            glPushMatrix();
-            glRotatef(90.0f, 0.0f, 1.0f, 0.0f);
+const AttractionSpawn ATTRACTION_SPAWNS[] = {
+    { RENDER_DROP_TOWER,  TOWER_POSITION_X, 0.4f, TOWER_POSITION_Z },
+    { RENDER_DROP_TOWER, -TOWER_POSITION_X, 0.0f, TOWER_POSITION_Z },
+    { RENDER_FERRIS_WHEEL, 20.0f * FERRIS_WHEEL_SCALE, 0.0f, 0.0f }
+};
 
-            // Gradient from dark to light
-            glBegin(GL_QUADS);
-            float armLength = seatRadius;
-            float armWidth = 0.3f;
-            float armHeight = 0.3f;
-            float gradientSteps = 10.0f;
+int extraDropTowers = 0;                  // --extra-towers, for stress tests
+const float EXTRA_TOWER_RING_RADIUS = 110.0f;
+
+// Add an entity with default values for each component in the mask
+uint32_t createEntity(uint32_t components) {
+    uint32_t entity = (uint32_t)attractions.components.size();
+    attractions.components.push_back(components);
+    if (components & COMPONENT_TRANSFORM) attractions.transforms.add(entity);
+    if (components & COMPONENT_RIDE_ANIMATOR) attractions.animators.add(entity);
+    if (components & COMPONENT_WHEEL_ANIMATOR) attractions.wheels.add(entity);
+    if (components & COMPONENT_LIGHT_RIG) attractions.lightRigs.add(entity);
+    if (components & COMPONENT_EMITTER) attractions.emitters.add(entity);
+    if (components & COMPONENT_RENDERABLE) attractions.renderables.add(entity);
+    return entity;
+}
 
-            for (float g = 0; g < gradientSteps; g++) {
-                float ratio = g / gradientSteps;
-                float x = ratio * armLength;
+uint32_t spawnDropTower(float x, float y, float z) {
+    uint32_t entity = createEntity(COMPONENT_TRANSFORM | COMPONENT_RIDE_ANIMATOR | COMPONENT_LIGHT_RIG |
+        COMPONENT_EMITTER | COMPONENT_RENDERABLE);
+    Transform& transform = *attractions.transforms.find(entity);
+    transform.x = x;
+    transform.y = y;
+    transform.z = z;
+
+    // Decorative lights around the tower, coloured by height
+    LightRig& rig = *attractions.lightRigs.find(entity);
+    rig.first = (uint32_t)attractions.lights.size();
+    for (int height = 0; height < TOWER_HEIGHT; height += 8) {
+        // Loop through four cardinal directions (0, 90, 180, and 270 degrees)
+        for (int i = 0; i < 4; i++) {
+            float angle = i * 90.0f * M_PI / 180.0f;
+            float radius = POLE_SPACING * 1.2f; // Increase the radius to spread out the lights
 
-                glColor3f(0.3f + ratio * 0.3f,
-                    0.5f + ratio * 0.3f,
-                    0.7f + ratio * 0.2f);
+            float hue = height / TOWER_HEIGHT; // Color hue changes with height
+            float r, g, b;
+            HSVtoRGB(hue, 1.0f, 1.0f, r, g, b);
 
-                // Top face
-                glVertex3f(x, armHeight / 2, -armWidth / 2);
-                glVertex3f(x + armLength / gradientSteps, armHeight / 2, -armWidth / 2);
-                glVertex3f(x + armLength / gradientSteps, armHeight / 2, armWidth / 2);
-                glVertex3f(x, armHeight / 2, armWidth / 2);
+            TowerLight light = {
+                radius * cos(angle),  // x coordinate of the light
+                (float)height,        // y coordinate (height of the light)
+                radius * sin(angle),  // z coordinate of the light
+                r, g, b,              // RGB color values for the light
+                true                  // The light is turned on initially
+            };
+            attractions.lights.push_back(light);
+        }
+    }
+    rig.count = (uint32_t)attractions.lights.size() - rig.first;
+    return entity;
+}
 
-                // Bottom face
-                glVertex3f(x, -armHeight / 2, -armWidth / 2);
-                glVertex3f(x + armLength / gradientSteps, -armHeight / 2, -armWidth / 2);
-                glVertex3f(x + armLength / gradientSteps, -armHeight / 2, armWidth / 2);
-                glVertex3f(x, -armHeight / 2, armWidth / 2);
+uint32_t spawnFerrisWheel(float x, float y, float z) {
+    uint32_t entity = createEntity(COMPONENT_TRANSFORM | COMPONENT_WHEEL_ANIMATOR | COMPONENT_RENDERABLE);
+    Transform& transform = *attractions.transforms.find(entity);
+    transform.x = x;
+    transform.y = y;
+    transform.z = z;
+    attractions.renderables.find(entity)->kind = RENDER_FERRIS_WHEEL;
+    return entity;
+}
 
-                // Front face
-                glVertex3f(x, -armHeight / 2, armWidth / 2);
-                glVertex3f(x + armLength / gradientSteps, -armHeight / 2, armWidth / 2);
-                glVertex3f(x + armLength / gradientSteps, armHeight / 2, armWidth / 2);
-                glVertex3f(x, armHeight / 2, armWidth / 2);
+// Give every wheel its own supports and hub scene nodes after the fixed ones
+void attachWheelSceneNodes() {
+    if (sceneGraph.nodes.size() > NODE_COUNT) sceneGraph.nodes.resize(NODE_COUNT);
+    for (size_t i = 0; i < attractions.wheels.items.size(); i++) {
+        WheelAnimator& wheel = attractions.wheels.items[i];
+        const Transform* transform = attractions.transforms.find(attractions.wheels.owners[i]);
+        Matrix4 placement = identityMatrix();
+        if (transform != nullptr) placement = translationMatrix(transform->x, transform->y, transform->z);
 
-                // Back face
-                glVertex3f(x, -armHeight / 2, -armWidth / 2);
-                glVertex3f(x + armLength / gradientSteps, -armHeight / 2, -armWidth / 2);
-                glVertex3f(x + armLength / gradientSteps, armHeight / 2, -armWidth / 2);
-                glVertex3f(x, armHeight / 2, -armWidth / 2);
-            }
-            glEnd();
-            glPopMatrix();
+        // The supports are scaled 1.4x at the wheel's base and never move again
+        wheel.supportsNode = addSceneNode(-1, multiplyMatrices(placement,
+            scaleMatrix(FERRIS_WHEEL_SCALE, FERRIS_WHEEL_SCALE, FERRIS_WHEEL_SCALE)));
+        wheel.hubNode = addSceneNode(wheel.supportsNode, identityMatrix());
+    }
+}
 
-            // Seat itself - using vibrant colors
-            glColor3f(0.8f, 0.3f, 0.3f); // Seat body in red
-            glScalef(0.6f, 0.6f, 0.6f);
-            chair();
-            glPopMatrix();
-        }
-        glPopMatrix();
+// Create every attraction entity from the spawn table
+void spawnAttractions() {
+    attractions = AttractionRegistry();
+    towerParticles.clear();
+
+    const int spawnCount = sizeof(ATTRACTION_SPAWNS) / sizeof(ATTRACTION_SPAWNS[0]);
+    for (int i = 0; i < spawnCount; i++) {
+        const AttractionSpawn& spawn = ATTRACTION_SPAWNS[i];
+        if (spawn.kind == RENDER_DROP_TOWER) spawnDropTower(spawn.x, spawn.y, spawn.z);
+        else if (spawn.kind == RENDER_FERRIS_WHEEL) spawnFerrisWheel(spawn.x, spawn.y, spawn.z);
     }
-    glPopMatrix();
+    for (int i = 0; i < extraDropTowers; i++) {
+        float angle = i * 2.0f * M_PI / extraDropTowers;
+        spawnDropTower(EXTRA_TOWER_RING_RADIUS * cos(angle), 0.0f, EXTRA_TOWER_RING_RADIUS * sin(angle));
+    }
+    attachWheelSceneNodes();
+}
 
-    // Draw decorative lights
-    glDisable(GL_LIGHTING);
-    glDisable(GL_TEXTURE_2D);
+bool hasComponents(uint32_t entity, uint32_t components) {
+    return (attractions.components[entity] & components) == components;
+}
 
-    for (const auto& light : towerLights) {
-        if (light.isOn) {
-            glPushMatrix();
-            glTranslatef(light.x, light.y, light.z);
+// Advance every drop cycle
+void updateRideAnimators(float deltaTime) {
+    for (RideAnimator& ride : attractions.animators.items) {
+
+        // If the tower is not currently dropping or recovering, wait for a period before starting the fall
+        if (!ride.dropping && !ride.recovering) {
+            ride.waitTimer += deltaTime;
+            if (ride.waitTimer >= 1.5f) {  // Reduce waiting time for a more thrilling experience
+                ride.dropping = true;  // Begin the dropping phase
+                ride.speed = 0.0f;  // Reset the drop speed at the start
+                ride.waitTimer = 0.0f;  // Reset the timer for the next round
+            }
+        }
 
-            // Draw light sphere
-            glColor3f(light.r, light.g, light.b);
-            glutSolidSphere(0.3f, 12, 12);
+        // During the dropping phase
+        if (ride.dropping) {
+            ride.speed += dropAcceleration * deltaTime;  // Increase the speed due to acceleration
+            ride.height -= ride.speed * deltaTime;  // Decrease the height to simulate falling
 
-            // Draw glow effect
-            glEnable(GL_BLEND);
-            glBlendFunc(GL_SRC_ALPHA, GL_ONE);
-            glColor4f(light.r, light.g, light.b, 0.8f);
-            glutSolidSphere(0.5f, 12, 12);
-            glDisable(GL_BLEND);
+            // Check if the tower has reached the bottom
+            if (ride.height <= 15.0f) {  // Increase the minimum height for a more dramatic stop
+                ride.height = 15.0f;  // Ensure the drop height does not go below this point
+                ride.dropping = false;  // Stop the dropping phase
+                ride.recovering = true;  // Begin the recovering phase
 
-            glPopMatrix();
+                // Add bouncing effect
+                ride.speed = recoverySpeed * 0.9f;  // Set initial speed for recovery (bounce)
+                ride.bounceHeight = ride.height;  // Store the bounce height
+            }
+        }
+        // During the recovering (bouncing) phase
+        else if (ride.recovering) {
+            if (ride.bounceHeight > 0) {
+                // Simulate the bounce effect by moving upwards
+                ride.height += ride.speed * deltaTime;
+                ride.speed -= dropAcceleration * 0.8f * deltaTime;  // Reduce the bounce speed due to gravity
+
+                if (ride.speed < 0) {
+                    // When the speed becomes negative, it indicates the bounce has been exhausted
+                    ride.bounceHeight = 0;  // Reset the bounce height
+                    ride.speed = recoverySpeed;  // Set the recovery speed for normal upward movement
+                }
+            }
+            else {
+                // Normal upward movement
+                ride.height += recoverySpeed * deltaTime;
+
+                // Check if the tower has reached the top
+                if (ride.height >= TOWER_HEIGHT) {
+                    ride.height = TOWER_HEIGHT;  // Ensure the tower reaches the top exactly
+                    ride.recovering = false;  // End the recovery phase
+                    ride.speed = -recoverySpeed * 0.1f;  // Add a slight rebound effect
+                }
+            }
         }
     }
+}
 
-    // Draw particle effects
-    drawTowerParticles();
+// Turn every Ferris wheel by one tick
+void updateWheelAnimators() {
+    for (WheelAnimator& wheel : attractions.wheels.items) {
+        wheel.angle += wheel.degreesPerTick;
+    }
+}
 
-    glEnable(GL_LIGHTING);
-    glEnable(GL_TEXTURE_2D);
+// Colour wave along each light rig; lights level with a dropping seat flash red
+void updateLightRigs(float deltaTime) {
+    for (size_t item = 0; item < attractions.lightRigs.items.size(); item++) {
+        const RideAnimator* seat = attractions.animators.find(attractions.lightRigs.owners[item]);
+        if (seat == nullptr) continue;
+        LightRig& rig = attractions.lightRigs.items[item];
+        const RideAnimator& ride = *seat;
+        rig.time += deltaTime;  // Accumulate time to create continuous animation
+
+        for (uint32_t i = 0; i < rig.count; i++) {
+            TowerLight& light = attractions.lights[rig.first + i];
+            // Create a wave-like flicker effect for the lights based on the time and index
+            float phase = rig.time * 3.0f + i * 0.2f;
+            float brightness = 0.5f + 0.5f * sin(phase);
+
+            float heightRatio = light.y / TOWER_HEIGHT;
+            if (ride.dropping && fabs(heightRatio - ride.height / TOWER_HEIGHT) < 0.1f) {
+                // Lights near the seat (during a drop event) turn red and flicker
+                light.r = 1.0f;
+                light.g = 0.0f;
+                light.b = 0.0f;
+                light.isOn = (sin(rig.time * 10.0f) > 0.0f);
+            }
+            else {
+                // Restore the original color based on the height ratio
+                HSVtoRGB(heightRatio, 1.0f, brightness, light.r, light.g, light.b);
+                light.isOn = true;
+            }
+        }
+    }
+}
 
-    // Restore original material state
-    glMaterialfv(GL_FRONT, GL_AMBIENT, currentAmbient);
-    glMaterialfv(GL_FRONT, GL_DIFFUSE, currentDiffuse);
-    glMaterialfv(GL_FRONT, GL_SPECULAR, currentSpecular);
-    glMaterialf(GL_FRONT, GL_SHININESS, currentShininess);
+// Spawn sparks around fast-dropping seats, then move and age every particle
+void updateEmitters(float deltaTime) {
+    for (size_t item = 0; item < attractions.emitters.items.size(); item++) {
+        uint32_t entity = attractions.emitters.owners[item];
+        const RideAnimator* seat = attractions.animators.find(entity);
+        const Transform* base = attractions.transforms.find(entity);
+        if (seat == nullptr || base == nullptr) continue;
+        const Emitter& emitter = attractions.emitters.items[item];
+        const RideAnimator& ride = *seat;
+        const Transform& transform = *base;
+        if (!ride.dropping || ride.speed <= emitter.minimumSpeed) continue;
+
+        for (int i = 0; i < emitter.burst; i++) {
+            TowerParticle particle;
 
-    glPopMatrix();
-}
+            // Set the initial position of the particle (random position around the seat)
+            float angle = (rand() % 360) * M_PI / 180.0f;  // Random angle
+            float radius = (rand() % 100) / 100.0f * emitter.radius;  // Random radius within a certain range
+            particle.x = transform.x + radius * cos(angle);
+            particle.y = ride.height;  // At the height of the drop
+            particle.z = transform.z + radius * sin(angle);
 
-// Define a vector to store the lights associated with the second drop tower
-std::vector<TowerLight> secondTowerLights;
+            // Set the initial velocity of the particle
+            particle.vx = (rand() % 200 - 100) / 100.0f * 2.0f;  // Random X velocity
+            particle.vy = (rand() % 100) / 100.0f * 5.0f;  // Random Y velocity
+            particle.vz = (rand() % 200 - 100) / 100.0f * 2.0f;  // Random Z velocity
 
-// Define a vector to store the particles associated with the second drop tower
-std::vector<TowerParticle> secondTowerParticles;
+            // Set the particle's lifetime and appearance
+            particle.life = 1.0f + (rand() % 100) / 100.0f;  // Random lifetime between 1 and 2 seconds
+            particle.r = 1.0f;  // Red component of the color
+            particle.g = 0.5f + (rand() % 50) / 100.0f;  // Green component of the color, with slight random variation
+            particle.b = 0.0f;  // Blue component of the color
+            particle.a = 1.0f;  // Full opacity
+            particle.size = 0.2f + (rand() % 30) / 100.0f;  // Random particle size between 0.2 and 0.5
 
+            towerParticles.push_back(particle);
+        }
+    }
 
-// Initialize the lights for the second drop tower
-void initSecondTowerLights() {
-    // Add decorative lights around the tower at various heights
-    for (int height = 0; height < TOWER_HEIGHT; height += 8) {
-        for (int i = 0; i < 4; i++) {
-            float angle = i * 90.0f * M_PI / 180.0f;  // Calculate the angle for each light
-            float radius = POLE_SPACING * 1.2f;  // Increase the radius for the light positions
+    // Update existing particles; dead ones are replaced by the last particle
+    for (size_t i = 0; i < towerParticles.size();) {
+        TowerParticle& particle = towerParticles[i];
+        particle.x += particle.vx * deltaTime;
+        particle.y += particle.vy * deltaTime;
+        particle.z += particle.vz * deltaTime;
 
-            // Create multicolored lights based on tower height
-            float hue = height / TOWER_HEIGHT;  // Vary the color based on the height
-            float r, g, b;
-            HSVtoRGB(hue, 1.0f, 1.0f, r, g, b);  // Convert HSV to RGB color values
+        // Apply gravity effect on the particle
+        particle.vy -= 9.8f * deltaTime;
 
-            // Define a new light source with position and color
-            TowerLight light = {
-                radius * cos(angle),  // x position of the light
-                (float)height,        // y position of the light (height)
-                radius * sin(angle),  // z position of the light
-                r, g, b,              // RGB color components
-                true                  // Light is initially turned on
-            };
+        // Update the particle's life and adjust transparency
+        particle.life -= deltaTime;
+        particle.a = particle.life;
 
-            // Add the created light to the vector
-            secondTowerLights.push_back(light);
+        if (particle.life <= 0) {
+            particle = towerParticles.back();
+            towerParticles.pop_back();
+        }
+        else {
+            ++i;
         }
     }
 }
 
-// Particle rendering function for the second drop tower
-void drawSecondTowerParticles() {
-    glPushMatrix();  // Save the current matrix state
+/**
+ * Renders particle effects for the tower attraction.
+ * This function handles the visualization of particles with:
+ * - Billboard technique (particles always face camera)
+ * - Alpha blending for transparency
+ * - Depth testing disabled for proper blending
+ */
+void drawTowerParticles() {
+    PROFILE_PASS(PROFILE_PARTICLES);
+    glPushMatrix();
 
-    // Disable lighting to ensure that particles are not affected by lighting
+    // Disable lighting for particle effects
     glDisable(GL_LIGHTING);
-    glEnable(GL_BLEND);  // Enable blending for transparency effects
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE);  // Set the blend function to allow transparency
-    glDisable(GL_DEPTH_TEST);  // Disable depth testing to ensure particles are rendered on top
 
-    // Iterate over each particle in the second tower's particle system
-    for (const auto& particle : secondTowerParticles) {
-        glPushMatrix();  // Save the current matrix state for each particle
-        glTranslatef(particle.x, particle.y, particle.z);  // Position the particle in 3D space
+    // Enable alpha blending for transparency
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE);  // Additive blending for glow effect
+
+    // Disable depth testing to prevent particle sorting issues
+    glDisable(GL_DEPTH_TEST);
+
+    // Render each particle in the system
+    for (const auto& particle : towerParticles) {
+        glPushMatrix();
+        glTranslatef(particle.x, particle.y, particle.z);
 
-        // Make the particle always face the camera (billboarding)
-        glRotatef(-cameraAngleY, 0.0f, 1.0f, 0.0f);  // Rotate around the Y-axis (horizontal)
-        glRotatef(-cameraAngleX, 1.0f, 0.0f, 0.0f);  // Rotate around the X-axis (vertical)
+        // Implement billboard technique - make particles face camera
+        glRotatef(-cameraAngleY, 0.0f, 1.0f, 0.0f);  // Horizontal rotation
+        glRotatef(-cameraAngleX, 1.0f, 0.0f, 0.0f);  // Vertical rotation
 
-        // Set the particle color and alpha (transparency)
+        // Set particle color and alpha
         glColor4f(particle.r, particle.g, particle.b, particle.a);
 
-        // Draw the particle as a square (quad)
+        // Draw particle as a textured quad
         glBegin(GL_QUADS);
-        float size = particle.size / 2.0f;  // Half the size of the particle
-        glVertex3f(-size, -size, 0.0f);  // Bottom-left corner
-        glVertex3f(size, -size, 0.0f);   // Bottom-right corner
-        glVertex3f(size, size, 0.0f);    // Top-right corner
-        glVertex3f(-size, size, 0.0f);   // Top-left corner
+        float size = particle.size / 2.0f;
+        glVertex3f(-size, -size, 0.0f);  // Bottom-left
+        glVertex3f(size, -size, 0.0f);   // Bottom-right
+        glVertex3f(size, size, 0.0f);    // Top-right
+        glVertex3f(-size, size, 0.0f);   // Top-left
         glEnd();
 
-        glPopMatrix();  // Restore the matrix state after drawing the particle
+        glPopMatrix();
     }
 
-    // Re-enable depth testing and lighting after rendering the particles
+    // Restore OpenGL states
     glEnable(GL_DEPTH_TEST);
     glDisable(GL_BLEND);
     glEnable(GL_LIGHTING);
-
-    glPopMatrix();  // Restore the original matrix state
-}
-
-
-// Light update function for the second drop tower
-void updateSecondTowerLights(float deltaTime) {
-    static float time = 0.0f;  // Static variable to accumulate time across function calls
-    time += deltaTime;  // Increment the time by the elapsed time (deltaTime)
-
-    // Iterate over each light in the second tower's light system
-    for (size_t i = 0; i < secondTowerLights.size(); i++) {
-        // Calculate the phase of the light's sine wave based on time and light index
-        float phase = time * 3.0f + i * 0.2f;  // Modulate phase for each light to create variation
-
-        // Compute the brightness of the light based on the sine wave
-        float brightness = 0.5f + 0.5f * sin(phase);  // Sine wave oscillation between 0.0 and 1.0
-
-        // Calculate the height ratio of the light's position relative to the tower's height
-        float heightRatio = secondTowerLights[i].y / TOWER_HEIGHT;
-
-        // Check if the tower is dropping and the light is near the drop height
-        if (isDropping && fabs(heightRatio - dropHeight / TOWER_HEIGHT) < 0.1f) {
-            // If the drop height is close, set the light color to red
-            secondTowerLights[i].r = 1.0f;  // Set red component to maximum
-            secondTowerLights[i].g = 0.0f;  // Set green component to 0
-            secondTowerLights[i].b = 0.0f;  // Set blue component to 0
-            // Toggle the light's state based on a fast sine wave oscillation
-            secondTowerLights[i].isOn = (sin(time * 10.0f) > 0.0f);
-        }
-        else {
-            // If not at the drop height, set the light color based on its height
-            float hue = heightRatio;  // Map height to hue for smooth color transition
-            // Convert from HSV to RGB using the calculated hue and brightness
-            HSVtoRGB(hue, 1.0f, brightness,
-                secondTowerLights[i].r,
-                secondTowerLights[i].g,
-                secondTowerLights[i].b);
-            // Ensure the light is always on (not flickering)
-            secondTowerLights[i].isOn = true;
-        }
-    }
-}
-
-
-// Particle update function for the second drop tower
-void updateSecondTowerParticles(float deltaTime) {
-    // Check if the tower is dropping and the drop speed exceeds a threshold
-    if (isDropping && dropSpeed > 20.0f) {
-        // Generate new particles every frame when the drop conditions are met
-        for (int i = 0; i < 30; i++) {
-            TowerParticle particle;
-
-            // Randomly generate the particle's direction (angle) and distance (radius) from the center
-            float angle = (rand() % 360) * M_PI / 180.0f;  // Convert random degree to radians
-            float radius = (rand() % 100) / 100.0f * POLE_SPACING;  // Random radius within a certain distance
-
-            // Calculate the particle's 3D position based on the angle and radius
-            particle.x = -TOWER_POSITION_X + radius * cos(angle);  // x-coordinate
-            particle.y = dropHeight;  // y-coordinate (initial drop height)
-            particle.z = TOWER_POSITION_Z + radius * sin(angle);  // z-coordinate
-
-            // Assign random velocities for the particle in 3D space
-            particle.vx = (rand() % 200 - 100) / 100.0f * 2.0f;  // Random horizontal velocity
-            particle.vy = (rand() % 100) / 100.0f * 5.0f;  // Random vertical velocity
-            particle.vz = (rand() % 200 - 100) / 100.0f * 2.0f;  // Random depth velocity
-
-            // Set the particle's initial lifetime, color, transparency, and size
-            particle.life = 1.0f + (rand() % 100) / 100.0f;  // Random life duration between 1 and 2 seconds
-            particle.r = 1.0f;  // Red component of color (fixed to red)
-            particle.g = 0.5f + (rand() % 50) / 100.0f;  // Random green component (between 0.5 and 1.0)
-            particle.b = 0.0f;  // Blue component of color (fixed to 0)
-            particle.a = 1.0f;  // Initial opacity (fully opaque)
-            particle.size = 0.2f + (rand() % 30) / 100.0f;  // Random size between 0.2 and 0.5 units
-
-            // Add the newly created particle to the particle system
-            secondTowerParticles.push_back(particle);
-        }
-    }
-
-    // Update the state of each particle in the particle system
-    for (auto it = secondTowerParticles.begin(); it != secondTowerParticles.end();) {
-        // Update the particle's position based on its velocity and the elapsed time
-        it->x += it->vx * deltaTime;  // Update x-position
-        it->y += it->vy * deltaTime;  // Update y-position
-        it->z += it->vz * deltaTime;  // Update z-position
-
-        // Apply gravity to the particle's vertical velocity (simple gravity model)
-        it->vy -= 9.8f * deltaTime;  // Gravity effect (acceleration due to gravity)
-
-        // Decrease the particle's lifetime over time
-        it->life -= deltaTime;  // Decrease the remaining life
-
-        // Update the particle's alpha (transparency) based on its remaining life
-        it->a = it->life;
-
-        // If the particle's life has ended, remove it from the system
-        if (it->life <= 0) {
-            it = secondTowerParticles.erase(it);  // Erase the particle and move to the next one
-        }
-        else {
-            ++it;  // Move to the next particle
-        }
-    }
+    glPopMatrix();
 }
 
-
 /**
- * Draws the second drop tower with detailed components and effects.
- * The function includes the base, main pillar, support pillars, seating structure,
- * decorative lights, and particle effects.
+ * Renders one drop tower with detailed components and effects.
+ * This function includes the base, main pillar, support pillars, seating structure
+ * and decorative lights; its sparks are drawn with every other emitter's.
  */
-void drawSecondDropTower() {
+void drawDropTower(uint32_t entity) {
+    const Transform& transform = *attractions.transforms.find(entity);
+    const RideAnimator& ride = *attractions.animators.find(entity);
     glPushMatrix();
 
     // Save current material state
@@ -5172,23 +7494,23 @@ void drawSecondDropTower() {
     glGetMaterialfv(GL_FRONT, GL_SPECULAR, currentSpecular);
     glGetMaterialfv(GL_FRONT, GL_SHININESS, &currentShininess);
 
-    glTranslatef(-TOWER_POSITION_X, 0.0f, TOWER_POSITION_Z);
+    glTranslatef(transform.x, transform.y, transform.z);
 
     // 1. Draw the base - using deep blue metallic texture
     glPushMatrix();
     if (gUseTexture) {
         glEnable(GL_TEXTURE_2D);
-        glBindTexture(GL_TEXTURE_2D, texVec[34]);
+        bindTexture2D(NO_TEXTURE);  // No tower texture loaded; the deep blue colour shows through
     }
     glColor3f(0.2f, 0.3f, 0.4f); // Deep blue tone
     glScalef(BASE_SIZE, 2.0f, BASE_SIZE);
-    glutSolidCube(1.0f);
+    solidCube(1.0f);
 
     // Add decorative edges to the base
     glColor3f(0.4f, 0.6f, 0.8f); // Bright blue decoration
     glTranslatef(0.0f, 0.5f, 0.0f);
     glScalef(1.05f, 0.1f, 1.05f);
-    glutSolidCube(1.0f);
+    solidCube(1.0f);
     glPopMatrix();
 
     // Main central pillar - using gradient colors
@@ -5286,13 +7608,13 @@ void drawSecondDropTower() {
 
     // Seat support structure - using modern color scheme
     glPushMatrix();
-    glTranslatef(0.0f, dropHeight, 0.0f);
+    glTranslatef(0.0f, ride.height, 0.0f);
 
     // Main crossbeam
     glColor3f(0.3f, 0.5f, 0.7f); // Deep blue tone
     glPushMatrix();
     glScalef(POLE_SPACING * 2, POLE_RADIUS * 2, POLE_RADIUS * 2);
-    glutSolidCube(1.0f);
+    solidCube(1.0f);
     glPopMatrix();
 
     // Seating levels
@@ -5305,7 +7627,7 @@ void drawSecondDropTower() {
         glColor3f(0.4f, 0.6f, 0.8f); // Bright blue
         glPushMatrix();
         glScalef(POLE_SPACING * 2, POLE_RADIUS, POLE_RADIUS);
-        glutSolidCube(1.0f);
+        solidCube(1.0f);
         glPopMatrix();
 
         // Seats
@@ -5377,29 +7699,29 @@ void drawSecondDropTower() {
     glDisable(GL_LIGHTING);
     glDisable(GL_TEXTURE_2D);
 
-    for (const auto& light : secondTowerLights) {
-        if (light.isOn) {
+    if (hasComponents(entity, COMPONENT_LIGHT_RIG)) {
+        const LightRig& rig = *attractions.lightRigs.find(entity);
+        for (uint32_t i = rig.first; i < rig.first + rig.count; i++) {
+            const TowerLight& light = attractions.lights[i];
+            if (!light.isOn) continue;
             glPushMatrix();
             glTranslatef(light.x, light.y, light.z);
 
             // Draw light sphere
             glColor3f(light.r, light.g, light.b);
-            glutSolidSphere(0.3f, 12, 12);
+            solidSphere(0.3f, 12, 12);
 
             // Draw glow effect
             glEnable(GL_BLEND);
             glBlendFunc(GL_SRC_ALPHA, GL_ONE);
             glColor4f(light.r, light.g, light.b, 0.8f);
-            glutSolidSphere(0.5f, 12, 12);
+            solidSphere(0.5f, 12, 12);
             glDisable(GL_BLEND);
 
             glPopMatrix();
         }
     }
 
-    // Draw particle effects
-    drawSecondTowerParticles();
-
     glEnable(GL_LIGHTING);
     glEnable(GL_TEXTURE_2D);
 
@@ -5412,59 +7734,274 @@ void drawSecondDropTower() {
     glPopMatrix();
 }
 
-void updateDropTower(float deltaTime) {
-    static float waitTimer = 0.0f;  // Timer to manage the waiting period before the drop starts
-    static float bounceHeight = 0.0f;  // Height during the bouncing phase
+// Modified function to draw the Ferris wheel with gradient-colored cabins
+/**
+ * @brief Draws the Ferris wheel with gradient-colored cabins and matching support frames.
+ *
+ * This function renders one Ferris wheel entity, including the rim, inner rings, spokes, support frames,
+ * and cabins. Each cabin and its supporting steel frame have the same gradient color to create
+ * a cohesive visual effect. The wheel's animator angle drives the rotation and swing of the cabins.
+ */
+void drawFerrisWheel(uint32_t entity)
+{
+    const WheelAnimator& wheel = *attractions.wheels.find(entity);
+
+    // The supports node scales the ride 1.4x and places it at the entity's base
+    glPushMatrix();
+    loadNodeMatrix(wheel.supportsNode);
+
+    // Draw the support structures of the Ferris wheel
+    drawSupports();
+
+    // Begin drawing the Ferris wheel
+    glPushMatrix();
+
+    // The hub sits at the wheel position, raised to Y = 13.0f, and turns around the Z-axis
+    setNodeLocal(wheel.hubNode, multiplyMatrices(
+        translationMatrix(ferrisWheelPosX, ferrisWheelPosY + 13.0f, ferrisWheelPosZ),
+        rotationMatrix(wheel.angle, 0.0f, 0.0f, 1.0f)));
+    loadNodeMatrix(wheel.hubNode);
+
+    // Enable smooth shading for better visual quality
+    glShadeModel(GL_SMOOTH);
+
+    // Set warm metallic material properties
+    GLfloat matAmbient[] = { 0.4f, 0.2f, 0.1f, 1.0f };
+    GLfloat matDiffuse[] = { 0.7f, 0.4f, 0.2f, 1.0f };
+    GLfloat matSpecular[] = { 0.9f, 0.6f, 0.3f, 1.0f };
+    GLfloat matShininess[] = { 50.0f };
+
+    glMaterialfv(GL_FRONT, GL_AMBIENT, matAmbient);
+    glMaterialfv(GL_FRONT, GL_DIFFUSE, matDiffuse);
+    glMaterialfv(GL_FRONT, GL_SPECULAR, matSpecular);
+    glMaterialfv(GL_FRONT, GL_SHININESS, matShininess);
+
+    float rimRadius = 10.0f;        // Radius of the rim
+    float rimThickness = 0.17f;     // Thickness of the rim
+
+    if (gUseTexture)
+    {
+        glEnable(GL_TEXTURE_2D);               // Enable textures
+        bindTexture2D(metalTexture);  // Bind the specified texture
+        glColor3f(1.0f, 1.0f, 1.0f);          // Set color to white (keep original texture color)
+        glPushMatrix();
+        // Draw the outer rim using a solid torus
+        float rimRadius = 10.0f;        // Radius of the rim
+        float rimThickness = 0.17f;     // Thickness of the rim
+        solidTorus(rimThickness, rimRadius, 32, 128);
+        glPopMatrix();
+    }
+    else
+    {
+        glColor3f(0.7f, 1.0f, 0.7f);          // Set color to light gray if no texture is used
+        // Draw the outer rim using a solid torus
+        glPushMatrix();
+        solidTorus(rimThickness, rimRadius, 32, 128);
+        glPopMatrix();
+    }
+
+    if (gUseTexture)
+    {
+        glDisable(GL_TEXTURE_2D);  // Disable textures when done
+    }
+
+    // Draw the inner rings using a separate function
+    int numInnerRings = 4; // Number of inner rings
+    drawInnerRings(rimRadius, numInnerRings);
+
+    // Draw the spokes with increased thickness
+    int numSpokes = 24; // Number of spokes
+
+    for (int i = 0; i < numSpokes; ++i)
+    {
+        // Calculate the angle for the current spoke
+        float spokeAngle = i * 360.0f / numSpokes;
+
+        glPushMatrix();
+
+        // Rotate to the current spoke angle around the Z-axis
+        glRotatef(spokeAngle, 0.0f, 0.0f, 1.0f);
+
+        // Create a new quadric object for rendering cylinders
+        GLUquadric* quad = gluNewQuadric();
+        gluQuadricNormals(quad, GLU_SMOOTH);
+        gluQuadricTexture(quad, GL_TRUE);
+
+        float spokeThickness = 0.3f;               // Thickness of the spoke
+        float centralCylinderLength = rimRadius * 0.2f; // Length of the central cylinder
+        gluCylinder(quad, spokeThickness, spokeThickness, centralCylinderLength, 16, 1);
+
+        // Add a cube at the front end of the central cylinder
+        float cubeSize = spokeThickness * 3.5f; // Size of the cube
+
+        glPushMatrix();
+
+        // Move to the end of the central cylinder
+        glTranslatef(0.0f, 0.0f, centralCylinderLength + cubeSize / 2.0f);
+
+        // Enable texture for the cube if required
+        if (gUseTexture)
+        {
+            glEnable(GL_TEXTURE_2D);
+            bindTexture2D(NO_TEXTURE); // Cube: no texture loaded, material colour only
+            glColor3f(1.0f, 1.0f, 1.0f);
+        }
+        else
+        {
+            glColor3f(0.8f, 1.0f, 1.0f); // Light gray color
+        }
+
+        // Draw the cube representing the cabin attachment
+        solidCube(cubeSize);
+
+        // Disable texture after drawing the cube
+        if (gUseTexture)
+        {
+            glDisable(GL_TEXTURE_2D);
+        }
+
+        glPopMatrix();
+
+        // Draw support rods for each inner ring
+        for (int r = 1; r <= numInnerRings; ++r)
+        {
+            float ringRadius = rimRadius * (1.0f - r * 0.25f);
+
+            // Draw the cylindrical support rod
+            glPushMatrix();
+            gluCylinder(quad, spokeThickness, spokeThickness, ringRadius, 10, 1);
+            glPopMatrix();
+
+            // Draw a rectangular prism at the end of the support rod
+            float length = ringRadius - 2;          // Length of the prism
+            float width = 2.0f * spokeThickness;    // Width of the prism
+            float height = spokeThickness;          // Height of the prism
+
+            glPushMatrix();
+
+            // Translate to the end of the support rod
+            glTranslatef(0.0f, 0.0f, length);
+
+            // Apply texture if enabled
+            if (gUseTexture)
+            {
+                glEnable(GL_TEXTURE_2D);
+                bindTexture2D(xjtluTexture); // Selected texture
+                glColor3f(1.0f, 1.0f, 1.0f); // Set color to white to display texture colors
+            }
+            else
+            {
+                glColor3f(0.8f, 0.8f, 0.8f); // Light gray color
+            }
+
+            // Scale and draw the rectangular prism
+            glScalef(width, height, length); // Set the size of the prism
+            solidCube(1.0f); // Use a cube to draw the prism
+
+            // Disable texture after drawing the prism
+            if (gUseTexture)
+            {
+                glDisable(GL_TEXTURE_2D);
+            }
+
+            glPopMatrix();
+        }
+
+        // Delete the quadric object to free resources
+        gluDeleteQuadric(quad);
+        glPopMatrix();
+    }
+
+    // Draw the cabins with gradient colors
+    int numCabins = numSpokes; // Assume one cabin per spoke
+
+    for (int i = 0; i < numCabins; ++i)
+    {
+        glPushMatrix();
+
+        // Calculate the angle for the current cabin
+        float spokeAngle = i * 360.0f / numCabins;
+        glRotatef(spokeAngle, 0.0f, 0.0f, 1.0f);
+
+        // Translate to the position of the cabin
+        glTranslatef(rimRadius, 0.0f, 0.0f);
+
+        // Calculate color to create a gradient effect
+        float hue = i / static_cast<float>(numCabins); // Hue ranges from 0 to 1
+        float r, g, b;
+        HSVtoRGB(hue, 0.8f, 1.0f, r, g, b);
+
+        // Draw the steel frame from the center to the cabin with matching color
+        glPushMatrix();
+        glTranslatef(-rimRadius, 0.0f, 0.0f); // Move back to the center
+
+        // Set material properties and apply texture for the steel frame
+        if (gUseTexture)
+        {
+            glEnable(GL_TEXTURE_2D);
+            bindTexture2D(metalTexture); // Metal texture
+            glColor3f(r, g, b); // Set color matching the cabin
+        }
+        else
+        {
+            glColor3f(r, g, b); // Set color matching the cabin
+        }
+
+        // Create a new quadric object for the frame cylinder
+        GLUquadric* quad = gluNewQuadric();
+        gluQuadricNormals(quad, GLU_SMOOTH);
+        gluQuadricTexture(quad, GL_TRUE);
+
+        float frameThickness = 0.15f; // Thickness of the frame
+        float frameLength = rimRadius; // Length of the frame
+
+        // Rotate to align the cylinder along the X-axis
+        glRotatef(90.0f, 0.0f, 1.0f, 0.0f);
+        gluCylinder(quad, frameThickness, frameThickness, frameLength, 16, 1);
+
+        // Delete the quadric object to free resources
+        gluDeleteQuadric(quad);
+
+        // Disable texture after drawing the frame
+        if (gUseTexture)
+        {
+            glDisable(GL_TEXTURE_2D);
+        }
+
+        glPopMatrix(); // Restore to the cabin position
 
-    // If the tower is not currently dropping or recovering, wait for a period before starting the fall
-    if (!isDropping && !isRecovering) {
-        waitTimer += deltaTime;
-        if (waitTimer >= 1.5f) {  // Reduce waiting time for a more thrilling experience
-            isDropping = true;  // Begin the dropping phase
-            dropSpeed = 0.0f;  // Reset the drop speed at the start
-            waitTimer = 0.0f;  // Reset the timer for the next round
-        }
-    }
+        // Calculate the swing angle based on the rotation speed
+        float swingAngle = sin((wheel.angle + spokeAngle) * M_PI / 180.0f) * 10.0f;
 
-    // During the dropping phase
-    if (isDropping) {
-        dropSpeed += dropAcceleration * deltaTime;  // Increase the speed due to acceleration
-        dropHeight -= dropSpeed * deltaTime;  // Decrease the height to simulate falling
+        // Call the function to draw the cabin, passing color parameters
+        drawCabin(swingAngle, r, g, b);
 
-        // Check if the tower has reached the bottom
-        if (dropHeight <= 15.0f) {  // Increase the minimum height for a more dramatic stop
-            dropHeight = 15.0f;  // Ensure the drop height does not go below this point
-            isDropping = false;  // Stop the dropping phase
-            isRecovering = true;  // Begin the recovering phase
+        glPopMatrix(); // Restore to the center of the wheel
+    }
 
-            // Add bouncing effect
-            dropSpeed = recoverySpeed * 0.9f;  // Set initial speed for recovery (bounce)
-            bounceHeight = dropHeight;  // Store the bounce height
-        }
+    // Disable textures if they were enabled
+    if (gUseTexture)
+    {
+        glDisable(GL_TEXTURE_2D);
     }
-    // During the recovering (bouncing) phase
-    else if (isRecovering) {
-        if (bounceHeight > 0) {
-            // Simulate the bounce effect by moving upwards
-            dropHeight += dropSpeed * deltaTime;
-            dropSpeed -= dropAcceleration * 0.8f * deltaTime;  // Reduce the bounce speed due to gravity
 
-            if (dropSpeed < 0) {
-                // When the speed becomes negative, it indicates the bounce has been exhausted
-                bounceHeight = 0;  // Reset the bounce height
-                dropSpeed = recoverySpeed;  // Set the recovery speed for normal upward movement
-            }
-        }
-        else {
-            // Normal upward movement
-            dropHeight += recoverySpeed * deltaTime;
-
-            // Check if the tower has reached the top
-            if (dropHeight >= TOWER_HEIGHT) {
-                dropHeight = TOWER_HEIGHT;  // Ensure the tower reaches the top exactly
-                isRecovering = false;  // End the recovery phase
-                dropSpeed = -recoverySpeed * 0.1f;  // Add a small deceleration effect when reaching the top
-            }
+    glPopMatrix(); // Restore the wheel's transformations
+    glPopMatrix(); // Restore the Ferris wheel's transformations
+}
+
+// Draw every renderable attraction of one kind; the caller opens its profiler pass
+void drawAttractions(RenderKind kind) {
+    for (size_t item = 0; item < attractions.renderables.items.size(); item++) {
+        if (attractions.renderables.items[item].kind != kind) continue;
+        uint32_t entity = attractions.renderables.owners[item];
+        if (!hasComponents(entity, COMPONENT_TRANSFORM)) continue;
+        switch (kind) {
+        case RENDER_DROP_TOWER:
+            if (hasComponents(entity, COMPONENT_RIDE_ANIMATOR)) drawDropTower(entity);
+            break;
+        case RENDER_FERRIS_WHEEL:
+            if (hasComponents(entity, COMPONENT_WHEEL_ANIMATOR)) drawFerrisWheel(entity);
+            break;
         }
     }
 }
@@ -5656,6 +8193,279 @@ Vec3 catmullRomSpline(const Vec3& p0, const Vec3& p1, const Vec3& p2, const Vec3
     );
 }
 
+// First derivative of the Catmull-Rom spline with respect to t
+Vec3 catmullRomDerivative(const Vec3& p0, const Vec3& p1, const Vec3& p2, const Vec3& p3, float t) {
+    float t2 = t * t;
+    float d0 = -1.5f * t2 + 2.0f * t - 0.5f;
+    float d1 = 4.5f * t2 - 5.0f * t;
+    float d2 = -4.5f * t2 + 4.0f * t + 0.5f;
+    float d3 = 1.5f * t2 - 1.0f * t;
+    return Vec3(
+        d0 * p0.x + d1 * p1.x + d2 * p2.x + d3 * p3.x,
+        d0 * p0.y + d1 * p1.y + d2 * p2.y + d3 * p3.y,
+        d0 * p0.z + d1 * p1.z + d2 * p2.z + d3 * p3.z
+    );
+}
+
+
+//=============================================================================
+// BATCH SPLINE EVALUATION
+//=============================================================================
+
+/**
+ * Evaluates Catmull-Rom positions and first derivatives for many samples at once.
+ * Results are stored as separate x/y/z streams so SIMD lanes can be written directly;
+ * the kernels are written once against the SplineLane wrappers below and compile to
+ * AVX, SSE or plain scalar code (define COASTER_NO_SIMD to force the scalar path).
+ */
+
+#if defined(COASTER_SPLINE_AVX)
+typedef __m256 SplineLane;
+const int SPLINE_LANES = 8;
+inline SplineLane laneLoad(const float* p) { return _mm256_loadu_ps(p); }
+inline SplineLane laneSet(float v) { return _mm256_set1_ps(v); }
+inline SplineLane laneAdd(SplineLane a, SplineLane b) { return _mm256_add_ps(a, b); }
+inline SplineLane laneMul(SplineLane a, SplineLane b) { return _mm256_mul_ps(a, b); }
+inline void laneStore(float* p, SplineLane v) { _mm256_storeu_ps(p, v); }
+#elif defined(COASTER_SPLINE_SSE)
+typedef __m128 SplineLane;
+const int SPLINE_LANES = 4;
+inline SplineLane laneLoad(const float* p) { return _mm_loadu_ps(p); }
+inline SplineLane laneSet(float v) { return _mm_set1_ps(v); }
+inline SplineLane laneAdd(SplineLane a, SplineLane b) { return _mm_add_ps(a, b); }
+inline SplineLane laneMul(SplineLane a, SplineLane b) { return _mm_mul_ps(a, b); }
+inline void laneStore(float* p, SplineLane v) { _mm_storeu_ps(p, v); }
+#else
+typedef float SplineLane;
+const int SPLINE_LANES = 1;
+inline SplineLane laneLoad(const float* p) { return *p; }
+inline SplineLane laneSet(float v) { return v; }
+inline SplineLane laneAdd(SplineLane a, SplineLane b) { return a + b; }
+inline SplineLane laneMul(SplineLane a, SplineLane b) { return a * b; }
+inline void laneStore(float* p, SplineLane v) { *p = v; }
+#endif
+
+// Weighted sum of four control coordinates
+inline SplineLane laneBlend(SplineLane w0, SplineLane w1, SplineLane w2, SplineLane w3,
+    SplineLane c0, SplineLane c1, SplineLane c2, SplineLane c3) {
+    return laneAdd(laneAdd(laneMul(w0, c0), laneMul(w1, c1)), laneAdd(laneMul(w2, c2), laneMul(w3, c3)));
+}
+
+// Precomputed basis weights for a fixed set of parameters t
+struct CatmullRomBasis {
+    size_t count = 0;             // Samples per segment
+    std::vector<float> weight[4]; // Position weights per control point, padded to whole lanes
+    std::vector<float> slope[4];  // Derivative weights per control point, padded to whole lanes
+};
+
+// Positions and first derivatives as structure-of-arrays streams
+struct SplineSamples {
+    size_t count = 0;
+    std::vector<float> x, y, z;
+    std::vector<float> dx, dy, dz;
+
+    // Streams keep one lane of slack so kernels can store whole lanes past the end
+    void resize(size_t n) {
+        count = n;
+        size_t padded = n + SPLINE_LANES;
+        x.resize(padded); y.resize(padded); z.resize(padded);
+        dx.resize(padded); dy.resize(padded); dz.resize(padded);
+    }
+    Vec3 position(size_t i) const { return Vec3(x[i], y[i], z[i]); }
+    Vec3 derivative(size_t i) const { return Vec3(dx[i], dy[i], dz[i]); }
+};
+
+// Build basis tables for t = i * step, i = 0 .. count-1
+void buildCatmullRomBasis(CatmullRomBasis& basis, size_t count, float step) {
+    size_t padded = (count + SPLINE_LANES - 1) / SPLINE_LANES * SPLINE_LANES;
+    basis.count = count;
+    for (int k = 0; k < 4; k++) {
+        basis.weight[k].assign(padded, 0.0f);
+        basis.slope[k].assign(padded, 0.0f);
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        float t = i * step;
+        float t2 = t * t;
+        float t3 = t2 * t;
+        basis.weight[0][i] = -0.5f * t3 + t2 - 0.5f * t;
+        basis.weight[1][i] = 1.5f * t3 - 2.5f * t2 + 1.0f;
+        basis.weight[2][i] = -1.5f * t3 + 2.0f * t2 + 0.5f * t;
+        basis.weight[3][i] = 0.5f * t3 - 0.5f * t2;
+        basis.slope[0][i] = -1.5f * t2 + 2.0f * t - 0.5f;
+        basis.slope[1][i] = 4.5f * t2 - 5.0f * t;
+        basis.slope[2][i] = -4.5f * t2 + 4.0f * t + 0.5f;
+        basis.slope[3][i] = 1.5f * t2 - 1.0f * t;
+    }
+}
+
+// The four control points of segment i, clamped at both ends of the track
+inline void segmentControls(const TrackPoint* points, size_t pointCount, size_t i, const Vec3* controls[4]) {
+    controls[0] = &points[i == 0 ? 0 : i - 1].position;
+    controls[1] = &points[i].position;
+    controls[2] = &points[i + 1].position;
+    controls[3] = &points[i + 2 < pointCount ? i + 2 : i + 1].position;
+}
+
+/**
+ * Evaluates every basis sample on every segment of a point list
+ * Output sample (segment * basis.count + j) holds t = j * step on that segment
+ */
+void evaluateCatmullRomTable(const TrackPoint* points, size_t pointCount, const CatmullRomBasis& basis, SplineSamples& out) {
+    size_t segments = pointCount < 2 ? 0 : pointCount - 1;
+    out.resize(segments * basis.count);
+
+    for (size_t i = 0; i < segments; i++) {
+        const Vec3* c[4];
+        segmentControls(points, pointCount, i, c);
+        SplineLane cx0 = laneSet(c[0]->x), cx1 = laneSet(c[1]->x), cx2 = laneSet(c[2]->x), cx3 = laneSet(c[3]->x);
+        SplineLane cy0 = laneSet(c[0]->y), cy1 = laneSet(c[1]->y), cy2 = laneSet(c[2]->y), cy3 = laneSet(c[3]->y);
+        SplineLane cz0 = laneSet(c[0]->z), cz1 = laneSet(c[1]->z), cz2 = laneSet(c[2]->z), cz3 = laneSet(c[3]->z);
+
+        // Whole lanes may spill into the next segment's samples, which are written afterwards
+        size_t base = i * basis.count;
+        for (size_t j = 0; j < basis.count; j += SPLINE_LANES) {
+            SplineLane w0 = laneLoad(&basis.weight[0][j]), w1 = laneLoad(&basis.weight[1][j]);
+            SplineLane w2 = laneLoad(&basis.weight[2][j]), w3 = laneLoad(&basis.weight[3][j]);
+            SplineLane s0 = laneLoad(&basis.slope[0][j]), s1 = laneLoad(&basis.slope[1][j]);
+            SplineLane s2 = laneLoad(&basis.slope[2][j]), s3 = laneLoad(&basis.slope[3][j]);
+
+            laneStore(&out.x[base + j], laneBlend(w0, w1, w2, w3, cx0, cx1, cx2, cx3));
+            laneStore(&out.y[base + j], laneBlend(w0, w1, w2, w3, cy0, cy1, cy2, cy3));
+            laneStore(&out.z[base + j], laneBlend(w0, w1, w2, w3, cz0, cz1, cz2, cz3));
+            laneStore(&out.dx[base + j], laneBlend(s0, s1, s2, s3, cx0, cx1, cx2, cx3));
+            laneStore(&out.dy[base + j], laneBlend(s0, s1, s2, s3, cy0, cy1, cy2, cy3));
+            laneStore(&out.dz[base + j], laneBlend(s0, s1, s2, s3, cz0, cz1, cz2, cz3));
+        }
+    }
+}
+
+/**
+ * Evaluates arbitrary track parameters, each given as segment index plus fraction
+ * (the same convention getTrainPosition uses); parameters are clamped to the track
+ */
+void evaluateCatmullRomParams(const TrackPoint* points, size_t pointCount, const float* params, size_t paramCount, SplineSamples& out) {
+    out.resize(paramCount);
+    if (pointCount < 2) return;
+
+    float lastSegment = (float)(pointCount - 1);
+    for (size_t i = 0; i < paramCount; i += SPLINE_LANES) {
+        // Gather parameters and controls lane by lane; the last block repeats its final parameter
+        float t[SPLINE_LANES];
+        float c[3][4][SPLINE_LANES];
+        for (int lane = 0; lane < SPLINE_LANES; lane++) {
+            float u = params[std::min(i + lane, paramCount - 1)];
+            u = std::max(0.0f, std::min(u, lastSegment));
+            size_t index = std::min((size_t)u, pointCount - 2);
+            t[lane] = u - index;
+
+            const Vec3* controls[4];
+            segmentControls(points, pointCount, index, controls);
+            for (int k = 0; k < 4; k++) {
+                c[0][k][lane] = controls[k]->x;
+                c[1][k][lane] = controls[k]->y;
+                c[2][k][lane] = controls[k]->z;
+            }
+        }
+
+        // Basis weights from t, as in catmullRomSpline and catmullRomDerivative
+        SplineLane tl = laneLoad(t);
+        SplineLane t2 = laneMul(tl, tl);
+        SplineLane t3 = laneMul(t2, tl);
+        SplineLane w0 = laneAdd(laneAdd(laneMul(laneSet(-0.5f), t3), t2), laneMul(laneSet(-0.5f), tl));
+        SplineLane w1 = laneAdd(laneAdd(laneMul(laneSet(1.5f), t3), laneMul(laneSet(-2.5f), t2)), laneSet(1.0f));
+        SplineLane w2 = laneAdd(laneAdd(laneMul(laneSet(-1.5f), t3), laneMul(laneSet(2.0f), t2)), laneMul(laneSet(0.5f), tl));
+        SplineLane w3 = laneAdd(laneMul(laneSet(0.5f), t3), laneMul(laneSet(-0.5f), t2));
+        SplineLane s0 = laneAdd(laneAdd(laneMul(laneSet(-1.5f), t2), laneMul(laneSet(2.0f), tl)), laneSet(-0.5f));
+        SplineLane s1 = laneAdd(laneMul(laneSet(4.5f), t2), laneMul(laneSet(-5.0f), tl));
+        SplineLane s2 = laneAdd(laneAdd(laneMul(laneSet(-4.5f), t2), laneMul(laneSet(4.0f), tl)), laneSet(0.5f));
+        SplineLane s3 = laneAdd(laneMul(laneSet(1.5f), t2), laneMul(laneSet(-1.0f), tl));
+
+        float* positions[3] = { &out.x[i], &out.y[i], &out.z[i] };
+        float* derivatives[3] = { &out.dx[i], &out.dy[i], &out.dz[i] };
+        for (int axis = 0; axis < 3; axis++) {
+            SplineLane c0 = laneLoad(c[axis][0]), c1 = laneLoad(c[axis][1]);
+            SplineLane c2 = laneLoad(c[axis][2]), c3 = laneLoad(c[axis][3]);
+            laneStore(positions[axis], laneBlend(w0, w1, w2, w3, c0, c1, c2, c3));
+            laneStore(derivatives[axis], laneBlend(s0, s1, s2, s3, c0, c1, c2, c3));
+        }
+    }
+}
+
+// Compare the batch evaluators against per-point catmullRomSpline calls (--bench-spline)
+int runSplineMicrobenchmark() {
+    typedef std::chrono::high_resolution_clock Clock;
+    const int samplesPerSegment = 40;
+    const int repetitions = 200;
+
+    initializeTrackPoints();
+    const TrackPoint* points = trackPoints.data();
+    size_t pointCount = trackPoints.size();
+    size_t sampleCount = (pointCount - 1) * samplesPerSegment;
+
+    // Reference: one call per sample, basis recomputed every time
+    std::vector<Vec3> reference(sampleCount), referenceSlope(sampleCount);
+    Clock::time_point start = Clock::now();
+    for (int r = 0; r < repetitions; r++) {
+        for (size_t i = 0; i + 1 < pointCount; i++) {
+            const Vec3* c[4];
+            segmentControls(points, pointCount, i, c);
+            for (int j = 0; j < samplesPerSegment; j++) {
+                float t = (float)j / samplesPerSegment;
+                reference[i * samplesPerSegment + j] = catmullRomSpline(*c[0], *c[1], *c[2], *c[3], t);
+                referenceSlope[i * samplesPerSegment + j] = catmullRomDerivative(*c[0], *c[1], *c[2], *c[3], t);
+            }
+        }
+    }
+    double scalarSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    // Batch over a shared basis table
+    CatmullRomBasis basis;
+    buildCatmullRomBasis(basis, samplesPerSegment, 1.0f / samplesPerSegment);
+    SplineSamples table;
+    start = Clock::now();
+    for (int r = 0; r < repetitions; r++) {
+        evaluateCatmullRomTable(points, pointCount, basis, table);
+    }
+    double tableSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    // Batch over arbitrary parameters
+    std::vector<float> params(sampleCount);
+    for (size_t i = 0; i < sampleCount; i++) {
+        params[i] = (float)(i / samplesPerSegment) + (float)(i % samplesPerSegment) / samplesPerSegment;
+    }
+    SplineSamples scattered;
+    start = Clock::now();
+    for (int r = 0; r < repetitions; r++) {
+        evaluateCatmullRomParams(points, pointCount, params.data(), params.size(), scattered);
+    }
+    double paramSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    // Largest disagreement with the reference
+    float maxError = 0.0f;
+    for (size_t i = 0; i < sampleCount; i++) {
+        Vec3 values[4] = { table.position(i), table.derivative(i), scattered.position(i), scattered.derivative(i) };
+        Vec3 expected[4] = { reference[i], referenceSlope[i], reference[i], referenceSlope[i] };
+        for (int k = 0; k < 4; k++) {
+            maxError = std::max(maxError, (float)fabs(values[k].x - expected[k].x));
+            maxError = std::max(maxError, (float)fabs(values[k].y - expected[k].y));
+            maxError = std::max(maxError, (float)fabs(values[k].z - expected[k].z));
+        }
+    }
+
+    double evaluations = (double)sampleCount * repetitions;
+    std::cout << "Catmull-Rom microbenchmark: " << sampleCount << " samples x " << repetitions
+        << " repetitions, " << SPLINE_LANES << " lane(s)" << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "  scalar catmullRomSpline: " << scalarSeconds * 1e9 / evaluations << " ns/sample" << std::endl;
+    std::cout << "  batch basis table:       " << tableSeconds * 1e9 / evaluations << " ns/sample ("
+        << scalarSeconds / tableSeconds << "x)" << std::endl;
+    std::cout << "  batch parameters:        " << paramSeconds * 1e9 / evaluations << " ns/sample ("
+        << scalarSeconds / paramSeconds << "x)" << std::endl;
+    std::cout << std::scientific << "  max abs error:           " << maxError << std::endl;
+    return 0;
+}
+
 
 
 // Macros to access train position and orientation
@@ -5679,96 +8489,682 @@ Vec3 getTrainPosition(float t, TrainDirection direction) {
         pos = totalLength - (t * totalLength);
     }
 
-    // Index of the current track point segment
-    int index = static_cast<int>(pos);
-    // Fractional part representing the position within the segment
-    float segmentT = pos - index;
+    // Index of the current track point segment
+    int index = static_cast<int>(pos);
+    // Fractional part representing the position within the segment
+    float segmentT = pos - index;
+
+    // Handle edge cases where the position exceeds track bounds
+    if (index >= trackPoints.size() - 1) {
+        // If the index exceeds the last point, return the position of the last point
+        return trackPoints.back().position;
+    }
+    if (index < 0) {
+        // If the index is negative, return the position of the first point
+        return trackPoints.front().position;
+    }
+
+    // Get the four track points surrounding the current position (for interpolation)
+    Vec3 p0 = (index == 0) ? trackPoints[0].position : trackPoints[index - 1].position;  // Previous point or first point
+    Vec3 p1 = trackPoints[index].position;  // Current point
+    Vec3 p2 = trackPoints[index + 1].position;  // Next point
+    Vec3 p3 = (index >= trackPoints.size() - 2) ? trackPoints[index + 1].position : trackPoints[index + 2].position;  // Next-to-next point or last point
+
+    // Perform Catmull-Rom spline interpolation to compute the exact train position
+    Vec3 trainPos = catmullRomSpline(p0, p1, p2, p3, segmentT);
+
+    // Compute the direction of movement by checking the train's position at the next step
+    float nextT = segmentT + 0.01f;
+    Vec3 nextPos = catmullRomSpline(p0, p1, p2, p3, nextT);
+
+    // Calculate the movement direction by subtracting the current position from the next position
+    Vec3 movementDirection = subtractVectors(nextPos, trainPos);
+    // Normalize the movement direction vector to obtain a unit vector
+    normalize(movementDirection);
+
+    // Return the computed train position
+    return trainPos;
+}
+
+// Function to draw a cube using OpenGL
+void drawBox() {
+    glBegin(GL_QUADS);  // Begin drawing quadrilateral faces
+
+    // Front face of the cube
+    // The normal vector is perpendicular to the face, pointing outwards
+    glNormal3f(0.0f, 0.0f, 1.0f);
+    glTexCoord2f(0.0f, 0.0f); glVertex3f(-0.5f, -0.5f, 0.5f);  // Bottom-left corner
+    glTexCoord2f(1.0f, 0.0f); glVertex3f(0.5f, -0.5f, 0.5f);   // Bottom-right corner
+    glTexCoord2f(1.0f, 1.0f); glVertex3f(0.5f, 0.5f, 0.5f);    // Top-right corner
+    glTexCoord2f(0.0f, 1.0f); glVertex3f(-0.5f, 0.5f, 0.5f);   // Top-left corner
+
+    // Back face of the cube
+    // The normal vector points in the opposite direction (into the screen)
+    glNormal3f(0.0f, 0.0f, -1.0f);
+    glTexCoord2f(1.0f, 0.0f); glVertex3f(-0.5f, -0.5f, -0.5f); // Bottom-left corner
+    glTexCoord2f(1.0f, 1.0f); glVertex3f(-0.5f, 0.5f, -0.5f);  // Top-left corner
+    glTexCoord2f(0.0f, 1.0f); glVertex3f(0.5f, 0.5f, -0.5f);   // Top-right corner
+    glTexCoord2f(0.0f, 0.0f); glVertex3f(0.5f, -0.5f, -0.5f);  // Bottom-right corner
+
+    // Top face of the cube
+    // Normal vector points upwards
+    glNormal3f(0.0f, 1.0f, 0.0f);
+    glTexCoord2f(0.0f, 1.0f); glVertex3f(-0.5f, 0.5f, -0.5f);  // Bottom-left corner
+    glTexCoord2f(0.0f, 0.0f); glVertex3f(-0.5f, 0.5f, 0.5f);   // Bottom-right corner
+    glTexCoord2f(1.0f, 0.0f); glVertex3f(0.5f, 0.5f, 0.5f);    // Top-right corner
+    glTexCoord2f(1.0f, 1.0f); glVertex3f(0.5f, 0.5f, -0.5f);   // Top-left corner
+
+    // Bottom face of the cube
+    // Normal vector points downwards
+    glNormal3f(0.0f, -1.0f, 0.0f);
+    glTexCoord2f(1.0f, 1.0f); glVertex3f(-0.5f, -0.5f, -0.5f); // Top-left corner
+    glTexCoord2f(0.0f, 1.0f); glVertex3f(0.5f, -0.5f, -0.5f);  // Top-right corner
+    glTexCoord2f(0.0f, 0.0f); glVertex3f(0.5f, -0.5f, 0.5f);   // Bottom-right corner
+    glTexCoord2f(1.0f, 0.0f); glVertex3f(-0.5f, -0.5f, 0.5f);  // Bottom-left corner
+
+    // Right face of the cube
+    // Normal vector points to the right
+    glNormal3f(1.0f, 0.0f, 0.0f);
+    glTexCoord2f(1.0f, 0.0f); glVertex3f(0.5f, -0.5f, -0.5f);  // Bottom-left corner
+    glTexCoord2f(1.0f, 1.0f); glVertex3f(0.5f, 0.5f, -0.5f);   // Top-left corner
+    glTexCoord2f(0.0f, 1.0f); glVertex3f(0.5f, 0.5f, 0.5f);    // Top-right corner
+    glTexCoord2f(0.0f, 0.0f); glVertex3f(0.5f, -0.5f, 0.5f);   // Bottom-right corner
+
+    // Left face of the cube
+    // Normal vector points to the left
+    glNormal3f(-1.0f, 0.0f, 0.0f);
+    glTexCoord2f(0.0f, 0.0f); glVertex3f(-0.5f, -0.5f, -0.5f); // Bottom-left corner
+    glTexCoord2f(1.0f, 0.0f); glVertex3f(-0.5f, -0.5f, 0.5f);  // Bottom-right corner
+    glTexCoord2f(1.0f, 1.0f); glVertex3f(-0.5f, 0.5f, 0.5f);   // Top-right corner
+    glTexCoord2f(0.0f, 1.0f); glVertex3f(-0.5f, 0.5f, -0.5f);  // Top-left corner
+
+    glEnd();  // End drawing quadrilateral faces
+}
+
+
+//=============================================================================
+// COASTER LAYOUT LOADING AND BAKE CACHE
+//=============================================================================
+
+/**
+ * Layout files describe the track as Catmull-Rom control points plus twist.
+ * Format (one statement per line, '#' starts a comment):
+ *   resolution <n>             track points generated per control segment
+ *   point <x> <y> <z> <twist>  control point in track space, twist in degrees
+ *
+ * Everything derived from a layout (frame table, tessellated track surface and
+ * support placements) is baked into a binary blob next to the layout, named by
+ * the hash of the layout text, and memory-mapped on later startups.
+ */
+
+const uint32_t COASTER_BAKE_VERSION = 5;               // Bump when the baked data changes
+const char COASTER_BAKE_MAGIC[4] = { 'C', 'S', 'T', 'R' };
+const int TRACK_SEGMENTS_PER_SECTION = 40;              // Dense samples per track segment before simplification
+const float TRACK_MAX_NORMAL_COS = 0.9986f;             // Keep a section when the normal turns more than ~3 degrees
+const float RAIL_GAUGE = 0.6f;                          // Rail offset from the track centreline
+const float RAIL_RADIUS = 0.2f;                         // Rail tube radius
+const int RAIL_SIDES = 8;                               // Facets around a rail tube
+const float SUPPORT_SPACING = 4.0f;                     // Arc length between support poles
+const float SUPPORT_MIN_HEIGHT = 1.0f;                  // Track lower than this needs no pole
+const float SUPPORT_POLE_RADIUS = 0.3f;                 // Support pole radius
+const float SUPPORT_BRACE_RADIUS = 0.12f;               // Cross-brace radius
+const int SUPPORT_POLE_SIDES = 12;                      // Facets around a pole
+const int SUPPORT_BRACE_SIDES = 6;                      // Facets around a brace
+
+// Interleaved vertex used by all baked coaster meshes
+struct CoasterVertex {
+    float position[3];
+    float normal[3];
+    float texCoord[2];
+};
+
+// Base position and height of a single support pole
+struct SupportPlacement {
+    float x, z;
+    float height;
+};
+
+// Header at the start of a baked coaster blob; the arrays follow in this order
+struct CoasterBakeHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t contentHash;
+    uint32_t frameCount;          // TrackPoint entries
+    uint32_t trackVertexCount;    // CoasterVertex entries of the track surface strip
+    uint32_t uniformVertexCount;  // Strip vertices a uniform tessellation would have needed
+    uint32_t supportCount;        // SupportPlacement entries
+    uint32_t supportVertexCount;  // CoasterVertex entries of the support triangle list
+    uint32_t railVertexCount;     // CoasterVertex entries of the rail rings
+    uint32_t railIndexCount;      // uint32_t triangle indices into the rail rings
+};
+
+// Baked geometry currently in use; arrays point into the mapping or owned buffer
+struct CoasterMesh {
+    MappedFile cacheFile;                    // Backing store when loaded from disk
+    std::vector<unsigned char> ownedBlob;    // Backing store when the cache could not be written
+    const CoasterVertex* trackVertices = nullptr;
+    size_t trackVertexCount = 0;
+    const SupportPlacement* supports = nullptr;
+    size_t supportCount = 0;
+    const CoasterVertex* supportVertices = nullptr;
+    size_t supportVertexCount = 0;
+    const CoasterVertex* railVertices = nullptr;
+    size_t railVertexCount = 0;
+    const uint32_t* railIndices = nullptr;
+    size_t railIndexCount = 0;
+};
+CoasterMesh coasterMesh;
+
+bool isInLoop(const TrackPoint& point);
+bool isOnSteepSlope(const TrackPoint& point);
+
+// Parse layout text and fill trackPoints; returns false if the text is unusable
+bool parseTrackLayout(const std::string& text, const std::string& sourceName) {
+    std::vector<TrackPoint> controlPoints;
+    int resolution = 1;
+
+    std::istringstream lines(text);
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(lines, line)) {
+        lineNumber++;
+        size_t comment = line.find('#');
+        if (comment != std::string::npos) line.erase(comment);
+
+        std::istringstream fields(line);
+        std::string keyword;
+        if (!(fields >> keyword)) continue;  // Blank or comment-only line
+
+        if (keyword == "resolution") {
+            if (!(fields >> resolution) || resolution < 1) {
+                std::cerr << sourceName << ":" << lineNumber << ": invalid resolution" << std::endl;
+                return false;
+            }
+        }
+        else if (keyword == "point") {
+            TrackPoint point;
+            if (!(fields >> point.position.x >> point.position.y >> point.position.z >> point.twist)) {
+                std::cerr << sourceName << ":" << lineNumber << ": expected 'point x y z twist'" << std::endl;
+                return false;
+            }
+            controlPoints.push_back(point);
+        }
+        else {
+            std::cerr << sourceName << ":" << lineNumber << ": unknown statement '" << keyword << "'" << std::endl;
+            return false;
+        }
+    }
+
+    if (controlPoints.size() < 2) {
+        std::cerr << sourceName << ": a layout needs at least two control points" << std::endl;
+        return false;
+    }
+
+    // Resample the control polygon into dense track points
+    CatmullRomBasis basis;
+    buildCatmullRomBasis(basis, resolution, 1.0f / resolution);
+    SplineSamples samples;
+    evaluateCatmullRomTable(controlPoints.data(), controlPoints.size(), basis, samples);
+
+    trackPoints.clear();
+    size_t last = controlPoints.size() - 1;
+    for (size_t i = 0; i < last; i++) {
+        for (int s = 0; s < resolution; s++) {
+            float t = (float)s / resolution;
+            TrackPoint point;
+            point.position = samples.position(i * resolution + s);
+            point.twist = controlPoints[i].twist + (controlPoints[i + 1].twist - controlPoints[i].twist) * t;
+            trackPoints.push_back(point);
+        }
+    }
+    trackPoints.push_back(controlPoints[last]);
+
+    calculateTrackNormals();
+    return true;
+}
+
+// Cross-section of the track surface at one dense sample
+struct TrackSection {
+    Vec3 center;        // Point on the spline
+    Vec3 left, right;   // Edge positions
+    Vec3 normal;        // Interpolated frame normal
+    Vec3 across;        // Unit vector from the left edge to the right edge
+    float v;            // Texture coordinate along the track
+};
+
+// Distance from point p to the segment a-b
+float distanceToSegment(const Vec3& p, const Vec3& a, const Vec3& b) {
+    Vec3 ab = subtractVectors(b, a);
+    Vec3 ap = subtractVectors(p, a);
+    float lengthSquared = dotProduct(ab, ab);
+    float t = (lengthSquared > 0.0f) ? std::max(0.0f, std::min(1.0f, dotProduct(ap, ab) / lengthSquared)) : 0.0f;
+    Vec3 offset = subtractVectors(ap, scaleVector(ab, t));
+    return sqrt(dotProduct(offset, offset));
+}
+
+// Check whether the strip quad from sections a to b still follows every section between them
+bool sectionSpanFits(const std::vector<TrackSection>& sections, size_t a, size_t b) {
+    // Twisting shows up as edge error; the normal limit keeps lighting smooth as well
+    if (dotProduct(sections[a].normal, sections[b].normal) < TRACK_MAX_NORMAL_COS) return false;
+
+    for (size_t k = a + 1; k < b; k++) {
+        if (distanceToSegment(sections[k].left, sections[a].left, sections[b].left) > trackTessellationTolerance ||
+            distanceToSegment(sections[k].right, sections[a].right, sections[b].right) > trackTessellationTolerance) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Samples the track cross-sections used by the surface and rail meshes
+ * The track is first sampled densely (TRACK_SEGMENTS_PER_SECTION per segment), then only the
+ * sections needed to keep both edges within trackTessellationTolerance of the dense curve are kept,
+ * so straight runs collapse to a few quads while loops and spirals keep full detail.
+ */
+void sampleTrackSections(std::vector<TrackSection>& kept, size_t& denseCount) {
+    const float trackWidth = 2.0f;
+    kept.clear();
+
+    // Evaluate every sample of every segment in one batch
+    const size_t samplesPerSegment = TRACK_SEGMENTS_PER_SECTION + 1;
+    CatmullRomBasis basis;
+    buildCatmullRomBasis(basis, samplesPerSegment, 1.0f / TRACK_SEGMENTS_PER_SECTION);
+    SplineSamples samples;
+    evaluateCatmullRomTable(trackPoints.data(), trackPoints.size(), basis, samples);
+
+    std::vector<TrackSection> sections;
+    for (size_t i = 0; i + 1 < trackPoints.size(); i++) {
+        // Consecutive segments share their end sample, so only the first segment emits t = 0
+        for (int j = (i == 0 ? 0 : 1); j <= TRACK_SEGMENTS_PER_SECTION; j++) {
+            float t = (float)j / TRACK_SEGMENTS_PER_SECTION;
+            Vec3 point = samples.position(i * samplesPerSegment + j);
+            Vec3 dir = samples.derivative(i * samplesPerSegment + j);
+
+            // Interpolate the frame normal between the two track points
+            Vec3 n1 = trackPoints[i].normal;
+            Vec3 n2 = trackPoints[i + 1].normal;
+            Vec3 normal = {
+                n1.x * (1 - t) + n2.x * t,
+                n1.y * (1 - t) + n2.y * t,
+                n1.z * (1 - t) + n2.z * t
+            };
+            normalize(normal);
+
+            // Offset across the track width
+            Vec3 right = crossProduct(dir, normal);
+            normalize(right);
+
+            // Texture coordinates keep increasing so the whole track is one strip
+            TrackSection section;
+            section.center = point;
+            section.left = subtractVectors(point, scaleVector(right, trackWidth));
+            section.right = addVectors(point, scaleVector(right, trackWidth));
+            section.normal = normal;
+            section.across = right;
+            section.v = (float)i + t;
+            sections.push_back(section);
+        }
+    }
+    denseCount = sections.size();
+    if (sections.empty()) return;
+
+    // Greedily extend each span as far as it fits, bounded so a bake stays cheap
+    const size_t maxSpan = 2 * TRACK_SEGMENTS_PER_SECTION;
+    kept.push_back(sections[0]);
+    size_t anchor = 0;
+    while (anchor + 1 < sections.size()) {
+        size_t end = anchor + 1;
+        while (end + 1 < sections.size() && end + 1 - anchor <= maxSpan && sectionSpanFits(sections, anchor, end + 1)) {
+            end++;
+        }
+        kept.push_back(sections[end]);
+        anchor = end;
+    }
+}
+
+// Build the track surface as a single triangle strip through the kept sections
+void bakeTrackSurface(const std::vector<TrackSection>& sections, std::vector<CoasterVertex>& vertices) {
+    vertices.clear();
+    for (const TrackSection& section : sections) {
+        CoasterVertex left = {
+            { section.left.x, section.left.y, section.left.z },
+            { section.normal.x, section.normal.y, section.normal.z },
+            { 0.0f, section.v }
+        };
+        CoasterVertex right = {
+            { section.right.x, section.right.y, section.right.z },
+            { section.normal.x, section.normal.y, section.normal.z },
+            { 1.0f, section.v }
+        };
+        vertices.push_back(left);
+        vertices.push_back(right);
+    }
+}
+
+/**
+ * Sweeps both rails as tubes along the kept sections
+ * Rails sit RAIL_GAUGE either side of the centreline in the local track frame; every ring is
+ * shared by the two quads it joins, so the rails are one indexed triangle list.
+ */
+void bakeTrackRails(const std::vector<TrackSection>& sections, std::vector<CoasterVertex>& vertices, std::vector<uint32_t>& indices) {
+    vertices.clear();
+    indices.clear();
+    if (sections.size() < 2) return;
+
+    const uint32_t ringSize = RAIL_SIDES + 1;  // Seam vertex repeated for texture wrap
+    for (int side = -1; side <= 1; side += 2) {
+        uint32_t firstRing = (uint32_t)vertices.size();
+
+        for (size_t i = 0; i < sections.size(); i++) {
+            const TrackSection& section = sections[i];
+
+            // Up axis of the local frame: the surface normal made perpendicular to the track direction
+            Vec3 tangent = subtractVectors(sections[i + 1 < sections.size() ? i + 1 : i].center,
+                sections[i > 0 ? i - 1 : i].center);
+            Vec3 up = crossProduct(section.across, tangent);
+            normalize(up);
+            if (dotProduct(up, section.normal) < 0.0f) up = scaleVector(up, -1.0f);
+
+            // Each ring lies in the plane of the up and sideways axes, offset sideways from the centreline
+            Vec3 railCenter = addVectors(section.center, scaleVector(section.across, side * RAIL_GAUGE));
+            for (int k = 0; k <= RAIL_SIDES; k++) {
+                float angle = 2.0f * M_PI * k / RAIL_SIDES;
+                Vec3 n = addVectors(scaleVector(up, cos(angle)), scaleVector(section.across, sin(angle)));
+                Vec3 p = addVectors(railCenter, scaleVector(n, RAIL_RADIUS));
+                CoasterVertex vertex = { { p.x, p.y, p.z }, { n.x, n.y, n.z }, { (float)k / RAIL_SIDES, section.v } };
+                vertices.push_back(vertex);
+            }
+        }
+
+        // Two triangles between each pair of neighbouring rings
+        for (uint32_t i = 0; i + 1 < sections.size(); i++) {
+            uint32_t ring = firstRing + i * ringSize;
+            uint32_t next = ring + ringSize;
+            for (uint32_t k = 0; k < RAIL_SIDES; k++) {
+                indices.push_back(ring + k);
+                indices.push_back(next + k);
+                indices.push_back(next + k + 1);
+                indices.push_back(ring + k);
+                indices.push_back(next + k + 1);
+                indices.push_back(ring + k + 1);
+            }
+        }
+    }
+}
+
+// Ground area kept clear of coaster supports, in world coordinates
+struct RideFootprint {
+    float x, z;
+    float radius;
+};
+
+// Footprints of the other attractions, matching the transforms used in displayCB
+std::vector<RideFootprint> getRideFootprints() {
+    return {
+        { (20.0f + ferrisWheelPosX) * 1.4f, ferrisWheelPosZ * 1.4f, 12.0f },  // Ferris wheel and its supports
+        { -35.0f, 0.0f, MAX_CHAIR_RADIUS + 3.0f },                          // Flying chair swing area
+        { TOWER_POSITION_X, TOWER_POSITION_Z, 6.0f },                       // First drop tower
+        { -TOWER_POSITION_X, TOWER_POSITION_Z, 6.0f },                      // Second drop tower
+        { -3.0f, -3.0f, 16.0f }                                             // House
+    };
+}
+
+// Map a track-space point to world space using the drawRollerCoaster transform
+Vec3 coasterToWorld(const Vec3& p) {
+    float angle = coasterRotationAngle * M_PI / 180.0f;
+    float dx = p.x - COASTER_START_X;
+    float dz = p.z - COASTER_START_Z;
+    float x = COASTER_START_X + dx * cos(angle) + dz * sin(angle);
+    float z = COASTER_START_Z - dx * sin(angle) + dz * cos(angle);
+    return Vec3(x * 0.85f, p.y * 0.65f, z * 0.65f);
+}
+
+// Check that a support standing at a track-space point does not intrude on another ride
+bool supportClearsRides(const Vec3& point, const std::vector<RideFootprint>& footprints) {
+    Vec3 world = coasterToWorld(point);
+    for (const RideFootprint& footprint : footprints) {
+        float dx = world.x - footprint.x;
+        float dz = world.z - footprint.z;
+        if (dx * dx + dz * dz < footprint.radius * footprint.radius) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Choose where support poles stand, spaced evenly by arc length along the track
+void bakeSupportPlacements(std::vector<SupportPlacement>& supports) {
+    std::vector<RideFootprint> footprints = getRideFootprints();
+    supports.clear();
+
+    float distance = 0.0f;      // Arc length travelled so far
+    float nextSupport = 0.0f;   // Arc length at which the next pole is due
+    for (size_t i = 0; i < trackPoints.size(); i++) {
+        if (i > 0) {
+            Vec3 step = subtractVectors(trackPoints[i].position, trackPoints[i - 1].position);
+            distance += sqrt(step.x * step.x + step.y * step.y + step.z * step.z);
+        }
+        if (distance < nextSupport) continue;
+
+        // Skip supports in special sections and near other rides; the pole is placed at the next valid point
+        const TrackPoint& point = trackPoints[i];
+        if (isInLoop(point) || isOnSteepSlope(point) || point.position.y < SUPPORT_MIN_HEIGHT ||
+            !supportClearsRides(point.position, footprints)) {
+            continue;
+        }
 
-    // Handle edge cases where the position exceeds track bounds
-    if (index >= trackPoints.size() - 1) {
-        // If the index exceeds the last point, return the position of the last point
-        return trackPoints.back().position;
+        supports.push_back({ point.position.x, point.position.z, point.position.y });
+        nextSupport = distance + SUPPORT_SPACING;
     }
-    if (index < 0) {
-        // If the index is negative, return the position of the first point
-        return trackPoints.front().position;
+}
+
+// Append an open cylinder from a to b as triangles
+void appendCylinder(std::vector<CoasterVertex>& vertices, const Vec3& a, const Vec3& b, float radius, int sides) {
+    Vec3 axis = subtractVectors(b, a);
+    float length = sqrt(axis.x * axis.x + axis.y * axis.y + axis.z * axis.z);
+    if (length <= 0.0f) return;
+    normalize(axis);
+
+    // Build two vectors perpendicular to the axis
+    Vec3 helper = (fabs(axis.y) < 0.9f) ? Vec3(0.0f, 1.0f, 0.0f) : Vec3(1.0f, 0.0f, 0.0f);
+    Vec3 u = crossProduct(axis, helper);
+    normalize(u);
+    Vec3 w = crossProduct(axis, u);
+
+    for (int k = 0; k < sides; k++) {
+        float angle0 = 2.0f * M_PI * k / sides;
+        float angle1 = 2.0f * M_PI * (k + 1) / sides;
+        Vec3 n0 = addVectors(scaleVector(u, cos(angle0)), scaleVector(w, sin(angle0)));
+        Vec3 n1 = addVectors(scaleVector(u, cos(angle1)), scaleVector(w, sin(angle1)));
+        float s0 = (float)k / sides;
+        float s1 = (float)(k + 1) / sides;
+
+        CoasterVertex bottom0 = { { a.x + n0.x * radius, a.y + n0.y * radius, a.z + n0.z * radius }, { n0.x, n0.y, n0.z }, { s0, 0.0f } };
+        CoasterVertex bottom1 = { { a.x + n1.x * radius, a.y + n1.y * radius, a.z + n1.z * radius }, { n1.x, n1.y, n1.z }, { s1, 0.0f } };
+        CoasterVertex top0 = { { b.x + n0.x * radius, b.y + n0.y * radius, b.z + n0.z * radius }, { n0.x, n0.y, n0.z }, { s0, length } };
+        CoasterVertex top1 = { { b.x + n1.x * radius, b.y + n1.y * radius, b.z + n1.z * radius }, { n1.x, n1.y, n1.z }, { s1, length } };
+
+        vertices.push_back(bottom0);
+        vertices.push_back(bottom1);
+        vertices.push_back(top1);
+        vertices.push_back(bottom0);
+        vertices.push_back(top1);
+        vertices.push_back(top0);
     }
+}
 
-    // Get the four track points surrounding the current position (for interpolation)
-    Vec3 p0 = (index == 0) ? trackPoints[0].position : trackPoints[index - 1].position;  // Previous point or first point
-    Vec3 p1 = trackPoints[index].position;  // Current point
-    Vec3 p2 = trackPoints[index + 1].position;  // Next point
-    Vec3 p3 = (index >= trackPoints.size() - 2) ? trackPoints[index + 1].position : trackPoints[index + 2].position;  // Next-to-next point or last point
+// Merge all support poles and the cross-braces between neighbours into one triangle list
+void bakeSupportMesh(const std::vector<SupportPlacement>& supports, std::vector<CoasterVertex>& vertices) {
+    vertices.clear();
 
-    // Perform Catmull-Rom spline interpolation to compute the exact train position
-    Vec3 trainPos = catmullRomSpline(p0, p1, p2, p3, segmentT);
+    for (size_t i = 0; i < supports.size(); i++) {
+        const SupportPlacement& support = supports[i];
+        appendCylinder(vertices, Vec3(support.x, 0.0f, support.z), Vec3(support.x, support.height, support.z),
+            SUPPORT_POLE_RADIUS, SUPPORT_POLE_SIDES);
 
-    // Compute the direction of movement by checking the train's position at the next step
-    float nextT = segmentT + 0.01f;
-    Vec3 nextPos = catmullRomSpline(p0, p1, p2, p3, nextT);
+        if (i == 0) continue;
 
-    // Calculate the movement direction by subtracting the current position from the next position
-    Vec3 movementDirection = subtractVectors(nextPos, trainPos);
-    // Normalize the movement direction vector to obtain a unit vector
-    normalize(movementDirection);
+        // Brace only direct neighbours; a wider gap means a loop or another ride lies between them
+        const SupportPlacement& previous = supports[i - 1];
+        float dx = support.x - previous.x;
+        float dz = support.z - previous.z;
+        if (dx * dx + dz * dz > (SUPPORT_SPACING * 1.5f) * (SUPPORT_SPACING * 1.5f)) continue;
 
-    // Return the computed train position
-    return trainPos;
+        float low = SUPPORT_MIN_HEIGHT;
+        float high = std::min(support.height, previous.height) * 0.8f;
+        if (high - low < 2.0f) continue;  // Too short to be worth bracing
+
+        appendCylinder(vertices, Vec3(previous.x, low, previous.z), Vec3(support.x, high, support.z),
+            SUPPORT_BRACE_RADIUS, SUPPORT_BRACE_SIDES);
+        appendCylinder(vertices, Vec3(previous.x, high, previous.z), Vec3(support.x, low, support.z),
+            SUPPORT_BRACE_RADIUS, SUPPORT_BRACE_SIDES);
+    }
 }
 
-// Function to draw a cube using OpenGL
-void drawBox() {
-    glBegin(GL_QUADS);  // Begin drawing quadrilateral faces
+// Serialize the current trackPoints and everything derived from them
+void bakeCoasterBlob(uint64_t contentHash, std::vector<unsigned char>& blob) {
+    std::vector<TrackSection> sections;
+    std::vector<CoasterVertex> trackVertices;
+    std::vector<CoasterVertex> railVertices;
+    std::vector<uint32_t> railIndices;
+    std::vector<SupportPlacement> supports;
+    std::vector<CoasterVertex> supportVertices;
+    size_t denseSectionCount = 0;
+    sampleTrackSections(sections, denseSectionCount);
+    bakeTrackSurface(sections, trackVertices);
+    bakeTrackRails(sections, railVertices, railIndices);
+    bakeSupportPlacements(supports);
+    bakeSupportMesh(supports, supportVertices);
+
+    CoasterBakeHeader header;
+    memcpy(header.magic, COASTER_BAKE_MAGIC, sizeof(header.magic));
+    header.version = COASTER_BAKE_VERSION;
+    header.contentHash = contentHash;
+    header.frameCount = (uint32_t)trackPoints.size();
+    header.trackVertexCount = (uint32_t)trackVertices.size();
+    header.uniformVertexCount = (uint32_t)(denseSectionCount * 2);
+    header.supportCount = (uint32_t)supports.size();
+    header.supportVertexCount = (uint32_t)supportVertices.size();
+    header.railVertexCount = (uint32_t)railVertices.size();
+    header.railIndexCount = (uint32_t)railIndices.size();
+
+    // Arrays follow the header in the order attachCoasterBlob reads them
+    blob.clear();
+    appendBlob(blob, &header, sizeof(header));
+    appendBlob(blob, trackPoints.data(), trackPoints.size() * sizeof(TrackPoint));
+    appendBlob(blob, trackVertices.data(), trackVertices.size() * sizeof(CoasterVertex));
+    appendBlob(blob, supports.data(), supports.size() * sizeof(SupportPlacement));
+    appendBlob(blob, supportVertices.data(), supportVertices.size() * sizeof(CoasterVertex));
+    appendBlob(blob, railVertices.data(), railVertices.size() * sizeof(CoasterVertex));
+    appendBlob(blob, railIndices.data(), railIndices.size() * sizeof(uint32_t));
+}
 
-    // Front face of the cube
-    // The normal vector is perpendicular to the face, pointing outwards
-    glNormal3f(0.0f, 0.0f, 1.0f);
-    glTexCoord2f(0.0f, 0.0f); glVertex3f(-0.5f, -0.5f, 0.5f);  // Bottom-left corner
-    glTexCoord2f(1.0f, 0.0f); glVertex3f(0.5f, -0.5f, 0.5f);   // Bottom-right corner
-    glTexCoord2f(1.0f, 1.0f); glVertex3f(0.5f, 0.5f, 0.5f);    // Top-right corner
-    glTexCoord2f(0.0f, 1.0f); glVertex3f(-0.5f, 0.5f, 0.5f);   // Top-left corner
+// Point coasterMesh at a baked blob; copies the frame table into trackPoints
+bool attachCoasterBlob(const unsigned char* bytes, size_t size, uint64_t contentHash) {
+    if (size < sizeof(CoasterBakeHeader)) return false;
 
-    // Back face of the cube
-    // The normal vector points in the opposite direction (into the screen)
-    glNormal3f(0.0f, 0.0f, -1.0f);
-    glTexCoord2f(1.0f, 0.0f); glVertex3f(-0.5f, -0.5f, -0.5f); // Bottom-left corner
-    glTexCoord2f(1.0f, 1.0f); glVertex3f(-0.5f, 0.5f, -0.5f);  // Top-left corner
-    glTexCoord2f(0.0f, 1.0f); glVertex3f(0.5f, 0.5f, -0.5f);   // Top-right corner
-    glTexCoord2f(0.0f, 0.0f); glVertex3f(0.5f, -0.5f, -0.5f);  // Bottom-right corner
+    CoasterBakeHeader header;
+    memcpy(&header, bytes, sizeof(header));
+    if (memcmp(header.magic, COASTER_BAKE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != COASTER_BAKE_VERSION || header.contentHash != contentHash) {
+        return false;
+    }
 
-    // Top face of the cube
-    // Normal vector points upwards
-    glNormal3f(0.0f, 1.0f, 0.0f);
-    glTexCoord2f(0.0f, 1.0f); glVertex3f(-0.5f, 0.5f, -0.5f);  // Bottom-left corner
-    glTexCoord2f(0.0f, 0.0f); glVertex3f(-0.5f, 0.5f, 0.5f);   // Bottom-right corner
-    glTexCoord2f(1.0f, 0.0f); glVertex3f(0.5f, 0.5f, 0.5f);    // Top-right corner
-    glTexCoord2f(1.0f, 1.0f); glVertex3f(0.5f, 0.5f, -0.5f);   // Top-left corner
+    size_t frameBytes = (size_t)header.frameCount * sizeof(TrackPoint);
+    size_t vertexBytes = (size_t)header.trackVertexCount * sizeof(CoasterVertex);
+    size_t supportBytes = (size_t)header.supportCount * sizeof(SupportPlacement);
+    size_t supportVertexBytes = (size_t)header.supportVertexCount * sizeof(CoasterVertex);
+    size_t railVertexBytes = (size_t)header.railVertexCount * sizeof(CoasterVertex);
+    size_t railIndexBytes = (size_t)header.railIndexCount * sizeof(uint32_t);
+    if (size != sizeof(header) + frameBytes + vertexBytes + supportBytes + supportVertexBytes +
+        railVertexBytes + railIndexBytes || header.frameCount < 2) {
+        return false;
+    }
 
-    // Bottom face of the cube
-    // Normal vector points downwards
-    glNormal3f(0.0f, -1.0f, 0.0f);
-    glTexCoord2f(1.0f, 1.0f); glVertex3f(-0.5f, -0.5f, -0.5f); // Top-left corner
-    glTexCoord2f(0.0f, 1.0f); glVertex3f(0.5f, -0.5f, -0.5f);  // Top-right corner
-    glTexCoord2f(0.0f, 0.0f); glVertex3f(0.5f, -0.5f, 0.5f);   // Bottom-right corner
-    glTexCoord2f(1.0f, 0.0f); glVertex3f(-0.5f, -0.5f, 0.5f);  // Bottom-left corner
+    const unsigned char* cursor = bytes + sizeof(header);
+    trackPoints.resize(header.frameCount);
+    memcpy(trackPoints.data(), cursor, frameBytes);
+    cursor += frameBytes;
 
-    // Right face of the cube
-    // Normal vector points to the right
-    glNormal3f(1.0f, 0.0f, 0.0f);
-    glTexCoord2f(1.0f, 0.0f); glVertex3f(0.5f, -0.5f, -0.5f);  // Bottom-left corner
-    glTexCoord2f(1.0f, 1.0f); glVertex3f(0.5f, 0.5f, -0.5f);   // Top-left corner
-    glTexCoord2f(0.0f, 1.0f); glVertex3f(0.5f, 0.5f, 0.5f);    // Top-right corner
-    glTexCoord2f(0.0f, 0.0f); glVertex3f(0.5f, -0.5f, 0.5f);   // Bottom-right corner
+    coasterMesh.trackVertices = reinterpret_cast<const CoasterVertex*>(cursor);
+    coasterMesh.trackVertexCount = header.trackVertexCount;
+    cursor += vertexBytes;
 
-    // Left face of the cube
-    // Normal vector points to the left
-    glNormal3f(-1.0f, 0.0f, 0.0f);
-    glTexCoord2f(0.0f, 0.0f); glVertex3f(-0.5f, -0.5f, -0.5f); // Bottom-left corner
-    glTexCoord2f(1.0f, 0.0f); glVertex3f(-0.5f, -0.5f, 0.5f);  // Bottom-right corner
-    glTexCoord2f(1.0f, 1.0f); glVertex3f(-0.5f, 0.5f, 0.5f);   // Top-right corner
-    glTexCoord2f(0.0f, 1.0f); glVertex3f(-0.5f, 0.5f, -0.5f);  // Top-left corner
+    coasterMesh.supports = reinterpret_cast<const SupportPlacement*>(cursor);
+    coasterMesh.supportCount = header.supportCount;
+    cursor += supportBytes;
 
-    glEnd();  // End drawing quadrilateral faces
+    coasterMesh.supportVertices = reinterpret_cast<const CoasterVertex*>(cursor);
+    coasterMesh.supportVertexCount = header.supportVertexCount;
+    cursor += supportVertexBytes;
+
+    coasterMesh.railVertices = reinterpret_cast<const CoasterVertex*>(cursor);
+    coasterMesh.railVertexCount = header.railVertexCount;
+    cursor += railVertexBytes;
+
+    coasterMesh.railIndices = reinterpret_cast<const uint32_t*>(cursor);
+    coasterMesh.railIndexCount = header.railIndexCount;
+
+    std::cout << "Coaster track: " << header.trackVertexCount << " vertices ("
+        << header.uniformVertexCount << " with uniform tessellation, tolerance "
+        << trackTessellationTolerance << ")" << std::endl;
+    return true;
+}
+
+// Load the coaster layout, preferring a warm bake cache over re-tessellating
+void loadCoasterLayout(const std::string& layoutPath) {
+    coasterMesh.cacheFile.close();
+    coasterMesh.ownedBlob.clear();
+
+    std::string layoutText;
+    bool haveLayout = readTextFile(layoutPath, layoutText);
+    if (!haveLayout) {
+        std::cerr << "Unable to open coaster layout " << layoutPath << ", using the built-in track." << std::endl;
+        layoutText = "builtin";
+    }
+
+    // Key the cache by layout content and by the tessellation settings
+    uint64_t contentHash = fnv1a64(layoutText.data(), layoutText.size());
+    contentHash = fnv1a64(&COASTER_BAKE_VERSION, sizeof(COASTER_BAKE_VERSION), contentHash);
+    contentHash = fnv1a64(&TRACK_SEGMENTS_PER_SECTION, sizeof(TRACK_SEGMENTS_PER_SECTION), contentHash);
+    contentHash = fnv1a64(&trackTessellationTolerance, sizeof(trackTessellationTolerance), contentHash);
+    contentHash = fnv1a64(&SUPPORT_SPACING, sizeof(SUPPORT_SPACING), contentHash);
+    contentHash = fnv1a64(&coasterRotationAngle, sizeof(coasterRotationAngle), contentHash);
+    std::vector<RideFootprint> footprints = getRideFootprints();
+    contentHash = fnv1a64(footprints.data(), footprints.size() * sizeof(RideFootprint), contentHash);
+
+    char hashName[32];
+    snprintf(hashName, sizeof(hashName), "%016llx", (unsigned long long)contentHash);
+    size_t slash = layoutPath.find_last_of("/\\");
+    std::string directory = (slash == std::string::npos) ? std::string() : layoutPath.substr(0, slash + 1);
+    std::string cachePath = directory + "coaster-" + hashName + ".bake";
+
+    // Warm path: map the cache and use it in place
+    if (coasterMesh.cacheFile.open(cachePath.c_str()) &&
+        attachCoasterBlob(coasterMesh.cacheFile.data, coasterMesh.cacheFile.size, contentHash)) {
+        return;
+    }
+    coasterMesh.cacheFile.close();
+
+    // Cold path: build the track points, bake, and try to persist the result
+    bool parsed = haveLayout && parseTrackLayout(layoutText, layoutPath);
+    if (!parsed) {
+        initializeTrackPoints();
+    }
+
+    // A broken layout is baked but not cached, so its parse error is reported on every run
+    std::vector<unsigned char> blob;
+    bakeCoasterBlob(contentHash, blob);
+    if (parsed && writeBinaryFile(cachePath, blob.data(), blob.size()) &&
+        coasterMesh.cacheFile.open(cachePath.c_str()) &&
+        attachCoasterBlob(coasterMesh.cacheFile.data, coasterMesh.cacheFile.size, contentHash)) {
+        return;
+    }
+
+    coasterMesh.cacheFile.close();
+    coasterMesh.ownedBlob.swap(blob);
+    attachCoasterBlob(coasterMesh.ownedBlob.data(), coasterMesh.ownedBlob.size(), contentHash);
 }
 
 
@@ -5776,13 +9172,35 @@ void drawBox() {
 // TRACK VISUALIZATION AND RENDERING
 //=============================================================================
 
+// Draw baked interleaved vertices with a single call, indexed when indices are given
+void drawCoasterVertices(GLenum mode, const CoasterVertex* vertices, size_t count,
+    const uint32_t* indices = nullptr, size_t indexCount = 0) {
+    if (vertices == nullptr || count == 0) return;
+
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_NORMAL_ARRAY);
+    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+    glVertexPointer(3, GL_FLOAT, sizeof(CoasterVertex), vertices->position);
+    glNormalPointer(GL_FLOAT, sizeof(CoasterVertex), vertices->normal);
+    glTexCoordPointer(2, GL_FLOAT, sizeof(CoasterVertex), vertices->texCoord);
+
+    if (indices != nullptr) {
+        glDrawElements(mode, (GLsizei)indexCount, GL_UNSIGNED_INT, indices);
+    }
+    else {
+        glDrawArrays(mode, 0, (GLsizei)count);
+    }
+
+    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+    glDisableClientState(GL_NORMAL_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+}
+
 /**
  * Draws the main track structure with textures and lighting
  * Rendering process:
  * 1. Apply track texture
- * 2. Generate quad strips for track surface
- * 3. Calculate proper normals for lighting
- * 4. Apply texture coordinates for mapping
+ * 2. Draw the baked track surface strip in a single call
  */
 void drawCoasterTrack() {
     // DEBUG: Track rendering
@@ -5792,61 +9210,10 @@ void drawCoasterTrack() {
 #endif
 
     glEnable(GL_TEXTURE_2D);
-    glBindTexture(GL_TEXTURE_2D, texVec[43]);
-
-    const float trackWidth = 2.0f;
-    const int segmentsPerSection = 40;
-
-    // Iterate through track points to create track surface
-    for (size_t i = 0; i < trackPoints.size() - 1; i++) {
-        // Get control points for spline segment
-        Vec3 p0 = (i == 0) ? trackPoints[0].position : trackPoints[i - 1].position;
-        Vec3 p1 = trackPoints[i].position;
-        Vec3 p2 = trackPoints[i + 1].position;
-        Vec3 p3 = (i == trackPoints.size() - 2) ? trackPoints[i + 1].position : trackPoints[i + 2].position;
-
-        // Create quad strip for track segment
-        glBegin(GL_QUAD_STRIP);
-        for (int j = 0; j <= segmentsPerSection; j++) {
-            float t = (float)j / segmentsPerSection;
-
-            // Calculate current point and next point for direction
-            Vec3 currentPoint = catmullRomSpline(p0, p1, p2, p3, t);
-            Vec3 nextPoint = (j < segmentsPerSection) ?
-                catmullRomSpline(p0, p1, p2, p3, (float)(j + 1) / segmentsPerSection) :
-                p2;
-
-            // Calculate track orientation vectors
-            Vec3 dir = subtractVectors(nextPoint, currentPoint);
-            Vec3 n1 = trackPoints[i].normal;
-            Vec3 n2 = trackPoints[i + 1].normal;
+    bindTexture2D(trackTexture);
 
-            // Interpolate normal vector
-            float blend = t;
-            Vec3 currentNormal = {
-                n1.x * (1 - blend) + n2.x * blend,
-                n1.y * (1 - blend) + n2.y * blend,
-                n1.z * (1 - blend) + n2.z * blend
-            };
-            normalize(currentNormal);
-
-            // Calculate right vector for track width
-            Vec3 right = crossProduct(dir, currentNormal);
-            normalize(right);
-
-            // Generate track vertices with texture coordinates
-            glTexCoord2f(0.0f, t);
-            glVertex3f(currentPoint.x - right.x * trackWidth,
-                currentPoint.y - right.y * trackWidth,
-                currentPoint.z - right.z * trackWidth);
-
-            glTexCoord2f(1.0f, t);
-            glVertex3f(currentPoint.x + right.x * trackWidth,
-                currentPoint.y + right.y * trackWidth,
-                currentPoint.z + right.z * trackWidth);
-        }
-        glEnd();
-    }
+    // The whole surface was tessellated into one strip when the layout was baked
+    drawCoasterVertices(GL_TRIANGLE_STRIP, coasterMesh.trackVertices, coasterMesh.trackVertexCount);
 
     glDisable(GL_TEXTURE_2D);
 }
@@ -5855,29 +9222,6 @@ void drawCoasterTrack() {
 // SUPPORT STRUCTURE GENERATION AND RENDERING
 //=============================================================================
 
-/**
- * Draws a single support pole for the track
- * @param baseX,baseY,baseZ: Base position of the support pole
- * @param height: Height of the support pole
- */
-void drawSupportPole(float baseX, float baseY, float baseZ, float height) {
-    const float poleRadius = 0.3f;  // Support pole radius
-
-    // Save current matrix state
-    glPushMatrix();
-    glTranslatef(baseX, baseY, baseZ);
-    glRotatef(-90, 1, 0, 0);  // Rotate to align with Y axis
-
-    // Create and render support pole
-    GLUquadric* quad = gluNewQuadric();
-    gluQuadricTexture(quad, GL_TRUE);
-    glColor4f(0.8f, 0.8f, 0.8f, 0.2f);  // Set pole color
-    gluCylinder(quad, poleRadius, poleRadius, height, 16, 16);
-    gluDeleteQuadric(quad);
-
-    glPopMatrix();
-}
-
 /**
  * Checks if a track point is within the loop section
  * @param point: Track point to check
@@ -5914,87 +9258,37 @@ bool isOnSteepSlope(const TrackPoint& point) {
 
 /**
  * Draws support structures for the entire coaster track
- * Support placement logic:
- * 1. Skip supports in loop sections
- * 2. Skip supports on steep slopes
- * 3. Place supports at regular intervals
+ * Poles and cross-braces were placed and merged into one mesh at bake time:
+ * 1. Supports are spaced evenly by arc length
+ * 2. Loops, steep slopes and other rides' footprints are kept clear
  */
 void drawCoasterSupports() {
     // DEBUG: Support structure rendering
 #ifdef DEBUG_SUPPORT_RENDERING
-    int supportCount = 0;
+    std::cout << "Total supports placed: " << coasterMesh.supportCount
+        << " (" << coasterMesh.supportVertexCount << " vertices)" << std::endl;
 #endif
 
     glEnable(GL_TEXTURE_2D);
-    glBindTexture(GL_TEXTURE_2D, texVec[44]);  // Support texture
-
-    // Iterate through track points
-    for (size_t i = 0; i < trackPoints.size(); i++) {
-        Vec3 p = trackPoints[i].position;
-
-        // Skip supports in special sections
-        if (!isInLoop(trackPoints[i]) && !isOnSteepSlope(trackPoints[i])) {
-            drawSupportPole(p.x, 0.0f, p.z, p.y);
+    bindTexture2D(NO_TEXTURE);  // Plain grey; no support texture is loaded
 
-#ifdef DEBUG_SUPPORT_RENDERING
-            supportCount++;
-#endif
-        }
-    }
-
-#ifdef DEBUG_SUPPORT_RENDERING
-    std::cout << "Total supports placed: " << supportCount << std::endl;
-#endif
+    glColor4f(0.8f, 0.8f, 0.8f, 0.2f);  // Set pole color
+    drawCoasterVertices(GL_TRIANGLES, coasterMesh.supportVertices, coasterMesh.supportVertexCount);
 
     glDisable(GL_TEXTURE_2D);
 }
 
 /**
  * Draws the track rails using metal texture
- * Rail rendering process:
- * 1. Apply metal texture
- * 2. Generate parallel rails
- * 3. Add proper lighting and materials
+ * Both rails were swept along the spline at bake time and share one indexed mesh.
  */
-void drawRail(const Vec3& start, const Vec3& end, float railRadius) {
-    Vec3 direction = { end.x - start.x, end.y - start.y, end.z - start.z };
-    float length = sqrt(direction.x * direction.x + direction.y * direction.y + direction.z * direction.z);
-
-    glPushMatrix();
-    glTranslatef(start.x, start.y, start.z);
-
-
-    float angle = acos(direction.y / length) * 180.0f / M_PI;
-    float axisX = -direction.z;
-    float axisZ = direction.x;
-
-    glRotatef(angle, axisX, 0, axisZ);
-
-    GLUquadric* quad = gluNewQuadric();
-    gluQuadricTexture(quad, GL_TRUE);
-    gluCylinder(quad, railRadius, railRadius, length, 16, 16);
-    gluDeleteQuadric(quad);
-
-    glPopMatrix();
-}
 void drawTrackRails() {
-    const float railRadius = 1.0f;  // Rail thickness
-
     // Enable texturing for rails
     glEnable(GL_TEXTURE_2D);
-    glBindTexture(GL_TEXTURE_2D, texVec[42]);  // Metal texture
-
-    // Iterate through track points
-    for (size_t i = 0; i < trackPoints.size() - 1; i++) {
-        Vec3 p1 = trackPoints[i].position;
-        Vec3 p2 = trackPoints[i + 1].position;
+    bindTexture2D(metalTexture);  // Metal texture
 
-        // Draw parallel rails
-        drawRail({ p1.x - 0.5f, p1.y, p1.z },
-            { p2.x - 0.5f, p2.y, p2.z }, railRadius);
-        drawRail({ p1.x + 0.5f, p1.y, p1.z },
-            { p2.x + 0.5f, p2.y, p2.z }, railRadius);
-    }
+    drawCoasterVertices(GL_TRIANGLES, coasterMesh.railVertices, coasterMesh.railVertexCount,
+        coasterMesh.railIndices, coasterMesh.railIndexCount);
 
     glDisable(GL_TEXTURE_2D);
 }
@@ -6003,8 +9297,8 @@ void drawTrackRails() {
 void drawTrackSupports() {
     // Enable 2D texture mapping
     glEnable(GL_TEXTURE_2D);
-    // Bind the texture identified by texVec[44]
-    glBindTexture(GL_TEXTURE_2D, texVec[44]);
+    // Supports are untextured; no support texture is loaded
+    bindTexture2D(NO_TEXTURE);
 
     // Define the spacing between the main support pillars
     const int supportInterval = 40;  // Distance between each support pillar
@@ -6021,7 +9315,7 @@ void drawTrackSupports() {
 // Function to draw safety bars for the ride's seating area
 void drawSafetyBars(float seatWidth, float seatDepth) {
     // Bind the texture for the metal appearance of the bars
-    glBindTexture(GL_TEXTURE_2D, texVec[42]); // Metal texture
+    bindTexture2D(metalTexture); // Metal texture
 
     // Define the color of the safety bars (gray)
     GLfloat bar_color[] = { 0.7f, 0.7f, 0.7f, 1.0f };
@@ -6069,7 +9363,7 @@ void drawSeats() {
     // Enable 2D texture mapping for the seat textures
     glEnable(GL_TEXTURE_2D);
     // Bind the texture for the seat surface
-    glBindTexture(GL_TEXTURE_2D, texVec[41]); // Seat texture
+    bindTexture2D(NO_TEXTURE); // Seats use their material colour; no seat texture is loaded
 
     // Define the dimensions of each seat
     const float seatWidth = CARRIAGE_WIDTH * 0.4f; // Seat width is 40% of carriage width
@@ -6134,7 +9428,7 @@ void drawWheels(float length, float width, float radius) {
     // Enable texture mapping for the quadric object
     gluQuadricTexture(quad, GL_TRUE);
     // Bind the texture for the wheels (metal texture)
-    glBindTexture(GL_TEXTURE_2D, texVec[42]); // Use metal texture
+    bindTexture2D(metalTexture); // Use metal texture
 
     // Calculate the offset for the wheel positions along the length of the vehicle
     const float wheelOffset = length * 0.4f;
@@ -6171,7 +9465,7 @@ void drawCarriageBody() {
     // Enable 2D texture mapping for the carriage body
     glEnable(GL_TEXTURE_2D);
     // Bind the texture for the carriage body (main texture for the body)
-    glBindTexture(GL_TEXTURE_2D, texVec[40]); // Texture for the carriage body
+    bindTexture2D(trainTexture); // Texture for the carriage body
 
     // Set material properties for the metal surface of the carriage body
     GLfloat metal_ambient[] = { 0.3f, 0.3f, 0.3f, 1.0f };   // Ambient reflection color
@@ -6223,7 +9517,7 @@ void drawCoasterTrain() {
     // Draw the train carriage with texture mapping enabled
     glEnable(GL_TEXTURE_2D);
     // Bind the texture for the train body (main texture for the body)
-    glBindTexture(GL_TEXTURE_2D, texVec[40]); // Texture for the carriage body
+    bindTexture2D(trainTexture); // Texture for the carriage body
 
     // Draw the main body of the train (carriage frame)
     glPushMatrix();
@@ -6234,7 +9528,7 @@ void drawCoasterTrain() {
     glPopMatrix();
 
     // Draw the seats inside the carriage
-    glBindTexture(GL_TEXTURE_2D, texVec[41]); // Texture for the seats
+    bindTexture2D(NO_TEXTURE); // Seats use their material colour
     for (int i = 0; i < 4; i++) {
         // Draw each seat at different positions along the z-axis
         glPushMatrix();
@@ -6314,71 +9608,801 @@ void updateCoasterTrain(float deltaTime) {
     const TrackPoint& p1 = trackPoints[currentIndex];       // Current track point
     const TrackPoint& p2 = trackPoints[currentIndex + 1];   // Next track point
 
-    // Interpolate the position and direction of the train based on the current and next track points
-    currentTrain.position = {
-        p1.position.x + (p2.position.x - p1.position.x) * t,   // Interpolated X position
-        p1.position.y + (p2.position.y - p1.position.y) * t,   // Interpolated Y position
-        p1.position.z + (p2.position.z - p1.position.z) * t    // Interpolated Z position
-    };
+    // Interpolate the position and direction of the train based on the current and next track points
+    currentTrain.position = {
+        p1.position.x + (p2.position.x - p1.position.x) * t,   // Interpolated X position
+        p1.position.y + (p2.position.y - p1.position.y) * t,   // Interpolated Y position
+        p1.position.z + (p2.position.z - p1.position.z) * t    // Interpolated Z position
+    };
+
+    // Compute the train's speed based on the height difference (gravitational acceleration)
+    float heightDiff = p2.position.y - p1.position.y; // Calculate the height difference between consecutive points
+    currentTrain.speed = std::max(MIN_SPEED,   // Ensure the speed is within the minimum speed limit
+        std::min(MAX_SPEED,                  // Ensure the speed is within the maximum speed limit
+            currentTrain.speed - heightDiff * GRAVITY * deltaTime));  // Adjust speed based on gravity
+
+    // Update the train's orientation (twist) based on the interpolation between the current and next track points
+    float twist = p1.twist + (p2.twist - p1.twist) * t;  // Interpolate the twist (orientation) between p1 and p2
+    currentTrain.orientation = twist;  // Set the new orientation for the train
+}
+
+// Overall rotation angle (in degrees), can be adjusted as needed
+
+
+
+// Function to draw the roller coaster with its components
+void drawRollerCoaster() {
+    PROFILE_PASS(PROFILE_ROLLER_COASTER);
+    // Apply transformations to the roller coaster model
+    glPushMatrix();
+    glScalef(0.85, 0.65, 0.65);  // Scale the model to adjust size
+
+    // First apply the overall rotation
+    glTranslatef(COASTER_START_X, 0, COASTER_START_Z);  // Translate the model to the starting position of the track
+    glRotatef(coasterRotationAngle, 0, 1, 0);            // Apply rotation around the Y-axis for the coaster's orientation
+    glTranslatef(-COASTER_START_X, 0, -COASTER_START_Z); // Translate the model back to its original position after rotation
+
+    // Set fixed material properties for the coaster
+    GLfloat material_diffuse[] = { 0.8f, 0.2f, 0.2f, 1.0f }; // Diffuse color (red)
+    GLfloat material_specular[] = { 0.5f, 0.5f, 0.5f, 1.0f }; // Specular reflection (gray)
+    GLfloat material_shininess[] = { 30.0f };                  // Shininess coefficient
+
+    // Apply material properties to the front face
+    glMaterialfv(GL_FRONT, GL_DIFFUSE, material_diffuse);
+    glMaterialfv(GL_FRONT, GL_SPECULAR, material_specular);
+    glMaterialfv(GL_FRONT, GL_SHININESS, material_shininess);
+
+    glColor3f(1, 1, 1);  // Set the color to white
+
+    // Draw the supporting structure of the roller coaster
+    drawCoasterSupports();
+
+    // Draw the roller coaster track
+    drawCoasterTrack();
+    drawTrackRails();
+
+    // Draw the roller coaster train (after transformations)
+    drawCoasterTrain();
+
+    // Pop the transformation matrix to revert to the previous state
+    glPopMatrix();
+}
+
+//=============================================================================
+// WORLD STATE SNAPSHOTS
+//=============================================================================
+
+/**
+ * F5 writes the simulation state (character, rides, weather, particle pools, Snake game) to
+ * world.state and F9 reads it back; --state <file> loads one at startup, windowed or under
+ * --bench, so a profiling run can begin mid-storm with every ride busy instead of playing up
+ * to it. The file is a header, one WorldState block of scalars and the variable-length pools
+ * as raw arrays, each copied with a single write or memcpy. Start times are stored as seconds
+ * elapsed, so a snapshot resumes correctly on either scene clock. The layout is the in-memory
+ * one of this build; bump WORLD_STATE_VERSION whenever a saved struct changes.
+ */
+
+const uint32_t WORLD_STATE_VERSION = 3;
+const char WORLD_STATE_MAGIC[4] = { 'W', 'S', 'T', 'A' };
+std::string worldStatePath = "world.state";   // F5/F9 file, or the one given with --state
+bool loadStateAtStartup = false;              // --state; ignored by golden frames
+
+// Every fixed-size piece of the simulation, written as one block
+struct WorldState {
+    // Camera
+    float cameraAngleX, cameraAngleY, cameraDistance, shakeIntensity;
+
+    // Character, animation and jump/fall state
+    float manPositionX, manPositionY, manPositionZ, manRotationAngle;
+    bool isWalking, isRunning, isJumping, isFalling, isAlternateTexture;
+    float limbSwing, limbSwingDirection;
+    float shoulderAngle, elbowAngle, hipAngle, kneeAngle;
+    float jumpElapsed, jumpStartX, jumpStartY, jumpStartZ;
+    float jumpVelocityX, jumpVelocityY, jumpVelocityZ;
+    float fallElapsed, fallInitialX, fallInitialY, fallInitialZ;
+    float fallVelocityX, fallVelocityY, fallVelocityZ;
+
+    // House
+    float doorAngle, arrowPositionY, arrowDirection;
+    bool doorOpen, spotlightsEnabled;
+
+    // Weather
+    bool isFadingSky, useCloudySky, isRaining, isLightningActive, lightningBoltActive;
+    float skyFadeProgress, skyFadeElapsed, sceneBrightness;
+    float lightningDuration, lightningTimer, lightningBoltDuration, lightningBoltElapsed;
+
+    // Ferris wheel and coaster
+    bool ferrisWheelLightsOn, isCoasterRunning, isRidingCoaster, isCoasterActive, isTransitioningCamera;
+    float coasterSpeed, trainPosition, originalTrainPosition;
+    float cameraTransitionProgress;
+    Vec3 lastPlayerPosition, transitionStartPos, transitionStartLook;
+    TrainState currentTrain;
+    TrainDirection currentDirection, nextDirection;
+
+    // Flying chair
+    bool isRidingChair, isAggregating, oscillateDirection;
+    float chairCurrentX, chairCurrentY, chairCurrentZ;
+    float flyingChairRotationAngle, additionalRotationAngle, chairTurntableAngle;
+    float oscillateAngle, tiltAngle, alpha, currentChairRadius;
+
+    // Snake game
+    GameState currentGameState;
+    Direction snakeDir;
+    Position snakeFood, snakeFireworksPosition;
+    bool snakeGameOver, snakeGameStarted, snakeTriggerFireworks;
+};
+
+// Header at the start of a world state file; WorldState and the arrays follow in this order
+struct WorldStateHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t stateBytes;            // sizeof(WorldState) of the build that wrote it
+    uint32_t seed;                  // srand() seed for the simulation after loading
+    uint32_t rainCount;             // RainParticle entries
+    uint32_t towerParticleCount;    // TowerParticle entries
+    uint32_t entityCount;           // Attraction component masks
+    uint32_t transformCount;        // Items of each dense component array, in entity order
+    uint32_t rideAnimatorCount;
+    uint32_t wheelAnimatorCount;
+    uint32_t lightRigCount;
+    uint32_t emitterCount;
+    uint32_t renderableCount;
+    uint32_t towerLightCount;       // TowerLight entries
+    uint32_t snakeSegmentCount;     // Position entries of the snake body
+    uint32_t fireworkCount;         // SnakeParticle entries
+    uint32_t lightningPointCount;   // Vec3 entries of the current lightning bolt
+};
+
+void captureWorldState(WorldState& state) {
+    float now = sceneSeconds();
+    state.cameraAngleX = cameraAngleX;
+    state.cameraAngleY = cameraAngleY;
+    state.cameraDistance = cameraDistance;
+    state.shakeIntensity = shakeIntensity;
+
+    state.manPositionX = manPositionX;
+    state.manPositionY = manPositionY;
+    state.manPositionZ = manPositionZ;
+    state.manRotationAngle = manRotationAngle;
+    state.isWalking = isWalking;
+    state.isRunning = isRunning;
+    state.isJumping = isJumping;
+    state.isFalling = isFalling;
+    state.isAlternateTexture = isAlternateTexture;
+    state.limbSwing = limbSwing;
+    state.limbSwingDirection = limbSwingDirection;
+    state.shoulderAngle = shoulderAngle;
+    state.elbowAngle = elbowAngle;
+    state.hipAngle = hipAngle;
+    state.kneeAngle = kneeAngle;
+    state.jumpElapsed = now - jumpStartTime;
+    state.jumpStartX = jumpStartX;
+    state.jumpStartY = jumpStartY;
+    state.jumpStartZ = jumpStartZ;
+    state.jumpVelocityX = jumpVelocityX;
+    state.jumpVelocityY = jumpVelocityY;
+    state.jumpVelocityZ = jumpVelocityZ;
+    state.fallElapsed = now - fallStartTime;
+    state.fallInitialX = fallInitialX;
+    state.fallInitialY = fallInitialY;
+    state.fallInitialZ = fallInitialZ;
+    state.fallVelocityX = fallVelocityX;
+    state.fallVelocityY = fallVelocityY;
+    state.fallVelocityZ = fallVelocityZ;
+
+    state.doorAngle = doorAngle;
+    state.arrowPositionY = arrowPositionY;
+    state.arrowDirection = arrowDirection;
+    state.doorOpen = doorOpen;
+    state.spotlightsEnabled = spotlightsEnabled;
+
+    state.isFadingSky = isFadingSky;
+    state.useCloudySky = useCloudySky;
+    state.isRaining = isRaining;
+    state.isLightningActive = isLightningActive;
+    state.lightningBoltActive = currentLightning.active;
+    state.skyFadeProgress = skyFadeProgress;
+    state.skyFadeElapsed = now - skyFadeStartTime;
+    state.sceneBrightness = sceneBrightness;
+    state.lightningDuration = lightningDuration;
+    state.lightningTimer = lightningTimer;
+    state.lightningBoltDuration = currentLightning.duration;
+    state.lightningBoltElapsed = currentLightning.elapsedTime;
+
+    state.ferrisWheelLightsOn = ferrisWheelLightsOn;
+    state.isCoasterRunning = isCoasterRunning;
+    state.isRidingCoaster = isRidingCoaster;
+    state.isCoasterActive = isCoasterActive;
+    state.isTransitioningCamera = isTransitioningCamera;
+    state.coasterSpeed = coasterSpeed;
+    state.trainPosition = trainPosition;
+    state.originalTrainPosition = originalTrainPosition;
+    state.cameraTransitionProgress = cameraTransitionProgress;
+    state.lastPlayerPosition = lastPlayerPosition;
+    state.transitionStartPos = transitionStartPos;
+    state.transitionStartLook = transitionStartLook;
+    state.currentTrain = currentTrain;
+    state.currentDirection = currentDirection;
+    state.nextDirection = nextDirection;
+
+    state.isRidingChair = isRidingChair;
+    state.isAggregating = isAggregating;
+    state.oscillateDirection = oscillateDirection;
+    state.chairCurrentX = chairCurrentX;
+    state.chairCurrentY = chairCurrentY;
+    state.chairCurrentZ = chairCurrentZ;
+    state.flyingChairRotationAngle = flyingChairRotationAngle;
+    state.additionalRotationAngle = additionalRotationAngle;
+    state.chairTurntableAngle = chairTurntableAngle;
+    state.oscillateAngle = oscillateAngle;
+    state.tiltAngle = tiltAngle;
+    state.alpha = alpha;
+    state.currentChairRadius = currentChairRadius;
+
+    state.currentGameState = currentGameState;
+    state.snakeDir = snake_dir;
+    state.snakeFood = snake_food;
+    state.snakeFireworksPosition = snake_fireworks_position;
+    state.snakeGameOver = snake_game_over;
+    state.snakeGameStarted = snake_game_started;
+    state.snakeTriggerFireworks = snake_trigger_fireworks;
+}
+
+void applyWorldState(const WorldState& state) {
+    float now = sceneSeconds();
+    cameraAngleX = state.cameraAngleX;
+    cameraAngleY = state.cameraAngleY;
+    cameraDistance = state.cameraDistance;
+    shakeIntensity = state.shakeIntensity;
+
+    manPositionX = state.manPositionX;
+    manPositionY = state.manPositionY;
+    manPositionZ = state.manPositionZ;
+    manRotationAngle = state.manRotationAngle;
+    isWalking = state.isWalking;
+    isRunning = state.isRunning;
+    isJumping = state.isJumping;
+    isFalling = state.isFalling;
+    isAlternateTexture = state.isAlternateTexture;
+    limbSwing = state.limbSwing;
+    limbSwingDirection = state.limbSwingDirection;
+    shoulderAngle = state.shoulderAngle;
+    elbowAngle = state.elbowAngle;
+    hipAngle = state.hipAngle;
+    kneeAngle = state.kneeAngle;
+    jumpStartTime = now - state.jumpElapsed;
+    jumpStartX = state.jumpStartX;
+    jumpStartY = state.jumpStartY;
+    jumpStartZ = state.jumpStartZ;
+    jumpVelocityX = state.jumpVelocityX;
+    jumpVelocityY = state.jumpVelocityY;
+    jumpVelocityZ = state.jumpVelocityZ;
+    fallStartTime = now - state.fallElapsed;
+    fallInitialX = state.fallInitialX;
+    fallInitialY = state.fallInitialY;
+    fallInitialZ = state.fallInitialZ;
+    fallVelocityX = state.fallVelocityX;
+    fallVelocityY = state.fallVelocityY;
+    fallVelocityZ = state.fallVelocityZ;
+
+    doorAngle = state.doorAngle;
+    arrowPositionY = state.arrowPositionY;
+    arrowDirection = state.arrowDirection;
+    doorOpen = state.doorOpen;
+    spotlightsEnabled = state.spotlightsEnabled;
+
+    isFadingSky = state.isFadingSky;
+    useCloudySky = state.useCloudySky;
+    isRaining = state.isRaining;
+    isLightningActive = state.isLightningActive;
+    currentLightning.active = state.lightningBoltActive;
+    skyFadeProgress = state.skyFadeProgress;
+    skyFadeStartTime = now - state.skyFadeElapsed;
+    sceneBrightness = state.sceneBrightness;
+    lightningDuration = state.lightningDuration;
+    lightningTimer = state.lightningTimer;
+    currentLightning.duration = state.lightningBoltDuration;
+    currentLightning.elapsedTime = state.lightningBoltElapsed;
+
+    ferrisWheelLightsOn = state.ferrisWheelLightsOn;
+    isCoasterRunning = state.isCoasterRunning;
+    isRidingCoaster = state.isRidingCoaster;
+    isCoasterActive = state.isCoasterActive;
+    isTransitioningCamera = state.isTransitioningCamera;
+    coasterSpeed = state.coasterSpeed;
+    trainPosition = state.trainPosition;
+    originalTrainPosition = state.originalTrainPosition;
+    cameraTransitionProgress = state.cameraTransitionProgress;
+    lastPlayerPosition = state.lastPlayerPosition;
+    transitionStartPos = state.transitionStartPos;
+    transitionStartLook = state.transitionStartLook;
+    currentTrain = state.currentTrain;
+    currentDirection = state.currentDirection;
+    nextDirection = state.nextDirection;
+
+    isRidingChair = state.isRidingChair;
+    isAggregating = state.isAggregating;
+    oscillateDirection = state.oscillateDirection;
+    chairCurrentX = state.chairCurrentX;
+    chairCurrentY = state.chairCurrentY;
+    chairCurrentZ = state.chairCurrentZ;
+    flyingChairRotationAngle = state.flyingChairRotationAngle;
+    additionalRotationAngle = state.additionalRotationAngle;
+    chairTurntableAngle = state.chairTurntableAngle;
+    oscillateAngle = state.oscillateAngle;
+    tiltAngle = state.tiltAngle;
+    alpha = state.alpha;
+    currentChairRadius = state.currentChairRadius;
+
+    currentGameState = state.currentGameState;
+    snake_dir = state.snakeDir;
+    snake_food = state.snakeFood;
+    snake_fireworks_position = state.snakeFireworksPosition;
+    snake_game_over = state.snakeGameOver;
+    snake_game_started = state.snakeGameStarted;
+    snake_trigger_fireworks = state.snakeTriggerFireworks;
+}
+
+// Bytes of an array section in the file
+template <typename Vector>
+size_t arrayBytes(const Vector& items) {
+    return items.size() * sizeof(items[0]);
+}
+
+// Copy count entries from the cursor into items and advance past them
+template <typename Vector>
+void readStateArray(const unsigned char*& cursor, Vector& items, uint32_t count) {
+    items.resize(count);
+    if (count > 0) memcpy(items.data(), cursor, arrayBytes(items));
+    cursor += arrayBytes(items);
+}
+
+// Read one dense component array and rebuild its entity map; false if the masks disagree with count
+template <typename T>
+bool readComponentArray(const unsigned char*& cursor, ComponentArray<T>& array, uint32_t count,
+    const std::vector<uint32_t>& masks, uint32_t component) {
+    readStateArray(cursor, array.items, count);
+    array.index(masks, component);
+    return array.owners.size() == array.items.size();
+}
+
+// Entity masks, component arrays and tower lights, in the order saveWorldState writes them
+bool readAttractionState(const unsigned char*& cursor, const WorldStateHeader& header, AttractionRegistry& loaded) {
+    readStateArray(cursor, loaded.components, header.entityCount);
+    bool consistent = true;
+    consistent &= readComponentArray(cursor, loaded.transforms, header.transformCount, loaded.components, COMPONENT_TRANSFORM);
+    consistent &= readComponentArray(cursor, loaded.animators, header.rideAnimatorCount, loaded.components, COMPONENT_RIDE_ANIMATOR);
+    consistent &= readComponentArray(cursor, loaded.wheels, header.wheelAnimatorCount, loaded.components, COMPONENT_WHEEL_ANIMATOR);
+    consistent &= readComponentArray(cursor, loaded.lightRigs, header.lightRigCount, loaded.components, COMPONENT_LIGHT_RIG);
+    consistent &= readComponentArray(cursor, loaded.emitters, header.emitterCount, loaded.components, COMPONENT_EMITTER);
+    consistent &= readComponentArray(cursor, loaded.renderables, header.renderableCount, loaded.components, COMPONENT_RENDERABLE);
+    readStateArray(cursor, loaded.lights, header.towerLightCount);
+
+    // Rigs index the light pool directly
+    for (const LightRig& rig : loaded.lightRigs.items) {
+        if (rig.first > header.towerLightCount || rig.count > header.towerLightCount - rig.first) consistent = false;
+    }
+    return consistent;
+}
+
+bool saveWorldState(const std::string& path) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    WorldStateHeader header;
+    memcpy(header.magic, WORLD_STATE_MAGIC, sizeof(header.magic));
+    header.version = WORLD_STATE_VERSION;
+    header.stateBytes = sizeof(WorldState);
+    header.seed = randomSeed + simulationTick;
+    header.rainCount = (uint32_t)rainParticles.size();
+    header.towerParticleCount = (uint32_t)towerParticles.size();
+    header.entityCount = (uint32_t)attractions.components.size();
+    header.transformCount = (uint32_t)attractions.transforms.items.size();
+    header.rideAnimatorCount = (uint32_t)attractions.animators.items.size();
+    header.wheelAnimatorCount = (uint32_t)attractions.wheels.items.size();
+    header.lightRigCount = (uint32_t)attractions.lightRigs.items.size();
+    header.emitterCount = (uint32_t)attractions.emitters.items.size();
+    header.renderableCount = (uint32_t)attractions.renderables.items.size();
+    header.towerLightCount = (uint32_t)attractions.lights.size();
+    header.snakeSegmentCount = (uint32_t)snake_body.size();
+    header.fireworkCount = (uint32_t)snake_fireworks.size();
+    header.lightningPointCount = (uint32_t)currentLightning.points.size();
+
+    WorldState state;
+    memset(static_cast<void*>(&state), 0, sizeof(state));  // Padding bytes go to disk too
+    captureWorldState(state);
+
+    // Arrays follow the state in the order loadWorldState reads them
+    std::vector<unsigned char> blob;
+    appendBlob(blob, &header, sizeof(header));
+    appendBlob(blob, &state, sizeof(state));
+    appendBlob(blob, rainParticles.data(), arrayBytes(rainParticles));
+    appendBlob(blob, towerParticles.data(), arrayBytes(towerParticles));
+    appendBlob(blob, attractions.components.data(), arrayBytes(attractions.components));
+    appendBlob(blob, attractions.transforms.items.data(), arrayBytes(attractions.transforms.items));
+    appendBlob(blob, attractions.animators.items.data(), arrayBytes(attractions.animators.items));
+    appendBlob(blob, attractions.wheels.items.data(), arrayBytes(attractions.wheels.items));
+    appendBlob(blob, attractions.lightRigs.items.data(), arrayBytes(attractions.lightRigs.items));
+    appendBlob(blob, attractions.emitters.items.data(), arrayBytes(attractions.emitters.items));
+    appendBlob(blob, attractions.renderables.items.data(), arrayBytes(attractions.renderables.items));
+    appendBlob(blob, attractions.lights.data(), arrayBytes(attractions.lights));
+    appendBlob(blob, snake_body.data(), arrayBytes(snake_body));
+    appendBlob(blob, snake_fireworks.data(), arrayBytes(snake_fireworks));
+    appendBlob(blob, currentLightning.points.data(), arrayBytes(currentLightning.points));
+
+    if (!writeBinaryFile(path, blob.data(), blob.size())) {
+        std::cerr << "Unable to write world state to " << path << std::endl;
+        return false;
+    }
+    printf("Saved world state to %s (%u bytes, %.2f ms)\n", path.c_str(), (unsigned int)blob.size(),
+        millisecondsSince(start));
+    return true;
+}
+
+bool loadWorldState(const std::string& path) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    MappedFile file;
+    WorldStateHeader header;
+    if (!file.open(path.c_str()) || file.size < sizeof(header)) {
+        std::cerr << "Unable to read world state " << path << std::endl;
+        return false;
+    }
+    memcpy(&header, file.data, sizeof(header));
+    if (memcmp(header.magic, WORLD_STATE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != WORLD_STATE_VERSION || header.stateBytes != sizeof(WorldState)) {
+        std::cerr << "Ignoring world state " << path << " from another version or build" << std::endl;
+        return false;
+    }
+
+    size_t expected = sizeof(header) + sizeof(WorldState) +
+        (size_t)header.rainCount * sizeof(RainParticle) +
+        (size_t)header.towerParticleCount * sizeof(TowerParticle) +
+        (size_t)header.entityCount * sizeof(uint32_t) +
+        (size_t)header.transformCount * sizeof(Transform) +
+        (size_t)header.rideAnimatorCount * sizeof(RideAnimator) +
+        (size_t)header.wheelAnimatorCount * sizeof(WheelAnimator) +
+        (size_t)header.lightRigCount * sizeof(LightRig) +
+        (size_t)header.emitterCount * sizeof(Emitter) +
+        (size_t)header.renderableCount * sizeof(Renderable) +
+        (size_t)header.towerLightCount * sizeof(TowerLight) +
+        (size_t)header.snakeSegmentCount * sizeof(Position) +
+        (size_t)header.fireworkCount * sizeof(SnakeParticle) +
+        (size_t)header.lightningPointCount * sizeof(Vec3);
+    if (file.size != expected) {
+        std::cerr << "Ignoring truncated world state " << path << std::endl;
+        return false;
+    }
+
+    // Attractions are checked before anything is applied; they follow the particle pools
+    const unsigned char* attractionData = file.data + sizeof(header) + sizeof(WorldState) +
+        (size_t)header.rainCount * sizeof(RainParticle) + (size_t)header.towerParticleCount * sizeof(TowerParticle);
+    AttractionRegistry loaded;
+    if (!readAttractionState(attractionData, header, loaded)) {
+        std::cerr << "Ignoring inconsistent world state " << path << std::endl;
+        return false;
+    }
+
+    // The Snake game runs on its own timer chain and GL state; carry them across a mode change
+    GameState previousGameState = currentGameState;
+    bool snakeTimerRunning = currentGameState == SNAKE_GAME && !snake_game_over;
+
+    WorldState state;
+    const unsigned char* cursor = file.data + sizeof(header);
+    memcpy(&state, cursor, sizeof(state));
+    cursor += sizeof(state);
+    applyWorldState(state);
+
+    readStateArray(cursor, rainParticles, header.rainCount);
+    readStateArray(cursor, towerParticles, header.towerParticleCount);
+    attractions = loaded;
+    attachWheelSceneNodes();  // Node ids in the file belong to the session that wrote it
+    cursor = attractionData;
+    readStateArray(cursor, snake_body, header.snakeSegmentCount);
+    readStateArray(cursor, snake_fireworks, header.fireworkCount);
+    readStateArray(cursor, currentLightning.points, header.lightningPointCount);
+
+    if (previousGameState == MAIN_SCENE && currentGameState == SNAKE_GAME) saveGLState();
+    if (previousGameState == SNAKE_GAME && currentGameState == MAIN_SCENE) restoreGLState();
+    if (currentGameState == SNAKE_GAME && !snake_game_over && !snakeTimerRunning) {
+        scheduleTimer(150, snake_timer, 0);
+    }
+    srand(header.seed);  // The run after loading does not depend on what came before it
+    postRedisplay();
+
+    printf("Loaded world state from %s (%u bytes, %.2f ms)\n", path.c_str(), (unsigned int)file.size,
+        millisecondsSince(start));
+    return true;
+}
+
+//=============================================================================
+// TEXTURE RESIDENCY
+//=============================================================================
+
+/**
+ * Streams zone textures in and out while the scene runs. Every streamed texture is registered
+ * up front with a 1x1 placeholder (its average colour from the asset pack, else the zone colour),
+ * so handles stay valid; the real texture replaces it once decoded on a worker and uploaded here.
+ * Zones out of range are evicted, least recently used first, while over the memory cap.
+ */
+
+const float ZONE_LOAD_MARGIN = 12.0f;          // Load when this close to a zone's footprint
+const float ZONE_UNLOAD_MARGIN = 10.0f;        // Extra distance before a zone may be evicted
+const double TEXTURE_UPLOAD_BUDGET_MS = 4.0;   // Upload time allowed per timer tick
+
+float textureMemoryCapMB = 128.0f;             // Eviction threshold (--texture-budget)
+
+struct ResidencyZone {
+    const char* name;
+    float x, z;               // Footprint centre in world space
+    float radius;             // Footprint radius; negative means always in range in the main scene
+    unsigned char colour[4];  // Placeholder colour (BGRA) when the asset pack has none
+    bool inRange = false;     // Within the load distance
+    bool keep = false;        // Within the unload distance
+    double lastNeeded = 0.0;  // Seconds since startup when last kept
+};
+
+ResidencyZone residencyZones[ZONE_COUNT] = {
+    { "resident",     0.0f,   0.0f,   -1.0f, { 128, 128, 128, 255 } },
+    { "interior",    -3.0f,  -3.0f,   16.0f, { 110, 140, 170, 255 } },
+    { "grounds",      0.0f,   0.0f,   -1.0f, {  60, 140,  70, 255 } },
+    { "sky",          0.0f,   0.0f,   -1.0f, { 230, 216, 173, 255 } },
+    { "weather",      0.0f,   0.0f,   -1.0f, { 150, 150, 150, 255 } },
+    { "ferris wheel", 0.0f,   0.0f,   12.0f, { 160, 160, 160, 255 } },
+    { "flying chair", -35.0f, 0.0f,   MAX_CHAIR_RADIUS + 3.0f, { 140, 140, 150, 255 } },
+    { "coaster",      0.0f,   0.0f,   -1.0f, { 120, 120, 120, 255 } },
+};
+
+// Decoded textures waiting for upload; never destroyed, so workers can finish during exit
+struct TextureStream {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<DecodedTexture>> done;
+    size_t inFlight = 0;      // Submitted and not yet uploaded (main thread only)
+};
+
+TextureStream& getTextureStream() {
+    static TextureStream* stream = new TextureStream();
+    return *stream;
+}
 
-    // Compute the train's speed based on the height difference (gravitational acceleration)
-    float heightDiff = p2.position.y - p1.position.y; // Calculate the height difference between consecutive points
-    currentTrain.speed = std::max(MIN_SPEED,   // Ensure the speed is within the minimum speed limit
-        std::min(MAX_SPEED,                  // Ensure the speed is within the maximum speed limit
-            currentTrain.speed - heightDiff * GRAVITY * deltaTime));  // Adjust speed based on gravity
+// Place the ride zones from the scene layout; the coaster zone bounds its track
+void placeResidencyZones() {
+    residencyZones[ZONE_FERRIS_WHEEL].x = (20.0f + ferrisWheelPosX) * 1.4f;
+    residencyZones[ZONE_FERRIS_WHEEL].z = ferrisWheelPosZ * 1.4f;
+
+    if (!trackPoints.empty()) {
+        float minX = 1e9f, maxX = -1e9f, minZ = 1e9f, maxZ = -1e9f;
+        for (const TrackPoint& point : trackPoints) {
+            Vec3 world = coasterToWorld(point.position);
+            minX = std::min(minX, world.x);
+            maxX = std::max(maxX, world.x);
+            minZ = std::min(minZ, world.z);
+            maxZ = std::max(maxZ, world.z);
+        }
+        residencyZones[ZONE_COASTER].x = 0.5f * (minX + maxX);
+        residencyZones[ZONE_COASTER].z = 0.5f * (minZ + maxZ);
+        residencyZones[ZONE_COASTER].radius = 0.5f * sqrt((maxX - minX) * (maxX - minX) + (maxZ - minZ) * (maxZ - minZ));
+    }
+}
 
-    // Update the train's orientation (twist) based on the interpolation between the current and next track points
-    float twist = p1.twist + (p2.twist - p1.twist) * t;  // Interpolate the twist (orientation) between p1 and p2
-    currentTrain.orientation = twist;  // Set the new orientation for the train
+// Create the 1x1 stand-in for a streamed texture
+unsigned int createPlaceholderTexture(const char* path, TextureZone zone) {
+    BmpImage image;
+    MipChain mips;
+    if (findPackedTexture(path, image, mips) && !mips.levels.empty()) {
+        BmpImage average = image;  // The last mip level is the 1x1 average colour
+        average.width = 1;
+        average.height = 1;
+        average.rowStride = mips.levels.back().rowStride;
+        average.pixels = mips.levelData(mips.levels.size() - 1);
+        return uploadBmpTexture(average, MipChain());
+    }
+
+    BmpImage colour;
+    colour.width = 1;
+    colour.height = 1;
+    colour.bytesPerPixel = 4;
+    colour.topDown = false;
+    colour.rowStride = 4;
+    colour.pixels = residencyZones[zone].colour;
+    return uploadBmpTexture(colour, MipChain());
 }
 
-// Overall rotation angle (in degrees), can be adjusted as needed
-float coasterRotationAngle = 0.0f;  // Rotation angle of the coaster, adjustable for the desired effect
+// Register streamed textures with placeholders; nothing is decoded yet
+void registerStreamedTextures(const std::vector<TextureLoadRequest>& requests) {
+    for (const TextureLoadRequest& request : requests) {
+        if (request.zone == ZONE_RESIDENT) continue;
+
+        *request.target = acquireTexture(request.path);
+        if (request.target->isNull()) {
+            unsigned int placeholder = createPlaceholderTexture(request.path, request.zone);
+            *request.target = registerTexture(request.path, 0, placeholder, 1, 1, 4);
+            TextureRecord& record = textureRegistry.records[request.target->index];
+            record.path = request.path;
+            record.placeholder = placeholder;
+            record.resident = false;
+        }
+        textureRegistry.records[request.target->index].zoneMask |= 1u << request.zone;
+    }
+}
 
-// Texture IDs for different materials
-GLuint woodTextureId;      // Texture ID for wood material
-GLuint metalTextureId;     // Texture ID for metal components
+// Queue every texture of a zone that is neither resident nor already loading
+void requestZoneTextures(TextureZone zone) {
+    TextureStream& stream = getTextureStream();
+    for (uint32_t i = 1; i < textureRegistry.records.size(); i++) {
+        TextureRecord& record = textureRegistry.records[i];
+        if (record.refCount == 0 || record.resident || record.loading || record.failed || !(record.zoneMask & (1u << zone))) continue;
+
+        record.loading = true;
+        stream.inFlight++;
+        const char* path = record.path;
+        getWorkerPool().submit([i, path]() {
+            std::unique_ptr<DecodedTexture> result(new DecodedTexture());
+            result->request = i;
+            decodeTexture(path, *result);
+
+            TextureStream& stream = getTextureStream();
+            std::lock_guard<std::mutex> lock(stream.mutex);
+            stream.done.push_back(std::move(result));
+        });
+    }
+}
 
+// Swap a streamed texture back to its placeholder
+void evictTexture(TextureRecord& record) {
+    if (!record.resident || record.placeholder == 0) return;
+    glDeleteTextures(1, &record.glTexture);
+    record.glTexture = record.placeholder;
+    record.width = 1;
+    record.height = 1;
+    record.bytes = 4;
+    record.resident = false;
+}
 
-// Function to draw the roller coaster with its components
-void drawRollerCoaster() {
-    // Apply transformations to the roller coaster model
-    glPushMatrix();
-    glScalef(0.85, 0.65, 0.65);  // Scale the model to adjust size
+// Upload finished decodes until the per-tick budget is spent
+void uploadStreamedTextures() {
+    TextureStream& stream = getTextureStream();
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
 
-    // First apply the overall rotation
-    glTranslatef(COASTER_START_X, 0, COASTER_START_Z);  // Translate the model to the starting position of the track
-    glRotatef(coasterRotationAngle, 0, 1, 0);            // Apply rotation around the Y-axis for the coaster's orientation
-    glTranslatef(-COASTER_START_X, 0, -COASTER_START_Z); // Translate the model back to its original position after rotation
+    while (stream.inFlight > 0 && millisecondsSince(start) < TEXTURE_UPLOAD_BUDGET_MS) {
+        std::unique_ptr<DecodedTexture> item;
+        {
+            std::lock_guard<std::mutex> lock(stream.mutex);
+            if (stream.done.empty()) return;
+            item = std::move(stream.done.back());
+            stream.done.pop_back();
+        }
+        stream.inFlight--;
+
+        TextureRecord& record = textureRegistry.records[item->request];
+        record.loading = false;
+        if (!item->error.empty()) {
+            std::cerr << "Unable to load texture " << record.path << ": " << item->error << std::endl;
+            record.failed = true;  // Keep the placeholder colour rather than retrying every tick
+            continue;
+        }
+        if (record.refCount == 0) continue;  // Released while loading
 
-    // Set fixed material properties for the coaster
-    GLfloat material_diffuse[] = { 0.8f, 0.2f, 0.2f, 1.0f }; // Diffuse color (red)
-    GLfloat material_specular[] = { 0.5f, 0.5f, 0.5f, 1.0f }; // Specular reflection (gray)
-    GLfloat material_shininess[] = { 30.0f };                  // Shininess coefficient
+        TRACE_SCOPE("texture upload", record.path);
+        record.glTexture = uploadBmpTexture(item->image, item->mips);
+        record.contentHash = item->contentHash;
+        record.width = item->image.width;
+        record.height = item->image.height;
+        record.bytes = textureMemoryBytes(item->image, item->mips);
+        record.resident = true;
+    }
+}
 
-    // Apply material properties to the front face
-    glMaterialfv(GL_FRONT, GL_DIFFUSE, material_diffuse);
-    glMaterialfv(GL_FRONT, GL_SPECULAR, material_specular);
-    glMaterialfv(GL_FRONT, GL_SHININESS, material_shininess);
+/**
+ * Called every timer tick: update zone ranges from the player, request zones coming into range,
+ * upload finished textures and evict unused zones while over the memory cap
+ */
+void updateTextureResidency() {
+    double now = millisecondsSince(startupTime) / 1000.0;
+
+    // The chair rider moves with the chair; Snake mode draws no world textures
+    float playerX = isRidingChair ? chairCurrentX : manPositionX;
+    float playerZ = isRidingChair ? chairCurrentZ : manPositionZ;
+    bool inWorld = currentGameState == MAIN_SCENE;
+
+    for (int zone = ZONE_INTERIOR; zone < ZONE_COUNT; zone++) {
+        ResidencyZone& info = residencyZones[zone];
+        float distance = sqrt((playerX - info.x) * (playerX - info.x) + (playerZ - info.z) * (playerZ - info.z)) - info.radius;
+        info.inRange = inWorld && (info.radius < 0.0f || distance <= ZONE_LOAD_MARGIN);
+        info.keep = inWorld && (info.radius < 0.0f || distance <= ZONE_LOAD_MARGIN + ZONE_UNLOAD_MARGIN);
+    }
+    bool weather = isRaining || useCloudySky || isFadingSky;
+    residencyZones[ZONE_WEATHER].inRange = residencyZones[ZONE_WEATHER].inRange && weather;
+    residencyZones[ZONE_WEATHER].keep = residencyZones[ZONE_WEATHER].keep && weather;
+
+    for (int zone = ZONE_INTERIOR; zone < ZONE_COUNT; zone++) {
+        if (residencyZones[zone].keep) residencyZones[zone].lastNeeded = now;
+        if (residencyZones[zone].inRange) requestZoneTextures((TextureZone)zone);
+    }
+
+    uploadStreamedTextures();
+
+    // Evict whole zones, least recently needed first, until back under the cap
+    uint32_t keptZones = 1u << ZONE_RESIDENT;
+    for (int zone = ZONE_INTERIOR; zone < ZONE_COUNT; zone++) {
+        if (residencyZones[zone].keep) keptZones |= 1u << zone;
+    }
+    size_t cap = (size_t)(textureMemoryCapMB * 1024.0f * 1024.0f);
+    while (totalTextureMemory() > cap) {
+        // Only textures no kept zone shares can be evicted
+        uint32_t evictableZones = 0;
+        for (const TextureRecord& record : textureRegistry.records) {
+            if (record.resident && record.placeholder != 0 && !(record.zoneMask & keptZones)) {
+                evictableZones |= record.zoneMask;
+            }
+        }
+        int victim = -1;
+        for (int zone = ZONE_INTERIOR; zone < ZONE_COUNT; zone++) {
+            if ((evictableZones & (1u << zone)) &&
+                (victim < 0 || residencyZones[zone].lastNeeded < residencyZones[victim].lastNeeded)) {
+                victim = zone;
+            }
+        }
+        if (victim < 0) break;  // Everything left is in use
 
-    glColor3f(1, 1, 1);  // Set the color to white
+        for (TextureRecord& record : textureRegistry.records) {
+            if ((record.zoneMask & (1u << victim)) && !(record.zoneMask & keptZones)) evictTexture(record);
+        }
+    }
+}
 
-    // Draw the supporting structure of the roller coaster
-    drawCoasterSupports();
+// Load every zone in range now, ignoring the upload budget; used where a frame must not depend on decode timing
+void finishTextureStreaming() {
+    updateTextureResidency();
+    while (getTextureStream().inFlight > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        uploadStreamedTextures();
+    }
+}
 
-    // Draw the roller coaster track
-    drawCoasterTrack();
 
-    // Draw the roller coaster train (after transformations)
-    drawCoasterTrain();
 
-    // Pop the transformation matrix to revert to the previous state
-    glPopMatrix();
-}
+// Draw the house with its furniture, the game console and the character
+void drawHouseScene() {
+    PROFILE_PASS(PROFILE_HOUSE);
 
+    // The house block is scaled 2x and moved into place by NODE_HOUSE; furniture sits under it
+    glPushMatrix();
+    loadNodeMatrix(NODE_HOUSE);
+
+    // Draw house and its internal elements
+    renderBase();
+    renderWalls();
+    drawDoor();
+
+    loadNodeMatrix(NODE_SOFA);
+    renderSofa();
+    loadNodeMatrix(NODE_CUPBOARD);
+    renderCupboard();
+    loadNodeMatrix(NODE_FLOOR_LAMP);
+    renderFloorLamp();
+    loadNodeMatrix(NODE_TABLE_LAMP);
+    renderTableLamp();
+    loadNodeMatrix(NODE_PARTITION);
+    renderPartitionBoard();
+    loadNodeMatrix(NODE_DESK);
+    renderDesk();
+
+    loadNodeMatrix(NODE_HOUSE);
+    drawPhoto();
+    glPopMatrix(); // Restore to initial state
+
+    drawGameConsole(); // Call function to draw game console
+
+    // Draw the man
+    drawMan();
+}
 
 void displayCB()
 {
+    TRACE_SCOPE("frame", "displayCB");
+    countFrameAllocations();
+    profilerBeginFrame();
+#ifdef COUNT_GL_CALLS
+    beginGLCallFrame();
+#endif
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
     if (isLightningActive) {
@@ -6413,9 +10437,9 @@ void displayCB()
             // If shaking, add random offsets
             if (shakeIntensity > 0.0f) {
                 float maxOffset = shakeIntensity; // Maximum offset
-                float shakeX = ((float)rand() / (float)RAND_MAX) * 2.0f - 1.0f; // -1 to 1
-                float shakeY = ((float)rand() / (float)RAND_MAX) * 2.0f - 1.0f;
-                float shakeZ = ((float)rand() / (float)RAND_MAX) * 2.0f - 1.0f;
+                float shakeX = ((float)renderRand() / (float)RAND_MAX) * 2.0f - 1.0f; // -1 to 1
+                float shakeY = ((float)renderRand() / (float)RAND_MAX) * 2.0f - 1.0f;
+                float shakeZ = ((float)renderRand() / (float)RAND_MAX) * 2.0f - 1.0f;
                 cameraPosX += shakeX * maxOffset;
                 cameraPosY += shakeY * maxOffset;
                 cameraPosZ += shakeZ * maxOffset;
@@ -6454,6 +10478,7 @@ void displayCB()
                 0.0f, 1.0f, 0.0f     // Up direction
             );
         }
+        captureSceneView();  // Scene graph nodes are drawn relative to this camera
 
         drawRollerCoaster();
 
@@ -6461,59 +10486,7 @@ void displayCB()
         setupSpotlights();
 
 
-        // Use a scaling factor of 2.0 for uniform scaling
-        float scaleFactor = 2.0f;
-        // Scale and translate to appropriately enlarge the scene and maintain reasonable position
-        glPushMatrix();
-        glScalef(scaleFactor, scaleFactor, scaleFactor);
-        glTranslatef(-1.5f, 0.0f, -1.5f); // Adjust translation as needed to ensure proper positioning
-
-        // Draw house and its internal elements
-        renderBase();
-        renderWalls();
-        drawDoor();
-
-        glPushMatrix();
-        glTranslated(-5.2, 0, -2.4);
-        glRotatef(90, 0, 1, 0);
-        glScaled(1.3, 1, 1);
-        renderSofa();
-        glPopMatrix();
-
-        glPushMatrix();
-        glTranslated(-5.4, 0, 1.2);
-        glRotatef(90, 0, 1, 0);
-        glScaled(1, 1.0f, 1.4f);
-        renderCupboard();
-        glPopMatrix();
-
-        glPushMatrix();
-        glTranslated(-5.4, 0, -5.5);
-        renderFloorLamp();
-        glPopMatrix();
-
-        glPushMatrix();
-        glTranslated(-5.4, 0.8, 1.8);
-        renderTableLamp();
-        glPopMatrix();
-
-        glPushMatrix();
-        glTranslated(-4.8, 0, 3.5);
-        renderPartitionBoard();
-        glPopMatrix();
-
-        glPushMatrix();
-        glTranslated(-1, 0, -2.5);
-        renderDesk();
-        glPopMatrix();
-
-        drawPhoto();
-        glPopMatrix(); // Restore to initial state
-
-        drawGameConsole(); // Call function to draw game console
-
-        // Draw the man
-        drawMan();
+        drawHouseScene();  // House, furniture, console and character
 
         // Enable or disable Ferris wheel lights based on user input
         if (ferrisWheelLightsOn) {
@@ -6537,12 +10510,18 @@ void displayCB()
                 glDisable(lightID);
             }
         }
-        drawFerrisWheel();
+        {
+            PROFILE_PASS(PROFILE_FERRIS_WHEEL);
+            drawFrontBlock();
+            drawAttractions(RENDER_FERRIS_WHEEL);
+        }
 
 
         // Draw the sky
         glPushMatrix();
         {
+            PROFILE_PASS(PROFILE_SKY_DOME);
+
             // Remove translation to center the sky sphere on the camera
             GLdouble modelview[16];
             glGetDoublev(GL_MODELVIEW_MATRIX, modelview);
@@ -6563,12 +10542,12 @@ void displayCB()
 
                 // Draw clear sky with gradually decreasing opacity
                 glColor4f(1.0f, 1.0f, 1.0f, 1.0f - skyFadeProgress);
-                glBindTexture(GL_TEXTURE_2D, texVec[24]); // Clear sky texture
+                bindTexture2D(clearSkyTexture); // Clear sky texture
                 drawSkySphere(500.0f);
 
                 // Draw cloudy sky with gradually increasing opacity
                 glColor4f(1.0f, 1.0f, 1.0f, skyFadeProgress);
-                glBindTexture(GL_TEXTURE_2D, texVec[25]); // Cloudy sky texture
+                bindTexture2D(rainySkyTexture); // Cloudy sky texture
                 drawSkySphere(500.0f);
 
                 // Disable blending
@@ -6578,11 +10557,11 @@ void displayCB()
                 // Draw the currently selected sky texture
                 if (useCloudySky) {
                     glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
-                    glBindTexture(GL_TEXTURE_2D, texVec[25]); // Cloudy sky texture
+                    bindTexture2D(rainySkyTexture); // Cloudy sky texture
                 }
                 else {
                     glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
-                    glBindTexture(GL_TEXTURE_2D, texVec[24]); // Clear sky texture
+                    bindTexture2D(clearSkyTexture); // Clear sky texture
                 }
                 drawSkySphere(500.0f);
             }
@@ -6620,13 +10599,29 @@ void displayCB()
         }
 
 
-        drawFirstDropTower();
-        drawSecondDropTower();
+        {
+            PROFILE_PASS(PROFILE_DROP_TOWERS);
+            drawAttractions(RENDER_DROP_TOWER);
+        }
         flyingChair();
         drawTowerParticles();
+        sceneGraph.lastFrameUpdates = sceneGraph.worldUpdates;
+        sceneGraph.worldUpdates = 0;
 
-        glutSwapBuffers();
-
+        profilerEndFrame();
+#ifdef COUNT_GL_CALLS
+        endGLCallFrame();
+#endif
+        drawProfilerOverlay();  // F3
+        swapWindowBuffers();
+        recordFramePresent();
+
+        // Report time-to-first-frame once
+        static bool firstFrameReported = false;
+        if (!firstFrameReported) {
+            firstFrameReported = true;
+            printf("First frame presented %.2f ms after startup\n", millisecondsSince(startupTime));
+        }
 
 
     }
@@ -6640,6 +10635,13 @@ void displayCB()
 
         // Call the display function for the Snake game
         snake_display();
+
+        // Finish the frame here too, or the Snake session lands in the next main-scene frame
+        profilerEndFrame();
+#ifdef COUNT_GL_CALLS
+        endGLCallFrame();
+#endif
+        recordFramePresent();  // snake_display swapped the buffers
     }
     drawLightningBolt();
 
@@ -6671,7 +10673,12 @@ void timerCB(int millisec)
 {
 
     // Register the timer callback again
-    glutTimerFunc(millisec, timerCB, millisec);
+    scheduleTimer(millisec, timerCB, millisec);
+    dispatchReplayInput();  // Recorded input for this tick goes first, as it did live
+    simulationTick++;
+
+    PROFILE_SCOPE(PROFILE_TIMER_UPDATE);
+    updateTextureResidency();  // Stream zone textures in and out around the player
 
     // Calculate delta time in seconds
 
@@ -6683,7 +10690,7 @@ void timerCB(int millisec)
 
     if (isFalling) {
         // Calculate the elapsed time since the fall started
-        float currentTime = glutGet(GLUT_ELAPSED_TIME) / 1000.0f;
+        float currentTime = sceneSeconds();
         float elapsedTime = currentTime - fallStartTime;
 
         // Update shake intensity (e.g., linearly decreasing)
@@ -6731,7 +10738,7 @@ void timerCB(int millisec)
 
     if (isJumping) {
         // Calculate the elapsed time since the jump started
-        float currentTime = glutGet(GLUT_ELAPSED_TIME) / 1000.0f;
+        float currentTime = sceneSeconds();
         float elapsedTime = currentTime - jumpStartTime;
 
         const float gravity = 9.8f;
@@ -6775,7 +10782,7 @@ void timerCB(int millisec)
     if (isFadingSky)
     {
         // Calculate the elapsed time since the sky fade started
-        float currentTime = glutGet(GLUT_ELAPSED_TIME) / 1000.0f;
+        float currentTime = sceneSeconds();
         float elapsedTime = currentTime - skyFadeStartTime;
 
         // Update sky fade progress
@@ -6798,7 +10805,6 @@ void timerCB(int millisec)
                 rainParticles.clear(); // Stop the rain
             }
         }
-        glutPostRedisplay(); // Trigger a redraw
     }
 
     // Update the rotation angle
@@ -6809,16 +10815,14 @@ void timerCB(int millisec)
 
     // Update the tilt angle based on the rotation angle
     tiltAngle = 15.0f + 5.0f * sin(alpha * M_PI / 180.0f);  // The tilt angle oscillates between [10  , 20  ]
+    updateFlyingChair();
+    updateWheelAnimators();  // Ferris wheel rotation
 
     // Calculate deltaTime for tower updates
     float deltaTowerTime = millisec / 1000.0f;  // Convert milliseconds to seconds
-    updateDropTower(deltaTowerTime);  // Update the drop tower state
-    updateTowerLights(deltaTowerTime);  // Update the tower lights
-    updateTowerParticles(deltaTowerTime);  // Update tower particles
-
-    // Update the second drop tower
-    updateSecondTowerLights(deltaTowerTime);  // Update the lights of the second tower
-    updateSecondTowerParticles(deltaTowerTime);  // Update the particles of the second tower
+    updateRideAnimators(deltaTowerTime);  // Drop cycles
+    updateLightRigs(deltaTowerTime);      // Tower lights
+    updateEmitters(deltaTowerTime);       // Tower sparks
 
     // Update the roller coaster train
     float deltaCoasterTime = millisec / 1000.0f;  // Convert milliseconds to seconds
@@ -6835,11 +10839,12 @@ void timerCB(int millisec)
         arrowDirection = 1.2f;
     }
 
-    glutPostRedisplay(); // Request a redraw of the scene
+    postRedisplay(); // Request a redraw of the scene
 }
 
 void keyboardCB(unsigned char key, int x, int y) {
-    int mod = glutGetModifiers(); // Get current modifier key state
+    if (!captureInput(INPUT_KEY_DOWN, key, keyModifiers(), x, y)) return;
+    int mod = keyModifiers(); // Get current modifier key state
 
     if (key == 'H' || key == 'h') {
         spotlightsEnabled = !spotlightsEnabled; // Toggle spotlight status
@@ -6847,18 +10852,18 @@ void keyboardCB(unsigned char key, int x, int y) {
     if (key == 'O' || key == 'o') {
         cameraDistance -= 1.0f; // Zoom in
         if (cameraDistance < 5.0f) cameraDistance = 5.0f; // Minimum distance limit
-        glutPostRedisplay(); // Trigger redraw
+        postRedisplay(); // Trigger redraw
     }
     else if (key == 'P' || key == 'p') {
         cameraDistance += 1.0f; // Zoom out
         if (cameraDistance > 180.0f) cameraDistance = 180.0f; // Maximum distance limit
-        glutPostRedisplay(); // Trigger redraw
+        postRedisplay(); // Trigger redraw
     }
 
     if (key == ' ') {
         if (!isJumping && !isFalling) {
             isJumping = true;
-            jumpStartTime = glutGet(GLUT_ELAPSED_TIME) / 1000.0f;
+            jumpStartTime = sceneSeconds();
 
             // Save starting position
             jumpStartX = manPositionX;
@@ -6906,7 +10911,7 @@ void keyboardCB(unsigned char key, int x, int y) {
     // Toggle Ferris wheel lights when 'y' is pressed
     if (key == 'Y' || key == 'y') {
         ferrisWheelLightsOn = !ferrisWheelLightsOn; // Toggle the Ferris wheel lights
-        glutPostRedisplay(); // Request a redraw
+        postRedisplay(); // Request a redraw
     }
 
     // Add logic to restart the Snake game when 'R' is pressed and the game is over
@@ -6915,7 +10920,7 @@ void keyboardCB(unsigned char key, int x, int y) {
             snake_restart_game();
             snake_game_over = false;
             snake_game_started = true;
-            glutPostRedisplay(); // Request a redraw
+            postRedisplay(); // Request a redraw
         }
     }
 
@@ -6974,9 +10979,9 @@ void keyboardCB(unsigned char key, int x, int y) {
             if (!isFadingSky) {
                 isFadingSky = true;
                 skyFadeProgress = 0.0f;
-                skyFadeStartTime = glutGet(GLUT_ELAPSED_TIME) / 1000.0f; // Record transition start time
+                skyFadeStartTime = sceneSeconds(); // Record transition start time
                 printf("B key pressed: Initiating sky fade.\n");
-                glutPostRedisplay();
+                postRedisplay();
             }
             break;
         case 'm':
@@ -7002,7 +11007,7 @@ void keyboardCB(unsigned char key, int x, int y) {
                     printf("Exiting riding chair perspective\n");
                     // Restore character's position or perform other actions
                 }
-                glutPostRedisplay(); // Trigger redraw
+                postRedisplay(); // Trigger redraw
             }
             else {
                 printf("Character is not within the chair's range and cannot ride.\n");
@@ -7016,7 +11021,7 @@ void keyboardCB(unsigned char key, int x, int y) {
             manPositionZ < GRASS_MIN_Z || manPositionZ > GRASS_MAX_Z) {
             // Initiate falling sequence
             isFalling = true;
-            fallStartTime = glutGet(GLUT_ELAPSED_TIME) / 1000.0f;
+            fallStartTime = sceneSeconds();
 
             // Record initial position
             fallInitialX = manPositionX;
@@ -7034,11 +11039,37 @@ void keyboardCB(unsigned char key, int x, int y) {
             shakeIntensity = 0.15f; // Adjust this value as needed to control maximum shake effect
         }
 
-        glutPostRedisplay(); // Trigger redraw
+        postRedisplay(); // Trigger redraw
     }
 }
 
 void special_callback(int key, int x, int y) {
+    // Diagnostic keys come before captureInput: they are not gameplay and stay off the input log
+    if (key == GLUT_KEY_F3) {
+        toggleProfiler();  // Frame profiler overlay
+        return;
+    }
+    if (key == GLUT_KEY_F4) {
+        // Write the trace so far; the first press starts recording
+        if (traceEnabled) writeTraceFile();
+        else enableTracing();
+        return;
+    }
+    if (key == GLUT_KEY_F5) {
+        saveWorldState(worldStatePath);  // Snapshot for --state or F9
+        return;
+    }
+    if (key == GLUT_KEY_F9) {
+        if (inputRecording.is_open() || replayActive) {
+            std::cerr << "World state loading is disabled while recording or replaying input" << std::endl;
+        }
+        else {
+            loadWorldState(worldStatePath);
+        }
+        return;
+    }
+    if (!captureInput(INPUT_SPECIAL_KEY, key, 0, x, y)) return;
+
     if (currentGameState == SNAKE_GAME) {
         if (snake_game_over) return;
         switch (key) {
@@ -7062,6 +11093,7 @@ void special_callback(int key, int x, int y) {
 
 void keyboardUpCB(unsigned char key, int x, int y)
 {
+    if (!captureInput(INPUT_KEY_UP, key, 0, x, y)) return;
     // Callback function for key release events
     switch (key)
     {
@@ -7078,6 +11110,7 @@ void keyboardUpCB(unsigned char key, int x, int y)
 
 void mouseCB(int button, int state, int x, int y)
 {
+    if (!captureInput(INPUT_MOUSE_BUTTON, button, state, x, y)) return;
     // Callback function for mouse button events
     mouseX = x; // Update mouse X position
     mouseY = y; // Update mouse Y position
@@ -7108,6 +11141,7 @@ void mouseCB(int button, int state, int x, int y)
 
 void mouseMotionCB(int x, int y)
 {
+    if (!captureInput(INPUT_MOUSE_MOTION, 0, 0, x, y)) return;
     // Callback function for mouse motion events
     if (mouseLeftDown)
     {
@@ -7132,6 +11166,55 @@ void mouseMotionCB(int x, int y)
     }
 }
 
+// Every texture the scene loads; also the input list for --pack-assets
+std::vector<TextureLoadRequest> getTextureManifest()
+{
+    return {
+        { &floorTexture, "texture/newfloor.bmp", ZONE_INTERIOR },                             // New floor texture
+        { &wallpaperTexture, "texture/wallpaper.bmp", ZONE_INTERIOR },                        // Wallpaper texture
+        { &sofaTexture, "texture/sofa.bmp", ZONE_INTERIOR },                                  // Sofa texture
+        { &woodTexture, "texture/wood.bmp", ZONE_INTERIOR },                                  // Wood texture
+        { &groundTexture, "texture/ground.bmp", ZONE_INTERIOR },                              // Ground texture
+        { &paintingTexture, "texture/StarryNight.bmp", ZONE_INTERIOR },                       // Picture texture
+        { &grassTexture, "texture/newgrass.bmp", ZONE_GROUNDS },                              // New grass texture
+        { &roofTexture, "texture/roof.bmp", ZONE_GROUNDS },                                   // Roof texture
+        { &barkTexture, "texture/bark.bmp", ZONE_GROUNDS },                                   // Bark texture
+        { &headTexture, "texture/head.bmp", ZONE_RESIDENT, &characterAtlas },                 // Head texture
+        { &jerseyTexture, "texture/Jersey.bmp", ZONE_RESIDENT, &characterAtlas },             // Body front texture
+        { &jamesTexture, "texture/james.bmp", ZONE_RESIDENT, &characterAtlas },               // Body back texture
+        { &sideClothTexture, "texture/sideclothe.bmp", ZONE_RESIDENT, &characterAtlas },      // Body side texture
+
+        { &armTexture, "texture/arm.bmp", ZONE_RESIDENT, &characterAtlas },                   // Arm texture
+        { &legTexture, "texture/leg.bmp", ZONE_RESIDENT, &characterAtlas },                   // Leg texture
+        { &consoleTexture, "texture/gameconsole.bmp", ZONE_RESIDENT, &characterAtlas },       // Game console texture
+        { &yaomingBackTexture, "texture/yaomingbei.bmp", ZONE_RESIDENT, &characterAtlas },    // Yaomingbei texture
+        { &yaomingFrontTexture, "texture/yaomingzheng.bmp", ZONE_RESIDENT, &characterAtlas }, // Yaomingzheng texture
+        { &doorTexture, "texture/door.bmp", ZONE_INTERIOR },                                  // Door texture
+        { &yaomingSideTexture, "texture/yaomingside.bmp", ZONE_RESIDENT, &characterAtlas },   // Yaomingside texture
+        { &clearSkyTexture, "texture/skyy.bmp", ZONE_SKY },                                   // Sky texture
+        { &rainySkyTexture, "texture/rainysky.bmp", ZONE_WEATHER },                           // Rainy sky texture
+        { &metalTexture, "texture/metal.bmp", ZONE_FERRIS_WHEEL },                            // Metal texture
+        { &cockpitTexture, "texture/skyy.bmp", ZONE_FERRIS_WHEEL },                           // Cockpit texture
+
+        { &xjtluTexture, "texture/xjtlu.bmp", ZONE_FERRIS_WHEEL },                            // XJTLU texture
+        { &marbleTexture, "texture/marble.bmp", ZONE_FERRIS_WHEEL },
+        { &fabricTexture, "texture/fabric.bmp", ZONE_FLYING_CHAIR },
+        { &columnTexture, "texture/column.bmp", ZONE_FLYING_CHAIR },
+        { &diskTexture, "texture/disk.bmp", ZONE_FLYING_CHAIR },
+
+        //{ &towerBaseTexture, "texture/tower_base.bmp", ZONE_GROUNDS },
+        //{ &towerFrameTexture, "texture/tower_frame.bmp", ZONE_GROUNDS },
+        //{ &towerCabinTexture, "texture/tower_cabin.bmp", ZONE_GROUNDS },
+        //{ &towerRailTexture, "texture/tower_rail.bmp", ZONE_GROUNDS },
+
+        { &trainTexture, "texture/train.bmp", ZONE_COASTER },
+        //{ &seatTexture, "texture/coaster/seat.bmp", ZONE_COASTER },
+        { &trackTexture, "texture/track.bmp", ZONE_COASTER },
+        //{ &supportTexture, "texture/coaster/support.bmp", ZONE_COASTER },
+        //{ &safetyTexture, "texture/coaster/safety.bmp", ZONE_COASTER },
+    };
+}
+
 void initGL()
 {
     glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE); // Set texture environment mode to modulate
@@ -7169,67 +11252,745 @@ void initGL()
     glColorMaterial(GL_FRONT, GL_AMBIENT_AND_DIFFUSE); // Specify which material parameters track the current color
 
     // Initialize random seed
-    srand(static_cast<unsigned int>(time(0)));
+    srand(randomSeed);  // --seed, or the recorded session's seed when replaying
     initTrees();                 // Initialize trees in the scene
     initFerrisWheelLights();     // Initialize Ferris wheel lights
+    initSceneGraph();            // House and ride transforms
+
+    // Load textures: resident ones decoded in parallel and uploaded now, the rest streamed by zone
+    openAssetPack(assetPackPath);  // Packed textures when available, loose BMP files otherwise
+    std::vector<TextureLoadRequest> textureManifest = getTextureManifest();
+    loadTexturesParallel(textureManifest);
+    registerStreamedTextures(textureManifest);
 
-    // Load textures
-    texVec[0] = loadGLTexture("Texture\\newfloor.bmp");          // Load new floor texture
-    texVec[1] = loadGLTexture("texture/wallpaper.bmp");         // Load wallpaper texture
-    texVec[3] = loadGLTexture("texture/sofa.bmp");              // Load sofa texture
-    texVec[4] = loadGLTexture("texture/wood.bmp");              // Load wood texture
-    texVec[5] = loadGLTexture("texture/ground.bmp");            // Load ground texture
-    texVec[6] = loadGLTexture("texture/StarryNight.bmp");       // Load picture texture
-    texVec[9] = loadGLTexture("texture/newgrass.bmp");          // Load new grass texture
-    texVec[10] = loadGLTexture("texture/roof.bmp");             // Load roof texture
-    texVec[11] = loadGLTexture("texture/bark.bmp");             // Load bark texture
-    texVec[12] = loadGLTexture("texture/head.bmp");             // Load head texture
-    texVec[13] = loadGLTexture("texture/Jersey.bmp");           // Load body front texture
-    texVec[14] = loadGLTexture("texture/james.bmp");            // Load body back texture
-    texVec[15] = loadGLTexture("texture/sideclothe.bmp");       // Load body side texture
-
-    texVec[17] = loadGLTexture("texture/arm.bmp");              // Load arm texture
-    texVec[18] = loadGLTexture("texture/leg.bmp");              // Load leg texture
-    texVec[19] = loadGLTexture("texture/gameconsole.bmp");      // Load game console texture
-    texVec[20] = loadGLTexture("texture/yaomingbei.bmp");       // Load Yaomingbei texture
-    texVec[21] = loadGLTexture("texture/yaomingzheng.bmp");     // Load Yaomingzheng texture
-    texVec[22] = loadGLTexture("texture/door.bmp");             // Load door texture
-    texVec[23] = loadGLTexture("texture/yaomingside.bmp");      // Load Yaomingside texture
-    texVec[24] = loadGLTexture("texture/skyy.bmp");             // Load sky texture
-    texVec[25] = loadGLTexture("texture/rainysky.bmp");         // Load rainy sky texture
-    texVec[26] = loadGLTexture("texture/metal.bmp");            // Load metal texture
-    texVec[27] = loadGLTexture("texture/skyy.bmp");             // Load cockpit texture
-
-    texVec[29] = loadGLTexture("texture/xjtlu.bmp");            // Load XJTLU texture
-    texVec[30] = loadGLTexture("texture/marble.bmp");
-    texVec[31] = loadGLTexture("texture/fabric.bmp");
-    texVec[32] = loadGLTexture("texture/column.bmp");
-    texVec[33] = loadGLTexture("texture/disk.bmp");
-
-    //texVec[34] = loadGLTexture("texture/tower_base.bmp");
-    //texVec[35] = loadGLTexture("texture/tower_frame.bmp");
-    //texVec[36] = loadGLTexture("texture/tower_cabin.bmp");
-    //texVec[37] = loadGLTexture("texture/tower_rail.bmp");
-
-    texVec[40] = loadGLTexture("texture/train.bmp");
-    //texVec[41] = loadGLTexture("texture/coaster/seat.bmp");  
-    //texVec[42] = loadGLTexture("texture/coaster/metal.bmp"); 
-    texVec[43] = loadGLTexture("texture/track.bmp");
-    //texVec[44] = loadGLTexture("texture/coaster/support.bmp");
-    //texVec[45] = loadGLTexture("texture/coaster/safety.bmp");  
     currentTrain.orientation = 0.0f;
     currentTrain.speed = MIN_SPEED;
 
+    loadCoasterLayout(coasterLayoutPath);  // Track frames, surface and supports (baked cache)
+    placeResidencyZones();                 // Texture zones around the rides and the track
+
+
+    initGpuTimers();             // Timer queries for the profiler overlay, when supported
+
+    spawnAttractions();          // Drop towers and Ferris wheels from the spawn table
+    srand(randomSeed);
+}
+
+//=============================================================================
+// HEADLESS BENCHMARK
+//=============================================================================
+
+/**
+ * --bench [frames] renders a scripted flythrough offscreen with no frame pacing: through the
+ * house, out past the Ferris wheel and coaster, a sky fade into rain, a flying chair ride
+ * and back. Every frame runs one timerCB update and one displayCB. Frame-time percentiles
+ * and per-pass CPU/GPU times are written as JSON to bench.json (or --bench-json <file>), so
+ * diagnostics printed during the run never end up inside the results.
+ * With --replay the recorded input drives the run instead of the script.
+ */
+
+int benchmarkFrames = 0;               // 0: 1800 (about a minute) for the script, or the replay's length
+std::string benchmarkJsonPath = "bench.json";  // Results file (--bench-json)
+
+// Character position and camera distance at a fraction of the run
+struct BenchmarkWaypoint {
+    float at;
+    float x, z;
+    float cameraDistance;
+};
+
+const BenchmarkWaypoint BENCHMARK_PATH[] = {
+    { 0.00f,   0.0f,  0.0f,  9.5f },  // Living room, camera orbits
+    { 0.15f,   0.0f,  0.0f,  9.5f },
+    { 0.25f,   0.0f, 12.0f, 15.0f },  // Out of the house
+    { 0.40f,  30.0f,  6.0f, 25.0f },  // Ferris wheel
+    { 0.55f,  12.0f, 22.0f, 30.0f },  // Coaster; the sky fades to rain here
+    { 0.70f, -24.0f,  6.0f, 25.0f },  // Flying chair, then ride it
+    { 0.90f, -24.0f,  6.0f, 25.0f },
+    { 1.00f,   0.0f, 10.0f, 15.0f }   // Back towards the house in the rain
+};
+const float BENCHMARK_ORBIT_END = 0.15f;
+const float BENCHMARK_RAIN_AT = 0.55f;
+const float BENCHMARK_RIDE_START = 0.72f;
+const float BENCHMARK_RIDE_END = 0.88f;
+
+// Move the character and camera to where the script is at fraction t of the run
+void applyBenchmarkPath(float t, float previous) {
+    const int count = sizeof(BENCHMARK_PATH) / sizeof(BENCHMARK_PATH[0]);
+    int segment = 0;
+    while (segment + 2 < count && BENCHMARK_PATH[segment + 1].at <= t) segment++;
+    const BenchmarkWaypoint& a = BENCHMARK_PATH[segment];
+    const BenchmarkWaypoint& b = BENCHMARK_PATH[segment + 1];
+    float u = std::min(1.0f, std::max(0.0f, (t - a.at) / (b.at - a.at)));
+
+    float dx = b.x - a.x, dz = b.z - a.z;
+    isWalking = dx != 0.0f || dz != 0.0f;
+    if (isWalking) {
+        manRotationAngle = atan2(-dx, -dz) * 180.0f / M_PI;  // Facing the direction of travel
+    }
+    manPositionX = a.x + dx * u;
+    manPositionZ = a.z + dz * u;
+    cameraDistance = a.cameraDistance + (b.cameraDistance - a.cameraDistance) * u;
+    cameraAngleY = manRotationAngle;
+    if (t < BENCHMARK_ORBIT_END) cameraAngleY += 360.0f * t / BENCHMARK_ORBIT_END;
+
+    // Scripted key presses go through the same handlers as real input
+    if (previous < BENCHMARK_RAIN_AT && t >= BENCHMARK_RAIN_AT) keyboardCB('b', 0, 0);
+    isRidingChair = t >= BENCHMARK_RIDE_START && t < BENCHMARK_RIDE_END;
+}
+
+// Value at fraction p of an ascending sample list
+float percentile(const std::vector<float>& sorted, float p) {
+    if (sorted.empty()) return 0.0f;
+    size_t index = (size_t)std::max(0.0, ceil(p * sorted.size()) - 1.0);
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+// Append {"mean":..,"stddev":..,"min":..,"p50":..} for a list of timing samples
+void writeTimingJson(std::ostream& out, std::vector<float> samples) {
+    std::sort(samples.begin(), samples.end());
+    double sum = 0.0, squares = 0.0;
+    for (float sample : samples) sum += sample;
+    double mean = samples.empty() ? 0.0 : sum / samples.size();
+    for (float sample : samples) squares += (sample - mean) * (sample - mean);
+    out << "{\"mean\":" << mean << ",\"stddev\":" << (samples.empty() ? 0.0 : sqrt(squares / samples.size()))
+        << ",\"min\":" << (samples.empty() ? 0.0f : samples.front())
+        << ",\"p50\":" << percentile(samples, 0.50f) << ",\"p90\":" << percentile(samples, 0.90f)
+        << ",\"p95\":" << percentile(samples, 0.95f) << ",\"p99\":" << percentile(samples, 0.99f)
+        << ",\"max\":" << (samples.empty() ? 0.0f : samples.back()) << "}";
+}
+
+int runBenchmark() {
+    headlessMode = true;
+    tickClock = true;  // One timerCB per frame, so the run is the same however long frames take
+    if (!createHeadlessContext(screenWidth, screenHeight)) return 1;
+
+    initGL();
+    initClouds();
+    reshapeCB(screenWidth, screenHeight);
+    if (loadStateAtStartup && !loadWorldState(worldStatePath)) return 1;
+    frameProfiler.enabled = true;  // Per-pass times; the overlay is not drawn headless
+
+    bool scripted = !replayActive;
+    if (benchmarkFrames == 0) {
+        benchmarkFrames = scripted || replayEvents.empty() ? 1800 : (int)replayEvents.back().tick + 1;
+    }
+
+    std::vector<float> frameTimes;
+    std::vector<float> frameAllocations;
+    std::vector<float> worldMatrixUpdates;
+    worldMatrixUpdates.reserve(benchmarkFrames);  // Growing it mid-run would show up as frame allocations
+    std::vector<float> cpuPasses[PROFILE_SECTION_COUNT];
+    std::vector<float> gpuPasses[PROFILE_SECTION_COUNT];
+    std::chrono::steady_clock::time_point runStart = std::chrono::steady_clock::now();
+
+    float previous = -1.0f;
+    for (int frame = 0; frame < benchmarkFrames; frame++) {
+        float t = benchmarkFrames > 1 ? (float)frame / (benchmarkFrames - 1) : 0.0f;
+        std::chrono::steady_clock::time_point frameStart = std::chrono::steady_clock::now();
+        if (scripted) applyBenchmarkPath(t, previous);
+        previous = t;
+        timerCB(SIMULATION_STEP_MS);
+        displayCB();
+        frameTimes.push_back((float)millisecondsSince(frameStart));
+        if (frame > 0) frameAllocations.push_back((float)memoryFrames.frameAllocations);  // Counted as the next frame starts
+        worldMatrixUpdates.push_back((float)sceneGraph.lastFrameUpdates);
+
+        // GPU times arrive a frame late, so the last frame's are not collected
+        int last = (frameProfiler.nextFrame + PROFILE_HISTORY_FRAMES - 1) % PROFILE_HISTORY_FRAMES;
+        for (int section = 0; section < PROFILE_SECTION_COUNT; section++) {
+            cpuPasses[section].push_back(frameProfiler.history[section][last]);
+            float gpuTime = frameProfiler.gpuHistory[section][last];
+            if (gpuTimers.available && frame > 0 && gpuTime >= 0.0f) gpuPasses[section].push_back(gpuTime);
+        }
+    }
+    double totalSeconds = millisecondsSince(runStart) / 1000.0;
+
+    std::ofstream out(benchmarkJsonPath.c_str(), std::ios::out | std::ios::trunc);
+    if (!out) {
+        std::cerr << "Unable to write benchmark results to " << benchmarkJsonPath << std::endl;
+        return 1;
+    }
+
+    const char* renderer = (const char*)glGetString(GL_RENDERER);
+    out << std::fixed << std::setprecision(3);
+    out << "{\"frames\":" << benchmarkFrames << ",\"width\":" << screenWidth << ",\"height\":" << screenHeight
+        << ",\"renderer\":\"" << (renderer ? renderer : "unknown") << "\",\"seconds\":" << totalSeconds
+        << ",\"fps\":" << (totalSeconds > 0.0 ? benchmarkFrames / totalSeconds : 0.0) << ",\n\"frame_ms\":";
+    writeTimingJson(out, frameTimes);
+    out << ",\n\"passes\":{";
+    for (int section = 0; section < PROFILE_SECTION_COUNT; section++) {
+        out << (section > 0 ? ",\n" : "\n") << "\"" << PROFILE_SECTION_NAMES[section] << "\":{\"cpu_ms\":";
+        writeTimingJson(out, cpuPasses[section]);
+        if (gpuTimers.available) {
+            out << ",\"gpu_ms\":";
+            writeTimingJson(out, gpuPasses[section]);
+        }
+        out << "}";
+    }
+    out << "}";
+    out << ",\n\"memory\":{";
+    for (int tag = 0; tag < MEMORY_TAG_COUNT; tag++) {
+        out << (tag > 0 ? ",\n" : "\n") << "\"" << MEMORY_TAG_NAMES[tag] << "\":{\"live_bytes\":" << memoryCounters[tag].live
+            << ",\"peak_bytes\":" << memoryCounters[tag].peak << ",\"allocations\":" << memoryCounters[tag].allocations << "}";
+    }
+    int allocationFree = 0;
+    for (float allocations : frameAllocations) {
+        if (allocations == 0.0f) allocationFree++;
+    }
+    out << "},\n\"allocations_per_frame\":";
+    writeTimingJson(out, frameAllocations);
+    out << ",\"allocation_free_frames\":" << allocationFree;
+    out << ",\n\"world_matrix_updates_per_frame\":";
+    writeTimingJson(out, worldMatrixUpdates);
+    out << ",\"scene_nodes\":" << (int)sceneGraph.nodes.size();
+    out << ",\n\"pacing\":{\"threshold_ms\":" << hitchThresholdMs << ",\"histogram\":{";
+    for (int bucket = 0; bucket < PACING_BUCKET_COUNT; bucket++) {
+        out << (bucket > 0 ? "," : "") << "\"" << PACING_BUCKET_NAMES[bucket] << "\":" << framePacing.histogram[bucket];
+    }
+    out << "},\"hitches\":" << framePacing.hitches << ",\"hitch_causes\":{";
+    bool firstCause = true;
+    for (int cause = 0; cause < PACING_CAUSE_COUNT; cause++) {
+        if (framePacing.hitchCauses[cause] == 0) continue;
+        out << (firstCause ? "" : ",") << "\"" << pacingCauseName(cause) << "\":" << framePacing.hitchCauses[cause];
+        firstCause = false;
+    }
+    out << "},\"worst_ms\":" << framePacing.worstMs << ",\"worst_cost_ms\":" << framePacing.worstCostMs << "}";
+#ifdef COUNT_GL_CALLS
+    out << ",\n\"gl_calls_per_frame\":";
+    writeGLCallCountsJson(out);
+#endif
+    out << "}\n";
+    out.close();
+    printf("Wrote benchmark results for %d frames to %s\n", benchmarkFrames, benchmarkJsonPath.c_str());
+    return 0;
+}
+
+//=============================================================================
+// GOLDEN FRAMES
+//=============================================================================
+
+/**
+ * --golden <dir> renders a fixed set of camera poses offscreen at fixed simulation ticks with
+ * seed 1, reads each frame back and writes <dir>/<pose>.ppm plus <dir>/golden.txt listing a
+ * perceptual hash (64-bit difference hash of a 9x8 luminance grid) and an exact FNV-1a
+ * checksum per frame. --golden-compare <dir> checks the frames against a stored baseline:
+ * identical checksums pass, otherwise the hashes may differ by --golden-tolerance bits and at most
+ * GOLDEN_PIXEL_FRACTION of the pixels by more than GOLDEN_CHANNEL_TOLERANCE, so driver rounding
+ * passes but a missing or moved object does not. Returns nonzero when a frame differs.
+ */
+
+std::string goldenOutputDir;           // --golden; empty: no dumps
+std::string goldenBaselineDir;         // --golden-compare; empty: no comparison
+int goldenToleranceBits = 4;           // Difference hash bits allowed to change
+
+const int GOLDEN_CHANNEL_TOLERANCE = 16;     // Per-channel difference ignored by the pixel check
+const float GOLDEN_PIXEL_FRACTION = 0.005f;  // Share of pixels allowed over the channel tolerance
+const unsigned int GOLDEN_RAIN_TICK = 150;   // The sky fade starts here; later poses render in the rain
+
+struct GoldenPose {
+    const char* name;
+    unsigned int tick;                 // Simulation tick the pose renders at
+    float x, z, facing;                // Character position and rotation
+    float yaw, pitch, distance;        // Orbit camera
+};
+
+const GoldenPose GOLDEN_POSES[] = {
+    { "living_room",   90,   0.0f,  0.0f,   0.0f,   30.0f, 20.0f,  9.5f },
+    { "front_yard",    90,   0.0f, 12.0f, 180.0f,  150.0f, 15.0f, 15.0f },
+    { "ferris_wheel",  90,  30.0f,  6.0f,  90.0f,   60.0f, 10.0f, 25.0f },
+    { "coaster",      120,  12.0f, 22.0f,   0.0f,  200.0f, 20.0f, 30.0f },
+    { "flying_chair", 120, -24.0f,  6.0f, 270.0f,  300.0f, 15.0f, 25.0f },
+    { "overview",     120,   0.0f, 10.0f,   0.0f,   45.0f, 40.0f, 60.0f },
+    { "rain_yard",    270,   0.0f, 10.0f, 180.0f,  180.0f, 15.0f, 15.0f },
+    { "rain_overview",270,   0.0f, 10.0f,   0.0f,  225.0f, 35.0f, 60.0f }
+};
+const int GOLDEN_POSE_COUNT = sizeof(GOLDEN_POSES) / sizeof(GOLDEN_POSES[0]);
+
+struct GoldenFrame {
+    std::string name;
+    int width = 0, height = 0;
+    uint64_t perceptualHash = 0;
+    uint64_t checksum = 0;
+};
+
+// Read the back buffer as tightly packed RGB rows, top row first
+std::vector<unsigned char> readFramePixels(int width, int height) {
+    std::vector<unsigned char> pixels((size_t)width * height * 3);
+    std::vector<unsigned char> flipped(pixels.size());
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, flipped.data());
+    size_t rowBytes = (size_t)width * 3;
+    for (int row = 0; row < height; row++) {
+        memcpy(&pixels[row * rowBytes], &flipped[(height - 1 - row) * rowBytes], rowBytes);
+    }
+    return pixels;
+}
+
+// 64-bit difference hash: each bit says whether a cell of a 9x8 luminance grid is darker than its right neighbour
+uint64_t perceptualHash(const std::vector<unsigned char>& pixels, int width, int height) {
+    float grid[8][9] = {};
+    int counts[8][9] = {};
+    for (int y = 0; y < height; y++) {
+        const unsigned char* row = &pixels[(size_t)y * width * 3];
+        int cellY = y * 8 / height;
+        for (int x = 0; x < width; x++) {
+            int cellX = x * 9 / width;
+            grid[cellY][cellX] += 0.299f * row[x * 3] + 0.587f * row[x * 3 + 1] + 0.114f * row[x * 3 + 2];
+            counts[cellY][cellX]++;
+        }
+    }
+    uint64_t hash = 0;
+    for (int y = 0; y < 8; y++) {
+        for (int x = 0; x < 8; x++) {
+            float left = grid[y][x] / std::max(1, counts[y][x]);
+            float right = grid[y][x + 1] / std::max(1, counts[y][x + 1]);
+            hash = (hash << 1) | (left < right ? 1u : 0u);
+        }
+    }
+    return hash;
+}
+
+int hashDistance(uint64_t a, uint64_t b) {
+    int bits = 0;
+    for (uint64_t diff = a ^ b; diff != 0; diff &= diff - 1) bits++;
+    return bits;
+}
+
+bool writePPM(const std::string& path, const std::vector<unsigned char>& pixels, int width, int height) {
+    std::ofstream file(path.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file) return false;
+    file << "P6\n" << width << " " << height << "\n255\n";
+    file.write((const char*)pixels.data(), pixels.size());
+    return (bool)file;
+}
+
+bool readPPM(const std::string& path, std::vector<unsigned char>& pixels, int& width, int& height) {
+    std::ifstream file(path.c_str(), std::ios::in | std::ios::binary);
+    std::string magic;
+    int maxValue = 0;
+    if (!(file >> magic >> width >> height >> maxValue) || magic != "P6" || maxValue != 255) return false;
+    file.get();  // Single whitespace before the pixel data
+    pixels.resize((size_t)width * height * 3);
+    file.read((char*)pixels.data(), pixels.size());
+    return file.gcount() == (std::streamsize)pixels.size();
+}
+
+// golden.txt: one "<name> <width> <height> <perceptual hash> <checksum>" line per pose
+bool writeGoldenManifest(const std::string& path, const std::vector<GoldenFrame>& frames) {
+    std::ofstream file(path.c_str(), std::ios::out | std::ios::trunc);
+    if (!file) return false;
+    file << "# pose width height perceptual_hash checksum\n";
+    for (const GoldenFrame& frame : frames) {
+        char line[128];
+        snprintf(line, sizeof(line), "%s %d %d %016llx %016llx\n", frame.name.c_str(), frame.width, frame.height,
+            (unsigned long long)frame.perceptualHash, (unsigned long long)frame.checksum);
+        file << line;
+    }
+    return (bool)file;
+}
+
+bool readGoldenManifest(const std::string& path, std::vector<GoldenFrame>& frames) {
+    std::string text;
+    if (!readTextFile(path, text)) return false;
+    std::istringstream lines(text);
+    std::string line;
+    while (std::getline(lines, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream fields(line);
+        GoldenFrame frame;
+        std::string perceptual, checksum;
+        if (!(fields >> frame.name >> frame.width >> frame.height >> perceptual >> checksum)) continue;
+        frame.perceptualHash = strtoull(perceptual.c_str(), nullptr, 16);
+        frame.checksum = strtoull(checksum.c_str(), nullptr, 16);
+        frames.push_back(frame);
+    }
+    return true;
+}
+
+// Compare one frame with its baseline; prints the result and returns false when it differs
+bool compareGoldenFrame(const GoldenFrame& frame, const std::vector<unsigned char>& pixels, const GoldenFrame& baseline) {
+    if (frame.width != baseline.width || frame.height != baseline.height) {
+        printf("%-14s DIFFERENT  size %dx%d, baseline %dx%d\n", frame.name.c_str(), frame.width, frame.height,
+            baseline.width, baseline.height);
+        return false;
+    }
+    if (frame.checksum == baseline.checksum) {
+        printf("%-14s identical\n", frame.name.c_str());
+        return true;
+    }
+
+    int bits = hashDistance(frame.perceptualHash, baseline.perceptualHash);
+    bool within = bits <= goldenToleranceBits;
+
+    // The pixel check needs the baseline dump; the hash alone decides without it
+    std::vector<unsigned char> expected;
+    int width = 0, height = 0;
+    char pixelReport[96] = "no baseline dump";
+    if (readPPM(goldenBaselineDir + "/" + frame.name + ".ppm", expected, width, height) &&
+        width == frame.width && height == frame.height) {
+        size_t overTolerance = 0;
+        int largest = 0;
+        for (size_t i = 0; i < pixels.size(); i += 3) {
+            int difference = 0;
+            for (int channel = 0; channel < 3; channel++) {
+                difference = std::max(difference, abs((int)pixels[i + channel] - (int)expected[i + channel]));
+            }
+            largest = std::max(largest, difference);
+            if (difference > GOLDEN_CHANNEL_TOLERANCE) overTolerance++;
+        }
+        float fraction = (float)overTolerance / (pixels.size() / 3);
+        within = within && fraction <= GOLDEN_PIXEL_FRACTION;
+        snprintf(pixelReport, sizeof(pixelReport), "%.3f%% of pixels off by >%d, max %d",
+            fraction * 100.0f, GOLDEN_CHANNEL_TOLERANCE, largest);
+    }
+    printf("%-14s %-10s hash %d bits, %s\n", frame.name.c_str(), within ? "within" : "DIFFERENT", bits, pixelReport);
+    return within;
+}
+
+int runGoldenFrames() {
+    headlessMode = true;
+    tickClock = true;
+    if (!createHeadlessContext(screenWidth, screenHeight)) return 1;
+
+    initGL();
+    initClouds();
+    reshapeCB(screenWidth, screenHeight);
+
+    std::vector<GoldenFrame> baseline;
+    if (!goldenBaselineDir.empty() && !readGoldenManifest(goldenBaselineDir + "/golden.txt", baseline)) {
+        std::cerr << "Unable to read golden baseline " << goldenBaselineDir << "/golden.txt" << std::endl;
+        return 1;
+    }
+
+    std::vector<GoldenFrame> frames;
+    int differences = 0;
+    int writeFailures = 0;  // A baseline that was not written must not pass as one
+    for (int pose = 0; pose < GOLDEN_POSE_COUNT; pose++) {
+        const GoldenPose& golden = GOLDEN_POSES[pose];
+        while (simulationTick < golden.tick) {
+            if (simulationTick == GOLDEN_RAIN_TICK) keyboardCB('b', 0, 0);
+            timerCB(SIMULATION_STEP_MS);
+        }
+        isWalking = false;
+        manPositionX = golden.x;
+        manPositionZ = golden.z;
+        manRotationAngle = golden.facing;
+        cameraAngleY = golden.yaw;
+        cameraAngleX = golden.pitch;
+        cameraDistance = golden.distance;
+        finishTextureStreaming();
+        displayCB();
+
+        std::vector<unsigned char> pixels = readFramePixels(screenWidth, screenHeight);
+        GoldenFrame frame;
+        frame.name = golden.name;
+        frame.width = screenWidth;
+        frame.height = screenHeight;
+        frame.perceptualHash = perceptualHash(pixels, screenWidth, screenHeight);
+        frame.checksum = fnv1a64(pixels.data(), pixels.size());
+        frames.push_back(frame);
+
+        if (!goldenOutputDir.empty() && !writePPM(goldenOutputDir + "/" + frame.name + ".ppm", pixels, frame.width, frame.height)) {
+            std::cerr << "Unable to write " << goldenOutputDir << "/" << frame.name << ".ppm" << std::endl;
+            writeFailures++;
+        }
+        if (goldenBaselineDir.empty()) continue;
+        const GoldenFrame* expected = nullptr;
+        for (const GoldenFrame& candidate : baseline) {
+            if (candidate.name == frame.name) expected = &candidate;
+        }
+        if (expected == nullptr) {
+            printf("%-14s missing from the baseline\n", frame.name.c_str());
+            differences++;
+        }
+        else if (!compareGoldenFrame(frame, pixels, *expected)) {
+            differences++;
+        }
+    }
+
+    if (!goldenOutputDir.empty()) {
+        if (writeGoldenManifest(goldenOutputDir + "/golden.txt", frames)) {
+            std::cout << "Wrote " << frames.size() << " golden frames to " << goldenOutputDir << std::endl;
+        }
+        else {
+            std::cerr << "Unable to write " << goldenOutputDir << "/golden.txt" << std::endl;
+            writeFailures++;
+        }
+    }
+    if (!goldenBaselineDir.empty()) {
+        printf("%d of %d frames differ from %s\n", differences, GOLDEN_POSE_COUNT, goldenBaselineDir.c_str());
+    }
+    return differences > 0 || writeFailures > 0 ? 1 : 0;
+}
+
+//=============================================================================
+// KERNEL MICROBENCHMARKS
+//=============================================================================
+
+/**
+ * --bench-kernels [file] times the math and simulation kernels without a window or GL
+ * context. Each kernel runs warm-up samples first, then KERNEL_SAMPLES timed samples of a
+ * fixed number of calls; the JSON reports nanoseconds per call so runs can be diffed.
+ */
+
+const int KERNEL_WARMUP_SAMPLES = 10;
+const int KERNEL_SAMPLES = 100;
+volatile float kernelSink = 0.0f;     // Keeps results from being optimized away
+
+// Warm up, then time samples of `calls` calls; returns nanoseconds per call for each sample
+std::vector<float> timeKernel(int calls, const std::function<void(int)>& kernel) {
+    std::vector<float> samples;
+    for (int i = 0; i < KERNEL_WARMUP_SAMPLES; i++) {
+        kernel(calls);
+    }
+    for (int i = 0; i < KERNEL_SAMPLES; i++) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        kernel(calls);
+        samples.push_back((float)(millisecondsSince(start) * 1.0e6 / calls));
+    }
+    return samples;
+}
+
+// Restart the Snake state without the GL setup in snake_init()
+void resetSnakeForBenchmark() {
+    currentGameState = SNAKE_GAME;
+    snake_body.clear();
+    snake_body.push_back({ snake_grid_columns / 2, snake_grid_rows / 2 });
+    snake_dir = RIGHT;
+    snake_food = { snake_grid_columns / 2 + 5, snake_grid_rows / 2 + 3 };
+    snake_game_over = false;
+    snake_fireworks.clear();
+}
+
+int runKernelBenchmarks(const std::string& outputPath) {
+    headlessMode = true;  // snake_timer's redisplay and timer requests become no-ops
+    srand(1);
     initializeTrackPoints();
+    const size_t controlCount = trackPoints.size();
 
+    struct KernelResult {
+        const char* name;
+        int calls;
+        std::vector<float> samples;
+    };
+    std::vector<KernelResult> results;
+
+    results.push_back({ "catmullRomSpline", 4096, timeKernel(4096, [controlCount](int calls) {
+        float sum = 0.0f;
+        for (int i = 0; i < calls; i++) {
+            size_t segment = (size_t)i % (controlCount - 3);
+            Vec3 p = catmullRomSpline(trackPoints[segment].position, trackPoints[segment + 1].position,
+                trackPoints[segment + 2].position, trackPoints[segment + 3].position, (i & 63) / 64.0f);
+            sum += p.x + p.y + p.z;
+        }
+        kernelSink = sum;
+    }) });
+
+    results.push_back({ "getTrainPosition", 4096, timeKernel(4096, [](int calls) {
+        float sum = 0.0f;
+        for (int i = 0; i < calls; i++) {
+            Vec3 p = getTrainPosition((float)i / calls, (i & 1) ? BACKWARD : FORWARD);
+            sum += p.x + p.y + p.z;
+        }
+        kernelSink = sum;
+    }) });
+
+    results.push_back({ "calculateTrackNormals", 16, timeKernel(16, [](int calls) {
+        for (int i = 0; i < calls; i++) calculateTrackNormals();
+        kernelSink = trackPoints.back().normal.y;
+    }) });
+
+    results.push_back({ "initializeTrackPoints", 4, timeKernel(4, [](int calls) {
+        for (int i = 0; i < calls; i++) initializeTrackPoints();
+        kernelSink = trackPoints.back().position.x;
+    }) });
+
+    initRainParticles();
+    results.push_back({ "updateRainParticles", 64, timeKernel(64, [](int calls) {
+        for (int i = 0; i < calls; i++) updateRainParticles(SIMULATION_STEP_MS / 1000.0f);
+        kernelSink = rainParticles.empty() ? 0.0f : rainParticles[0].y;
+    }) });
+
+    // A fast drop spawns 30 particles per update; warm-up reaches the steady-state count. Only
+    // the first tower is spawned so the numbers stay comparable with single-tower runs.
+    attractions = AttractionRegistry();
+    towerParticles.clear();
+    RideAnimator& benchRide = *attractions.animators.find(
+        spawnDropTower(ATTRACTION_SPAWNS[0].x, ATTRACTION_SPAWNS[0].y, ATTRACTION_SPAWNS[0].z));
+    benchRide.dropping = true;
+    benchRide.speed = 25.0f;
+    benchRide.height = TOWER_HEIGHT * 0.5f;
+    results.push_back({ "updateTowerParticles", 64, timeKernel(64, [](int calls) {
+        for (int i = 0; i < calls; i++) updateEmitters(SIMULATION_STEP_MS / 1000.0f);
+        kernelSink = (float)towerParticles.size();
+    }) });
+    spawnAttractions();
+
+    // Steer towards the food so the snake grows and fireworks spawn; restart on a collision
+    resetSnakeForBenchmark();
+    results.push_back({ "snake_timer", 1024, timeKernel(1024, [](int calls) {
+        for (int i = 0; i < calls; i++) {
+            if (snake_game_over || snake_body.size() > 200) resetSnakeForBenchmark();
+            const Position& head = snake_body.front();
+            if (snake_food.x > head.x && snake_dir != LEFT) snake_dir = RIGHT;
+            else if (snake_food.x < head.x && snake_dir != RIGHT) snake_dir = LEFT;
+            else if (snake_food.y > head.y && snake_dir != DOWN) snake_dir = UP;
+            else if (snake_food.y < head.y && snake_dir != UP) snake_dir = DOWN;
+            snake_timer(0);
+            if (snake_fireworks.size() > 1000) snake_fireworks.clear();
+        }
+        kernelSink = (float)snake_body.size();
+    }) });
+    currentGameState = MAIN_SCENE;
 
-    initTowerLights();
-    initSecondTowerLights();
-    srand(time(NULL));
+    results.push_back({ "HSVtoRGB", 4096, timeKernel(4096, [](int calls) {
+        float sum = 0.0f;
+        for (int i = 0; i < calls; i++) {
+            float r, g, b;
+            HSVtoRGB((i % 360) / 360.0f, 0.8f, 1.0f, r, g, b);  // Hue in [0, 1), as the scene passes it
+            sum += r + g + b;
+        }
+        kernelSink = sum;
+    }) });
+
+    // crossProduct, normalize, dotProduct, vectorLength, add/subtract/scaleVector together
+    results.push_back({ "vectorHelpers", 4096, timeKernel(4096, [](int calls) {
+        Vec3 a(0.3f, 1.0f, -0.2f), b(-0.7f, 0.1f, 0.5f);
+        float sum = 0.0f;
+        for (int i = 0; i < calls; i++) {
+            Vec3 c = crossProduct(a, b);
+            normalize(c);
+            sum += dotProduct(c, a) + vectorLength(b);
+            a = addVectors(scaleVector(c, 0.5f), subtractVectors(a, b));
+            normalize(a);
+        }
+        kernelSink = sum;
+    }) });
+
+    std::ofstream file;
+    if (!outputPath.empty()) {
+        file.open(outputPath.c_str(), std::ios::out | std::ios::trunc);
+        if (!file) std::cerr << "Unable to write " << outputPath << "; printing instead" << std::endl;
+    }
+    std::ostream& out = file.is_open() ? (std::ostream&)file : std::cout;
+    out << std::fixed << std::setprecision(3);
+    out << "{\"unit\":\"ns/call\",\"warmup_samples\":" << KERNEL_WARMUP_SAMPLES << ",\"samples\":" << KERNEL_SAMPLES
+        << ",\"track_points\":" << trackPoints.size() << ",\n\"kernels\":{";
+    for (size_t i = 0; i < results.size(); i++) {
+        out << (i > 0 ? ",\n" : "\n") << "\"" << results[i].name << "\":{\"calls_per_sample\":" << results[i].calls << ",\"ns\":";
+        writeTimingJson(out, results[i].samples);
+        out << "}";
+    }
+    out << "}}\n";
+    out.flush();
+    return 0;
 }
 
 int main(int argc, char** argv) {
-    glutInit(&argc, argv); // Initialize GLUT
+    // Microbenchmarks run without a window
+    if (argc > 1 && std::string(argv[1]) == "--bench-spline") {
+        return runSplineMicrobenchmark();
+    }
+    if (argc > 1 && std::string(argv[1]) == "--bench-kernels") {
+        return runKernelBenchmarks(argc > 2 ? argv[2] : "");
+    }
+    if (argc > 2 && std::string(argv[1]) == "--pack-assets") {
+        std::vector<std::string> paths;
+        for (const TextureLoadRequest& request : getTextureManifest()) {
+            paths.push_back(request.path);
+        }
+        return writeAssetPack(paths, argv[2]);
+    }
+
+    // The benchmark and golden frames have no window, and glutInit fails without a display
+    bool benchmark = false;
+    bool golden = false;
+    std::string recordPath, replayPath;
+    bool seeded = false;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--bench") benchmark = true;
+        if (arg == "--golden" || arg == "--golden-compare") golden = true;
+    }
+    if (!benchmark && !golden) glutInit(&argc, argv); // Initialize GLUT
+
+    // Parse the remaining command line options
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--track" && i + 1 < argc) {
+            coasterLayoutPath = argv[++i];     // Coaster layout file to load
+        }
+        else if (arg == "--assets" && i + 1 < argc) {
+            assetPackPath = argv[++i];         // Asset pack written by --pack-assets
+        }
+        else if (arg == "--bench") {
+            if (i + 1 < argc && atoi(argv[i + 1]) > 0) benchmarkFrames = atoi(argv[++i]);  // Headless flythrough
+        }
+        else if (arg == "--bench-json" && i + 1 < argc) {
+            benchmarkJsonPath = argv[++i];     // Benchmark results file
+        }
+        else if (arg == "--golden" && i + 1 < argc) {
+            goldenOutputDir = argv[++i];       // Directory for golden frame dumps and hashes
+        }
+        else if (arg == "--golden-compare" && i + 1 < argc) {
+            goldenBaselineDir = argv[++i];     // Golden frames to compare against
+        }
+        else if (arg == "--golden-tolerance" && i + 1 < argc) {
+            goldenToleranceBits = std::max(0, atoi(argv[++i]));  // Perceptual hash bits allowed to differ
+        }
+        else if (arg == "--seed" && i + 1 < argc) {
+            randomSeed = (unsigned int)strtoul(argv[++i], nullptr, 10);  // Fixed random sequence
+            seeded = true;
+        }
+        else if (arg == "--record" && i + 1 < argc) {
+            recordPath = argv[++i];            // Input log to write
+        }
+        else if (arg == "--replay" && i + 1 < argc) {
+            replayPath = argv[++i];            // Input log to play back
+        }
+        else if (arg == "--trace" && i + 1 < argc) {
+            tracePath = argv[++i];             // Chrome trace written at exit and on F4
+            enableTracing();
+        }
+        else if (arg == "--hitch-ms" && i + 1 < argc) {
+            hitchThresholdMs = std::max(1.0f, (float)atof(argv[++i]));  // Present interval counted as a hitch
+        }
+        else if (arg == "--state" && i + 1 < argc) {
+            worldStatePath = argv[++i];        // World state to start from; also the F5/F9 file
+            loadStateAtStartup = true;
+        }
+        else if (arg == "--extra-towers" && i + 1 < argc) {
+            extraDropTowers = std::max(0, atoi(argv[++i]));  // More drop towers in a ring, for stress tests
+        }
+        else if (arg == "--texture-budget" && i + 1 < argc) {
+            textureMemoryCapMB = std::max(1.0f, (float)atof(argv[++i]));  // Evict distant zones above this
+        }
+        else if (arg == "--anisotropy" && i + 1 < argc) {
+            textureAnisotropy = std::max(1.0f, (float)atof(argv[++i]));  // Used when the GPU supports it
+        }
+        else if (arg == "--track-tolerance" && i + 1 < argc) {
+            trackTessellationTolerance = std::max(0.001f, (float)atof(argv[++i]));  // Larger is coarser and faster
+        }
+        else {
+            std::cerr << "Unknown option: " << arg << std::endl;
+        }
+    }
+    // After --seed, so a recording stores the seed in use and a replay overrides it
+    if (benchmark && !seeded) randomSeed = 1;  // Benchmarks are repeatable by default
+    if (golden) randomSeed = 1;                // Golden frames are only comparable with the same seed
+#ifdef COUNT_GL_CALLS
+    atexit(reportGLCallCounts);
+#endif
+    // A log does not carry the snapshot it started from, so its replay would diverge
+    if (loadStateAtStartup && !golden && (!replayPath.empty() || !recordPath.empty())) {
+        std::cerr << "--state cannot be combined with --record or --replay" << std::endl;
+        return 1;
+    }
+    if (!replayPath.empty() && !loadInputReplay(replayPath)) return 1;
+    if (replayPath.empty() && !recordPath.empty() && !startInputRecording(recordPath)) return 1;
+    if (golden) return runGoldenFrames();
+    if (benchmark) return runBenchmark();
 
     glutInitDisplayMode(GLUT_RGBA | GLUT_DOUBLE | GLUT_DEPTH); // Set display mode with RGBA, double buffering, and depth buffer
     glutInitWindowSize(screenWidth, screenHeight); // Set initial window size
@@ -7239,6 +12000,7 @@ int main(int argc, char** argv) {
 
     initGL();             // Initialize OpenGL settings
     initClouds();        // Initialize clouds in the scene
+    if (loadStateAtStartup) loadWorldState(worldStatePath);  // Start from a saved scenario
 
     // Register callback functions
     glutDisplayFunc(displayCB);                // Register display callback